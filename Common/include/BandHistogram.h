@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_BANDHISTOGRAM_H_
+#define COMMON_INCLUDE_BANDHISTOGRAM_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Histogram of the integer values [0, nBins) of a band, e.g. of a flag mask.
+ * Partial histograms computed by several threads are merged into it.
+ * Values outside of the bins are only counted in the total.
+ */
+class BandHistogram{
+public:
+	typedef std::shared_ptr<BandHistogram>	Pointer;
+
+	explicit BandHistogram(const size_t &nBins) : m_Counts(nBins, 0), m_TotalCount(0) {}
+
+	size_t GetNumberOfBins() const { return m_Counts.size(); }
+
+	/**
+	 * @brief Reset all counts to zero
+	 */
+	void Reset(){
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		std::fill(m_Counts.begin(), m_Counts.end(), 0);
+		m_TotalCount = 0;
+	}
+
+	/**
+	 * @brief Merge a partial histogram
+	 * @param counts Counts of the bins, with the same number of bins as this histogram
+	 * @param totalCount Number of values counted, including the ones outside of the bins
+	 */
+	void Merge(const std::vector<uint64_t> &counts, const uint64_t &totalCount){
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for(size_t bin = 0; bin < m_Counts.size() && bin < counts.size(); bin++){
+			m_Counts[bin] += counts[bin];
+		}
+		m_TotalCount += totalCount;
+	}
+
+	/**
+	 * @brief Number of values equal to the given bin
+	 */
+	uint64_t GetCount(const size_t &bin) const { return bin < m_Counts.size() ? m_Counts[bin] : 0; }
+
+	/**
+	 * @brief Number of all values counted
+	 */
+	uint64_t GetTotalCount() const { return m_TotalCount; }
+
+	/**
+	 * @brief Share of the values equal to the given bin in percent
+	 */
+	double GetPercent(const size_t &bin) const {
+		return m_TotalCount > 0 ? 100.0 * GetCount(bin) / m_TotalCount : 0.0;
+	}
+
+private:
+	std::vector<uint64_t> m_Counts;
+	uint64_t m_TotalCount;
+	std::mutex m_Mutex;
+};
+
+} // namespace ts
+
+#endif /* COMMON_INCLUDE_BANDHISTOGRAM_H_ */
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_COGEOTIFFWRITER_H_
+#define COMMON_INCLUDE_COGEOTIFFWRITER_H_
+
+#include "gdal.h"
+#include "IOProfiles.h"
+#include <string>
+#include <vector>
+
+class GDALDataset;
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief GDAL type of a pixel value type
+ */
+template <typename TValue> inline GDALDataType GetGDALDataType() { return GDT_Unknown; }
+template <> inline GDALDataType GetGDALDataType<unsigned char>() { return GDT_Byte; }
+template <> inline GDALDataType GetGDALDataType<unsigned short>() { return GDT_UInt16; }
+template <> inline GDALDataType GetGDALDataType<short>() { return GDT_Int16; }
+template <> inline GDALDataType GetGDALDataType<unsigned int>() { return GDT_UInt32; }
+template <> inline GDALDataType GetGDALDataType<int>() { return GDT_Int32; }
+template <> inline GDALDataType GetGDALDataType<float>() { return GDT_Float32; }
+template <> inline GDALDataType GetGDALDataType<double>() { return GDT_Float64; }
+
+/**
+ * @brief Reduces full-width rows by a factor of two in both directions, as they arrive.
+ * Each level keeps the sum and the count of the valid full resolution pixels it covers,
+ * so that the averages of all levels are computed from the full resolution pixels.
+ */
+class OverviewLevel{
+public:
+	/**
+	 * @brief Create the level from the width of the level below
+	 * @param inputWidth Width of the level below, i.e. the full resolution or the previous overview
+	 * @param bAverage True to average the valid pixels, false to take the upper left pixel of each 2x2 block
+	 */
+	OverviewLevel(const size_t &inputWidth, const bool &bAverage);
+
+	/**
+	 * @brief Width of the rows returned by this level
+	 */
+	size_t GetWidth() const { return m_Sum.size(); }
+
+	/**
+	 * @brief Add a row of the level below
+	 * @return True, if a row of this level is complete and can be retrieved by GetSum() and GetCount()
+	 */
+	bool AddRow(const double *sum, const double *count);
+
+	/**
+	 * @brief Complete the last row if the level below has an odd number of rows
+	 * @return True, if a row of this level is complete
+	 */
+	bool Flush();
+
+	const double *GetSum() const { return m_Sum.data(); }
+	const double *GetCount() const { return m_Count.data(); }
+
+private:
+	bool m_bAverage;
+	size_t m_InputWidth;
+	size_t m_nPendingRows;
+	std::vector<double> m_Sum;
+	std::vector<double> m_Count;
+};
+
+/**
+ * @brief Writes a single band Cloud-Optimized GeoTiff from full-width strips using the GDAL API.
+ * The strips are written to a tiled intermediate file on disk, while the overviews are
+ * computed from the same strips as they arrive and written to the intermediate file as well.
+ * On Close(), the intermediate file is copied into the final compressed file with the overviews placed
+ * in front of the full resolution data, and removed. The copy is needed, as GDAL can only place the
+ * overviews in front of the data when creating a file from a complete source.
+ * @note Doc on the layout can be found under https://trac.osgeo.org/gdal/wiki/CloudOptimizedGeoTIFF
+ */
+class CoGeoTiffWriter{
+public:
+	/**
+	 * @brief Config of the Cloud-Optimized GeoTiff
+	 */
+	struct Options{
+		Options();
+		// Directory of the intermediate file. If empty, it is written next to the final file.
+		std::string tempDir;
+		// Number of overviews, each reducing the previous level by a factor of two
+		size_t nLevels;
+		std::string compress;
+		// "average" ignores no-data pixels, "nearest" takes the upper left pixel of each block
+		std::string resamplingMethod;
+		bool bHasNoData;
+		double noDataValue;
+		// Further GeoTiff creation options of the final file, e.g. NUM_THREADS. They override the ones above.
+		CreationOptionsType creationOptions;
+	};
+
+	/**
+	 * @brief Constructor
+	 * @param filename The final output filename
+	 * @param options The layout and resampling config
+	 */
+	CoGeoTiffWriter(const std::string &filename, const Options &options);
+
+	virtual ~CoGeoTiffWriter();
+
+	/**
+	 * @brief Set the number of final copies that may run at the same time in the process
+	 * @param nCopies The maximum number of copies, 2 by default
+	 */
+	static void SetMaxConcurrentCopies(const size_t &nCopies);
+
+	/**
+	 * @brief Create the intermediate file
+	 * @param width Width of the full resolution image
+	 * @param height Height of the full resolution image
+	 * @param type GDAL pixel type of the output
+	 * @param geoTransform The GDAL geotransform of the upper left corner
+	 * @param projection The projection as WKT. Can be empty.
+	 */
+	void Create(const size_t &width, const size_t &height, const GDALDataType &type,
+			const double geoTransform[6], const std::string &projection);
+
+	/**
+	 * @brief Write the next full-width strip. Strips have to be written from top to bottom.
+	 * @param firstRow Index of the first row of the strip
+	 * @param nRows Number of rows of the strip
+	 * @param buffer Row-major values of the strip
+	 */
+	void WriteRows(const size_t &firstRow, const size_t &nRows, const double *buffer);
+
+	/**
+	 * @brief Complete the overviews and create the final file
+	 */
+	void Close();
+
+	const std::string &GetFileName() const { return m_FileName; }
+
+private:
+	CoGeoTiffWriter(const CoGeoTiffWriter &); //purposely not implemented
+	void operator=(const CoGeoTiffWriter &); //purposely not implemented
+
+	/**
+	 * @brief Push a row of the given level into the next level and write all rows completed by it
+	 */
+	void PropagateRow(const size_t &level, const double *sum, const double *count);
+
+	/**
+	 * @brief Write a completed row of an overview
+	 */
+	void WriteOverviewRow(const size_t &level);
+
+	/**
+	 * @brief Remove the intermediate file
+	 */
+	void Discard();
+
+	std::string m_FileName;
+	std::string m_TempFileName;
+	Options m_Options;
+	GDALDataset *m_pDataset;
+	size_t m_Width;
+	size_t m_Height;
+	size_t m_NextRow;
+	std::vector<OverviewLevel> m_Levels;
+	std::vector<size_t> m_LevelRows;
+	std::vector<double> m_RowBuffer;
+	std::vector<double> m_OnesBuffer;
+};
+
+} // namespace ts
+
+#endif /* COMMON_INCLUDE_COGEOTIFFWRITER_H_ */
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_FOOTPRINTFUNCTORIMAGEFILTER_H_
+#define COMMON_INCLUDE_FOOTPRINTFUNCTORIMAGEFILTER_H_
+
+#include "itkUnaryFunctorImageFilter.h"
+#include "itkBinaryFunctorImageFilter.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "FootprintRestrictionFilter.h"
+#include "ValidSpanIterator.h"
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief UnaryFunctorImageFilter evaluating the functor only on the valid spans of a footprint.
+ * The input is only requested within the bounding box of the spans, all other output pixels
+ * are filled with the given no-data values. Without footprint it behaves like its superclass.
+ */
+template <class TInputImage, class TOutputImage, class TFunction>
+class FootprintUnaryFunctorImageFilter : public itk::UnaryFunctorImageFilter<TInputImage, TOutputImage, TFunction>
+{
+public:
+	typedef FootprintUnaryFunctorImageFilter										Self;
+	typedef itk::UnaryFunctorImageFilter<TInputImage, TOutputImage, TFunction>	Superclass;
+	typedef itk::SmartPointer<Self>												Pointer;
+	typedef itk::SmartPointer<const Self>										ConstPointer;
+
+	typedef typename TOutputImage::PixelType		OutputPixelType;
+	typedef typename TOutputImage::RegionType		OutputImageRegionType;
+	typedef typename TInputImage::RegionType		InputImageRegionType;
+
+	itkNewMacro(Self);
+	itkTypeMacro(FootprintUnaryFunctorImageFilter, UnaryFunctorImageFilter);
+
+	/**
+	 * @brief Set the footprint of the product. A null footprint disables the restriction
+	 */
+	void SetFootprint(const ValidFootprint::ConstPointer &footprint){
+		m_Restriction.SetFootprint(footprint);
+		this->Modified();
+	}
+
+	/**
+	 * @brief Set the same no-data value for all components
+	 */
+	void SetOutsideValue(const double &value){
+		m_Restriction.SetOutsideValue(value);
+		this->Modified();
+	}
+
+	/**
+	 * @brief Set one no-data value per component. The last value is repeated for the remaining components
+	 */
+	void SetOutsideValues(const std::vector<double> &values){
+		m_Restriction.SetOutsideValues(values);
+		this->Modified();
+	}
+
+protected:
+	FootprintUnaryFunctorImageFilter() {}
+	virtual ~FootprintUnaryFunctorImageFilter() {}
+
+	virtual void GenerateOutputInformation(){
+		Superclass::GenerateOutputInformation();
+		m_Restriction.UpdateSpans(this->GetOutput());
+	}
+
+	virtual void GenerateInputRequestedRegion(){
+		Superclass::GenerateInputRequestedRegion();
+		TInputImage *input = const_cast<TInputImage *>(this->GetInput());
+		if(!input){
+			return;
+		}
+		InputImageRegionType requested = input->GetRequestedRegion();
+		m_Restriction.CropRequestedRegion(requested);
+		input->SetRequestedRegion(requested);
+	}
+
+	virtual void ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType itkNotUsed(threadId)){
+		TOutputImage *output = this->GetOutput();
+		const TInputImage *input = this->GetInput();
+		const OutputPixelType outsideValue = m_Restriction.GetOutsideValue(output->GetNumberOfComponentsPerPixel());
+
+		for(ValidSpanIterator seg(m_Restriction.GetSpans(), outputRegionForThread); !seg.IsAtEnd(); ++seg){
+			if(!seg.IsValid()){
+				FootprintRestriction<TOutputImage>::Fill(output, seg.GetRegion(), outsideValue);
+				continue;
+			}
+			itk::ImageRegionConstIterator<TInputImage> inIt(input, seg.GetRegion());
+			itk::ImageRegionIterator<TOutputImage> outIt(output, seg.GetRegion());
+			for(inIt.GoToBegin(), outIt.GoToBegin(); !inIt.IsAtEnd(); ++inIt, ++outIt){
+				outIt.Set(this->GetFunctor()(inIt.Get()));
+			}
+		}
+	}
+
+private:
+	FootprintUnaryFunctorImageFilter(const Self &) = delete;
+	void operator=(const Self &) = delete;
+
+	FootprintRestriction<TOutputImage> m_Restriction;
+};
+
+/**
+ * @brief BinaryFunctorImageFilter evaluating the functor only on the valid spans of a footprint.
+ * Both inputs have to be images on the same grid as the output.
+ * @see FootprintUnaryFunctorImageFilter
+ */
+template <class TInputImage1, class TInputImage2, class TOutputImage, class TFunction>
+class FootprintBinaryFunctorImageFilter : public itk::BinaryFunctorImageFilter<TInputImage1, TInputImage2, TOutputImage, TFunction>
+{
+public:
+	typedef FootprintBinaryFunctorImageFilter														Self;
+	typedef itk::BinaryFunctorImageFilter<TInputImage1, TInputImage2, TOutputImage, TFunction>	Superclass;
+	typedef itk::SmartPointer<Self>																Pointer;
+	typedef itk::SmartPointer<const Self>														ConstPointer;
+
+	typedef typename TOutputImage::PixelType		OutputPixelType;
+	typedef typename TOutputImage::RegionType		OutputImageRegionType;
+
+	itkNewMacro(Self);
+	itkTypeMacro(FootprintBinaryFunctorImageFilter, BinaryFunctorImageFilter);
+
+	/**
+	 * @brief Set the footprint of the product. A null footprint disables the restriction
+	 */
+	void SetFootprint(const ValidFootprint::ConstPointer &footprint){
+		m_Restriction.SetFootprint(footprint);
+		this->Modified();
+	}
+
+	/**
+	 * @brief Set the same no-data value for all components
+	 */
+	void SetOutsideValue(const double &value){
+		m_Restriction.SetOutsideValue(value);
+		this->Modified();
+	}
+
+	/**
+	 * @brief Set one no-data value per component. The last value is repeated for the remaining components
+	 */
+	void SetOutsideValues(const std::vector<double> &values){
+		m_Restriction.SetOutsideValues(values);
+		this->Modified();
+	}
+
+protected:
+	FootprintBinaryFunctorImageFilter() {}
+	virtual ~FootprintBinaryFunctorImageFilter() {}
+
+	virtual void GenerateOutputInformation(){
+		Superclass::GenerateOutputInformation();
+		m_Restriction.UpdateSpans(this->GetOutput());
+	}
+
+	virtual void GenerateInputRequestedRegion(){
+		Superclass::GenerateInputRequestedRegion();
+		CropInputRequestedRegion(const_cast<TInputImage1 *>(GetImageInput<TInputImage1>(0)));
+		CropInputRequestedRegion(const_cast<TInputImage2 *>(GetImageInput<TInputImage2>(1)));
+	}
+
+	virtual void ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType itkNotUsed(threadId)){
+		TOutputImage *output = this->GetOutput();
+		const TInputImage1 *input1 = GetImageInput<TInputImage1>(0);
+		const TInputImage2 *input2 = GetImageInput<TInputImage2>(1);
+		if(!input1 || !input2){
+			itkExceptionMacro("Both inputs have to be images");
+		}
+		const OutputPixelType outsideValue = m_Restriction.GetOutsideValue(output->GetNumberOfComponentsPerPixel());
+
+		for(ValidSpanIterator seg(m_Restriction.GetSpans(), outputRegionForThread); !seg.IsAtEnd(); ++seg){
+			if(!seg.IsValid()){
+				FootprintRestriction<TOutputImage>::Fill(output, seg.GetRegion(), outsideValue);
+				continue;
+			}
+			itk::ImageRegionConstIterator<TInputImage1> in1It(input1, seg.GetRegion());
+			itk::ImageRegionConstIterator<TInputImage2> in2It(input2, seg.GetRegion());
+			itk::ImageRegionIterator<TOutputImage> outIt(output, seg.GetRegion());
+			for(in1It.GoToBegin(), in2It.GoToBegin(), outIt.GoToBegin(); !outIt.IsAtEnd(); ++in1It, ++in2It, ++outIt){
+				outIt.Set(this->GetFunctor()(in1It.Get(), in2It.Get()));
+			}
+		}
+	}
+
+private:
+	FootprintBinaryFunctorImageFilter(const Self &) = delete;
+	void operator=(const Self &) = delete;
+
+	template <class TImage>
+	const TImage *GetImageInput(const unsigned int &idx) const {
+		return dynamic_cast<const TImage *>(this->itk::ProcessObject::GetInput(idx));
+	}
+
+	template <class TImage>
+	void CropInputRequestedRegion(TImage *input) {
+		if(!input){
+			return;
+		}
+		typename TImage::RegionType requested = input->GetRequestedRegion();
+		m_Restriction.CropRequestedRegion(requested);
+		input->SetRequestedRegion(requested);
+	}
+
+	FootprintRestriction<TOutputImage> m_Restriction;
+};
+
+} //namespace ts
+
+#endif /* COMMON_INCLUDE_FOOTPRINTFUNCTORIMAGEFILTER_H_ */
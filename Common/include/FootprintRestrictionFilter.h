@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_FOOTPRINTRESTRICTIONFILTER_H_
+#define COMMON_INCLUDE_FOOTPRINTRESTRICTIONFILTER_H_
+
+#include "itkImageToImageFilter.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkNumericTraits.h"
+#include "itkDefaultConvertPixelTraits.h"
+#include "ValidFootprint.h"
+#include "ValidSpanIterator.h"
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Footprint handling shared by the filters writing images of type TImage.
+ * Holds the footprint, its spans on the output grid and the no-data values to use outside of them.
+ */
+template <class TImage>
+class FootprintRestriction
+{
+public:
+	typedef typename TImage::PixelType					PixelType;
+	typedef typename TImage::RegionType					RegionType;
+	typedef itk::DefaultConvertPixelTraits<PixelType>	PixelTraits;
+	typedef typename PixelTraits::ComponentType			ComponentType;
+
+	FootprintRestriction() : m_OutsideValues({0.0}) {}
+
+	/**
+	 * @brief Set the footprint of the product. A null footprint disables the restriction
+	 */
+	void SetFootprint(const ValidFootprint::ConstPointer &footprint) { m_Footprint = footprint; }
+
+	/**
+	 * @brief Set the same no-data value for all components
+	 */
+	void SetOutsideValue(const double &value) { m_OutsideValues = {value}; }
+
+	/**
+	 * @brief Set one no-data value per component. The last value is repeated for the remaining components
+	 */
+	void SetOutsideValues(const std::vector<double> &values) { m_OutsideValues = values; }
+
+	/**
+	 * @brief Compute the spans of the footprint on the grid of the output. To be called once the output information is known
+	 */
+	void UpdateSpans(const TImage *output) {
+		m_Spans.reset();
+		if(m_Footprint){
+			m_Spans = m_Footprint->GetValidSpans(output);
+		}
+	}
+
+	/**
+	 * @brief The spans on the grid of the output, null if there is no footprint
+	 */
+	const ValidSpans *GetSpans() const { return m_Spans.get(); }
+
+	/**
+	 * @brief Crop a region requested from an input to the bounding box of the spans
+	 */
+	void CropRequestedRegion(RegionType &requested) const {
+		if(!m_Spans){
+			return;
+		}
+		const RegionType &box = m_Spans->GetBoundingRegion();
+		if(!requested.Crop(box)){
+			// Nothing to read: keep the upstream pipeline busy for a single pixel only
+			if(box.GetNumberOfPixels() > 0){
+				requested.SetIndex(box.GetIndex());
+			}
+			requested.GetModifiableSize().Fill(1);
+		}
+	}
+
+	/**
+	 * @brief Build the no-data pixel for the given number of components
+	 */
+	PixelType GetOutsideValue(const unsigned int &nComponents) const {
+		PixelType pix;
+		itk::NumericTraits<PixelType>::SetLength(pix, nComponents);
+		for(unsigned int i = 0; i < nComponents; i++){
+			const double value = m_OutsideValues[std::min<size_t>(i, m_OutsideValues.size() - 1)];
+			PixelTraits::SetNthComponent(i, pix, static_cast<ComponentType>(value));
+		}
+		return pix;
+	}
+
+	/**
+	 * @brief Fill a region of an image with the given value
+	 */
+	static void Fill(TImage *image, const RegionType &region, const PixelType &value) {
+		itk::ImageRegionIterator<TImage> it(image, region);
+		for(it.GoToBegin(); !it.IsAtEnd(); ++it){
+			it.Set(value);
+		}
+	}
+
+private:
+	ValidFootprint::ConstPointer m_Footprint;
+	ValidSpans::ConstPointer m_Spans;
+	std::vector<double> m_OutsideValues;
+};
+
+/**
+ * @brief Restricts the processing of an upstream pipeline to the valid footprint of a product.
+ * Only the part of each requested region that intersects the bounding box of the footprint is requested
+ * from the input. Within it, only the valid spans are copied, the rest of the output is filled with the given no-data values.
+ * Without footprint the filter passes the regions through unchanged.
+ */
+template <class TImage>
+class FootprintRestrictionFilter : public itk::ImageToImageFilter<TImage, TImage>
+{
+public:
+	typedef FootprintRestrictionFilter					Self;
+	typedef itk::ImageToImageFilter<TImage, TImage>		Superclass;
+	typedef itk::SmartPointer<Self>						Pointer;
+	typedef itk::SmartPointer<const Self>				ConstPointer;
+
+	typedef typename TImage::PixelType					PixelType;
+	typedef typename TImage::RegionType					RegionType;
+
+	itkNewMacro(Self);
+	itkTypeMacro(FootprintRestrictionFilter, ImageToImageFilter);
+
+	/**
+	 * @brief Set the footprint of the product. A null footprint disables the restriction
+	 */
+	void SetFootprint(const ValidFootprint::ConstPointer &footprint){
+		m_Restriction.SetFootprint(footprint);
+		this->Modified();
+	}
+
+	/**
+	 * @brief Set the same no-data value for all components
+	 */
+	void SetOutsideValue(const double &value){
+		m_Restriction.SetOutsideValue(value);
+		this->Modified();
+	}
+
+	/**
+	 * @brief Set one no-data value per component. The last value is repeated for the remaining components
+	 */
+	void SetOutsideValues(const std::vector<double> &values){
+		m_Restriction.SetOutsideValues(values);
+		this->Modified();
+	}
+
+protected:
+	FootprintRestrictionFilter() {}
+	virtual ~FootprintRestrictionFilter() {}
+
+	virtual void GenerateOutputInformation(){
+		Superclass::GenerateOutputInformation();
+		m_Restriction.UpdateSpans(this->GetOutput());
+	}
+
+	virtual void GenerateInputRequestedRegion(){
+		Superclass::GenerateInputRequestedRegion();
+		TImage *input = const_cast<TImage *>(this->GetInput());
+		if(!input){
+			return;
+		}
+		RegionType requested = input->GetRequestedRegion();
+		m_Restriction.CropRequestedRegion(requested);
+		input->SetRequestedRegion(requested);
+	}
+
+	virtual void ThreadedGenerateData(const RegionType &outputRegionForThread, itk::ThreadIdType itkNotUsed(threadId)){
+		TImage *output = this->GetOutput();
+		const TImage *input = this->GetInput();
+		const PixelType outsideValue = m_Restriction.GetOutsideValue(output->GetNumberOfComponentsPerPixel());
+
+		for(ValidSpanIterator seg(m_Restriction.GetSpans(), outputRegionForThread); !seg.IsAtEnd(); ++seg){
+			if(!seg.IsValid()){
+				FootprintRestriction<TImage>::Fill(output, seg.GetRegion(), outsideValue);
+				continue;
+			}
+			itk::ImageRegionConstIterator<TImage> inIt(input, seg.GetRegion());
+			itk::ImageRegionIterator<TImage> outIt(output, seg.GetRegion());
+			for(inIt.GoToBegin(), outIt.GoToBegin(); !inIt.IsAtEnd(); ++inIt, ++outIt){
+				outIt.Set(inIt.Get());
+			}
+		}
+	}
+
+private:
+	FootprintRestrictionFilter(const Self &) = delete;
+	void operator=(const Self &) = delete;
+
+	FootprintRestriction<TImage> m_Restriction;
+};
+
+} //namespace ts
+
+#endif /* COMMON_INCLUDE_FOOTPRINTRESTRICTIONFILTER_H_ */
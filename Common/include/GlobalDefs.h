@@ -140,6 +140,32 @@ std::string getBasename(const std::string &path);
  */
 std::string getEnvVar( std::string const & key );
 
+/**
+ * @brief Get the number of days between two dates
+ * @param date1 The first date in the format YYYYMMDD
+ * @param date2 The second date in the format YYYYMMDD
+ * @return The absolute number of days between both dates
+ */
+int getDaysBetween(const std::string &date1, const std::string &date2);
+
+/**
+ * @brief Get the weight of an acquisition depending on its distance to the synthesis date
+ * @param nDays The number of days between the acquisition and the synthesis date
+ * @param nHalfSynthesis The half synthesis period in days. If not positive, the date is not weighted
+ * @param fWeightOnDateMin The minimum weight at the edge of the synthesis period
+ * @return The weight on date
+ */
+float computeWeightOnDate(int nDays, int nHalfSynthesis, float fWeightOnDateMin);
+
+/**
+ * @brief Get the factor by which the weight of an acquisition is scaled in a synthesis
+ * @param nDays The number of days between the acquisition and the synthesis date
+ * @param nHalfSynthesis The half synthesis period in days. If not positive, the date is not weighted
+ * @param fWeightOnDateMin The minimum weight at the edge of the synthesis period
+ * @return The weight on date within the synthesis period, 0 beyond it
+ */
+float computeSynthesisWeight(int nDays, int nHalfSynthesis, float fWeightOnDateMin);
+
 }  // namespace ts
 
 #endif //GLOBALDEFS_H
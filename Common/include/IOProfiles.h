@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_IOPROFILES_H_
+#define COMMON_INCLUDE_IOPROFILES_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#define IO_PROFILE_DEFAULT						"default"
+#define IO_PROFILE_TEMP_FAST					"temp-fast"
+#define IO_PROFILE_ARCHIVE						"archive"
+#define IO_PROFILE_COG							"cog"
+#define IO_PROFILE_BLOCK_SIZE					512
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+typedef std::vector<std::pair<std::string, std::string> >	CreationOptionsType;
+
+/**
+ * @brief Get the names of all I/O profiles
+ * @note The profiles are:
+ * - default: GDAL defaults, only masks are DEFLATE-compressed
+ * - temp-fast: Tiled and uncompressed, for temporary files that are read once
+ * - archive: Tiled, DEFLATE-compressed with horizontal predictor on all cores
+ * - cog: Like archive, products are additionally written as Cloud-Optimized GeoTiff
+ */
+std::vector<std::string> GetIOProfileNames();
+
+/**
+ * @brief Check, if the given name is a known I/O profile
+ */
+bool IsIOProfile(const std::string &profile);
+
+/**
+ * @brief Get the GDAL GeoTiff creation options of a profile
+ * @param profile The name of the profile
+ * @param bIsMask True, if the raster is a mask
+ * @return The creation options as pairs of name and value
+ */
+CreationOptionsType GetIOProfileCreationOptions(const std::string &profile, const bool &bIsMask = false);
+
+/**
+ * @brief Get the creation options of a profile as OTB extended filename, to be appended to an output filename
+ * @param profile The name of the profile
+ * @param bIsMask True, if the raster is a mask
+ * @return The extended filename, e.g. "?&gdal:co:TILED=YES", or an empty string if there are no options
+ */
+std::string GetIOProfileExtendedFilename(const std::string &profile, const bool &bIsMask = false);
+
+}  // namespace ts
+
+#endif /* COMMON_INCLUDE_IOPROFILES_H_ */
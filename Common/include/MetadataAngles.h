@@ -38,13 +38,22 @@ typedef struct {
     double azimuth;
 } MeanAngles_Type;
 
+/**
+ * @brief Grid of angles, stored row by row in a single contiguous vector
+ */
 struct MetadataHelperAngleList
 {
+    MetadataHelperAngleList() : Rows(0), Cols(0) {}
+
+    double GetValue(const size_t &row, const size_t &col) const { return Values[row * Cols + col]; }
+
     std::string ColumnUnit;
     std::string ColumnStep;
     std::string RowUnit;
     std::string RowStep;
-    std::vector<std::vector<double> > Values;
+    size_t Rows;
+    size_t Cols;
+    std::vector<double> Values;
 };
 
 struct MetadataHelperAngles
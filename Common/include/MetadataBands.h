@@ -55,17 +55,17 @@ public:
 	/**
 	 * @return The path to the band-file
 	 */
-	std::string getPath(){return m_path;}
+	const std::string &getPath() const {return m_path;}
 
 	/**
 	 * @return The type of band
 	 */
-	std::string getType(){return m_type;}
+	const std::string &getType() const {return m_type;}
 
 	/**
 	 * @return The Resolution of the band
 	 */
-	size_t getResolution(){return m_res;}
+	size_t getResolution() const {return m_res;}
 
 private:
 	std::string m_path;
@@ -100,26 +100,26 @@ public:
 	/**
 	 * @return The bands of the resolution
 	 */
-	std::vector<Band> getBands(){ return m_bands;};
+	const std::vector<Band> &getBands() const { return m_bands;};
 
 	/**
 	 * @return The name of the group
 	 */
-	std::string getGroupName(){ return m_groupName; };
+	const std::string &getGroupName() const { return m_groupName; };
 
 	/**
 	 * @brief Return the index of a given band inside the Band vector
 	 * @param type The type to be searched for as string (e.g. "B1" or "B8A")
 	 * @return The index, if band is present or -1 if not
 	 */
-	int getBandIndexByType(const std::string &type);
+	int getBandIndexByType(const std::string &type) const;
 
 	/**
 	 * @brief Checks, if a given BandType is present
 	 * @param type The type to be searched for as string (e.g. "B1" or "B8A")
 	 * @return True, if the band was found in one of the resolutions, false if not
 	 */
-	bool doesBandTypeExist(const std::string &type);
+	bool doesBandTypeExist(const std::string &type) const;
 
 private:
 	std::vector<Band> m_bands;
@@ -147,13 +147,13 @@ public:
 	 * @brief Returns the number of Resolutions present in the vector
 	 * @return 0, if none are present, otherwise the vectors size()
 	 */
-	size_t getNumberOfResolutions();
+	size_t getNumberOfResolutions() const;
 
 	/**
 	 * @brief Get the combined number of bands in all resolutions
 	 * @return The total number of bands as size_t
 	 */
-	size_t getTotalNumberOfBands();
+	size_t getTotalNumberOfBands() const;
 
 	/**
 	 * @brief Get a resolution by index.
@@ -161,7 +161,7 @@ public:
 	 * @return The resolution stored inside the vector at the n-th position
 	 * @note IMPORTANT: The first resolution is always the main-one!
 	 */
-	productReturnType getNthResolutionFilenames(const size_t &n);
+	productReturnType getNthResolutionFilenames(const size_t &n) const;
 
 	/**
 	 * @brief Checks, if a given BandType is present
@@ -175,13 +175,13 @@ public:
 	 * @param type The type to be searched for as string (e.g. "B1" or "B8A")
 	 * @return The filename, if the band was found or an empty string if it wasn't
 	 */
-	std::string getSpecificBandTypeFilename(const std::string &type);
+	std::string getSpecificBandTypeFilename(const std::string &type) const;
 
 	/**
 	 * @brief Return the Resolution vector
 	 * @return The vector of resolutions
 	 */
-	std::vector<Resolution> getResolutionVector(){ return m_resolutions;}
+	const std::vector<Resolution> &getResolutionVector() const { return m_resolutions;}
 private:
 	/**
 	 * @brief The Resolution vector, storing all given resolutions.
@@ -28,6 +28,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 #include "otbImage.h"
 #include "MetadataAngles.h"
 #include "GlobalDefs.h"
@@ -38,21 +39,37 @@
  */
 namespace ts {
 
+/**
+ * @brief Parts of a metadata file, which can be loaded separately
+ * @note MTD_CONTENT_PRODUCT covers the platform, dates, file lists and quantification values
+ */
+typedef enum {MTD_CONTENT_PRODUCT=1, MTD_CONTENT_ANGLES=2, MTD_CONTENT_ALL=0x3} MetadataContentType;
+
 /**
  * @brief Abstract class to load a metadata-file
+ * @note Once loaded, a helper is only read. Instances obtained via the MetadataHelperFactory are shared
+ * between all callers of the process and are therefore only accessible as const.
  */
 class MetadataHelper
 {
 public:
+	typedef std::shared_ptr<const MetadataHelper> ConstPointer;
+
 	MetadataHelper();
 	virtual ~MetadataHelper();
 
 	/**
 	 * @brief Main Metadata-reader function. Loads the file and initialises the common variables.
 	 * @param file The path to the file
+	 * @param content Mask of MetadataContentType values to be loaded. Skipping MTD_CONTENT_ANGLES avoids decoding the angle grids.
 	 * @return True, if the reading suceeded, false if not.
 	 */
-	bool LoadMetadataFile(const std::string& file);
+	bool LoadMetadataFile(const std::string& file, const unsigned int &content = MTD_CONTENT_ALL);
+
+	/**
+	 * @return The mask of MetadataContentType values loaded
+	 */
+	unsigned int GetLoadedContent() const { return m_nLoadedContent; }
 
 	///////////////////////////
 	/// GENETAL FIELDS API ///
@@ -61,7 +78,12 @@ public:
 	/**
 	 * @return Return the main mission/platform name
 	 */
-	virtual std::string GetMissionName() { return m_Mission; }
+	virtual const std::string &GetMissionName() const { return m_Mission; }
+
+	/**
+	 * @return Return the geographical zone of the product, i.e. the tile for Sentinel-2 or the site for Venus
+	 */
+	virtual const std::string &GetGeographicalZone() const { return m_GeographicalZone; }
 
 	////////////////////////
 	/// MAIN RASTER API ///
@@ -70,12 +92,12 @@ public:
 	/**
 	 * @return Get the Filename vector corresponding to all SRE-image files
 	 */
-	virtual productReturnType GetImageFileNames() { return m_ImageFileName; }
+	virtual const productReturnType &GetImageFileNames() const { return m_ImageFileName; }
 
 	/**
 	 * @return Get the NODATA value as string
 	 */
-	virtual std::string GetNoDataValue() { return m_strNoDataValue; }
+	virtual const std::string &GetNoDataValue() const { return m_strNoDataValue; }
 
 	/**
 	 * @brief Return Filename by given string
@@ -84,17 +106,18 @@ public:
 	 * @return The filename containing a string. If multiple results are given, it returns the first element.
 	 * 		   If none are found, an empty string is returned
 	 */
-	virtual std::string getFileNameByString(const productReturnType &filenames, const std::string &toFind) = 0;
+	virtual std::string getFileNameByString(const productReturnType &filenames, const std::string &toFind) const = 0;
 
 	//////////////////
 	/// MASKS API ///
 	////////////////
 
-	virtual productReturnType GetCloudImageFileNames() { return m_CloudFileName; }
-	virtual productReturnType GetWaterImageFileNames() { return m_WaterFileName; }
-	virtual productReturnType GetSnowImageFileNames() { return m_SnowFileName; }
-	virtual productReturnType GetSaturationImageFileNames() { return m_SaturationFileName; }
-	virtual productReturnType GetAotImageFileNames() { return m_AotFileName; }
+	virtual const productReturnType &GetCloudImageFileNames() const { return m_CloudFileName; }
+	virtual const productReturnType &GetWaterImageFileNames() const { return m_WaterFileName; }
+	virtual const productReturnType &GetSnowImageFileNames() const { return m_SnowFileName; }
+	virtual const productReturnType &GetSaturationImageFileNames() const { return m_SaturationFileName; }
+	virtual const productReturnType &GetAotImageFileNames() const { return m_AotFileName; }
+	virtual const productReturnType &GetEdgeImageFileNames() const { return m_EdgeFileName; }
 
 	/////////////////
 	/// DATE API ///
@@ -103,17 +126,17 @@ public:
 	/**
 	 * @brief Returns the acquisition date as string in the format YYYY-MM-DDTHH:mm:ss.SSSZ
 	 */
-	virtual std::string GetAcquisitionDateLong() { return m_AcquisitionDate; }
+	virtual const std::string &GetAcquisitionDateLong() const { return m_AcquisitionDate; }
 
 	/**
 	 * @brief Returns the acquisition date as string in the format YYYYMMDD
 	 */
-	virtual std::string GetAcquisitionDate();
+	virtual std::string GetAcquisitionDate() const;
 
 	/**
 	 * @return Returns the Acquisition date as Date of Year
 	 */
-	virtual int GetAcquisitionDateAsDoy();
+	virtual int GetAcquisitionDateAsDoy() const;
 
 	////////////////
 	/// AOT API ///
@@ -122,37 +145,45 @@ public:
 	/**
 	 * @return Return the Reflectance Quantification field as double
 	 */
-	virtual double GetReflectanceQuantificationValue() {return m_ReflQuantifVal; }
+	virtual double GetReflectanceQuantificationValue() const {return m_ReflQuantifVal; }
 
 	/**
 	 * @return Return the AOT Quantification field as double
 	 */
-	virtual double GetAotQuantificationValue() { return m_fAotQuantificationValue; }
+	virtual double GetAotQuantificationValue() const { return m_fAotQuantificationValue; }
 
 	/**
 	 * @return Return the AOT NODATA field as double
 	 */
-	virtual double GetAotNoDataValue() { return m_fAotNoDataVal; }
+	virtual double GetAotNoDataValue() const { return m_fAotNoDataVal; }
 
 	///////////////////
 	/// ANGLES API ///
 	/////////////////
 
-	virtual bool HasGlobalMeanAngles() { return m_bHasGlobalMeanAngles; }
-	virtual bool HasBandMeanAngles() { return m_bHasBandMeanAngles; }
-	virtual MeanAngles_Type GetSolarMeanAngles() { return m_solarMeanAngles;}
-	virtual MeanAngles_Type GetSensorMeanAngles();
-	virtual double GetRelativeAzimuthAngle();
-	virtual MeanAngles_Type GetSensorMeanAngles(int nBand);
+	virtual bool HasGlobalMeanAngles() const { return m_bHasGlobalMeanAngles; }
+	virtual bool HasBandMeanAngles() const { return m_bHasBandMeanAngles; }
+	virtual MeanAngles_Type GetSolarMeanAngles() const { return m_solarMeanAngles;}
+	virtual MeanAngles_Type GetSensorMeanAngles() const;
+	virtual double GetRelativeAzimuthAngle() const;
+	virtual MeanAngles_Type GetSensorMeanAngles(int nBand) const;
+
+	/**
+	 * @brief Get the mean viewing angles of a band by its id
+	 * @param bandId The band id, e.g. B7
+	 * @param angles The angles of the band. Return by reference
+	 * @return True, if the product gives mean viewing angles for this band, false if not
+	 */
+	virtual bool GetSensorMeanAngles(const std::string &bandId, MeanAngles_Type &angles) const;
 
 	/**
 	 * @return True, if detailed viewing angles were found in the product and successfully read, false if not.
 	 */
-	virtual bool HasDetailedAngles() { return m_bHasDetailedAngles; }
+	virtual bool HasDetailedAngles() const { return m_bHasDetailedAngles; }
 
-	virtual int GetDetailedAnglesGridSize() { return m_detailedAnglesGridSize; }
-	virtual MetadataHelperAngles GetDetailedSolarAngles() { return m_detailedSolarAngles; }
-	virtual std::vector<MetadataHelperViewingAnglesGrid> GetDetailedViewingAngles() { return m_detailedViewingAngles; }
+	virtual int GetDetailedAnglesGridSize() const { return m_detailedAnglesGridSize; }
+	virtual const MetadataHelperAngles &GetDetailedSolarAngles() const { return m_detailedSolarAngles; }
+	virtual const std::vector<MetadataHelperViewingAnglesGrid> &GetDetailedViewingAngles() const { return m_detailedViewingAngles; }
 
 	////////////////////
 	/// PRODUCT API ///
@@ -161,7 +192,7 @@ public:
 	/**
 	 * @return Return the Metadata product level
 	 */
-	virtual std::string getProductLevel(){ return m_productLevel;}
+	virtual const std::string &getProductLevel() const { return m_productLevel;}
 
 	///////////////////////////
 	/// BANDS HANDLING API ///
@@ -171,20 +202,20 @@ public:
 	 * @brief Get the total number of resolutions for a platform.
 	 * @note In the case of Sentinel: 2, By default: 0
 	 */
-	virtual size_t getNumberOfResolutions() { return m_Resolutions.getNumberOfResolutions();}
+	virtual size_t getNumberOfResolutions() const { return m_Resolutions.getNumberOfResolutions();}
 
 	/**
 	 * @brief Get the combined number of bands in all resolutions
 	 * @return The total number of bands as size_t
 	 */
-	virtual size_t GetTotalBandsNo() { return m_Resolutions.getTotalNumberOfBands(); }
+	virtual size_t GetTotalBandsNo() const { return m_Resolutions.getTotalNumberOfBands(); }
 
 	/**
 	 * @brief Return the product resolutions
 	 * @return The MultiResolution struct
 	 * @note The values are specific to each platform and therefore hardcoded
 	 */
-	virtual MultiResolution getResolutions() { return m_Resolutions;};
+	virtual const MultiResolution &getResolutions() const { return m_Resolutions;};
 
 protected:
 	/**
@@ -204,9 +235,10 @@ protected:
 	 * @param fileName The path to a file
 	 * @return The filename with the dir name prepended
 	 */
-	std::string buildFullPath(const std::string& fileName);
+	std::string buildFullPath(const std::string& fileName) const;
 
 	std::string m_Mission;
+	std::string m_GeographicalZone;
 	std::string m_Instrument;
 	std::string m_productLevel;
 
@@ -215,6 +247,7 @@ protected:
 	productReturnType m_WaterFileName;
 	productReturnType m_SnowFileName;
 	productReturnType m_SaturationFileName;
+	productReturnType m_EdgeFileName;
 	productReturnType m_ImageFileName;
 
 	std::string m_AcquisitionDate;
@@ -228,6 +261,8 @@ protected:
 
 	MeanAngles_Type m_solarMeanAngles;
 	std::vector<MeanAngles_Type> m_sensorBandsMeanAngles;
+	// The band id of each mean viewing angle, empty if given per detector
+	std::vector<std::string> m_sensorBandsMeanAnglesIds;
 	bool m_bHasGlobalMeanAngles;
 	bool m_bHasBandMeanAngles;
 
@@ -236,6 +271,8 @@ protected:
 	MetadataHelperAngles m_detailedSolarAngles;
 	std::vector<MetadataHelperViewingAnglesGrid> m_detailedViewingAngles;
 
+	unsigned int m_nLoadedContent;
+
 	std::string m_inputMetadataFileName;
 	std::string m_DirName;
 	std::string m_basename;
@@ -32,6 +32,9 @@
 #include "MetadataHelper.h"
 #include <vector>
 #include <memory>
+#include <map>
+#include <mutex>
+#include <ctime>
 
 /**
  * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
@@ -40,6 +43,8 @@ namespace ts {
 
 /**
  * @brief Factory to load a metadata-helper
+ * @note The loaded helpers are cached for the whole process, keyed by the path and the modification time
+ * of the metadata file. The same file is thus only parsed once, even if requested by several filters or threads.
  */
 class MetadataHelperFactory : public itk::LightObject
 {
@@ -53,7 +58,24 @@ public:
 
     itkTypeMacro(MetadataHelperFactory, itk::LightObject)
 
-    std::unique_ptr<MetadataHelper> GetMetadataHelper(const std::string& metadataFileName);
+    /**
+     * @brief Returns the helper of the given metadata file, which is loaded at the first request
+     * @param metadataFileName The path to the metadata file
+     * @param content Mask of MetadataContentType values needed by the caller. A cached helper loaded with more content is returned as well.
+     * @return The shared helper. It is immutable, as it is shared with all other callers of the process.
+     */
+    MetadataHelper::ConstPointer GetMetadataHelper(const std::string& metadataFileName, const unsigned int &content = MTD_CONTENT_ALL);
+
+    /**
+     * @brief Release all the cached helpers
+     */
+    static void ClearCache();
+
+private:
+    typedef std::pair<std::time_t, MetadataHelper::ConstPointer> CacheEntryType;
+
+    static std::mutex s_CacheMutex;
+    static std::map<std::string, CacheEntryType> s_Cache;
 };
 }  // namespace ts
 
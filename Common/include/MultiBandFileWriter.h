@@ -0,0 +1,599 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_MULTIBANDFILEWRITER_H_
+#define COMMON_INCLUDE_MULTIBANDFILEWRITER_H_
+
+#include "itkProcessObject.h"
+#include "itkMultiThreader.h"
+#include "itkImageRegionConstIterator.h"
+#include "otbImageIOFactory.h"
+#include "otbGDALImageIO.h"
+#include "otbExtendedFilenameToWriterOptions.h"
+#include "otbRAMDrivenStripedStreamingManager.h"
+#include "otbNumberOfLinesStrippedStreamingManager.h"
+#include "otbMetaDataKey.h"
+#include "itkMetaDataObject.h"
+#include "CoGeoTiffWriter.h"
+#include "QuicklookBuilder.h"
+#include "BandHistogram.h"
+#include "StreamingAlignment.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Writes single bands of a multi-band image to separate files, reading the input only once.
+ * The input is streamed region by region. Each region is requested once from the upstream pipeline
+ * and then written to every output file, converted to the pixel type chosen for that file.
+ * Besides single bands, a decimated JPEG quicklook of several bands and band histograms can be built from the same pass.
+ * The output files of a region are written concurrently, using up to GetNumberOfThreads() threads.
+ * @note The filenames may contain extended filename options, e.g. "?&gdal:co:COMPRESS=DEFLATE"
+ */
+template <class TInputImage>
+class MultiBandFileWriter : public itk::ProcessObject
+{
+public:
+	typedef MultiBandFileWriter						Self;
+	typedef itk::ProcessObject						Superclass;
+	typedef itk::SmartPointer<Self>					Pointer;
+	typedef itk::SmartPointer<const Self>			ConstPointer;
+
+	typedef TInputImage								InputImageType;
+	typedef typename TInputImage::RegionType		RegionType;
+	typedef typename TInputImage::InternalPixelType	InputValueType;
+	typedef otb::StreamingManager<TInputImage>						StreamingManagerType;
+	typedef otb::RAMDrivenStripedStreamingManager<TInputImage>	RAMDrivenStreamingManagerType;
+	typedef otb::NumberOfLinesStrippedStreamingManager<TInputImage>	AlignedStreamingManagerType;
+
+	itkNewMacro(Self);
+	itkTypeMacro(MultiBandFileWriter, itk::ProcessObject);
+
+	itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+	void SetInput(const TInputImage *image){
+		this->SetNthInput(0, const_cast<TInputImage *>(image));
+	}
+
+	const TInputImage *GetInput() const{
+		return static_cast<const TInputImage *>(this->GetPrimaryInput());
+	}
+
+	/**
+	 * @brief Set the RAM used for streaming in MB. 0 uses the OTB default.
+	 */
+	itkSetMacro(AvailableRAMInMB, unsigned int);
+	itkGetConstMacro(AvailableRAMInMB, unsigned int);
+
+	/**
+	 * @brief Set the files the input is read from, to align the streamed strips to their blocks.
+	 * Strips are used even for tiled files, since the COG, quicklook and histogram outputs need full rows.
+	 * @param filenames The rasters on the grid of the input. If empty, the strips only follow the RAM.
+	 * @param roi The region of interest the input is cropped to. The full rasters if it is not set.
+	 */
+	void SetAlignedInputFileNames(const std::vector<std::string> &filenames, const RegionOfInterest &roi = RegionOfInterest()){
+		m_AlignedInputFileNames = filenames;
+		m_AlignedRegionOfInterest = roi;
+		this->Modified();
+	}
+
+	/**
+	 * @brief Set the logger of the application, to report the streaming through it. If NULL, it is printed to stdout.
+	 */
+	void SetLogger(itk::Logger *logger){
+		m_Logger = logger;
+	}
+
+	/**
+	 * @brief Add an output file for one band of the input
+	 * @tparam TOutputValue The pixel type of the output file. The input values are cast to it.
+	 * @param band The index of the band to be written
+	 * @param filename The filename, optionally including extended filename options
+	 */
+	template <typename TOutputValue>
+	void AddBand(const unsigned int &band, const std::string &filename){
+		m_Sinks.emplace_back(new ImageIOSink<TOutputValue>(band, filename));
+		this->Modified();
+	}
+
+	/**
+	 * @brief Add a Cloud-Optimized GeoTiff output file for one band of the input
+	 * @tparam TOutputValue The pixel type of the output file. The input values are cast to it.
+	 * @param band The index of the band to be written
+	 * @param filename The final filename, without extended filename options
+	 * @param options The layout and resampling config of the file
+	 */
+	template <typename TOutputValue>
+	void AddCoGeoTiffBand(const unsigned int &band, const std::string &filename, const CoGeoTiffWriter::Options &options){
+		m_Sinks.emplace_back(new CoGeoTiffSink<TOutputValue>(band, filename, options));
+		this->Modified();
+	}
+
+	/**
+	 * @brief Add a JPEG quicklook of some bands of the input, decimated while the input is streamed
+	 * @param bands The indices of the bands in the order of the quicklook, usually red, green and blue
+	 * @param filename The JPEG filename
+	 * @param width Width of the quicklook
+	 * @param height Height of the quicklook
+	 * @param scaleMin Input value mapped to 0
+	 * @param scaleMax Input value mapped to 255
+	 * @param noDataValue Input value ignored when decimating
+	 */
+	void AddQuicklook(const std::vector<unsigned int> &bands, const std::string &filename, const size_t &width, const size_t &height,
+			const double &scaleMin, const double &scaleMax, const double &noDataValue){
+		m_Sinks.emplace_back(new QuicklookSink(bands, filename, width, height, scaleMin, scaleMax, noDataValue));
+		this->Modified();
+	}
+
+	/**
+	 * @brief Count the values of a band while the input is streamed
+	 * @param band The index of the band
+	 * @param histogram The histogram to be filled. It is reset when the writing starts.
+	 */
+	void AddHistogram(const unsigned int &band, BandHistogram::Pointer histogram){
+		m_Sinks.emplace_back(new HistogramSink(band, histogram, this->GetNumberOfThreads()));
+		this->Modified();
+	}
+
+	/**
+	 * @brief Remove all output files
+	 */
+	void ClearBands(){
+		m_Sinks.clear();
+		this->Modified();
+	}
+
+	/**
+	 * @brief Get the number of output files
+	 */
+	size_t GetNumberOfBands() const{
+		return m_Sinks.size();
+	}
+
+	/**
+	 * @brief Get the filenames of all output files
+	 */
+	std::vector<std::string> GetFileNames() const{
+		std::vector<std::string> filenames;
+		for(const std::unique_ptr<SinkBase> &sink : m_Sinks){
+			filenames.push_back(sink->GetFileName());
+		}
+		return filenames;
+	}
+
+	/**
+	 * @brief Stream the input and write all output files
+	 */
+	virtual void Update(){
+		this->Write();
+	}
+
+	void Write(){
+		TInputImage *input = const_cast<TInputImage *>(this->GetInput());
+		if(!input){
+			itkExceptionMacro("No input image set");
+		}
+		if(m_Sinks.empty()){
+			itkExceptionMacro("No output band set");
+		}
+		this->InvokeEvent(itk::StartEvent());
+		input->UpdateOutputInformation();
+		const RegionType largestRegion = input->GetLargestPossibleRegion();
+		for(const std::unique_ptr<SinkBase> &sink : m_Sinks){
+			for(const unsigned int &band : sink->GetBands()){
+				if(band >= input->GetNumberOfComponentsPerPixel()){
+					itkExceptionMacro("Band " << band << " requested for " << sink->GetFileName()
+							<< ", but the input only has " << input->GetNumberOfComponentsPerPixel() << " bands");
+				}
+			}
+			sink->WriteImageInformation(input, largestRegion);
+		}
+
+		typename StreamingManagerType::Pointer streamingManager;
+		StreamingAlignment::Splitting splitting;
+		if(!m_AlignedInputFileNames.empty() && StreamingAlignment::ComputeAlignedSplitting(
+				"bands of " + m_AlignedInputFileNames.front(), m_AlignedInputFileNames, m_AvailableRAMInMB, false,
+				m_AlignedRegionOfInterest, m_Logger, splitting)){
+			typename AlignedStreamingManagerType::Pointer alignedManager = AlignedStreamingManagerType::New();
+			alignedManager->SetNumberOfLinesPerStrip(splitting.size);
+			streamingManager = alignedManager.GetPointer();
+		}else{
+			typename RAMDrivenStreamingManagerType::Pointer ramManager = RAMDrivenStreamingManagerType::New();
+			ramManager->SetAvailableRAMInMB(m_AvailableRAMInMB);
+			streamingManager = ramManager.GetPointer();
+		}
+		streamingManager->PrepareStreaming(input, largestRegion);
+		const unsigned int nDivisions = streamingManager->GetNumberOfSplits();
+
+		for(unsigned int division = 0; division < nDivisions && !this->GetAbortGenerateData(); division++){
+			const RegionType streamRegion = streamingManager->GetSplit(division);
+			// The region is read once here, all sinks then write from the same buffer
+			input->SetRequestedRegion(streamRegion);
+			input->PropagateRequestedRegion();
+			input->UpdateOutputData();
+			ForEachSink([&](SinkBase &sink){ sink.Write(input, streamRegion, largestRegion); });
+			this->UpdateProgress(float(division + 1) / nDivisions);
+		}
+		ForEachSink([](SinkBase &sink){ sink.Close(); });
+		this->InvokeEvent(itk::EndEvent());
+		this->ReleaseInputs();
+	}
+
+protected:
+	MultiBandFileWriter() : m_AvailableRAMInMB(0), m_Logger(NULL) {
+		this->SetNumberOfRequiredInputs(1);
+	}
+	virtual ~MultiBandFileWriter() {}
+
+private:
+	MultiBandFileWriter(const Self &); //purposely not implemented
+	void operator=(const Self &); //purposely not implemented
+
+	/**
+	 * @brief Output file of a single band, independent of its pixel type and format
+	 */
+	class SinkBase {
+	public:
+		explicit SinkBase(const std::vector<unsigned int> &bands) : m_Bands(bands) {}
+		virtual ~SinkBase() {}
+
+		const std::vector<unsigned int> &GetBands() const { return m_Bands; }
+		virtual std::string GetFileName() const = 0;
+
+		/**
+		 * @brief Create the output file, using the geometry and metadata of the input
+		 */
+		virtual void WriteImageInformation(const TInputImage *input, const RegionType &region) = 0;
+
+		/**
+		 * @brief Write the band inside the given region of the buffered input
+		 */
+		virtual void Write(const TInputImage *input, const RegionType &streamRegion, const RegionType &largestRegion) = 0;
+
+		/**
+		 * @brief Finish the output file once all regions are written
+		 */
+		virtual void Close() = 0;
+
+	protected:
+		/**
+		 * @brief Copy a band inside the given region of the buffered input, cast to the output type
+		 */
+		template <typename TOutputValue>
+		void ExtractBand(const TInputImage *input, const RegionType &region, const unsigned int &band, std::vector<TOutputValue> &buffer) const{
+			buffer.resize(region.GetNumberOfPixels());
+			auto outIt = buffer.begin();
+			for(itk::ImageRegionConstIterator<TInputImage> inIt(input, region); !inIt.IsAtEnd(); ++inIt, ++outIt){
+				*outIt = static_cast<TOutputValue>(inIt.Get()[band]);
+			}
+		}
+
+		const std::vector<unsigned int> m_Bands;
+	};
+
+	/**
+	 * @brief Output file written through the OTB ImageIO of the file format
+	 */
+	class ImageIOSinkBase : public SinkBase {
+	public:
+		ImageIOSinkBase(const unsigned int &band, const std::string &filename) : SinkBase({band}) {
+			m_Options = otb::ExtendedFilenameToWriterOptions::New();
+			m_Options->SetExtendedFileName(filename.c_str());
+		}
+
+		virtual std::string GetFileName() const { return m_Options->GetSimpleFileName(); }
+
+		virtual void WriteImageInformation(const TInputImage *input, const RegionType &region){
+			m_ImageIO = otb::ImageIOFactory::CreateImageIO(GetFileName().c_str(), otb::ImageIOFactory::WriteMode);
+			if(m_ImageIO.IsNull()){
+				itkGenericExceptionMacro("Cannot write image " << GetFileName() << ", no ImageIO found");
+			}
+			otb::GDALImageIO *gdalImageIO = dynamic_cast<otb::GDALImageIO *>(m_ImageIO.GetPointer());
+			if(gdalImageIO && m_Options->gdalCreationOptionsIsSet()){
+				gdalImageIO->SetOptions(m_Options->GetgdalCreationOptions());
+			}
+			m_ImageIO->SetNumberOfDimensions(ImageDimension);
+			for(unsigned int i = 0; i < ImageDimension; i++){
+				m_ImageIO->SetDimensions(i, region.GetSize(i));
+				m_ImageIO->SetSpacing(i, input->GetSpacing()[i]);
+				m_ImageIO->SetOrigin(i, input->GetOrigin()[i] + region.GetIndex(i) * input->GetSpacing()[i]);
+				std::vector<double> axisDirection(ImageDimension);
+				for(unsigned int j = 0; j < ImageDimension; j++){
+					axisDirection[j] = input->GetDirection()[j][i];
+				}
+				m_ImageIO->SetDirection(i, axisDirection);
+			}
+			SetPixelType();
+			m_ImageIO->SetMetaDataDictionary(input->GetMetaDataDictionary());
+			m_ImageIO->SetFileName(GetFileName().c_str());
+			m_ImageIO->WriteImageInformation();
+		}
+
+		virtual void Close(){
+			m_ImageIO = nullptr;
+		}
+
+	protected:
+		virtual void SetPixelType() = 0;
+
+		/**
+		 * @brief Write the buffer of the given region to the file
+		 */
+		void WriteBuffer(const void *buffer, const RegionType &streamRegion, const RegionType &largestRegion){
+			itk::ImageIORegion ioRegion(ImageDimension);
+			for(unsigned int i = 0; i < ImageDimension; i++){
+				ioRegion.SetSize(i, streamRegion.GetSize(i));
+				ioRegion.SetIndex(i, streamRegion.GetIndex(i) - largestRegion.GetIndex(i));
+			}
+			m_ImageIO->SetIORegion(ioRegion);
+			m_ImageIO->Write(buffer);
+		}
+
+		otb::ExtendedFilenameToWriterOptions::Pointer m_Options;
+		otb::ImageIOBase::Pointer m_ImageIO;
+	};
+
+	template <typename TOutputValue>
+	class ImageIOSink : public ImageIOSinkBase {
+	public:
+		ImageIOSink(const unsigned int &band, const std::string &filename) : ImageIOSinkBase(band, filename) {}
+
+		virtual void Write(const TInputImage *input, const RegionType &streamRegion, const RegionType &largestRegion){
+			this->ExtractBand(input, streamRegion, this->m_Bands[0], m_Buffer);
+			this->WriteBuffer(m_Buffer.data(), streamRegion, largestRegion);
+		}
+
+	protected:
+		virtual void SetPixelType(){
+			this->m_ImageIO->SetPixelTypeInfo(static_cast<const TOutputValue *>(nullptr));
+		}
+
+	private:
+		std::vector<TOutputValue> m_Buffer;
+	};
+
+	/**
+	 * @brief Output file written as Cloud-Optimized GeoTiff. Needs full-width regions from top to bottom.
+	 */
+	template <typename TOutputValue>
+	class CoGeoTiffSink : public SinkBase {
+	public:
+		CoGeoTiffSink(const unsigned int &band, const std::string &filename, const CoGeoTiffWriter::Options &options) :
+			SinkBase({band}), m_Writer(filename, options) {}
+
+		virtual std::string GetFileName() const { return m_Writer.GetFileName(); }
+
+		virtual void WriteImageInformation(const TInputImage *input, const RegionType &region){
+			// GDAL refers to the upper left corner of the first pixel, ITK to its center
+			const double geoTransform[6] = {
+					input->GetOrigin()[0] + (region.GetIndex(0) - 0.5) * input->GetSpacing()[0], input->GetSpacing()[0], 0,
+					input->GetOrigin()[1] + (region.GetIndex(1) - 0.5) * input->GetSpacing()[1], 0, input->GetSpacing()[1]};
+			std::string projection;
+			itk::ExposeMetaData<std::string>(input->GetMetaDataDictionary(), otb::MetaDataKey::ProjectionRefKey, projection);
+			m_Writer.Create(region.GetSize(0), region.GetSize(1), GetGDALDataType<TOutputValue>(), geoTransform, projection);
+		}
+
+		virtual void Write(const TInputImage *input, const RegionType &streamRegion, const RegionType &largestRegion){
+			if(streamRegion.GetIndex(0) != largestRegion.GetIndex(0) || streamRegion.GetSize(0) != largestRegion.GetSize(0)){
+				itkGenericExceptionMacro("Cloud-Optimized GeoTiff " << GetFileName() << " can only be written in full-width strips");
+			}
+			this->ExtractBand(input, streamRegion, this->m_Bands[0], m_Buffer);
+			m_Values.assign(m_Buffer.begin(), m_Buffer.end());
+			m_Writer.WriteRows(streamRegion.GetIndex(1) - largestRegion.GetIndex(1), streamRegion.GetSize(1), m_Values.data());
+		}
+
+		virtual void Close(){
+			m_Writer.Close();
+		}
+
+	private:
+		CoGeoTiffWriter m_Writer;
+		std::vector<TOutputValue> m_Buffer;
+		std::vector<double> m_Values;
+	};
+
+	/**
+	 * @brief JPEG quicklook of several bands. Needs full-width regions.
+	 */
+	class QuicklookSink : public SinkBase {
+	public:
+		QuicklookSink(const std::vector<unsigned int> &bands, const std::string &filename, const size_t &width, const size_t &height,
+				const double &scaleMin, const double &scaleMax, const double &noDataValue) :
+			SinkBase(bands), m_Builder(filename, bands.size(), width, height, scaleMin, scaleMax, noDataValue) {}
+
+		virtual std::string GetFileName() const { return m_Builder.GetFileName(); }
+
+		virtual void WriteImageInformation(const TInputImage *, const RegionType &region){
+			m_Builder.SetInputSize(region.GetSize(0), region.GetSize(1));
+		}
+
+		virtual void Write(const TInputImage *input, const RegionType &streamRegion, const RegionType &largestRegion){
+			if(streamRegion.GetIndex(0) != largestRegion.GetIndex(0) || streamRegion.GetSize(0) != largestRegion.GetSize(0)){
+				itkGenericExceptionMacro("Quicklook " << GetFileName() << " can only be built from full-width strips");
+			}
+			for(size_t i = 0; i < this->m_Bands.size(); i++){
+				this->ExtractBand(input, streamRegion, this->m_Bands[i], m_Values);
+				m_Builder.AddRows(i, streamRegion.GetIndex(1) - largestRegion.GetIndex(1), streamRegion.GetSize(1), m_Values.data());
+			}
+		}
+
+		virtual void Close(){
+			m_Builder.Write();
+		}
+
+	private:
+		QuicklookBuilder m_Builder;
+		std::vector<double> m_Values;
+	};
+
+	/**
+	 * @brief Histogram of a band. Each region is split into rows over the threads of an itk::MultiThreader,
+	 * each thread counts its part into a partial histogram and the partial histograms are merged.
+	 */
+	class HistogramSink : public SinkBase {
+	public:
+		HistogramSink(const unsigned int &band, BandHistogram::Pointer histogram, const unsigned int &nThreads) :
+			SinkBase({band}), m_Histogram(histogram), m_nThreads(std::max(nThreads, 1u)) {}
+
+		virtual std::string GetFileName() const { return "histogram of band " + std::to_string(this->m_Bands[0]); }
+
+		virtual void WriteImageInformation(const TInputImage *, const RegionType &){
+			m_Histogram->Reset();
+		}
+
+		virtual void Write(const TInputImage *input, const RegionType &streamRegion, const RegionType &){
+			const size_t nThreads = std::min<size_t>(m_nThreads, streamRegion.GetSize(1));
+			CountData data;
+			data.input = input;
+			data.region = streamRegion;
+			data.band = this->m_Bands[0];
+			data.counts.assign(std::max<size_t>(nThreads, 1), std::vector<uint64_t>(m_Histogram->GetNumberOfBins(), 0));
+			if(nThreads <= 1){
+				Count(input, streamRegion, data.band, data.counts[0]);
+			}else{
+				itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+				threader->SetNumberOfThreads(nThreads);
+				threader->SetSingleMethod(CountCallback, &data);
+				threader->SingleMethodExecute();
+			}
+			std::vector<uint64_t> counts(m_Histogram->GetNumberOfBins(), 0);
+			for(const std::vector<uint64_t> &partialCounts : data.counts){
+				std::transform(counts.begin(), counts.end(), partialCounts.begin(), counts.begin(), std::plus<uint64_t>());
+			}
+			m_Histogram->Merge(counts, streamRegion.GetNumberOfPixels());
+		}
+
+		virtual void Close() {}
+
+	private:
+		/**
+		 * @brief Shared state of the threads counting a region, each of them fills its own partial histogram
+		 */
+		struct CountData{
+			const TInputImage *input;
+			RegionType region;
+			unsigned int band;
+			std::vector<std::vector<uint64_t> > counts;
+		};
+
+		static ITK_THREAD_RETURN_TYPE CountCallback(void *arg){
+			itk::MultiThreader::ThreadInfoStruct *info = static_cast<itk::MultiThreader::ThreadInfoStruct *>(arg);
+			CountData *data = static_cast<CountData *>(info->UserData);
+			// Split by the threads actually started, which may be fewer than requested
+			const size_t nRows = data->region.GetSize(1);
+			const size_t thread = info->ThreadID;
+			const size_t nThreads = info->NumberOfThreads;
+			RegionType part = data->region;
+			part.SetIndex(1, data->region.GetIndex(1) + thread * nRows / nThreads);
+			part.SetSize(1, (thread + 1) * nRows / nThreads - thread * nRows / nThreads);
+			Count(data->input, part, data->band, data->counts[thread]);
+			return ITK_THREAD_RETURN_VALUE;
+		}
+
+		static void Count(const TInputImage *input, const RegionType &region, const unsigned int &band, std::vector<uint64_t> &counts){
+			for(itk::ImageRegionConstIterator<TInputImage> it(input, region); !it.IsAtEnd(); ++it){
+				const double value = it.Get()[band];
+				if(value >= 0 && value < counts.size()){
+					counts[size_t(value)]++;
+				}
+			}
+		}
+
+		BandHistogram::Pointer m_Histogram;
+		const unsigned int m_nThreads;
+	};
+
+	/**
+	 * @brief Apply a function to all sinks, distributing them over the threads of an itk::MultiThreader.
+	 * At most GetNumberOfThreads() threads are used, which follows the ITK thread settings.
+	 */
+	template <typename TFunction>
+	void ForEachSink(const TFunction &function){
+		const size_t nThreads = std::min<size_t>(std::max<size_t>(this->GetNumberOfThreads(), 1), m_Sinks.size());
+		if(nThreads <= 1){
+			for(const std::unique_ptr<SinkBase> &sink : m_Sinks){
+				function(*sink);
+			}
+			return;
+		}
+		ForEachSinkData data;
+		data.function = function;
+		data.sinks = &m_Sinks;
+		data.next = 0;
+		data.errors.resize(nThreads);
+		itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+		threader->SetNumberOfThreads(nThreads);
+		threader->SetSingleMethod(ForEachSinkCallback, &data);
+		threader->SingleMethodExecute();
+		for(const std::exception_ptr &error : data.errors){
+			if(error){
+				std::rethrow_exception(error);
+			}
+		}
+	}
+
+	/**
+	 * @brief Shared state of the threads of ForEachSink, which take the next sink until all are done
+	 */
+	struct ForEachSinkData{
+		std::function<void(SinkBase &)> function;
+		std::vector<std::unique_ptr<SinkBase> > *sinks;
+		std::atomic<size_t> next;
+		std::vector<std::exception_ptr> errors;
+	};
+
+	static ITK_THREAD_RETURN_TYPE ForEachSinkCallback(void *arg){
+		itk::MultiThreader::ThreadInfoStruct *info = static_cast<itk::MultiThreader::ThreadInfoStruct *>(arg);
+		ForEachSinkData *data = static_cast<ForEachSinkData *>(info->UserData);
+		try{
+			for(size_t i = data->next++; i < data->sinks->size(); i = data->next++){
+				data->function(*(*data->sinks)[i]);
+			}
+		}catch(...){
+			data->errors[info->ThreadID] = std::current_exception();
+		}
+		return ITK_THREAD_RETURN_VALUE;
+	}
+
+	unsigned int m_AvailableRAMInMB;
+	std::vector<std::string> m_AlignedInputFileNames;
+	RegionOfInterest m_AlignedRegionOfInterest;
+	itk::Logger *m_Logger;
+	std::vector<std::unique_ptr<SinkBase> > m_Sinks;
+};
+
+} // namespace ts
+
+#endif /* COMMON_INCLUDE_MULTIBANDFILEWRITER_H_ */
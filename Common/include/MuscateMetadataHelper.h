@@ -54,7 +54,7 @@ public:
 	 * @return The filename containing a string. If multiple results are given, it returns the first element.
 	 * 		   If none are found, an empty string is returned
 	 */
-	std::string getFileNameByString(const productReturnType &filenames, const std::string &toFind);
+	std::string getFileNameByString(const productReturnType &filenames, const std::string &toFind) const;
 
 	/**
 	 * @brief Get a pointer to the full metadata Struct
@@ -81,6 +81,7 @@ protected:
 	productReturnType getWaterFileName();
 	productReturnType getSnowFileName();
 	productReturnType getQualityFileName();
+	productReturnType getEdgeFileName();
 
 private:
 
@@ -101,6 +102,12 @@ private:
 	 */
 	void UpdateValuesForSentinel();
 
+	/**
+	 * @brief Reads the mean solar and viewing angles, if available
+	 * @note Found in the Mean_Value_List of the Geometric_Informations section
+	 */
+	void UpdateMeanAngles();
+
 	/**
 	 * @brief Reads all Angles values
 	 * @note Mostly found in the Geometric_Informations section of the Metadata
@@ -113,6 +120,14 @@ private:
 	 * @note Return by reference
 	 */
 	void removeDuplicateElements(productReturnType &vec);
+
+	/**
+	 * @brief Copy a Muscate angle grid to the MetadataHelper structure
+	 * @param src The grid read from the metadata
+	 * @param dst The grid to be filled
+	 */
+	static void copyAngleList(const MuscateAngleList &src, MetadataHelperAngleList &dst);
+
 	/**
 	 * @brief MuscateMetadataHelper::CheckFileExistence
 	 * Checks if the file exists and if not, it tries to change the extension to small capitals letters.
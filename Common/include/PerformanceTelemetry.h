@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_PERFORMANCETELEMETRY_H_
+#define COMMON_INCLUDE_PERFORMANCETELEMETRY_H_
+
+#include "otbWrapperApplication.h"
+#include "itkProcessObject.h"
+#include "itkCommand.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Records the performance of an application and of the filters of its pipeline as JSON,
+ * if the environment variable WASP_TELEMETRY is set to a directory.
+ * Each application writes its record to its own file in this directory, updated whenever one of its outputs is written.
+ * A filter is accounted to the application whose writer executes it, e.g. for applications chained in memory.
+ * Its wall time excludes its inputs, as the pipeline updates them before it starts. Its CPU time is not recorded,
+ * as it runs on the threads of the filter and concurrently to the other pipelines, e.g. the ones of ForEachSink.
+ * The filters are observed without being kept alive, only while a watched writer runs.
+ */
+class PerformanceTelemetry{
+public:
+	/**
+	 * @brief Performance of a filter, summed over all its executions, i.e. over the stream divisions
+	 */
+	struct FilterRecord{
+		FilterRecord() : executions(0), wallTime(0), pixels(0), startWall(0) {}
+		std::string name;
+		size_t executions;
+		double wallTime;
+		uint64_t pixels;
+		double startWall;
+	};
+
+	/**
+	 * @brief File of an input or output of the application
+	 */
+	struct FileRecord{
+		FileRecord() : fileSize(0), streams(0), pixels(0), bFromApplication(false) {}
+		std::string parameter;
+		std::string filename;
+		// The size of the file on disk, not the bytes read or written, e.g. for a region of interest or an input kept in memory
+		uint64_t fileSize;
+		// Only for outputs: The number of stream divisions and the number of pixels
+		size_t streams;
+		uint64_t pixels;
+		// Only for outputs: The image written to the file, until its writer finished. NULL if unknown.
+		itk::DataObject::Pointer image;
+		// True, if read from the parameters of the application, which are read again on each update
+		bool bFromApplication;
+	};
+
+	PerformanceTelemetry();
+	~PerformanceTelemetry();
+
+	/**
+	 * @brief Get the directory the records are written to
+	 * @return The value of WASP_TELEMETRY, empty if the telemetry is disabled
+	 */
+	static std::string GetDirectory();
+
+	/**
+	 * @brief Start recording an application, to be called at the beginning of its DoExecute.
+	 * Its inputs and outputs are read from its parameters and its writers are watched.
+	 * Does nothing if the telemetry is disabled.
+	 */
+	void Start(otb::Wrapper::Application *app);
+
+	/**
+	 * @brief Start recording without an application, whose inputs, outputs and writers are then given explicitly
+	 * @param name The name of the record
+	 * @param directory The directory to write the record to. Does nothing if empty.
+	 */
+	void Start(const std::string &name, const std::string &directory);
+
+	/**
+	 * @brief Add an input file
+	 */
+	void AddInput(const std::string &parameter, const std::string &filename);
+
+	/**
+	 * @brief Add an output file
+	 * @param image The image written to the file, to count its pixels and the executions of its source
+	 */
+	void AddOutput(const std::string &parameter, const std::string &filename, itk::DataObject *image);
+
+	/**
+	 * @brief Watch a writer: While it runs, the filters of its pipeline are recorded. The record is written once it finishes.
+	 */
+	void WatchWriter(itk::ProcessObject *writer);
+
+	/**
+	 * @brief Get the record of a filter
+	 * @return The record, NULL if the filter was not executed by a watched writer
+	 */
+	const FilterRecord *GetFilterRecord(const itk::ProcessObject *process) const;
+
+	/**
+	 * @brief Get the record as JSON
+	 */
+	std::string ToJSON();
+
+	/**
+	 * @brief Write the record to its file in the telemetry directory
+	 */
+	void Write();
+
+private:
+	void ObservePipeline(itk::ProcessObject *process);
+	void Observe(itk::Object *object, const itk::EventObject &event, itk::Command *command);
+	void RemoveObservers(itk::Object *object);
+	void OnApplicationEvent(itk::Object *caller, const itk::EventObject &event);
+	void OnWriterEvent(itk::Object *caller, const itk::EventObject &event);
+	void OnFilterEvent(itk::Object *caller, const itk::EventObject &event);
+	void OnDeleteEvent(itk::Object *caller, const itk::EventObject &event);
+	void UpdateFiles();
+	void UpdateApplicationFiles();
+	static uint64_t GetFileSize(const std::string &filename);
+	static double GetWallTime();
+	static double GetCpuTime();
+
+	typedef itk::MemberCommand<PerformanceTelemetry>	CommandType;
+
+	otb::Wrapper::Application *m_App;
+	std::string m_Name;
+	std::string m_Filename;
+	double m_StartWall;
+	double m_StartCpu;
+	double m_StartEpoch;
+	int m_nActiveWriters;
+	unsigned long m_ApplicationObserver;
+	CommandType::Pointer m_ApplicationCommand;
+	CommandType::Pointer m_WriterCommand;
+	CommandType::Pointer m_FilterCommand;
+	CommandType::Pointer m_DeleteCommand;
+	std::vector<FileRecord> m_Inputs;
+	std::vector<FileRecord> m_Outputs;
+	std::vector<FilterRecord> m_Filters;
+	std::map<const itk::ProcessObject*, size_t> m_FilterIndex;
+	// The observed objects and the tags of their observers. The filters are only observed while a writer runs.
+	std::map<itk::Object*, std::vector<unsigned long> > m_Observers;
+	// The tags of the observers forgetting an object once it is deleted, kept until the destruction of the telemetry
+	std::map<itk::Object*, unsigned long> m_DeleteObservers;
+	// Numbers the records of the process, whose applications may run concurrently
+	static std::atomic<unsigned int> s_nRecords;
+};
+
+} // namespace ts
+
+#endif /* COMMON_INCLUDE_PERFORMANCETELEMETRY_H_ */
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_QUICKLOOKBUILDER_H_
+#define COMMON_INCLUDE_QUICKLOOKBUILDER_H_
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Builds a JPEG quicklook of a few bands while their rows are streamed.
+ * Each input pixel is added to the output pixel covering it, so that every output pixel holds
+ * the average of its box of valid input pixels. The averages are then scaled to 8 bit and encoded
+ * in-process, without a second pass over the input.
+ */
+class QuicklookBuilder{
+public:
+	/**
+	 * @brief Constructor
+	 * @param filename The JPEG output filename
+	 * @param nBands Number of bands of the quicklook, usually 3 for RGB
+	 * @param outWidth Width of the quicklook
+	 * @param outHeight Height of the quicklook
+	 * @param scaleMin Input value mapped to 0
+	 * @param scaleMax Input value mapped to 255
+	 * @param noDataValue Input value ignored when averaging
+	 */
+	QuicklookBuilder(const std::string &filename, const size_t &nBands, const size_t &outWidth, const size_t &outHeight,
+			const double &scaleMin, const double &scaleMax, const double &noDataValue);
+
+	/**
+	 * @brief Set the size of the full resolution input. Resets all accumulated values.
+	 */
+	void SetInputSize(const size_t &width, const size_t &height);
+
+	/**
+	 * @brief Add full-width rows of one band
+	 * @param band Index of the band in the quicklook
+	 * @param firstRow Index of the first row
+	 * @param nRows Number of rows
+	 * @param buffer Row-major values of the rows
+	 */
+	void AddRows(const size_t &band, const size_t &firstRow, const size_t &nRows, const double *buffer);
+
+	/**
+	 * @brief Scale the averages and write the JPEG file
+	 */
+	void Write();
+
+	/**
+	 * @brief Get the scaled 8 bit value of an output pixel
+	 */
+	unsigned char GetValue(const size_t &band, const size_t &x, const size_t &y) const;
+
+	const std::string &GetFileName() const { return m_FileName; }
+
+private:
+	std::string m_FileName;
+	size_t m_nBands;
+	size_t m_OutWidth;
+	size_t m_OutHeight;
+	double m_ScaleMin;
+	double m_ScaleMax;
+	double m_NoDataValue;
+	size_t m_InWidth;
+	size_t m_InHeight;
+	// Output column of each input column
+	std::vector<size_t> m_ColumnMap;
+	// Sum and count of the valid input pixels of each output pixel, band by band
+	std::vector<double> m_Sum;
+	std::vector<double> m_Count;
+};
+
+} // namespace ts
+
+#endif /* COMMON_INCLUDE_QUICKLOOKBUILDER_H_ */
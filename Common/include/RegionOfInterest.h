@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_REGIONOFINTEREST_H_
+#define COMMON_INCLUDE_REGIONOFINTEREST_H_
+
+#include "itkImageBase.h"
+#include "itkRegionOfInterestImageFilter.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Extent in the map coordinates of the rasters to restrict the processing to.
+ * A raster is cropped to the pixels whose centre lies within the extent. Thus rasters of all resolutions
+ * of a product are cropped to the same area, and cropping an already cropped raster has no effect.
+ */
+class RegionOfInterest{
+public:
+	typedef itk::ImageRegion<2>			RegionType;
+	typedef itk::ImageBase<2>			ImageBaseType;
+
+	/**
+	 * @brief Default constructor, not restricting anything
+	 */
+	RegionOfInterest() : m_bIsSet(false), m_xMin(0), m_yMin(0), m_xMax(0), m_yMax(0) {}
+
+	/**
+	 * @brief Constructor of an extent given by its corners
+	 */
+	RegionOfInterest(const double &xMin, const double &yMin, const double &xMax, const double &yMax);
+
+	/**
+	 * @brief Parse the extent from the values of an application parameter
+	 * @param values The corners as xmin ymin xmax ymax
+	 * @return The extent. Throws if the values do not describe a non-empty extent.
+	 */
+	static RegionOfInterest FromStringList(const std::vector<std::string> &values);
+
+	/**
+	 * @brief Returns true, if an extent is set
+	 */
+	bool IsSet() const { return m_bIsSet; }
+
+	double GetXMin() const { return m_xMin; }
+	double GetYMin() const { return m_yMin; }
+	double GetXMax() const { return m_xMax; }
+	double GetYMax() const { return m_yMax; }
+
+	/**
+	 * @brief Get the pixels of an image within the extent
+	 * @param image The image, its output information has to be up to date
+	 * @return The region inside the largest possible region of the image. The full region if no extent is set.
+	 * Throws if the extent does not contain any pixel centre of the image.
+	 */
+	RegionType GetRegion(const ImageBaseType *image) const;
+
+	/**
+	 * @brief Get the pixels along one axis whose centre lies within an interval
+	 * @param lo The lower bound of the interval as continuous index
+	 * @param hi The upper bound of the interval as continuous index
+	 * @param first The first index of the axis
+	 * @param size The number of pixels along the axis
+	 * @param start The first index of the pixels within the interval
+	 * @param count The number of pixels within the interval, 0 if there are none
+	 */
+	static void GetAxisRange(const double &lo, const double &hi, const long &first, const size_t &size, long &start, size_t &count);
+
+	/**
+	 * @brief Print the extent, e.g. to the log
+	 */
+	std::string ToString() const;
+
+private:
+	bool m_bIsSet;
+	double m_xMin, m_yMin, m_xMax, m_yMax;
+};
+
+/**
+ * @brief Crops images to a region of interest and keeps the cropping filters alive for the lifetime of an application
+ */
+class RegionOfInterestExtractor{
+public:
+	/**
+	 * @brief Set the extent to crop to. Nothing is cropped if it is not set.
+	 */
+	void SetRegionOfInterest(const RegionOfInterest &roi) { m_RegionOfInterest = roi; }
+
+	const RegionOfInterest &GetRegionOfInterest() const { return m_RegionOfInterest; }
+
+	/**
+	 * @brief Crop an image, keeping its georeferencing
+	 * @param image The image to be cropped
+	 * @return The cropped image, or the image itself if no region of interest is set
+	 */
+	template <typename TImage>
+	typename TImage::Pointer Extract(TImage *image){
+		if(!m_RegionOfInterest.IsSet()){
+			return image;
+		}
+		image->UpdateOutputInformation();
+		return ExtractRegion(image, m_RegionOfInterest.GetRegion(image));
+	}
+
+	/**
+	 * @brief Crop an image to a region of its pixels, keeping its georeferencing
+	 * @param image The image to be cropped
+	 * @param region The region inside the largest possible region of the image
+	 * @return The cropped image
+	 */
+	template <typename TImage>
+	typename TImage::Pointer ExtractRegion(TImage *image, const RegionOfInterest::RegionType &region){
+		typedef itk::RegionOfInterestImageFilter<TImage, TImage> FilterType;
+		typename FilterType::Pointer filter = FilterType::New();
+		filter->SetInput(image);
+		filter->SetRegionOfInterest(region);
+		filter->UpdateOutputInformation();
+		m_Filters.push_back(filter.GetPointer());
+		return filter->GetOutput();
+	}
+
+private:
+	RegionOfInterest m_RegionOfInterest;
+	std::vector<itk::ProcessObject::Pointer> m_Filters;
+};
+
+} // namespace ts
+
+#endif /* COMMON_INCLUDE_REGIONOFINTEREST_H_ */
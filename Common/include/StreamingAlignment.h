@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_STREAMINGALIGNMENT_H_
+#define COMMON_INCLUDE_STREAMINGALIGNMENT_H_
+
+#include "RegionOfInterest.h"
+#include "itkLogger.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Chooses stream regions that are aligned to the internal blocks of the input rasters.
+ * Regions straddling a block make the same compressed block to be decoded once per region touching it.
+ * The region size still follows the available RAM, rounded to a multiple of the blocks.
+ * If the output is restricted to a region of interest, the layout is computed relative to the origin of the
+ * pixels within it. A region of interest starting inside a block cannot be aligned with regions of a fixed size,
+ * the regions then still cover whole blocks, so that each boundary between them cuts a single block row.
+ */
+class StreamingAlignment{
+public:
+	/**
+	 * @brief Size and internal block size of a raster
+	 */
+	struct BlockLayout{
+		BlockLayout() : width(0), height(0), xStart(0), yStart(0), blockWidth(1), blockHeight(1), bytesPerPixel(0) {}
+		// Size of the streamed region, i.e. the full raster or the pixels within the region of interest
+		size_t width;
+		size_t height;
+		// Position of the first pixel of the streamed region in the raster
+		size_t xStart;
+		size_t yStart;
+		size_t blockWidth;
+		size_t blockHeight;
+		// Size of a pixel over all bands
+		size_t bytesPerPixel;
+		/**
+		 * @brief True, if the blocks are tiles and not full-width strips
+		 */
+		bool IsTiled() const { return blockWidth < width; }
+	};
+
+	/**
+	 * @brief Shape of the stream regions
+	 */
+	struct Splitting{
+		Splitting() : bTiled(false), size(0) {}
+		// Square tiles of size x size pixels if true, full-width strips of size lines otherwise
+		bool bTiled;
+		size_t size;
+	};
+
+	/**
+	 * @brief Read the layout of a raster with GDAL
+	 * @param filename The raster, optionally followed by extended filename options
+	 * @param roi The region of interest the raster is cropped to. The full raster if it is not set.
+	 * @return The layout. Throws if the file cannot be opened or if it does not intersect the region of interest.
+	 */
+	static BlockLayout GetBlockLayout(const std::string &filename, const RegionOfInterest &roi = RegionOfInterest());
+
+	/**
+	 * @brief Combine the layouts of rasters with regions of the same size into the blocks all of them are aligned to
+	 * @param filenames The rasters. Empty names are skipped.
+	 * @param roi The region of interest the rasters are cropped to. The full rasters if it is not set.
+	 * @return The layout with the least common multiple of all block sizes and the sum of the pixel sizes.
+	 * The start of the region is the one of the first raster. Throws if the regions differ in size.
+	 */
+	static BlockLayout GetCommonBlockLayout(const std::vector<std::string> &filenames, const RegionOfInterest &roi = RegionOfInterest());
+
+	/**
+	 * @brief Split as the RAM driven striped streaming does by default, ignoring the blocks
+	 * @param layout The layout of the inputs
+	 * @param ramMB The available RAM in MB. 0 uses the OTB default.
+	 */
+	static Splitting GetDefaultSplitting(const BlockLayout &layout, const unsigned int &ramMB);
+
+	/**
+	 * @brief Split into regions covering whole blocks, as large as the available RAM allows
+	 * @param layout The layout of the inputs
+	 * @param ramMB The available RAM in MB. 0 uses the OTB default.
+	 * @param bAllowTiles False to get strips even for tiled inputs, e.g. for writers needing full-width regions
+	 */
+	static Splitting GetAlignedSplitting(const BlockLayout &layout, const unsigned int &ramMB, const bool &bAllowTiles = true);
+
+	/**
+	 * @brief Number of block decodes needed to stream the raster with the given splitting
+	 * @note A block is decoded once per region intersecting it
+	 */
+	static uint64_t CountBlockDecodes(const BlockLayout &layout, const Splitting &splitting);
+
+	/**
+	 * @brief Append the splitting to an output filename as OTB extended filename options
+	 * @param filename The output filename, optionally with extended filename options already
+	 * @param splitting The splitting to be used by the writer
+	 */
+	static std::string GetExtendedFilename(const std::string &filename, const Splitting &splitting);
+
+	/**
+	 * @brief Compute the aligned splitting for streaming an output from the given inputs.
+	 * Logs the number of block decodes with the default and the aligned splitting.
+	 * @param name The name of the output, for the report
+	 * @param inputs The input rasters on the grid of the output
+	 * @param ramMB The available RAM in MB. 0 uses the OTB default.
+	 * @param bAllowTiles False to get strips even for tiled inputs
+	 * @param roi The region of interest the output is restricted to. The full inputs if it is not set.
+	 * @param logger The logger of the application. If NULL, the report is printed to stdout.
+	 * @param splitting The aligned splitting
+	 * @return True, if the splitting could be computed. False with a warning if the inputs cannot be read
+	 * or if their regions differ in size.
+	 */
+	static bool ComputeAlignedSplitting(const std::string &name, const std::vector<std::string> &inputs, const unsigned int &ramMB,
+			const bool &bAllowTiles, const RegionOfInterest &roi, itk::Logger *logger, Splitting &splitting);
+
+	/**
+	 * @brief Align the streaming of an OTB application output to the blocks of its inputs.
+	 * Logs the number of block decodes with the default and the aligned splitting.
+	 * @param filename The output filename
+	 * @param inputs The input rasters on the grid of the output
+	 * @param ramMB The available RAM in MB. 0 uses the OTB default.
+	 * @param roi The region of interest the output is restricted to. The full inputs if it is not set.
+	 * @param logger The logger of the application. If NULL, the report is printed to stdout.
+	 * @return The output filename with the streaming options. It is unchanged if the splitting cannot be computed
+	 * or if the filename already has streaming options.
+	 */
+	static std::string AlignOutput(const std::string &filename, const std::vector<std::string> &inputs, const unsigned int &ramMB,
+			const RegionOfInterest &roi = RegionOfInterest(), itk::Logger *logger = NULL);
+
+private:
+	/**
+	 * @brief Available RAM in bytes
+	 */
+	static uint64_t GetAvailableRAM(const unsigned int &ramMB);
+};
+
+} // namespace ts
+
+#endif /* COMMON_INCLUDE_STREAMINGALIGNMENT_H_ */
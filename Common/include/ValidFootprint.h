@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_VALIDFOOTPRINT_H_
+#define COMMON_INCLUDE_VALIDFOOTPRINT_H_
+
+#include "itkImageRegion.h"
+#include "itkImageBase.h"
+#include "itkPoint.h"
+#include <memory>
+#include <mutex>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+class MetadataHelper;
+
+/**
+ * @brief Run-length index of the valid pixels of a footprint on the grid of a given image.
+ * Each row of the bounding box stores the sorted, non-overlapping column spans to be processed.
+ */
+class ValidSpans{
+public:
+	typedef itk::ImageRegion<2>						RegionType;
+	typedef std::shared_ptr<const ValidSpans>		ConstPointer;
+
+	/**
+	 * @brief Columns [Begin, End) of a row
+	 */
+	struct Span{
+		long Begin;
+		long End;
+	};
+
+	/**
+	 * @brief Bounding box of all spans. Has a size of zero if there are no valid pixels
+	 */
+	const RegionType &GetBoundingRegion() const { return m_BoundingRegion; }
+
+	/**
+	 * @brief First span of a row. Rows outside the bounding box have no spans
+	 */
+	const Span *RowBegin(const long &row) const {
+		return IsRowInside(row) ? m_Spans.data() + m_RowOffsets[row - m_BoundingRegion.GetIndex(1)] : nullptr;
+	}
+
+	/**
+	 * @brief End of the spans of a row
+	 */
+	const Span *RowEnd(const long &row) const {
+		return IsRowInside(row) ? m_Spans.data() + m_RowOffsets[row - m_BoundingRegion.GetIndex(1) + 1] : nullptr;
+	}
+
+	/**
+	 * @brief Total number of pixels covered by the spans
+	 */
+	size_t GetNumberOfValidPixels() const;
+
+private:
+	friend class ValidFootprint;
+
+	explicit ValidSpans(const RegionType &boundingRegion);
+
+	bool IsRowInside(const long &row) const {
+		return row >= m_BoundingRegion.GetIndex(1) && row < m_BoundingRegion.GetIndex(1) + long(m_BoundingRegion.GetSize(1));
+	}
+
+	RegionType m_BoundingRegion;
+	std::vector<size_t> m_RowOffsets;
+	std::vector<Span> m_Spans;
+};
+
+/**
+ * @brief Valid-data footprint of an L2A product, derived from its edge mask.
+ * The edge mask is read once, strip by strip, and reduced to the runs of pixels per row
+ * that are not flagged as edge, as well as their bounding box. Both can be mapped onto
+ * any resolution of the same product.
+ */
+class ValidFootprint{
+public:
+	typedef itk::ImageRegion<2>						RegionType;
+	typedef itk::ImageBase<2>						ImageBaseType;
+	typedef itk::Point<double, 2>					PointType;
+	typedef std::shared_ptr<const ValidFootprint>	ConstPointer;
+
+	/**
+	 * @brief Build the footprint from an edge mask (0 = valid, any other value = edge)
+	 * @param edgeMaskFile Path to the edge mask
+	 */
+	explicit ValidFootprint(const std::string &edgeMaskFile);
+
+	/**
+	 * @brief Get the footprint of an edge mask, building it on first use.
+	 * Footprints are cached for the lifetime of the process and shared between callers.
+	 * @param edgeMaskFile Path to the edge mask
+	 * @return The shared footprint
+	 */
+	static ConstPointer GetFootprint(const std::string &edgeMaskFile);
+
+	/**
+	 * @brief Get the footprint of a product, using its coarsest edge mask
+	 * @param pHelper The metadata helper of the product
+	 * @return The shared footprint, or a null pointer if the product has no edge mask
+	 */
+	static ConstPointer GetFootprint(const MetadataHelper *pHelper);
+
+	/**
+	 * @brief Returns true, if the mask does not contain a single valid pixel
+	 */
+	bool IsEmpty() const { return m_bIsEmpty; }
+
+	/**
+	 * @brief Returns true, if all pixels of the mask are valid
+	 */
+	bool IsFull() const;
+
+	/**
+	 * @brief Bounding box of the valid pixels, on the grid of the edge mask
+	 */
+	const RegionType &GetMaskRegion() const { return m_ValidRegion; }
+
+	/**
+	 * @brief Map the bounding box onto the grid of another image of the same product
+	 * @param image The image, of which only the geometry is used
+	 * @param nPadding Number of pixels to add on each side, to account for resampling at the borders
+	 * @return The bounding box on the grid of the image, cropped to its largest possible region.
+	 * The returned region has a size of zero if the footprint is empty or does not overlap the image.
+	 */
+	RegionType GetValidRegion(const ImageBaseType *image, const unsigned int &nPadding = 1) const;
+
+	/**
+	 * @brief Map the valid runs of the mask onto the grid of another image of the same product
+	 * @param image The image, of which only the geometry is used
+	 * @param nPadding Number of pixels to add on each side of each span and each row
+	 * @return The spans on the grid of the image, within the region given by GetValidRegion()
+	 */
+	ValidSpans::ConstPointer GetValidSpans(const ImageBaseType *image, const unsigned int &nPadding = 1) const;
+
+private:
+	/**
+	 * @brief Read the mask and compute the runs and the bounding box of the valid pixels
+	 */
+	void Build();
+
+	std::string m_MaskFileName;
+	PointType m_FirstCorner;
+	PointType m_LastCorner;
+	RegionType m_LargestRegion;
+	RegionType m_ValidRegion;
+	bool m_bIsEmpty;
+	ImageBaseType::Pointer m_MaskGeometry;
+	// Runs of valid pixels of mask row r are m_Runs[m_RunOffsets[r]] to m_Runs[m_RunOffsets[r+1]-1]
+	std::vector<size_t> m_RunOffsets;
+	std::vector<ValidSpans::Span> m_Runs;
+
+	static std::mutex s_CacheMutex;
+	static std::map<std::string, ConstPointer> s_Cache;
+};
+
+} //namespace ts
+
+#endif /* COMMON_INCLUDE_VALIDFOOTPRINT_H_ */
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMMON_INCLUDE_VALIDSPANITERATOR_H_
+#define COMMON_INCLUDE_VALIDSPANITERATOR_H_
+
+#include "ValidFootprint.h"
+#include <algorithm>
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Walks a region as a sequence of segments, which are either entirely inside or entirely outside the valid spans.
+ * Valid segments are parts of a single row. Consecutive rows without any valid pixel are grouped to a single
+ * invalid segment, so that they can be filled at once.
+ * Without spans, the whole region is returned as one valid segment.
+ *
+ * Typical use in a ThreadedGenerateData():
+ * @code
+ * for(ValidSpanIterator seg(spans, outputRegionForThread); !seg.IsAtEnd(); ++seg){
+ *     if(seg.IsValid()){ ... process seg.GetRegion() ... } else { ... fill seg.GetRegion() ... }
+ * }
+ * @endcode
+ */
+class ValidSpanIterator{
+public:
+	typedef ValidSpans::RegionType	RegionType;
+	typedef ValidSpans::Span		Span;
+
+	/**
+	 * @brief Constructor
+	 * @param spans The spans on the grid of the region, can be null
+	 * @param region The region to walk
+	 */
+	ValidSpanIterator(const ValidSpans *spans, const RegionType &region) : m_Spans(spans), m_Region(region) {
+		m_StartX = region.GetIndex(0);
+		m_EndX = m_StartX + region.GetSize(0);
+		m_EndY = region.GetIndex(1) + region.GetSize(1);
+		GoToBegin();
+	}
+
+	/**
+	 * @brief Move to the first segment of the region
+	 */
+	void GoToBegin() {
+		m_bIsAtEnd = (m_Region.GetNumberOfPixels() == 0);
+		SetRow(m_Region.GetIndex(1));
+		if(!m_bIsAtEnd){
+			Next();
+		}
+	}
+
+	bool IsAtEnd() const { return m_bIsAtEnd; }
+
+	ValidSpanIterator &operator++() {
+		Next();
+		return *this;
+	}
+
+	/**
+	 * @brief The current segment
+	 */
+	const RegionType &GetRegion() const { return m_Segment; }
+
+	/**
+	 * @brief Returns true, if the current segment is inside the valid spans
+	 */
+	bool IsValid() const { return m_bIsValid; }
+
+private:
+	void SetRow(const long &row) {
+		m_Row = row;
+		m_Col = m_StartX;
+		if(m_Spans){
+			m_CurSpan = m_Spans->RowBegin(row);
+			m_EndSpan = m_Spans->RowEnd(row);
+		}
+	}
+
+	/**
+	 * @brief Returns true, if the row has at least one valid pixel within the columns of the region
+	 */
+	bool HasValidPixels(const long &row) const {
+		const Span *end = m_Spans->RowEnd(row);
+		for(const Span *span = m_Spans->RowBegin(row); span != end && span->Begin < m_EndX; ++span){
+			if(span->End > m_StartX){
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void SetSegment(const long &beginX, const long &endX, const long &beginY, const long &endY, const bool &bIsValid) {
+		m_Segment.SetIndex(0, beginX);
+		m_Segment.SetIndex(1, beginY);
+		m_Segment.SetSize(0, endX - beginX);
+		m_Segment.SetSize(1, endY - beginY);
+		m_bIsValid = bIsValid;
+	}
+
+	void Next() {
+		if(m_Col >= m_EndX){
+			SetRow(m_Row + 1);
+		}
+		if(m_Row >= m_EndY){
+			m_bIsAtEnd = true;
+			return;
+		}
+		if(!m_Spans){
+			SetSegment(m_StartX, m_EndX, m_Row, m_EndY, true);
+			SetRow(m_EndY);
+			return;
+		}
+		// Skip the spans ending before the current column
+		while(m_CurSpan != m_EndSpan && m_CurSpan->End <= m_Col){
+			++m_CurSpan;
+		}
+		if(m_CurSpan == m_EndSpan || m_CurSpan->Begin >= m_EndX){
+			if(m_Col == m_StartX){
+				// Empty row: group it with the following empty rows
+				long endRow = m_Row + 1;
+				while(endRow < m_EndY && !HasValidPixels(endRow)){
+					endRow++;
+				}
+				SetSegment(m_StartX, m_EndX, m_Row, endRow, false);
+				SetRow(endRow);
+				m_Col = m_StartX;
+			}else{
+				SetSegment(m_Col, m_EndX, m_Row, m_Row + 1, false);
+				m_Col = m_EndX;
+			}
+		}else if(m_CurSpan->Begin > m_Col){
+			SetSegment(m_Col, m_CurSpan->Begin, m_Row, m_Row + 1, false);
+			m_Col = m_CurSpan->Begin;
+		}else{
+			const long endX = std::min(m_CurSpan->End, m_EndX);
+			SetSegment(m_Col, endX, m_Row, m_Row + 1, true);
+			m_Col = endX;
+			++m_CurSpan;
+		}
+	}
+
+	const ValidSpans *m_Spans;
+	RegionType m_Region;
+	RegionType m_Segment;
+	long m_StartX;
+	long m_EndX;
+	long m_EndY;
+	long m_Row;
+	long m_Col;
+	const Span *m_CurSpan = nullptr;
+	const Span *m_EndSpan = nullptr;
+	bool m_bIsValid = false;
+	bool m_bIsAtEnd = false;
+};
+
+} //namespace ts
+
+#endif /* COMMON_INCLUDE_VALIDSPANITERATOR_H_ */
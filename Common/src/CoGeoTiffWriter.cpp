@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "CoGeoTiffWriter.h"
+#include "gdal_priv.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+#include "itkMacro.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+using namespace ts;
+
+namespace {
+/**
+ * @brief Limits the number of final copies running at the same time in the process,
+ * as each of them reads its whole intermediate file while compressing it
+ */
+struct CopySlots{
+	std::mutex mutex;
+	std::condition_variable released;
+	size_t nMax = 2;
+	size_t nUsed = 0;
+};
+
+CopySlots &GetCopySlots(){
+	static CopySlots slots;
+	return slots;
+}
+
+/**
+ * @brief Holds one of the copy slots during its lifetime
+ */
+class CopySlotLock{
+public:
+	CopySlotLock() : m_Slots(GetCopySlots()){
+		std::unique_lock<std::mutex> lock(m_Slots.mutex);
+		m_Slots.released.wait(lock, [this]{ return m_Slots.nUsed < m_Slots.nMax; });
+		m_Slots.nUsed++;
+	}
+	~CopySlotLock(){
+		{
+			std::lock_guard<std::mutex> lock(m_Slots.mutex);
+			m_Slots.nUsed--;
+		}
+		m_Slots.released.notify_one();
+	}
+private:
+	CopySlots &m_Slots;
+};
+} // namespace
+
+OverviewLevel::OverviewLevel(const size_t &inputWidth, const bool &bAverage) :
+		m_bAverage(bAverage), m_InputWidth(inputWidth), m_nPendingRows(0),
+		m_Sum((inputWidth + 1) / 2, 0), m_Count((inputWidth + 1) / 2, 0){
+}
+
+bool OverviewLevel::AddRow(const double *sum, const double *count){
+	if(m_nPendingRows == 2){
+		std::fill(m_Sum.begin(), m_Sum.end(), 0);
+		std::fill(m_Count.begin(), m_Count.end(), 0);
+		m_nPendingRows = 0;
+	}
+	if(m_bAverage){
+		for(size_t col = 0; col < m_InputWidth; col++){
+			m_Sum[col / 2] += sum[col];
+			m_Count[col / 2] += count[col];
+		}
+	}else if(m_nPendingRows == 0){
+		for(size_t col = 0; col < m_InputWidth; col += 2){
+			m_Sum[col / 2] = sum[col];
+			m_Count[col / 2] = count[col];
+		}
+	}
+	return ++m_nPendingRows == 2;
+}
+
+bool OverviewLevel::Flush(){
+	if(m_nPendingRows == 1){
+		m_nPendingRows = 2;
+		return true;
+	}
+	return false;
+}
+
+CoGeoTiffWriter::Options::Options() :
+		nLevels(5), compress("DEFLATE"), resamplingMethod("average"), bHasNoData(false), noDataValue(0){
+}
+
+CoGeoTiffWriter::CoGeoTiffWriter(const std::string &filename, const Options &options) :
+		m_FileName(filename), m_Options(options), m_pDataset(nullptr), m_Width(0), m_Height(0), m_NextRow(0){
+	const size_t separator = filename.find_last_of('/');
+	const std::string baseName = filename.substr(separator + 1);
+	if(m_Options.tempDir.empty()){
+		// Next to the final file, so that the intermediate is on the same disk and never kept in memory
+		const std::string dir = (separator == std::string::npos) ? std::string(".") : filename.substr(0, separator);
+		m_TempFileName = dir + "/" + baseName.substr(0, baseName.find_last_of('.')) + ".tmp.tif";
+	}else{
+		m_TempFileName = m_Options.tempDir + "/" + baseName;
+	}
+}
+
+void CoGeoTiffWriter::SetMaxConcurrentCopies(const size_t &nCopies){
+	CopySlots &slots = GetCopySlots();
+	{
+		std::lock_guard<std::mutex> lock(slots.mutex);
+		slots.nMax = std::max<size_t>(nCopies, 1);
+	}
+	slots.released.notify_all();
+}
+
+CoGeoTiffWriter::~CoGeoTiffWriter(){
+	Discard();
+}
+
+void CoGeoTiffWriter::Create(const size_t &width, const size_t &height, const GDALDataType &type,
+		const double geoTransform[6], const std::string &projection){
+	GDALAllRegister();
+	GDALDriver *pDriver = GetGDALDriverManager()->GetDriverByName("GTiff");
+	if(!pDriver){
+		itkGenericExceptionMacro("GDAL GTiff driver not available");
+	}
+	// The intermediate file is tiled like the final one, but left uncompressed as it is only written once
+	char **papszOptions = nullptr;
+	papszOptions = CSLSetNameValue(papszOptions, "TILED", "YES");
+	papszOptions = CSLSetNameValue(papszOptions, "BIGTIFF", "IF_SAFER");
+	m_pDataset = pDriver->Create(m_TempFileName.c_str(), int(width), int(height), 1, type, papszOptions);
+	CSLDestroy(papszOptions);
+	if(!m_pDataset){
+		itkGenericExceptionMacro("Cannot create " << m_TempFileName << ": " << CPLGetLastErrorMsg());
+	}
+	m_pDataset->SetGeoTransform(const_cast<double *>(geoTransform));
+	if(!projection.empty()){
+		m_pDataset->SetProjection(projection.c_str());
+	}
+	GDALRasterBand *pBand = m_pDataset->GetRasterBand(1);
+	if(m_Options.bHasNoData){
+		pBand->SetNoDataValue(m_Options.noDataValue);
+	}
+
+	// Allocate the overviews without computing them, they are filled while the strips arrive
+	const bool bAverage = m_Options.resamplingMethod != "nearest";
+	std::vector<int> factors;
+	size_t levelWidth = width;
+	for(size_t level = 0; level < m_Options.nLevels; level++){
+		factors.push_back(2 << level);
+		m_Levels.emplace_back(levelWidth, bAverage);
+		levelWidth = m_Levels.back().GetWidth();
+	}
+	m_LevelRows.assign(m_Levels.size(), 0);
+	if(!factors.empty() && m_pDataset->BuildOverviews("NONE", int(factors.size()), factors.data(), 0, nullptr, nullptr, nullptr) != CE_None){
+		itkGenericExceptionMacro("Cannot create the overviews of " << m_TempFileName << ": " << CPLGetLastErrorMsg());
+	}
+	for(size_t level = 0; level < m_Levels.size(); level++){
+		GDALRasterBand *pOverview = pBand->GetOverview(int(level));
+		if(!pOverview || size_t(pOverview->GetXSize()) != m_Levels[level].GetWidth()){
+			itkGenericExceptionMacro("Unexpected layout of overview " << level << " of " << m_TempFileName);
+		}
+	}
+	m_Width = width;
+	m_Height = height;
+	m_NextRow = 0;
+	m_RowBuffer.resize(m_Width);
+	m_OnesBuffer.assign(m_Width, 1);
+}
+
+void CoGeoTiffWriter::WriteRows(const size_t &firstRow, const size_t &nRows, const double *buffer){
+	if(!m_pDataset){
+		itkGenericExceptionMacro("Writing to " << m_FileName << " before it was created");
+	}
+	if(firstRow != m_NextRow || firstRow + nRows > m_Height){
+		itkGenericExceptionMacro("Rows " << firstRow << " to " << firstRow + nRows << " of " << m_FileName
+				<< " do not follow row " << m_NextRow);
+	}
+	if(m_pDataset->GetRasterBand(1)->RasterIO(GF_Write, 0, int(firstRow), int(m_Width), int(nRows),
+			const_cast<double *>(buffer), int(m_Width), int(nRows), GDT_Float64, 0, 0, nullptr) != CE_None){
+		itkGenericExceptionMacro("Cannot write to " << m_TempFileName << ": " << CPLGetLastErrorMsg());
+	}
+	std::vector<double> sum;
+	std::vector<double> count;
+	for(size_t row = 0; row < nRows; row++){
+		const double *values = buffer + row * m_Width;
+		const double *valid = m_OnesBuffer.data();
+		if(m_Options.bHasNoData){
+			// No-data pixels neither add to the sum nor to the count of their block
+			sum.resize(m_Width);
+			count.resize(m_Width);
+			for(size_t col = 0; col < m_Width; col++){
+				const bool bIsValid = values[col] != m_Options.noDataValue;
+				sum[col] = bIsValid ? values[col] : 0;
+				count[col] = bIsValid ? 1 : 0;
+			}
+			values = sum.data();
+			valid = count.data();
+		}
+		PropagateRow(0, values, valid);
+	}
+	m_NextRow += nRows;
+}
+
+void CoGeoTiffWriter::PropagateRow(const size_t &level, const double *sum, const double *count){
+	if(level >= m_Levels.size()){
+		return;
+	}
+	if(m_Levels[level].AddRow(sum, count)){
+		WriteOverviewRow(level);
+		PropagateRow(level + 1, m_Levels[level].GetSum(), m_Levels[level].GetCount());
+	}
+}
+
+void CoGeoTiffWriter::WriteOverviewRow(const size_t &level){
+	const OverviewLevel &overview = m_Levels[level];
+	const size_t width = overview.GetWidth();
+	for(size_t col = 0; col < width; col++){
+		const double count = overview.GetCount()[col];
+		m_RowBuffer[col] = (count > 0) ? overview.GetSum()[col] / count : m_Options.noDataValue;
+	}
+	GDALRasterBand *pOverview = m_pDataset->GetRasterBand(1)->GetOverview(int(level));
+	if(pOverview->RasterIO(GF_Write, 0, int(m_LevelRows[level]), int(width), 1,
+			m_RowBuffer.data(), int(width), 1, GDT_Float64, 0, 0, nullptr) != CE_None){
+		itkGenericExceptionMacro("Cannot write overview " << level << " of " << m_TempFileName << ": " << CPLGetLastErrorMsg());
+	}
+	m_LevelRows[level]++;
+}
+
+void CoGeoTiffWriter::Close(){
+	if(!m_pDataset){
+		itkGenericExceptionMacro("Closing " << m_FileName << " before it was created");
+	}
+	if(m_NextRow != m_Height){
+		itkGenericExceptionMacro("Only " << m_NextRow << " of " << m_Height << " rows written to " << m_FileName);
+	}
+	// Levels with an odd number of input rows still hold their last row
+	for(size_t level = 0; level < m_Levels.size(); level++){
+		if(m_Levels[level].Flush()){
+			WriteOverviewRow(level);
+			PropagateRow(level + 1, m_Levels[level].GetSum(), m_Levels[level].GetCount());
+		}
+	}
+	m_pDataset->FlushCache();
+
+	char **papszOptions = nullptr;
+	papszOptions = CSLSetNameValue(papszOptions, "TILED", "YES");
+	papszOptions = CSLSetNameValue(papszOptions, "COPY_SRC_OVERVIEWS", "YES");
+	papszOptions = CSLSetNameValue(papszOptions, "COMPRESS", m_Options.compress.c_str());
+	papszOptions = CSLSetNameValue(papszOptions, "BIGTIFF", "IF_SAFER");
+	for(const auto &option : m_Options.creationOptions){
+		papszOptions = CSLSetNameValue(papszOptions, option.first.c_str(), option.second.c_str());
+	}
+	{
+		// Only the copy is limited, the strips keep arriving at all bands in parallel
+		CopySlotLock slot;
+		GDALDataset *pCopy = m_pDataset->GetDriver()->CreateCopy(m_FileName.c_str(), m_pDataset, FALSE, papszOptions, nullptr, nullptr);
+		CSLDestroy(papszOptions);
+		if(!pCopy){
+			itkGenericExceptionMacro("Cannot create " << m_FileName << ": " << CPLGetLastErrorMsg());
+		}
+		GDALClose(pCopy);
+	}
+	Discard();
+}
+
+void CoGeoTiffWriter::Discard(){
+	if(m_pDataset){
+		GDALClose(m_pDataset);
+		m_pDataset = nullptr;
+		VSIUnlink(m_TempFileName.c_str());
+	}
+}
@@ -28,6 +28,9 @@
 #include "GlobalDefs.h"
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
 
 std::string ts::getDirname(const std::string &path) {
     boost::filesystem::path p(path);
@@ -44,3 +47,27 @@ std::string ts::getEnvVar( std::string const & key ) {
     char * val = getenv( key.c_str() );
     return val == NULL ? std::string("") : std::string(val);
 }
+
+int ts::getDaysBetween(const std::string &date1, const std::string &date2) {
+    struct tm tmTime1 = {};
+    struct tm tmTime2 = {};
+    strptime(date1.c_str(), "%Y%m%d", &tmTime1);
+    strptime(date2.c_str(), "%Y%m%d", &tmTime2);
+    double seconds = fabs(difftime(mktime(&tmTime1), mktime(&tmTime2)));
+    // compute the time difference as the number of days
+    return (int)(seconds / (3600 * 24));
+}
+
+float ts::computeWeightOnDate(int nDays, int nHalfSynthesis, float fWeightOnDateMin) {
+    if(nHalfSynthesis <= 0) {
+        return 1;
+    }
+    return 1 - (abs(nDays) / nHalfSynthesis) * (1 - fWeightOnDateMin);
+}
+
+float ts::computeSynthesisWeight(int nDays, int nHalfSynthesis, float fWeightOnDateMin) {
+    if(nHalfSynthesis > 0 && abs(nDays) > nHalfSynthesis) {
+        return 0;
+    }
+    return computeWeightOnDate(nDays, nHalfSynthesis, fWeightOnDateMin);
+}
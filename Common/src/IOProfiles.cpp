@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "IOProfiles.h"
+#include "itkMacro.h"
+#include <algorithm>
+
+std::vector<std::string> ts::GetIOProfileNames(){
+	return {IO_PROFILE_DEFAULT, IO_PROFILE_TEMP_FAST, IO_PROFILE_ARCHIVE, IO_PROFILE_COG};
+}
+
+bool ts::IsIOProfile(const std::string &profile){
+	const std::vector<std::string> names = GetIOProfileNames();
+	return std::find(names.begin(), names.end(), profile) != names.end();
+}
+
+ts::CreationOptionsType ts::GetIOProfileCreationOptions(const std::string &profile, const bool &bIsMask){
+	if(!IsIOProfile(profile)){
+		itkGenericExceptionMacro("Unknown I/O profile: " << profile);
+	}
+	if(profile == IO_PROFILE_DEFAULT){
+		return bIsMask ? CreationOptionsType{{"COMPRESS", "DEFLATE"}} : CreationOptionsType();
+	}
+	// Square blocks, so that streamed regions can be aligned to them
+	const std::string blockSize = std::to_string(IO_PROFILE_BLOCK_SIZE);
+	CreationOptionsType options = {{"TILED", "YES"}, {"BLOCKXSIZE", blockSize}, {"BLOCKYSIZE", blockSize}, {"BIGTIFF", "IF_SAFER"}};
+	if(profile == IO_PROFILE_TEMP_FAST){
+		options.emplace_back("COMPRESS", "NONE");
+	}else{
+		options.emplace_back("COMPRESS", "DEFLATE");
+		options.emplace_back("PREDICTOR", "2");
+		options.emplace_back("NUM_THREADS", "ALL_CPUS");
+	}
+	return options;
+}
+
+std::string ts::GetIOProfileExtendedFilename(const std::string &profile, const bool &bIsMask){
+	std::string extendedFilename;
+	for(const auto &option : GetIOProfileCreationOptions(profile, bIsMask)){
+		extendedFilename += "&gdal:co:" + option.first + "=" + option.second;
+	}
+	return extendedFilename.empty() ? extendedFilename : "?" + extendedFilename;
+}
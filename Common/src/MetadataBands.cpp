@@ -29,14 +29,14 @@
 
 using namespace ts;
 
-int Resolution::getBandIndexByType(const std::string &type){
+int Resolution::getBandIndexByType(const std::string &type) const{
 	for(size_t band = 0; band < m_bands.size(); band++){
 		if(m_bands[band].getType() == type) return (int)band;
 	}
 	return -1;
 }
 
-bool Resolution::doesBandTypeExist(const std::string &type){
+bool Resolution::doesBandTypeExist(const std::string &type) const{
 	if(getBandIndexByType(type) >= 0) return true;
 	return false;
 }
@@ -50,41 +50,41 @@ void MultiResolution::addResolution(const Resolution &res){
 	m_resolutions.emplace_back(res);
 }
 
-size_t MultiResolution::getNumberOfResolutions(){
+size_t MultiResolution::getNumberOfResolutions() const{
 	return m_resolutions.size();
 }
 
-size_t MultiResolution::getTotalNumberOfBands(){
+size_t MultiResolution::getTotalNumberOfBands() const{
 	size_t total = 0;
-	for(auto resolution : m_resolutions){
+	for(const Resolution &resolution : m_resolutions){
 		total += resolution.getBands().size();
 	}
 	return total;
 }
 
-productReturnType MultiResolution::getNthResolutionFilenames(const size_t &n = 0){
-	if(n > m_resolutions.size()){
+productReturnType MultiResolution::getNthResolutionFilenames(const size_t &n = 0) const{
+	if(n >= m_resolutions.size()){
 		return {};
 	}
 	productReturnType filenames;
-	for(auto band : m_resolutions[n].getBands()){
+	for(const Band &band : m_resolutions[n].getBands()){
 		filenames.emplace_back(band.getPath());
 	}
 	return filenames;
 }
 
 bool MultiResolution::doesBandTypeExist(const std::string &type) const{
-	for(auto resolution : m_resolutions){
-		for(auto band : resolution.getBands()){
+	for(const Resolution &resolution : m_resolutions){
+		for(const Band &band : resolution.getBands()){
 			if(band.getType() == type) return true;
 		}
 	}
 	return false;
 }
 
-std::string MultiResolution::getSpecificBandTypeFilename(const std::string &type){
-	for(auto resolution : m_resolutions){
-		for(auto band : resolution.getBands()){
+std::string MultiResolution::getSpecificBandTypeFilename(const std::string &type) const{
+	for(const Resolution &resolution : m_resolutions){
+		for(const Band &band : resolution.getBands()){
 			if(band.getType() == type) return band.getPath();
 		}
 	}
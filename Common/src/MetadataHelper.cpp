@@ -36,6 +36,7 @@ using namespace ts;
 MetadataHelper::MetadataHelper()
 {
     m_detailedAnglesGridSize = 0;
+    m_nLoadedContent = 0;
     m_Resolutions = {};
 }
 
@@ -44,9 +45,10 @@ MetadataHelper::~MetadataHelper()
 
 }
 
-bool MetadataHelper::LoadMetadataFile(const std::string& file)
+bool MetadataHelper::LoadMetadataFile(const std::string& file, const unsigned int &content)
 {
     Reset();
+    m_nLoadedContent = content;
     m_inputMetadataFileName = file;
     m_DirName = getDirname(m_inputMetadataFileName);
     m_basename = getBasename(m_inputMetadataFileName);
@@ -56,12 +58,14 @@ bool MetadataHelper::LoadMetadataFile(const std::string& file)
 void MetadataHelper::Reset()
 {
     m_Mission = "";
+    m_GeographicalZone = "";
     m_productLevel = "";
 
     m_AotFileName = {""};
     m_CloudFileName = {""};
     m_WaterFileName = {""};
     m_SnowFileName = {""};
+    m_EdgeFileName = {};
     m_ImageFileName = {""};
 
     m_AcquisitionDate = "";
@@ -72,18 +76,23 @@ void MetadataHelper::Reset()
     m_fAotNoDataVal = 0;
 
     m_solarMeanAngles.azimuth = m_solarMeanAngles.zenith = 0.0;
+    m_sensorBandsMeanAngles.clear();
+    m_sensorBandsMeanAnglesIds.clear();
+    m_bHasGlobalMeanAngles = false;
+    m_bHasBandMeanAngles = false;
     m_bHasDetailedAngles = false;
+    m_detailedViewingAngles.clear();
     m_Resolutions = {};
 }
 
-std::string MetadataHelper::GetAcquisitionDate(){
+std::string MetadataHelper::GetAcquisitionDate() const{
 	std::string acqDateShort = m_AcquisitionDate.substr(0, m_AcquisitionDate.find("T", 0)); //Cut After "T"
 	acqDateShort.erase(std::remove(acqDateShort.begin(), acqDateShort.end(), '-'), acqDateShort.end()); //Remove the two "-" separators
 
 	return acqDateShort;
 }
 
-int MetadataHelper::GetAcquisitionDateAsDoy()
+int MetadataHelper::GetAcquisitionDateAsDoy() const
 {
     struct tm tmDate = {};
     if (strptime(GetAcquisitionDate().c_str(), "%Y%m%d", &tmDate) == NULL) {
@@ -102,7 +111,7 @@ int MetadataHelper::GetAcquisitionDateAsDoy()
     return lrintf(diff / 86400 /* 60*60*24*/);
 }
 
-MeanAngles_Type MetadataHelper::GetSensorMeanAngles() {
+MeanAngles_Type MetadataHelper::GetSensorMeanAngles() const {
     MeanAngles_Type angles = {0,0};
 
     if(HasBandMeanAngles()) {
@@ -137,7 +146,7 @@ MeanAngles_Type MetadataHelper::GetSensorMeanAngles() {
     return angles;
 }
 
-MeanAngles_Type MetadataHelper::GetSensorMeanAngles(int nBand) {
+MeanAngles_Type MetadataHelper::GetSensorMeanAngles(int nBand) const {
     MeanAngles_Type angles = {0,0};
     if(nBand >= 0 && nBand < (int)m_sensorBandsMeanAngles.size()) {
         angles = m_sensorBandsMeanAngles[nBand];
@@ -147,7 +156,17 @@ MeanAngles_Type MetadataHelper::GetSensorMeanAngles(int nBand) {
     return angles;
 }
 
-double MetadataHelper::GetRelativeAzimuthAngle()
+bool MetadataHelper::GetSensorMeanAngles(const std::string &bandId, MeanAngles_Type &angles) const {
+    for(size_t i = 0; i < m_sensorBandsMeanAnglesIds.size() && i < m_sensorBandsMeanAngles.size(); i++) {
+        if(m_sensorBandsMeanAnglesIds[i] == bandId) {
+            angles = m_sensorBandsMeanAngles[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+double MetadataHelper::GetRelativeAzimuthAngle() const
 {
     MeanAngles_Type solarAngle = GetSolarMeanAngles();
     MeanAngles_Type sensorAngle = GetSensorMeanAngles();
@@ -164,7 +183,7 @@ double MetadataHelper::GetRelativeAzimuthAngle()
     return relAzimuth;
 }
 
-std::string MetadataHelper::buildFullPath(const std::string& fileName)
+std::string MetadataHelper::buildFullPath(const std::string& fileName) const
 {
     boost::filesystem::path p(m_DirName);
     p /= fileName;
@@ -25,17 +25,47 @@
 
 #include "MetadataHelperFactory.h"
 #include "MuscateMetadataHelper.h"
+#include <boost/filesystem.hpp>
 
 using namespace ts;
 
-std::unique_ptr<MetadataHelper> MetadataHelperFactory::GetMetadataHelper(const std::string& metadataFileName)
+std::mutex MetadataHelperFactory::s_CacheMutex;
+std::map<std::string, MetadataHelperFactory::CacheEntryType> MetadataHelperFactory::s_Cache;
+
+MetadataHelper::ConstPointer MetadataHelperFactory::GetMetadataHelper(const std::string& metadataFileName, const unsigned int &content)
 {
+    boost::system::error_code ec;
+    boost::filesystem::path canonicalPath = boost::filesystem::canonical(metadataFileName, ec);
+    const std::string key = ec ? metadataFileName : canonicalPath.string();
+    const std::time_t modificationTime = ec ? std::time_t(0) : boost::filesystem::last_write_time(canonicalPath, ec);
+    {
+        std::lock_guard<std::mutex> lock(s_CacheMutex);
+        auto it = s_Cache.find(key);
+        if(it != s_Cache.end() && it->second.first == modificationTime &&
+                (it->second.second->GetLoadedContent() & content) == content){
+            return it->second.second;
+        }
+    }
 
-	//Only Muscate existing so far here.
-    std::unique_ptr<MetadataHelper> muscateMetadataHelper(new MuscateMetadataHelper);
-    if (muscateMetadataHelper->LoadMetadataFile(metadataFileName)){
-        return muscateMetadataHelper;
+    //Parsed without holding the lock, so that different products can be loaded concurrently.
+    //Only Muscate existing so far here.
+    std::shared_ptr<MuscateMetadataHelper> muscateMetadataHelper = std::make_shared<MuscateMetadataHelper>();
+    if (!muscateMetadataHelper->LoadMetadataFile(metadataFileName, content)){
+        itkExceptionMacro("Unable to read metadata from " << metadataFileName);
+    }
+    std::lock_guard<std::mutex> lock(s_CacheMutex);
+    CacheEntryType &entry = s_Cache[key];
+    if(entry.second && entry.first == modificationTime &&
+            (entry.second->GetLoadedContent() & content) == content){
+        //Another thread loaded the same file meanwhile
+        return entry.second;
     }
-    itkExceptionMacro("Unable to read metadata from " << metadataFileName);
-    return NULL;
+    entry = CacheEntryType(modificationTime, muscateMetadataHelper);
+    return muscateMetadataHelper;
+}
+
+void MetadataHelperFactory::ClearCache()
+{
+    std::lock_guard<std::mutex> lock(s_CacheMutex);
+    s_Cache.clear();
 }
@@ -42,9 +42,16 @@ MuscateMetadataHelper::MuscateMetadataHelper()
 bool MuscateMetadataHelper::DoLoadMetadata()
 {
 	MuscateMetadataReaderType::Pointer muscateMetadataReader = MuscateMetadataReaderType::New();
-	if (m_metadata = muscateMetadataReader->ReadMetadata(m_inputMetadataFileName)) {
+	unsigned int sections = ts::muscate::SECTION_ALL;
+	if(!(m_nLoadedContent & MTD_CONTENT_ANGLES)){
+		//Only the sections used by the product API
+		sections = ts::muscate::SECTION_IDENTIFICATION | ts::muscate::SECTION_PRODUCT_CHARACTERISTICS |
+				ts::muscate::SECTION_PRODUCT_ORGANISATION | ts::muscate::SECTION_RADIOMETRIC;
+	}
+	if (m_metadata = muscateMetadataReader->ReadMetadata(m_inputMetadataFileName, sections)) {
 		m_Mission = m_metadata->ProductCharacteristics.Platform;
 		m_productLevel = m_metadata->ProductCharacteristics.ProductLevel;
+		m_GeographicalZone = m_metadata->DatasetIdentification.GeographicalZone;
 		if (IsMissionKnown(m_metadata->ProductCharacteristics.Platform)){
 			m_ReflQuantifVal = std::stod(m_metadata->RadiometricInformations.quantificationValues[0].value); //We know that the First one is always the reflectance-QuantValue
 			if(m_ReflQuantifVal < 1) {
@@ -61,6 +68,8 @@ bool MuscateMetadataHelper::DoLoadMetadata()
 			m_WaterFileName = getWaterFileName();
 			// compute the Snow file name
 			m_SnowFileName = getSnowFileName();
+			// compute the Edge file name
+			m_EdgeFileName = getEdgeFileName();
 			// set the acquisition date
 			m_AcquisitionDate = m_metadata->ProductCharacteristics.AcquisitionDate;
 			//Find the "nodata"-Field in the Vec of SpecialValues
@@ -69,13 +78,20 @@ bool MuscateMetadataHelper::DoLoadMetadata()
 					[](const SpecialValue& sv)->bool{return "nodata" == sv.name; })->value;
 
 
+			const bool bHasAngles = (m_nLoadedContent & MTD_CONTENT_ANGLES) != 0;
 			if(m_metadata->ProductCharacteristics.Platform.find(SENTINEL_MISSION_STR) != std::string::npos){
 				//Set Mission Specific Values
 				UpdateValuesForSentinel();
 				//Set the Metadata Angle-Grids
-				UpdateAngles();
+				if(bHasAngles){
+					UpdateAngles();
+				}
 			}else if(m_metadata->ProductCharacteristics.Platform.find(VENUS_MISSION_STR) != std::string::npos){
 				UpdateValuesForVenus();
+				//Venus only provides the mean angles
+				if(bHasAngles){
+					UpdateMeanAngles();
+				}
 			}
 			return true;
 		}else {
@@ -129,66 +145,68 @@ void MuscateMetadataHelper::UpdateValuesForSentinel(){
 
 }
 
-void MuscateMetadataHelper::UpdateAngles(){
-	m_bHasGlobalMeanAngles = true;
-	m_bHasBandMeanAngles = true;
-	m_bHasDetailedAngles = true;
-	m_detailedAnglesGridSize = 23;
+void MuscateMetadataHelper::UpdateMeanAngles(){
+	const MuscateGeometricInformations &geomInfos = m_metadata->GeometricInformations;
+	// the units are only filled if the Mean_Value_List was present in the product
+	m_bHasGlobalMeanAngles = !geomInfos.MeanSunAngle.ZenithUnit.empty();
+	m_bHasBandMeanAngles = !geomInfos.MeanViewingIncidenceAngles.empty();
 
 	// update the solar mean angle
-	m_solarMeanAngles.azimuth = m_metadata->GeometricInformations.MeanSunAngle.AzimuthValue;
-	m_solarMeanAngles.zenith = m_metadata->GeometricInformations.MeanSunAngle.ZenithValue;
+	if(m_bHasGlobalMeanAngles) {
+		m_solarMeanAngles.azimuth = geomInfos.MeanSunAngle.AzimuthValue;
+		m_solarMeanAngles.zenith = geomInfos.MeanSunAngle.ZenithValue;
+	}
 
 	// first compute the total number of bands to add into m_sensorBandsMeanAngles
 	size_t nMaxBandId = 0;
-	std::vector<MuscateAnglePair> angles = m_metadata->GeometricInformations.MeanViewingIncidenceAngles;
+	const std::vector<MuscateAnglePair> &angles = geomInfos.MeanViewingIncidenceAngles;
 
 	// compute the array size
 	unsigned int nArrSize = (nMaxBandId > angles.size() ? nMaxBandId+1 : angles.size());
 	// update the viewing mean angle
 	m_sensorBandsMeanAngles.resize(nArrSize);
+	m_sensorBandsMeanAnglesIds.resize(nArrSize);
 	for(unsigned int i = 0; i<angles.size(); i++) {
 		m_sensorBandsMeanAngles[i].azimuth = angles[i].AzimuthValue;
 		m_sensorBandsMeanAngles[i].zenith = angles[i].ZenithValue;
+		m_sensorBandsMeanAnglesIds[i] = angles[i].bandId;
 	}
+}
+
+void MuscateMetadataHelper::UpdateAngles(){
+	m_bHasDetailedAngles = true;
+	m_detailedAnglesGridSize = 23;
+
+	UpdateMeanAngles();
+	m_bHasGlobalMeanAngles = true;
+	m_bHasBandMeanAngles = true;
 
 	// extract the detailed viewing and solar angles
 	std::vector<MuscateBandViewingAnglesGrid> muscateAngles = ComputeViewingAngles(m_metadata->GeometricInformations.ViewingAngles);
-	for(unsigned int i = 0; i<muscateAngles.size(); i++) {
-		MuscateBandViewingAnglesGrid muscateGrid = muscateAngles[i];
+	for(const MuscateBandViewingAnglesGrid &muscateGrid : muscateAngles) {
 		//Return only the angles of the bands for the current resolution
-		if(m_Resolutions.doesBandTypeExist(muscateAngles[i].BandId)) {
-			//Copy MuscateBandViewingAnglesGrid to MetadataHelperViewingAnglesGrid
+		if(m_Resolutions.doesBandTypeExist(muscateGrid.BandId)) {
 			MetadataHelperViewingAnglesGrid mhGrid;
 			mhGrid.BandId = muscateGrid.BandId;
-			mhGrid.Angles.Azimuth.ColumnStep = muscateGrid.Angles.Azimuth.ColumnStep;
-			mhGrid.Angles.Azimuth.ColumnUnit = muscateGrid.Angles.Azimuth.ColumnUnit;
-			mhGrid.Angles.Azimuth.RowStep = muscateGrid.Angles.Azimuth.RowStep;
-			mhGrid.Angles.Azimuth.RowUnit = muscateGrid.Angles.Azimuth.RowUnit;
-			mhGrid.Angles.Azimuth.Values = muscateGrid.Angles.Azimuth.Values;
-
-			mhGrid.Angles.Zenith.ColumnStep = muscateGrid.Angles.Zenith.ColumnStep;
-			mhGrid.Angles.Zenith.ColumnUnit = muscateGrid.Angles.Zenith.ColumnUnit;
-			mhGrid.Angles.Zenith.RowStep = muscateGrid.Angles.Zenith.RowStep;
-			mhGrid.Angles.Zenith.RowUnit = muscateGrid.Angles.Zenith.RowUnit;
-			mhGrid.Angles.Zenith.Values = muscateGrid.Angles.Zenith.Values;
-
-			m_detailedViewingAngles.push_back(mhGrid);
+			copyAngleList(muscateGrid.Angles.Azimuth, mhGrid.Angles.Azimuth);
+			copyAngleList(muscateGrid.Angles.Zenith, mhGrid.Angles.Zenith);
+			m_detailedViewingAngles.emplace_back(std::move(mhGrid));
 		}
 	}
 
 	//Copy Muscate angles to MetadataHelper Angles
-	m_detailedSolarAngles.Azimuth.ColumnStep = m_metadata->GeometricInformations.SolarAngles.Azimuth.ColumnStep;
-	m_detailedSolarAngles.Azimuth.ColumnUnit = m_metadata->GeometricInformations.SolarAngles.Azimuth.ColumnUnit;
-	m_detailedSolarAngles.Azimuth.RowStep = m_metadata->GeometricInformations.SolarAngles.Azimuth.RowStep;
-	m_detailedSolarAngles.Azimuth.RowUnit = m_metadata->GeometricInformations.SolarAngles.Azimuth.RowUnit;
-	m_detailedSolarAngles.Azimuth.Values = m_metadata->GeometricInformations.SolarAngles.Azimuth.Values;
+	copyAngleList(m_metadata->GeometricInformations.SolarAngles.Azimuth, m_detailedSolarAngles.Azimuth);
+	copyAngleList(m_metadata->GeometricInformations.SolarAngles.Zenith, m_detailedSolarAngles.Zenith);
+}
 
-	m_detailedSolarAngles.Zenith.ColumnStep = m_metadata->GeometricInformations.SolarAngles.Zenith.ColumnStep;
-	m_detailedSolarAngles.Zenith.ColumnUnit = m_metadata->GeometricInformations.SolarAngles.Zenith.ColumnUnit;
-	m_detailedSolarAngles.Zenith.RowStep = m_metadata->GeometricInformations.SolarAngles.Zenith.RowStep;
-	m_detailedSolarAngles.Zenith.RowUnit = m_metadata->GeometricInformations.SolarAngles.Zenith.RowUnit;
-	m_detailedSolarAngles.Zenith.Values = m_metadata->GeometricInformations.SolarAngles.Zenith.Values;
+void MuscateMetadataHelper::copyAngleList(const MuscateAngleList &src, MetadataHelperAngleList &dst){
+	dst.ColumnStep = src.ColumnStep;
+	dst.ColumnUnit = src.ColumnUnit;
+	dst.RowStep = src.RowStep;
+	dst.RowUnit = src.RowUnit;
+	dst.Rows = src.Rows;
+	dst.Cols = src.Cols;
+	dst.Values = src.Values;
 }
 
 productReturnType MuscateMetadataHelper::getAllImageFileNames(const std::string &name) {
@@ -264,9 +282,16 @@ productReturnType MuscateMetadataHelper::getQualityFileName(){
 	}
 	return maskList;
 }
-std::string MuscateMetadataHelper::getFileNameByString(const productReturnType &vec, const std::string &toFind){
-	auto el = std::find_if(vec.begin(), vec.end(), [toFind](const std::string& i)->bool{return i.find(toFind) != std::string::npos;});
-	return *el;
+productReturnType MuscateMetadataHelper::getEdgeFileName(){
+	productReturnType maskList = getAllMaskFileNames("Edge");
+	if(maskList.size() > getNumberOfResolutions()){
+		removeDuplicateElements(maskList);
+	}
+	return maskList;
+}
+std::string MuscateMetadataHelper::getFileNameByString(const productReturnType &vec, const std::string &toFind) const{
+	auto el = std::find_if(vec.begin(), vec.end(), [&toFind](const std::string& i)->bool{return i.find(toFind) != std::string::npos;});
+	return el != vec.end() ? *el : std::string();
 }
 
 void MuscateMetadataHelper::removeDuplicateElements(productReturnType &vec){
@@ -0,0 +1,400 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "PerformanceTelemetry.h"
+#include "otbWrapperAddProcessToWatchEvent.h"
+#include "itkImageBase.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::string EscapeJSON(const std::string &value){
+	std::ostringstream escaped;
+	for(const char c : value){
+		switch(c){
+		case '"': escaped << "\\\""; break;
+		case '\\': escaped << "\\\\"; break;
+		case '\n': escaped << "\\n"; break;
+		case '\t': escaped << "\\t"; break;
+		default:
+			if(static_cast<unsigned char>(c) < 0x20){
+				escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+			}else{
+				escaped << c;
+			}
+		}
+	}
+	return escaped.str();
+}
+
+void WriteFiles(std::ostream &out, const std::vector<ts::PerformanceTelemetry::FileRecord> &files, const bool &bOutputs){
+	out << "[";
+	for(size_t i = 0; i < files.size(); i++){
+		const ts::PerformanceTelemetry::FileRecord &file = files[i];
+		out << (i == 0 ? "" : ", ") << "{\"parameter\": \"" << EscapeJSON(file.parameter) << "\", \"file\": \"" << EscapeJSON(file.filename)
+				<< "\", \"fileSize\": " << file.fileSize;
+		if(bOutputs){
+			out << ", \"streams\": " << file.streams << ", \"pixels\": " << file.pixels;
+		}
+		out << "}";
+	}
+	out << "]";
+}
+
+uint64_t GetNumberOfPixels(itk::DataObject *data){
+	const itk::ImageBase<2> *image = dynamic_cast<const itk::ImageBase<2>*>(data);
+	return image == NULL ? 0 : image->GetLargestPossibleRegion().GetNumberOfPixels();
+}
+
+} // namespace
+
+std::atomic<unsigned int> ts::PerformanceTelemetry::s_nRecords(0);
+
+ts::PerformanceTelemetry::PerformanceTelemetry() : m_App(NULL), m_StartWall(0), m_StartCpu(0), m_StartEpoch(0), m_nActiveWriters(0),
+		m_ApplicationObserver(0) {
+}
+
+ts::PerformanceTelemetry::~PerformanceTelemetry(){
+	if(m_App != NULL){
+		m_App->RemoveObserver(m_ApplicationObserver);
+	}
+	// The objects still observed are alive, the deleted ones were forgotten
+	for(const std::pair<itk::Object* const, std::vector<unsigned long> > &observers : m_Observers){
+		for(const unsigned long tag : observers.second){
+			observers.first->RemoveObserver(tag);
+		}
+	}
+	for(const std::pair<itk::Object* const, unsigned long> &observer : m_DeleteObservers){
+		observer.first->RemoveObserver(observer.second);
+	}
+	// The application is being destroyed, thus only the files gathered before are written
+	m_App = NULL;
+	if(!m_Filename.empty()){
+		Write();
+	}
+}
+
+std::string ts::PerformanceTelemetry::GetDirectory(){
+	const char *directory = std::getenv("WASP_TELEMETRY");
+	return directory == NULL ? "" : directory;
+}
+
+void ts::PerformanceTelemetry::Start(otb::Wrapper::Application *app){
+	Start(app->GetName(), GetDirectory());
+	if(m_Filename.empty()){
+		return;
+	}
+	m_App = app;
+	m_ApplicationCommand = CommandType::New();
+	m_ApplicationCommand->SetCallbackFunction(this, &PerformanceTelemetry::OnApplicationEvent);
+	// Not kept in m_Observers, which would keep the application alive
+	m_ApplicationObserver = app->AddObserver(otb::Wrapper::AddProcessToWatchEvent(), m_ApplicationCommand);
+	UpdateFiles();
+}
+
+void ts::PerformanceTelemetry::Start(const std::string &name, const std::string &directory){
+	if(directory.empty()){
+		return;
+	}
+	m_Name = name;
+	m_Filename = directory + "/" + name + "_" + std::to_string(getpid()) + "_" + std::to_string(s_nRecords++) + ".json";
+	m_StartWall = GetWallTime();
+	m_StartCpu = GetCpuTime();
+	m_StartEpoch = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+	m_WriterCommand = CommandType::New();
+	m_WriterCommand->SetCallbackFunction(this, &PerformanceTelemetry::OnWriterEvent);
+	m_FilterCommand = CommandType::New();
+	m_FilterCommand->SetCallbackFunction(this, &PerformanceTelemetry::OnFilterEvent);
+	m_DeleteCommand = CommandType::New();
+	m_DeleteCommand->SetCallbackFunction(this, &PerformanceTelemetry::OnDeleteEvent);
+}
+
+void ts::PerformanceTelemetry::AddInput(const std::string &parameter, const std::string &filename){
+	FileRecord input;
+	input.parameter = parameter;
+	input.filename = filename;
+	input.fileSize = GetFileSize(filename);
+	m_Inputs.push_back(input);
+}
+
+void ts::PerformanceTelemetry::AddOutput(const std::string &parameter, const std::string &filename, itk::DataObject *image){
+	FileRecord output;
+	output.parameter = parameter;
+	output.filename = filename;
+	output.image = image;
+	m_Outputs.push_back(output);
+}
+
+void ts::PerformanceTelemetry::WatchWriter(itk::ProcessObject *writer){
+	if(m_Filename.empty()){
+		return;
+	}
+	Observe(writer, itk::StartEvent(), m_WriterCommand);
+	Observe(writer, itk::EndEvent(), m_WriterCommand);
+}
+
+const ts::PerformanceTelemetry::FilterRecord *ts::PerformanceTelemetry::GetFilterRecord(const itk::ProcessObject *process) const{
+	std::map<const itk::ProcessObject*, size_t>::const_iterator it = m_FilterIndex.find(process);
+	if(it == m_FilterIndex.end() || m_Filters[it->second].executions == 0){
+		return NULL;
+	}
+	return &m_Filters[it->second];
+}
+
+std::string ts::PerformanceTelemetry::ToJSON(){
+	UpdateFiles();
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	std::ostringstream out;
+	out << std::setprecision(15);
+	out << "{\"application\": \"" << EscapeJSON(m_Name) << "\", \"pid\": " << getpid() << ", \"start\": " << m_StartEpoch
+			<< ", \"wallTime\": " << GetWallTime() - m_StartWall << ", \"cpuTime\": " << GetCpuTime() - m_StartCpu
+			// Peak of the whole process, ru_maxrss is in kB
+			<< ", \"peakRSS\": " << uint64_t(usage.ru_maxrss) * 1024 << ", \"inputs\": ";
+	WriteFiles(out, m_Inputs, false);
+	out << ", \"outputs\": ";
+	WriteFiles(out, m_Outputs, true);
+	out << ", \"filters\": [";
+	bool bFirst = true;
+	for(const FilterRecord &filter : m_Filters){
+		if(filter.executions == 0){
+			continue;
+		}
+		out << (bFirst ? "" : ", ") << "{\"name\": \"" << EscapeJSON(filter.name) << "\", \"executions\": " << filter.executions
+				<< ", \"wallTime\": " << filter.wallTime << ", \"pixels\": " << filter.pixels << "}";
+		bFirst = false;
+	}
+	out << "]}";
+	return out.str();
+}
+
+void ts::PerformanceTelemetry::Write(){
+	if(m_Filename.empty()){
+		return;
+	}
+	const std::string json = ToJSON();
+	// Written to a temporary file first, so that readers never see a partial record
+	const std::string tempFilename = m_Filename + ".tmp";
+	std::ofstream file(tempFilename.c_str());
+	file << json << std::endl;
+	file.close();
+	if(!file || std::rename(tempFilename.c_str(), m_Filename.c_str()) != 0){
+		std::cout << "Cannot write the telemetry record " << m_Filename << std::endl;
+	}
+}
+
+void ts::PerformanceTelemetry::ObservePipeline(itk::ProcessObject *process){
+	if(process == NULL || m_Observers.count(process) != 0){
+		return;
+	}
+	// A filter observed by a previous writer keeps its record
+	if(m_FilterIndex.count(process) == 0){
+		m_FilterIndex[process] = m_Filters.size();
+		FilterRecord filter;
+		filter.name = process->GetNameOfClass();
+		m_Filters.push_back(filter);
+	}
+	Observe(process, itk::StartEvent(), m_FilterCommand);
+	Observe(process, itk::EndEvent(), m_FilterCommand);
+	for(const itk::DataObject::Pointer &input : process->GetInputs()){
+		if(input.IsNotNull()){
+			ObservePipeline(input->GetSource().GetPointer());
+		}
+	}
+}
+
+void ts::PerformanceTelemetry::Observe(itk::Object *object, const itk::EventObject &event, itk::Command *command){
+	// The object is not kept alive, it is forgotten once deleted
+	if(m_DeleteObservers.count(object) == 0){
+		m_DeleteObservers[object] = object->AddObserver(itk::DeleteEvent(), m_DeleteCommand);
+	}
+	m_Observers[object].push_back(object->AddObserver(event, command));
+}
+
+void ts::PerformanceTelemetry::RemoveObservers(itk::Object *object){
+	std::map<itk::Object*, std::vector<unsigned long> >::iterator it = m_Observers.find(object);
+	if(it == m_Observers.end()){
+		return;
+	}
+	for(const unsigned long tag : it->second){
+		object->RemoveObserver(tag);
+	}
+	m_Observers.erase(it);
+}
+
+void ts::PerformanceTelemetry::OnApplicationEvent(itk::Object *, const itk::EventObject &event){
+	const otb::Wrapper::AddProcessToWatchEvent *watchEvent = dynamic_cast<const otb::Wrapper::AddProcessToWatchEvent*>(&event);
+	if(watchEvent != NULL && watchEvent->GetProcess() != NULL){
+		WatchWriter(watchEvent->GetProcess());
+	}
+}
+
+void ts::PerformanceTelemetry::OnWriterEvent(itk::Object *caller, const itk::EventObject &event){
+	itk::ProcessObject *writer = dynamic_cast<itk::ProcessObject*>(caller);
+	if(itk::StartEvent().CheckEvent(&event)){
+		m_nActiveWriters++;
+		// The writer itself is not recorded, its inputs are the filters of the pipeline
+		for(const itk::DataObject::Pointer &input : writer->GetInputs()){
+			if(input.IsNotNull()){
+				ObservePipeline(input->GetSource().GetPointer());
+			}
+		}
+	}else if(itk::EndEvent().CheckEvent(&event)){
+		m_nActiveWriters = std::max(0, m_nActiveWriters - 1);
+		UpdateFiles();
+		// The outputs added explicitly for this writer are final, their images are not kept alive any longer
+		const std::vector<itk::DataObject::Pointer> inputs = writer->GetInputs();
+		for(FileRecord &output : m_Outputs){
+			if(!output.bFromApplication && std::find(inputs.begin(), inputs.end(), output.image) != inputs.end()){
+				output.image = NULL;
+			}
+		}
+		if(m_nActiveWriters == 0){
+			// The pipelines are observed again by the next writer, their records are kept
+			for(const std::pair<const itk::ProcessObject* const, size_t> &filter : m_FilterIndex){
+				RemoveObservers(const_cast<itk::ProcessObject*>(filter.first));
+			}
+		}
+		Write();
+	}
+}
+
+void ts::PerformanceTelemetry::OnFilterEvent(itk::Object *caller, const itk::EventObject &event){
+	if(m_nActiveWriters == 0){
+		return;
+	}
+	itk::ProcessObject *process = dynamic_cast<itk::ProcessObject*>(caller);
+	FilterRecord &filter = m_Filters[m_FilterIndex[process]];
+	if(itk::StartEvent().CheckEvent(&event)){
+		filter.startWall = GetWallTime();
+	}else if(itk::EndEvent().CheckEvent(&event)){
+		filter.executions++;
+		filter.wallTime += GetWallTime() - filter.startWall;
+		if(process->GetNumberOfOutputs() > 0){
+			const itk::ImageBase<2> *output = dynamic_cast<const itk::ImageBase<2>*>(process->GetOutputs()[0].GetPointer());
+			if(output != NULL){
+				filter.pixels += output->GetRequestedRegion().GetNumberOfPixels();
+			}
+		}
+	}
+}
+
+void ts::PerformanceTelemetry::OnDeleteEvent(itk::Object *caller, const itk::EventObject &){
+	// Invoked before the deletion, the address may be reused by another object afterwards
+	m_Observers.erase(caller);
+	m_DeleteObservers.erase(caller);
+	m_FilterIndex.erase(dynamic_cast<const itk::ProcessObject*>(caller));
+}
+
+void ts::PerformanceTelemetry::UpdateFiles(){
+	if(m_App != NULL){
+		UpdateApplicationFiles();
+	}
+	for(FileRecord &output : m_Outputs){
+		output.fileSize = GetFileSize(output.filename);
+		if(output.image != NULL){
+			output.pixels = GetNumberOfPixels(output.image);
+			// Kept if the source was deleted in the meantime
+			const FilterRecord *source = GetFilterRecord(output.image->GetSource().GetPointer());
+			if(source != NULL){
+				output.streams = source->executions;
+			}
+		}
+	}
+}
+
+void ts::PerformanceTelemetry::UpdateApplicationFiles(){
+	// The files added explicitly are kept, the ones of the parameters are read again, as they may have changed since the last update
+	const auto isFromApplication = [](const FileRecord &file){ return file.bFromApplication; };
+	m_Inputs.erase(std::remove_if(m_Inputs.begin(), m_Inputs.end(), isFromApplication), m_Inputs.end());
+	m_Outputs.erase(std::remove_if(m_Outputs.begin(), m_Outputs.end(), isFromApplication), m_Outputs.end());
+	const size_t nInputs = m_Inputs.size();
+	const size_t nOutputs = m_Outputs.size();
+	for(const std::string &key : m_App->GetParametersKeys(true)){
+		if(!m_App->IsParameterEnabled(key) || !m_App->HasValue(key)){
+			continue;
+		}
+		switch(m_App->GetParameterType(key)){
+		case otb::Wrapper::ParameterType_InputImage:
+		case otb::Wrapper::ParameterType_InputFilename:
+			AddInput(key, m_App->GetParameterString(key));
+			break;
+		case otb::Wrapper::ParameterType_InputImageList:
+		case otb::Wrapper::ParameterType_InputFilenameList:
+			for(const std::string &filename : m_App->GetParameterStringList(key)){
+				AddInput(key, filename);
+			}
+			break;
+		case otb::Wrapper::ParameterType_OutputImage:
+			AddOutput(key, m_App->GetParameterString(key), m_App->GetParameterOutputImage(key));
+			break;
+		case otb::Wrapper::ParameterType_OutputFilename:
+			AddOutput(key, m_App->GetParameterString(key), NULL);
+			break;
+		default:
+			break;
+		}
+	}
+	for(size_t i = nInputs; i < m_Inputs.size(); i++){
+		m_Inputs[i].bFromApplication = true;
+	}
+	for(size_t i = nOutputs; i < m_Outputs.size(); i++){
+		m_Outputs[i].bFromApplication = true;
+	}
+}
+
+uint64_t ts::PerformanceTelemetry::GetFileSize(const std::string &filename){
+	// Inputs kept in memory by a previous application have no filename, extended filename options are stripped
+	struct stat buf;
+	const std::string path = filename.substr(0, filename.find('?'));
+	if(path.empty() || stat(path.c_str(), &buf) != 0){
+		return 0;
+	}
+	return uint64_t(buf.st_size);
+}
+
+double ts::PerformanceTelemetry::GetWallTime(){
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double ts::PerformanceTelemetry::GetCpuTime(){
+	// CPU time of all threads of the process, only meaningful for the whole application
+	struct timespec time;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "QuicklookBuilder.h"
+#include "gdal_priv.h"
+#include "itkMacro.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace ts;
+
+QuicklookBuilder::QuicklookBuilder(const std::string &filename, const size_t &nBands, const size_t &outWidth, const size_t &outHeight,
+		const double &scaleMin, const double &scaleMax, const double &noDataValue) :
+		m_FileName(filename), m_nBands(nBands), m_OutWidth(outWidth), m_OutHeight(outHeight),
+		m_ScaleMin(scaleMin), m_ScaleMax(scaleMax), m_NoDataValue(noDataValue), m_InWidth(0), m_InHeight(0){
+}
+
+void QuicklookBuilder::SetInputSize(const size_t &width, const size_t &height){
+	m_InWidth = width;
+	m_InHeight = height;
+	m_ColumnMap.resize(width);
+	for(size_t col = 0; col < width; col++){
+		m_ColumnMap[col] = col * m_OutWidth / width;
+	}
+	m_Sum.assign(m_nBands * m_OutWidth * m_OutHeight, 0);
+	m_Count.assign(m_nBands * m_OutWidth * m_OutHeight, 0);
+}
+
+void QuicklookBuilder::AddRows(const size_t &band, const size_t &firstRow, const size_t &nRows, const double *buffer){
+	if(band >= m_nBands || firstRow + nRows > m_InHeight){
+		itkGenericExceptionMacro("Rows " << firstRow << " to " << firstRow + nRows << " of band " << band
+				<< " are outside of the input of quicklook " << m_FileName);
+	}
+	for(size_t row = 0; row < nRows; row++){
+		const size_t outOffset = (band * m_OutHeight + (firstRow + row) * m_OutHeight / m_InHeight) * m_OutWidth;
+		double *sum = m_Sum.data() + outOffset;
+		double *count = m_Count.data() + outOffset;
+		const double *values = buffer + row * m_InWidth;
+		for(size_t col = 0; col < m_InWidth; col++){
+			if(values[col] != m_NoDataValue){
+				sum[m_ColumnMap[col]] += values[col];
+				count[m_ColumnMap[col]]++;
+			}
+		}
+	}
+}
+
+unsigned char QuicklookBuilder::GetValue(const size_t &band, const size_t &x, const size_t &y) const{
+	const size_t index = (band * m_OutHeight + y) * m_OutWidth + x;
+	if(m_Count[index] == 0){
+		return 0;
+	}
+	const double scaled = (m_Sum[index] / m_Count[index] - m_ScaleMin) * 255.0 / (m_ScaleMax - m_ScaleMin);
+	return static_cast<unsigned char>(std::lround(std::min(std::max(scaled, 0.0), 255.0)));
+}
+
+void QuicklookBuilder::Write(){
+	GDALAllRegister();
+	GDALDriver *pMemDriver = GetGDALDriverManager()->GetDriverByName("MEM");
+	GDALDriver *pJpegDriver = GetGDALDriverManager()->GetDriverByName("JPEG");
+	if(!pMemDriver || !pJpegDriver){
+		itkGenericExceptionMacro("GDAL MEM or JPEG driver not available");
+	}
+	GDALDataset *pDataset = pMemDriver->Create("", int(m_OutWidth), int(m_OutHeight), int(m_nBands), GDT_Byte, nullptr);
+	if(!pDataset){
+		itkGenericExceptionMacro("Cannot create quicklook " << m_FileName << ": " << CPLGetLastErrorMsg());
+	}
+	std::vector<unsigned char> bandBuffer(m_OutWidth * m_OutHeight);
+	for(size_t band = 0; band < m_nBands; band++){
+		for(size_t y = 0; y < m_OutHeight; y++){
+			for(size_t x = 0; x < m_OutWidth; x++){
+				bandBuffer[y * m_OutWidth + x] = GetValue(band, x, y);
+			}
+		}
+		pDataset->GetRasterBand(int(band + 1))->RasterIO(GF_Write, 0, 0, int(m_OutWidth), int(m_OutHeight),
+				bandBuffer.data(), int(m_OutWidth), int(m_OutHeight), GDT_Byte, 0, 0, nullptr);
+	}
+	GDALDataset *pJpeg = pJpegDriver->CreateCopy(m_FileName.c_str(), pDataset, FALSE, nullptr, nullptr, nullptr);
+	GDALClose(pDataset);
+	if(!pJpeg){
+		itkGenericExceptionMacro("Cannot write quicklook " << m_FileName << ": " << CPLGetLastErrorMsg());
+	}
+	GDALClose(pJpeg);
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "RegionOfInterest.h"
+#include "itkMacro.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+ts::RegionOfInterest::RegionOfInterest(const double &xMin, const double &yMin, const double &xMax, const double &yMax)
+	: m_bIsSet(true), m_xMin(xMin), m_yMin(yMin), m_xMax(xMax), m_yMax(yMax) {
+	if(!(xMin < xMax) || !(yMin < yMax)){
+		itkGenericExceptionMacro("Empty region of interest: " << ToString());
+	}
+}
+
+ts::RegionOfInterest ts::RegionOfInterest::FromStringList(const std::vector<std::string> &values){
+	if(values.size() != 4){
+		itkGenericExceptionMacro("The region of interest needs 4 values xmin ymin xmax ymax, got " << values.size());
+	}
+	double corners[4];
+	for(size_t i = 0; i < values.size(); i++){
+		try{
+			size_t nParsed = 0;
+			corners[i] = std::stod(values[i], &nParsed);
+			if(nParsed != values[i].size()){
+				throw std::invalid_argument(values[i]);
+			}
+		}catch(std::exception &){
+			itkGenericExceptionMacro("Invalid coordinate in the region of interest: " << values[i]);
+		}
+	}
+	return RegionOfInterest(corners[0], corners[1], corners[2], corners[3]);
+}
+
+ts::RegionOfInterest::RegionType ts::RegionOfInterest::GetRegion(const ImageBaseType *image) const{
+	const RegionType &largest = image->GetLargestPossibleRegion();
+	if(!m_bIsSet){
+		return largest;
+	}
+	ImageBaseType::PointType upperLeft, lowerRight;
+	upperLeft[0] = m_xMin;
+	upperLeft[1] = m_yMax;
+	lowerRight[0] = m_xMax;
+	lowerRight[1] = m_yMin;
+	itk::ContinuousIndex<double, 2> c1, c2;
+	image->TransformPhysicalPointToContinuousIndex(upperLeft, c1);
+	image->TransformPhysicalPointToContinuousIndex(lowerRight, c2);
+	RegionType region;
+	for(unsigned int dim = 0; dim < 2; dim++){
+		long start = 0;
+		size_t count = 0;
+		GetAxisRange(std::min(c1[dim], c2[dim]), std::max(c1[dim], c2[dim]), largest.GetIndex(dim), largest.GetSize(dim), start, count);
+		if(count == 0){
+			itkGenericExceptionMacro("The region of interest " << ToString() << " does not intersect the image of size "
+					<< largest.GetSize(0) << "x" << largest.GetSize(1) << " at " << image->GetOrigin());
+		}
+		region.SetIndex(dim, start);
+		region.SetSize(dim, count);
+	}
+	return region;
+}
+
+void ts::RegionOfInterest::GetAxisRange(const double &lo, const double &hi, const long &first, const size_t &size, long &start, size_t &count){
+	// Pixel i covers the continuous indices [i - 0.5, i + 0.5], thus it is kept if its centre i lies within [lo, hi]
+	start = std::max<long>(static_cast<long>(std::ceil(lo)), first);
+	const long last = std::min<long>(static_cast<long>(std::floor(hi)), first + long(size) - 1);
+	count = last < start ? 0 : size_t(last - start + 1);
+}
+
+std::string ts::RegionOfInterest::ToString() const{
+	std::ostringstream stream;
+	stream.precision(12);
+	stream << "[" << m_xMin << ", " << m_yMin << ", " << m_xMax << ", " << m_yMax << "]";
+	return stream.str();
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "StreamingAlignment.h"
+#include "otbConfigurationManager.h"
+#include "gdal_priv.h"
+#include "itkMacro.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+size_t GreatestCommonDivisor(size_t a, size_t b){
+	while(b != 0){
+		const size_t r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+size_t LeastCommonMultiple(const size_t &a, const size_t &b){
+	return a / GreatestCommonDivisor(a, b) * b;
+}
+
+size_t CeilDiv(const size_t &a, const size_t &b){
+	return (a + b - 1) / b;
+}
+
+/**
+ * @brief Number of blocks touched along one axis by the consecutive intervals of the given length
+ * @param offset Position of the first interval relative to the blocks
+ */
+uint64_t CountAxisDecodes(const size_t &length, const size_t &interval, const size_t &block, const size_t &offset){
+	uint64_t decodes = 0;
+	for(size_t start = 0; start < length; start += interval){
+		const size_t end = std::min(length, start + interval);
+		decodes += (offset + end - 1) / block - (offset + start) / block + 1;
+	}
+	return decodes;
+}
+
+/**
+ * @brief Log an info or a warning through the logger of the application, or print it if there is none
+ */
+void Log(itk::Logger *logger, const bool &bWarning, const std::string &message){
+	if(logger == NULL){
+		(bWarning ? std::cerr : std::cout) << message << std::endl;
+	}else if(bWarning){
+		logger->Warning(message + "\n");
+	}else{
+		logger->Info(message + "\n");
+	}
+}
+
+} // namespace
+
+ts::StreamingAlignment::BlockLayout ts::StreamingAlignment::GetBlockLayout(const std::string &filename, const RegionOfInterest &roi){
+	const std::string path = filename.substr(0, filename.find('?'));
+	GDALAllRegister();
+	GDALDataset *dataset = static_cast<GDALDataset*>(GDALOpen(path.c_str(), GA_ReadOnly));
+	if(dataset == NULL){
+		itkGenericExceptionMacro("Cannot open " << path);
+	}
+	BlockLayout layout;
+	layout.width = dataset->GetRasterXSize();
+	layout.height = dataset->GetRasterYSize();
+	if(dataset->GetRasterCount() > 0){
+		int blockWidth = 1, blockHeight = 1;
+		dataset->GetRasterBand(1)->GetBlockSize(&blockWidth, &blockHeight);
+		layout.blockWidth = std::max(blockWidth, 1);
+		layout.blockHeight = std::max(blockHeight, 1);
+		for(int i = 1; i <= dataset->GetRasterCount(); i++){
+			layout.bytesPerPixel += GDALGetDataTypeSize(dataset->GetRasterBand(i)->GetRasterDataType()) / 8;
+		}
+	}
+	double geoTransform[6] = {0, 1, 0, 0, 1, 0};
+	const bool bHasGeoTransform = dataset->GetGeoTransform(geoTransform) == CE_None;
+	GDALClose(dataset);
+	if(!roi.IsSet()){
+		return layout;
+	}
+	if(!bHasGeoTransform || geoTransform[1] == 0 || geoTransform[5] == 0){
+		itkGenericExceptionMacro("No georeferencing in " << path << " to locate the region of interest " << roi.ToString());
+	}
+	// Same pixels as RegionOfInterest::GetRegion() keeps, the pixel centres being at the continuous indices
+	const double colMin = (roi.GetXMin() - geoTransform[0]) / geoTransform[1] - 0.5;
+	const double colMax = (roi.GetXMax() - geoTransform[0]) / geoTransform[1] - 0.5;
+	const double rowMin = (roi.GetYMax() - geoTransform[3]) / geoTransform[5] - 0.5;
+	const double rowMax = (roi.GetYMin() - geoTransform[3]) / geoTransform[5] - 0.5;
+	long xStart = 0, yStart = 0;
+	size_t width = 0, height = 0;
+	RegionOfInterest::GetAxisRange(std::min(colMin, colMax), std::max(colMin, colMax), 0, layout.width, xStart, width);
+	RegionOfInterest::GetAxisRange(std::min(rowMin, rowMax), std::max(rowMin, rowMax), 0, layout.height, yStart, height);
+	if(width == 0 || height == 0){
+		itkGenericExceptionMacro("The region of interest " << roi.ToString() << " does not intersect " << path);
+	}
+	layout.xStart = size_t(xStart);
+	layout.yStart = size_t(yStart);
+	layout.width = width;
+	layout.height = height;
+	return layout;
+}
+
+ts::StreamingAlignment::BlockLayout ts::StreamingAlignment::GetCommonBlockLayout(const std::vector<std::string> &filenames, const RegionOfInterest &roi){
+	BlockLayout common;
+	bool bFirst = true;
+	for(const std::string &filename : filenames){
+		if(filename.empty()){
+			continue;
+		}
+		const BlockLayout layout = GetBlockLayout(filename, roi);
+		if(bFirst){
+			common = layout;
+			bFirst = false;
+			continue;
+		}
+		if(layout.width != common.width || layout.height != common.height){
+			itkGenericExceptionMacro("Size of the region of " << filename << " differs from the other inputs: "
+					<< layout.width << "x" << layout.height << " instead of " << common.width << "x" << common.height);
+		}
+		// Strips of different heights are still full-width strips
+		common.blockWidth = std::min(LeastCommonMultiple(common.blockWidth, layout.blockWidth), common.width);
+		common.blockHeight = std::min(LeastCommonMultiple(common.blockHeight, layout.blockHeight), common.height);
+		common.bytesPerPixel += layout.bytesPerPixel;
+	}
+	if(bFirst){
+		itkGenericExceptionMacro("No input given to compute the block layout");
+	}
+	return common;
+}
+
+ts::StreamingAlignment::Splitting ts::StreamingAlignment::GetDefaultSplitting(const BlockLayout &layout, const unsigned int &ramMB){
+	const uint64_t imageSize = uint64_t(layout.width) * layout.height * std::max<size_t>(layout.bytesPerPixel, 1);
+	const size_t nSplits = std::max<uint64_t>(1, (imageSize + GetAvailableRAM(ramMB) - 1) / GetAvailableRAM(ramMB));
+	Splitting splitting;
+	splitting.bTiled = false;
+	splitting.size = std::max<size_t>(1, CeilDiv(layout.height, std::min(nSplits, std::max<size_t>(layout.height, 1))));
+	return splitting;
+}
+
+ts::StreamingAlignment::Splitting ts::StreamingAlignment::GetAlignedSplitting(const BlockLayout &layout, const unsigned int &ramMB, const bool &bAllowTiles){
+	const uint64_t ram = GetAvailableRAM(ramMB);
+	const size_t bytesPerPixel = std::max<size_t>(layout.bytesPerPixel, 1);
+	Splitting splitting;
+	if(bAllowTiles && layout.IsTiled()){
+		// Square tiles, so the tile size has to be a multiple of both block dimensions
+		const size_t block = LeastCommonMultiple(layout.blockWidth, layout.blockHeight);
+		const size_t maxSize = size_t(std::sqrt(double(ram) / bytesPerPixel));
+		splitting.bTiled = true;
+		const size_t imageSize = CeilDiv(std::max(layout.width, layout.height), block) * block;
+		splitting.size = std::min(std::max<size_t>(1, maxSize / block) * block, imageSize);
+	}else{
+		const uint64_t rowSize = uint64_t(std::max<size_t>(layout.width, 1)) * bytesPerPixel;
+		const size_t maxLines = size_t(ram / rowSize);
+		splitting.bTiled = false;
+		const size_t imageLines = CeilDiv(layout.height, layout.blockHeight) * layout.blockHeight;
+		splitting.size = std::min(std::max<size_t>(1, maxLines / layout.blockHeight) * layout.blockHeight, imageLines);
+	}
+	return splitting;
+}
+
+uint64_t ts::StreamingAlignment::CountBlockDecodes(const BlockLayout &layout, const Splitting &splitting){
+	if(layout.width == 0 || layout.height == 0 || splitting.size == 0){
+		return 0;
+	}
+	const uint64_t rowDecodes = CountAxisDecodes(layout.height, splitting.size, layout.blockHeight, layout.yStart);
+	if(!splitting.bTiled){
+		return rowDecodes * CountAxisDecodes(layout.width, layout.width, layout.blockWidth, layout.xStart);
+	}
+	return rowDecodes * CountAxisDecodes(layout.width, splitting.size, layout.blockWidth, layout.xStart);
+}
+
+std::string ts::StreamingAlignment::GetExtendedFilename(const std::string &filename, const Splitting &splitting){
+	const std::string separator = filename.find('?') == std::string::npos ? "?" : "";
+	return filename + separator + "&streaming:type=" + (splitting.bTiled ? "tiled" : "stripped")
+			+ "&streaming:sizemode=height&streaming:sizevalue=" + std::to_string(splitting.size);
+}
+
+bool ts::StreamingAlignment::ComputeAlignedSplitting(const std::string &name, const std::vector<std::string> &inputs, const unsigned int &ramMB,
+		const bool &bAllowTiles, const RegionOfInterest &roi, itk::Logger *logger, Splitting &splitting){
+	BlockLayout layout;
+	try{
+		layout = GetCommonBlockLayout(inputs, roi);
+	}catch(itk::ExceptionObject &e){
+		Log(logger, true, "Cannot align the streaming of " + name + ", falling back to the default splitting: " + e.GetDescription());
+		return false;
+	}
+	const Splitting defaultSplitting = GetDefaultSplitting(layout, ramMB);
+	splitting = GetAlignedSplitting(layout, ramMB, bAllowTiles);
+	const uint64_t nBlocks = CountAxisDecodes(layout.width, layout.width, layout.blockWidth, layout.xStart)
+			* CountAxisDecodes(layout.height, layout.height, layout.blockHeight, layout.yStart);
+	std::ostringstream report;
+	report << "Streaming " << name << " in " << (splitting.bTiled ? "tiles" : "strips") << " of "
+			<< splitting.size << (splitting.bTiled ? " pixels" : " lines")
+			<< " aligned to input blocks of " << layout.blockWidth << "x" << layout.blockHeight;
+	if(layout.xStart % layout.blockWidth != 0 || layout.yStart % layout.blockHeight != 0){
+		report << ", the region starting at " << layout.xStart << " " << layout.yStart << " inside a block";
+	}
+	report << ". Block decodes: " << CountBlockDecodes(layout, defaultSplitting) << " by default, "
+			<< CountBlockDecodes(layout, splitting) << " aligned, for " << nBlocks << " blocks";
+	Log(logger, false, report.str());
+	return true;
+}
+
+std::string ts::StreamingAlignment::AlignOutput(const std::string &filename, const std::vector<std::string> &inputs, const unsigned int &ramMB,
+		const RegionOfInterest &roi, itk::Logger *logger){
+	Splitting splitting;
+	if(filename.find("streaming:") != std::string::npos || !ComputeAlignedSplitting(filename, inputs, ramMB, true, roi, logger, splitting)){
+		return filename;
+	}
+	return GetExtendedFilename(filename, splitting);
+}
+
+uint64_t ts::StreamingAlignment::GetAvailableRAM(const unsigned int &ramMB){
+	const uint64_t ram = ramMB != 0 ? ramMB : otb::ConfigurationManager::GetMaxRAMHint();
+	return std::max<uint64_t>(ram, 1) * 1024 * 1024;
+}
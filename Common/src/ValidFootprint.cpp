@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "ValidFootprint.h"
+#include "MetadataHelper.h"
+#include "otbImage.h"
+#include "otbImageFileReader.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkContinuousIndex.h"
+#include "itkMacro.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace ts;
+
+#define FOOTPRINT_STRIP_ROWS	256
+
+std::mutex ValidFootprint::s_CacheMutex;
+std::map<std::string, ValidFootprint::ConstPointer> ValidFootprint::s_Cache;
+
+ValidFootprint::ValidFootprint(const std::string &edgeMaskFile) : m_MaskFileName(edgeMaskFile), m_bIsEmpty(true){
+	Build();
+}
+
+ValidFootprint::ConstPointer ValidFootprint::GetFootprint(const std::string &edgeMaskFile){
+	std::lock_guard<std::mutex> lock(s_CacheMutex);
+	auto it = s_Cache.find(edgeMaskFile);
+	if(it != s_Cache.end()){
+		return it->second;
+	}
+	ConstPointer footprint = std::make_shared<const ValidFootprint>(edgeMaskFile);
+	s_Cache[edgeMaskFile] = footprint;
+	return footprint;
+}
+
+ValidFootprint::ConstPointer ValidFootprint::GetFootprint(const MetadataHelper *pHelper){
+	productReturnType edgeMasks = pHelper->GetEdgeImageFileNames();
+	edgeMasks.erase(std::remove(edgeMasks.begin(), edgeMasks.end(), ""), edgeMasks.end());
+	if(edgeMasks.empty()){
+		return ConstPointer();
+	}
+	// The masks are listed from the finest to the coarsest resolution. The coarsest one is the cheapest to scan
+	// and still gives a conservative box once it is mapped on a finer grid.
+	return GetFootprint(edgeMasks.back());
+}
+
+bool ValidFootprint::IsFull() const{
+	return !m_bIsEmpty && m_ValidRegion == m_LargestRegion;
+}
+
+void ValidFootprint::Build(){
+	typedef otb::Image<unsigned char, 2>		MaskImageType;
+	typedef otb::ImageFileReader<MaskImageType>	MaskReaderType;
+
+	MaskReaderType::Pointer reader = MaskReaderType::New();
+	reader->SetFileName(m_MaskFileName);
+	try{
+		reader->UpdateOutputInformation();
+	}catch(itk::ExceptionObject &err){
+		itkGenericExceptionMacro("Cannot read edge mask " << m_MaskFileName << ": " << err.GetDescription());
+	}
+	MaskImageType *mask = reader->GetOutput();
+	m_LargestRegion = mask->GetLargestPossibleRegion();
+	m_MaskGeometry = ImageBaseType::New();
+	m_MaskGeometry->CopyInformation(mask);
+
+	const long nWidth = m_LargestRegion.GetSize(0);
+	const long nHeight = m_LargestRegion.GetSize(1);
+	const long nStartX = m_LargestRegion.GetIndex(0);
+	const long nStartY = m_LargestRegion.GetIndex(1);
+	long minX = nStartX + nWidth, maxX = nStartX - 1;
+	long minY = nStartY + nHeight, maxY = nStartY - 1;
+	m_RunOffsets.assign(1, 0);
+	m_RunOffsets.reserve(nHeight + 1);
+	m_Runs.clear();
+
+	for(long row = 0; row < nHeight; row += FOOTPRINT_STRIP_ROWS){
+		RegionType strip;
+		strip.SetIndex(0, nStartX);
+		strip.SetIndex(1, nStartY + row);
+		strip.SetSize(0, nWidth);
+		strip.SetSize(1, std::min<long>(FOOTPRINT_STRIP_ROWS, nHeight - row));
+		mask->SetRequestedRegion(strip);
+		mask->Update();
+
+		itk::ImageRegionConstIterator<MaskImageType> it(mask, strip);
+		for(it.GoToBegin(); !it.IsAtEnd(); ){
+			const long y = it.GetIndex()[1];
+			const size_t nRowRuns = m_Runs.size();
+			long runStart = -1;
+			for(long x = nStartX; x < nStartX + nWidth; ++x, ++it){
+				const bool bIsValid = (it.Get() == 0);
+				if(bIsValid && runStart < 0){
+					runStart = x;
+				}else if(!bIsValid && runStart >= 0){
+					m_Runs.push_back({runStart, x});
+					runStart = -1;
+				}
+			}
+			if(runStart >= 0){
+				m_Runs.push_back({runStart, nStartX + nWidth});
+			}
+			if(m_Runs.size() > nRowRuns){
+				minX = std::min(minX, m_Runs[nRowRuns].Begin);
+				maxX = std::max(maxX, m_Runs.back().End - 1);
+				minY = std::min(minY, y);
+				maxY = std::max(maxY, y);
+			}
+			m_RunOffsets.push_back(m_Runs.size());
+		}
+	}
+
+	m_bIsEmpty = (maxX < minX || maxY < minY);
+	if(!m_bIsEmpty){
+		m_ValidRegion.SetIndex(0, minX);
+		m_ValidRegion.SetIndex(1, minY);
+		m_ValidRegion.SetSize(0, maxX - minX + 1);
+		m_ValidRegion.SetSize(1, maxY - minY + 1);
+
+		// Outer corners of the box in physical space, the pixel centers being on integer indices
+		itk::ContinuousIndex<double, 2> first, last;
+		first[0] = minX - 0.5;
+		first[1] = minY - 0.5;
+		last[0] = maxX + 0.5;
+		last[1] = maxY + 0.5;
+		mask->TransformContinuousIndexToPhysicalPoint(first, m_FirstCorner);
+		mask->TransformContinuousIndexToPhysicalPoint(last, m_LastCorner);
+	}
+}
+
+ValidFootprint::RegionType ValidFootprint::GetValidRegion(const ImageBaseType *image, const unsigned int &nPadding) const{
+	RegionType largest = image->GetLargestPossibleRegion();
+	RegionType validRegion;
+	validRegion.SetIndex(largest.GetIndex());
+	validRegion.GetModifiableSize().Fill(0);
+	if(m_bIsEmpty){
+		return validRegion;
+	}
+
+	// Map both corners on the grid of the image. Each pixel touching the box is kept
+	long first[2], last[2];
+	itk::ContinuousIndex<double, 2> c1, c2;
+	image->TransformPhysicalPointToContinuousIndex(m_FirstCorner, c1);
+	image->TransformPhysicalPointToContinuousIndex(m_LastCorner, c2);
+	for(unsigned int dim = 0; dim < 2; dim++){
+		const double lo = std::min(c1[dim], c2[dim]);
+		const double hi = std::max(c1[dim], c2[dim]);
+		first[dim] = static_cast<long>(std::floor(lo + 0.5)) - nPadding;
+		last[dim] = static_cast<long>(std::ceil(hi - 0.5)) + nPadding;
+		first[dim] = std::max<long>(first[dim], largest.GetIndex(dim));
+		last[dim] = std::min<long>(last[dim], largest.GetIndex(dim) + largest.GetSize(dim) - 1);
+		if(last[dim] < first[dim]){
+			return validRegion;
+		}
+	}
+	validRegion.SetIndex(0, first[0]);
+	validRegion.SetIndex(1, first[1]);
+	validRegion.SetSize(0, last[0] - first[0] + 1);
+	validRegion.SetSize(1, last[1] - first[1] + 1);
+	return validRegion;
+}
+
+ValidSpans::ConstPointer ValidFootprint::GetValidSpans(const ImageBaseType *image, const unsigned int &nPadding) const{
+	const RegionType box = GetValidRegion(image, nPadding);
+	std::shared_ptr<ValidSpans> spans(new ValidSpans(box));
+	if(box.GetNumberOfPixels() == 0){
+		return spans;
+	}
+
+	// Both grids are axis aligned, thus the mapping of the continuous indices is affine along each axis
+	itk::ContinuousIndex<double, 2> imgIdx, maskIdx0, maskIdx1;
+	PointType point;
+	imgIdx.Fill(0);
+	image->TransformContinuousIndexToPhysicalPoint(imgIdx, point);
+	m_MaskGeometry->TransformPhysicalPointToContinuousIndex(point, maskIdx0);
+	imgIdx.Fill(1);
+	image->TransformContinuousIndexToPhysicalPoint(imgIdx, point);
+	m_MaskGeometry->TransformPhysicalPointToContinuousIndex(point, maskIdx1);
+	const double scaleX = maskIdx1[0] - maskIdx0[0];
+	const double scaleY = maskIdx1[1] - maskIdx0[1];
+
+	const long boxStartX = box.GetIndex(0);
+	const long boxEndX = boxStartX + box.GetSize(0);
+	const long maskStartY = m_LargestRegion.GetIndex(1);
+	const long maskEndY = maskStartY + m_LargestRegion.GetSize(1);
+	const double padding = nPadding;
+
+	std::vector<ValidSpans::Span> rowSpans;
+	for(long y = box.GetIndex(1); y < box.GetIndex(1) + long(box.GetSize(1)); y++){
+		// Mask rows touched by the (padded) image row
+		const double a = maskIdx0[1] + scaleY * (y - 0.5 - padding);
+		const double b = maskIdx0[1] + scaleY * (y + 0.5 + padding);
+		const long firstRow = std::max(maskStartY, static_cast<long>(std::floor(std::min(a, b) + 0.5)));
+		const long lastRow = std::min(maskEndY - 1, static_cast<long>(std::ceil(std::max(a, b) - 0.5)));
+
+		rowSpans.clear();
+		for(long r = firstRow; r <= lastRow; r++){
+			const size_t nRow = r - maskStartY;
+			for(size_t i = m_RunOffsets[nRow]; i < m_RunOffsets[nRow + 1]; i++){
+				// Image columns touched by the run [Begin, End)
+				const double c = (m_Runs[i].Begin - 0.5 - maskIdx0[0]) / scaleX;
+				const double d = (m_Runs[i].End - 0.5 - maskIdx0[0]) / scaleX;
+				const long begin = std::max(boxStartX, static_cast<long>(std::floor(std::min(c, d) + 0.5)) - long(nPadding));
+				const long end = std::min(boxEndX, static_cast<long>(std::ceil(std::max(c, d) - 0.5)) + long(nPadding) + 1);
+				if(begin < end){
+					rowSpans.push_back({begin, end});
+				}
+			}
+		}
+		// Merge the spans coming from several mask rows
+		std::sort(rowSpans.begin(), rowSpans.end(), [](const ValidSpans::Span &l, const ValidSpans::Span &r){ return l.Begin < r.Begin; });
+		const size_t nRowStart = spans->m_Spans.size();
+		for(const ValidSpans::Span &span : rowSpans){
+			if(spans->m_Spans.size() > nRowStart && span.Begin <= spans->m_Spans.back().End){
+				spans->m_Spans.back().End = std::max(spans->m_Spans.back().End, span.End);
+			}else{
+				spans->m_Spans.push_back(span);
+			}
+		}
+		spans->m_RowOffsets.push_back(spans->m_Spans.size());
+	}
+	return spans;
+}
+
+ValidSpans::ValidSpans(const RegionType &boundingRegion) : m_BoundingRegion(boundingRegion), m_RowOffsets(1, 0){
+}
+
+size_t ValidSpans::GetNumberOfValidPixels() const{
+	size_t nPixels = 0;
+	for(const Span &span : m_Spans){
+		nPixels += span.End - span.Begin;
+	}
+	return nPixels;
+}
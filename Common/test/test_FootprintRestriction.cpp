@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE FootprintRestriction
+#include <boost/test/unit_test.hpp>
+#include "../include/FootprintRestrictionFilter.h"
+#include "../include/FootprintFunctorImageFilter.h"
+#include "../include/ValidSpanIterator.h"
+#include "../include/ValidFootprint.h"
+#include "TestImageCreator.h"
+#include "otbImageFileWriter.h"
+#include "otbVectorImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkExtractImageFilter.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+using namespace ts;
+
+typedef otb::Image<unsigned char, 2>				MaskImageType;
+typedef otb::Image<short, 2>						ShortImageType;
+typedef otb::VectorImage<short, 2>					ShortVectorImageType;
+
+#define TEST_EDGE_MASK	"test_FootprintRestriction_EDG.tif"
+#define MASK_SIZE		10
+
+/**
+ * @brief Returns true, if the index is within one of the spans of its row
+ */
+bool isInSpans(const ValidSpans &spans, const itk::Index<2> &idx){
+	for(const ValidSpans::Span *span = spans.RowBegin(idx[1]); span != spans.RowEnd(idx[1]); ++span){
+		if(idx[0] >= span->Begin && idx[0] < span->End){
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Write an edge mask of size MASK_SIZE*MASK_SIZE, whose lower right triangle is valid
+ */
+std::string writeDiagonalEdgeMask(){
+	TestImageCreator t;
+	MaskImageType::Pointer mask = t.createTestImage<MaskImageType>(MASK_SIZE, MASK_SIZE);
+	itk::ImageRegionIteratorWithIndex<MaskImageType> it(mask, mask->GetLargestPossibleRegion());
+	for(it.GoToBegin(); !it.IsAtEnd(); ++it){
+		it.Set(it.GetIndex()[0] + it.GetIndex()[1] < MASK_SIZE ? 1 : 0);
+	}
+	std::string fileName = std::string(TEST_EDGE_MASK);
+	otb::ImageFileWriter<MaskImageType>::Pointer writer = otb::ImageFileWriter<MaskImageType>::New();
+	writer->SetInput(mask);
+	writer->SetFileName(fileName);
+	writer->Update();
+	return fileName;
+}
+
+BOOST_AUTO_TEST_CASE(testBoundingBox){
+	std::string maskFile = writeDiagonalEdgeMask();
+	ValidFootprint::ConstPointer footprint = ValidFootprint::GetFootprint(maskFile);
+	BOOST_REQUIRE(footprint);
+	BOOST_CHECK(!footprint->IsEmpty());
+	BOOST_CHECK(!footprint->IsFull());
+	// First valid pixel is (9,1), last is (9,9)
+	BOOST_CHECK_EQUAL(footprint->GetMaskRegion().GetIndex(0), 1);
+	BOOST_CHECK_EQUAL(footprint->GetMaskRegion().GetIndex(1), 1);
+	BOOST_CHECK_EQUAL(footprint->GetMaskRegion().GetSize(0), MASK_SIZE - 1);
+	BOOST_CHECK_EQUAL(footprint->GetMaskRegion().GetSize(1), MASK_SIZE - 1);
+	// The footprint is shared between callers
+	BOOST_CHECK_EQUAL(footprint.get(), ValidFootprint::GetFootprint(maskFile).get());
+
+	// Padding is cropped to the image
+	TestImageCreator t;
+	ShortImageType::Pointer img = t.createTestImage<ShortImageType>(MASK_SIZE, MASK_SIZE);
+	ValidFootprint::RegionType region = footprint->GetValidRegion(img, 1);
+	BOOST_CHECK_EQUAL(region.GetIndex(0), 0);
+	BOOST_CHECK_EQUAL(region.GetSize(0), MASK_SIZE);
+	region = footprint->GetValidRegion(img, 0);
+	BOOST_CHECK(region == footprint->GetMaskRegion());
+	std::remove(maskFile.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testRestrictionFilter){
+	std::string maskFile = writeDiagonalEdgeMask();
+	ValidFootprint::ConstPointer footprint = ValidFootprint::GetFootprint(maskFile);
+
+	TestImageCreator t;
+	ShortImageType::Pointer img = t.createTestImage<ShortImageType>(2 * MASK_SIZE, 2 * MASK_SIZE);
+	// Same extent as the mask, at twice the resolution
+	ShortImageType::SpacingType spacing;
+	spacing.Fill(0.5);
+	ShortImageType::PointType origin;
+	origin.Fill(-0.25);
+	img->SetSpacing(spacing);
+	img->SetOrigin(origin);
+
+	typedef FootprintRestrictionFilter<ShortImageType> FilterType;
+	FilterType::Pointer filter = FilterType::New();
+	filter->SetInput(img);
+	filter->SetFootprint(footprint);
+	filter->SetOutsideValue(-10000);
+	filter->Update();
+
+	// The box (1..9) of the mask covers 1..19 at twice the resolution, without padding
+	ShortImageType::RegionType expected = footprint->GetValidRegion(img, 0);
+	BOOST_CHECK_EQUAL(expected.GetIndex(0), 2);
+	BOOST_CHECK_EQUAL(expected.GetSize(0), 2 * MASK_SIZE - 2);
+	ValidSpans::ConstPointer spans = footprint->GetValidSpans(img);
+	itk::ImageRegionConstIteratorWithIndex<ShortImageType> it(filter->GetOutput(), filter->GetOutput()->GetLargestPossibleRegion());
+	for(it.GoToBegin(); !it.IsAtEnd(); ++it){
+		if(isInSpans(*spans, it.GetIndex())){
+			BOOST_CHECK_EQUAL(it.Get(), img->GetPixel(it.GetIndex()));
+		}else{
+			BOOST_CHECK_EQUAL(it.Get(), -10000);
+		}
+	}
+	std::remove(maskFile.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testRestrictionFilterVector){
+	std::string maskFile = writeDiagonalEdgeMask();
+	ValidFootprint::ConstPointer footprint = ValidFootprint::GetFootprint(maskFile);
+
+	ShortVectorImageType::Pointer img = ShortVectorImageType::New();
+	ShortVectorImageType::RegionType largest;
+	largest.SetSize(0, MASK_SIZE);
+	largest.SetSize(1, MASK_SIZE);
+	img->SetRegions(largest);
+	img->SetNumberOfComponentsPerPixel(3);
+	img->Allocate();
+	ShortVectorImageType::PixelType pix(3);
+	pix.Fill(42);
+	img->FillBuffer(pix);
+
+	typedef FootprintRestrictionFilter<ShortVectorImageType> FilterType;
+	FilterType::Pointer filter = FilterType::New();
+	filter->SetInput(img);
+	filter->SetFootprint(footprint);
+	filter->SetOutsideValues({-10000, 0});
+	filter->Update();
+
+	ShortVectorImageType::IndexType outside;
+	outside.Fill(0);
+	ShortVectorImageType::PixelType res = filter->GetOutput()->GetPixel(outside);
+	BOOST_CHECK_EQUAL(res[0], -10000);
+	BOOST_CHECK_EQUAL(res[1], 0);
+	BOOST_CHECK_EQUAL(res[2], 0);
+	ShortVectorImageType::IndexType inside;
+	inside.Fill(MASK_SIZE - 1);
+	res = filter->GetOutput()->GetPixel(inside);
+	BOOST_CHECK_EQUAL(res[0], 42);
+	BOOST_CHECK_EQUAL(res[2], 42);
+	std::remove(maskFile.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testValidSpans){
+	std::string maskFile = writeDiagonalEdgeMask();
+	ValidFootprint::ConstPointer footprint = ValidFootprint::GetFootprint(maskFile);
+
+	TestImageCreator t;
+	ShortImageType::Pointer img = t.createTestImage<ShortImageType>(MASK_SIZE, MASK_SIZE);
+	// On the grid of the mask and without padding, the spans are the valid pixels
+	ValidSpans::ConstPointer spans = footprint->GetValidSpans(img, 0);
+	BOOST_CHECK(spans->RowBegin(0) == spans->RowEnd(0));
+	for(long y = 1; y < MASK_SIZE; y++){
+		BOOST_REQUIRE_EQUAL(spans->RowEnd(y) - spans->RowBegin(y), 1);
+		BOOST_CHECK_EQUAL(spans->RowBegin(y)->Begin, MASK_SIZE - y);
+		BOOST_CHECK_EQUAL(spans->RowBegin(y)->End, MASK_SIZE);
+	}
+	BOOST_CHECK_EQUAL(spans->GetNumberOfValidPixels(), size_t(MASK_SIZE * (MASK_SIZE - 1) / 2));
+
+	// Each padded span covers its neighbours
+	spans = footprint->GetValidSpans(img, 1);
+	BOOST_REQUIRE_EQUAL(spans->RowEnd(0) - spans->RowBegin(0), 1);
+	BOOST_CHECK_EQUAL(spans->RowBegin(0)->Begin, MASK_SIZE - 2);
+	BOOST_CHECK_EQUAL(spans->RowBegin(5)->Begin, MASK_SIZE - 7);
+	std::remove(maskFile.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testValidSpanIterator){
+	std::string maskFile = writeDiagonalEdgeMask();
+	ValidFootprint::ConstPointer footprint = ValidFootprint::GetFootprint(maskFile);
+
+	TestImageCreator t;
+	ShortImageType::Pointer img = t.createTestImage<ShortImageType>(MASK_SIZE, MASK_SIZE);
+	ValidSpans::ConstPointer spans = footprint->GetValidSpans(img, 0);
+
+	ValidSpans::RegionType region;
+	region.SetIndex(0, 2);
+	region.SetIndex(1, 0);
+	region.SetSize(0, 5);
+	region.SetSize(1, MASK_SIZE);
+	// Each pixel of the region is covered by exactly one segment, with the right validity
+	std::vector<int> coverage(region.GetNumberOfPixels(), 0);
+	size_t nSegments = 0;
+	for(ValidSpanIterator seg(spans.get(), region); !seg.IsAtEnd(); ++seg, ++nSegments){
+		BOOST_CHECK(seg.GetRegion().GetNumberOfPixels() > 0);
+		itk::ImageRegionConstIteratorWithIndex<ShortImageType> it(img, seg.GetRegion());
+		for(it.GoToBegin(); !it.IsAtEnd(); ++it){
+			BOOST_REQUIRE(region.IsInside(it.GetIndex()));
+			BOOST_CHECK_EQUAL(isInSpans(*spans, it.GetIndex()), seg.IsValid());
+			coverage[(it.GetIndex()[1] - region.GetIndex(1)) * region.GetSize(0) + it.GetIndex()[0] - region.GetIndex(0)]++;
+		}
+	}
+	for(int nCovered : coverage){
+		BOOST_CHECK_EQUAL(nCovered, 1);
+	}
+	// Rows 0..3 have no valid pixel within the columns 2..6, and are grouped
+	ValidSpanIterator first(spans.get(), region);
+	BOOST_CHECK(!first.IsValid());
+	BOOST_CHECK_EQUAL(first.GetRegion().GetSize(1), 4);
+
+	// Without spans, the whole region is a single valid segment
+	ValidSpanIterator all(nullptr, region);
+	BOOST_CHECK(all.IsValid());
+	BOOST_CHECK(all.GetRegion() == region);
+	++all;
+	BOOST_CHECK(all.IsAtEnd());
+	std::remove(maskFile.c_str());
+}
+
+namespace {
+/**
+ * @brief Functor with a cost similar to the one of a directional model
+ */
+class CostlyFunctor{
+public:
+	bool operator!=(const CostlyFunctor &) const { return false; }
+	bool operator==(const CostlyFunctor &) const { return true; }
+	inline short operator()(const short &a) const {
+		return static_cast<short>(a * std::cos(a * 0.001) / (2.0 + std::sin(a * 0.002)));
+	}
+	inline short operator()(const short &a, const short &b) const {
+		return a - b;
+	}
+};
+}
+
+BOOST_AUTO_TEST_CASE(testFootprintFunctorFilters){
+	std::string maskFile = writeDiagonalEdgeMask();
+	ValidFootprint::ConstPointer footprint = ValidFootprint::GetFootprint(maskFile);
+
+	TestImageCreator t;
+	ShortImageType::Pointer img = t.createTestImage<ShortImageType>(MASK_SIZE, MASK_SIZE);
+	ValidSpans::ConstPointer spans = footprint->GetValidSpans(img);
+
+	typedef itk::UnaryFunctorImageFilter<ShortImageType, ShortImageType, CostlyFunctor> UnaryFilterType;
+	typedef FootprintUnaryFunctorImageFilter<ShortImageType, ShortImageType, CostlyFunctor> FootprintUnaryFilterType;
+	typedef FootprintBinaryFunctorImageFilter<ShortImageType, ShortImageType, ShortImageType, CostlyFunctor> FootprintBinaryFilterType;
+
+	UnaryFilterType::Pointer reference = UnaryFilterType::New();
+	reference->SetInput(img);
+	reference->Update();
+	FootprintUnaryFilterType::Pointer unary = FootprintUnaryFilterType::New();
+	unary->SetInput(img);
+	unary->SetFootprint(footprint);
+	unary->SetOutsideValue(-10000);
+	unary->Update();
+	FootprintBinaryFilterType::Pointer binary = FootprintBinaryFilterType::New();
+	binary->SetInput1(img);
+	binary->SetInput2(img);
+	binary->SetFootprint(footprint);
+	binary->SetOutsideValue(-10000);
+	binary->Update();
+
+	itk::ImageRegionConstIteratorWithIndex<ShortImageType> it(reference->GetOutput(), reference->GetOutput()->GetLargestPossibleRegion());
+	for(it.GoToBegin(); !it.IsAtEnd(); ++it){
+		const bool bIsValid = isInSpans(*spans, it.GetIndex());
+		BOOST_CHECK_EQUAL(unary->GetOutput()->GetPixel(it.GetIndex()), bIsValid ? it.Get() : -10000);
+		BOOST_CHECK_EQUAL(binary->GetOutput()->GetPixel(it.GetIndex()), bIsValid ? 0 : -10000);
+	}
+
+	// Without footprint, the filter behaves like its superclass
+	FootprintUnaryFilterType::Pointer unrestricted = FootprintUnaryFilterType::New();
+	unrestricted->SetInput(img);
+	unrestricted->Update();
+	for(it.GoToBegin(); !it.IsAtEnd(); ++it){
+		BOOST_CHECK_EQUAL(unrestricted->GetOutput()->GetPixel(it.GetIndex()), it.Get());
+	}
+	std::remove(maskFile.c_str());
+}
+
+namespace {
+/**
+ * @brief CostlyFunctor counting its evaluations over all threads
+ */
+class CountingFunctor : public CostlyFunctor{
+public:
+	CountingFunctor() : m_Count(std::make_shared<std::atomic<size_t> >(0)) {}
+	bool operator!=(const CountingFunctor &) const { return false; }
+	bool operator==(const CountingFunctor &) const { return true; }
+	inline short operator()(const short &a) const {
+		(*m_Count)++;
+		return CostlyFunctor::operator()(a);
+	}
+	size_t GetCount() const { return *m_Count; }
+private:
+	std::shared_ptr<std::atomic<size_t> > m_Count;
+};
+
+/**
+ * @brief Benchmark the functor filters on a diagonal swath, i.e. an edge mask whose upper left triangle is valid
+ * @param coverage The valid share of the image, at most 0.5. The bounding box of the swath covers twice this share.
+ * @note The directional correction is evaluated over the full extent, over the bounding box of the footprint
+ * as done by the restriction to the valid region, and over the valid spans only.
+ */
+void benchmarkDiagonalSwath(const double &coverage){
+	const size_t nMaskSize = 2000;
+	const double threshold = nMaskSize * std::sqrt(2 * coverage);
+	TestImageCreator t;
+	MaskImageType::Pointer mask = t.createTestImage<MaskImageType>(nMaskSize, nMaskSize);
+	itk::ImageRegionIteratorWithIndex<MaskImageType> maskIt(mask, mask->GetLargestPossibleRegion());
+	for(maskIt.GoToBegin(); !maskIt.IsAtEnd(); ++maskIt){
+		maskIt.Set(maskIt.GetIndex()[0] + maskIt.GetIndex()[1] < threshold ? 1 : 0);
+	}
+	std::string maskFile = "test_FootprintRestriction_diagonal_EDG.tif";
+	otb::ImageFileWriter<MaskImageType>::Pointer writer = otb::ImageFileWriter<MaskImageType>::New();
+	writer->SetInput(mask);
+	writer->SetFileName(maskFile);
+	writer->Update();
+
+	// Processed at twice the resolution of the mask, like the 10m bands of Sentinel-2
+	ShortImageType::Pointer img = t.createTestImage<ShortImageType>(2 * nMaskSize, 2 * nMaskSize);
+	ShortImageType::SpacingType spacing;
+	spacing.Fill(0.5);
+	ShortImageType::PointType origin;
+	origin.Fill(-0.25);
+	img->SetSpacing(spacing);
+	img->SetOrigin(origin);
+	const size_t nPixels = img->GetLargestPossibleRegion().GetNumberOfPixels();
+
+	auto start = std::chrono::steady_clock::now();
+	ValidFootprint::ConstPointer footprint = ValidFootprint::GetFootprint(maskFile);
+	ValidSpans::ConstPointer spans = footprint->GetValidSpans(img);
+	ShortImageType::RegionType box = footprint->GetValidRegion(img);
+	auto built = std::chrono::steady_clock::now();
+
+	typedef itk::UnaryFunctorImageFilter<ShortImageType, ShortImageType, CountingFunctor> UnaryFilterType;
+	typedef itk::ExtractImageFilter<ShortImageType, ShortImageType> ExtractFilterType;
+	typedef FootprintUnaryFunctorImageFilter<ShortImageType, ShortImageType, CountingFunctor> FootprintUnaryFilterType;
+	UnaryFilterType::Pointer full = UnaryFilterType::New();
+	full->SetInput(img);
+	full->Update();
+	auto fullEnd = std::chrono::steady_clock::now();
+
+	ExtractFilterType::Pointer extract = ExtractFilterType::New();
+	extract->SetInput(img);
+	extract->SetExtractionRegion(box);
+	UnaryFilterType::Pointer boxed = UnaryFilterType::New();
+	boxed->SetInput(extract->GetOutput());
+	boxed->Update();
+	auto boxEnd = std::chrono::steady_clock::now();
+
+	FootprintUnaryFilterType::Pointer restricted = FootprintUnaryFilterType::New();
+	restricted->SetInput(img);
+	restricted->SetFootprint(footprint);
+	restricted->SetOutsideValue(-10000);
+	restricted->Update();
+	auto spansEnd = std::chrono::steady_clock::now();
+
+	typedef std::chrono::duration<double, std::milli> ms;
+	std::cout << "Diagonal swath covering " << coverage * 100 << "%: " << spans->GetNumberOfValidPixels() << " of " << nPixels
+			<< " pixels valid. Index: " << ms(built - start).count() << " ms, full extent: " << ms(fullEnd - built).count()
+			<< " ms, bounding box: " << ms(boxEnd - fullEnd).count() << " ms, valid spans: " << ms(spansEnd - boxEnd).count() << " ms" << std::endl;
+
+	// The functor is only evaluated within the valid spans, which are much smaller than the bounding box
+	BOOST_CHECK_EQUAL(full->GetFunctor().GetCount(), nPixels);
+	BOOST_CHECK_EQUAL(boxed->GetFunctor().GetCount(), box.GetNumberOfPixels());
+	BOOST_CHECK_EQUAL(restricted->GetFunctor().GetCount(), spans->GetNumberOfValidPixels());
+	BOOST_CHECK_LT(spans->GetNumberOfValidPixels(), nPixels * (coverage + 0.01));
+	BOOST_CHECK_GT(box.GetNumberOfPixels(), nPixels * (2 * coverage - 0.01));
+
+	ShortImageType::IndexType idx;
+	idx.Fill(0);
+	BOOST_CHECK_EQUAL(restricted->GetOutput()->GetPixel(idx), full->GetOutput()->GetPixel(idx));
+	idx.Fill(2 * nMaskSize - 1);
+	BOOST_CHECK_EQUAL(restricted->GetOutput()->GetPixel(idx), -10000);
+	std::remove(maskFile.c_str());
+}
+}
+
+BOOST_AUTO_TEST_CASE(testDiagonalSwathHalf){
+	benchmarkDiagonalSwath(0.5);
+}
+
+BOOST_AUTO_TEST_CASE(testDiagonalSwathQuarter){
+	benchmarkDiagonalSwath(0.25);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE IOProfiles
+#include <boost/test/unit_test.hpp>
+#include "IOProfiles.h"
+#include "otbImage.h"
+#include "otbImageFileReader.h"
+#include "otbImageFileWriter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using namespace ts;
+
+typedef otb::Image<short, 2>					ShortImageType;
+typedef otb::ImageFileReader<ShortImageType>	ShortImageReaderType;
+typedef otb::ImageFileWriter<ShortImageType>	ShortImageWriterType;
+typedef std::chrono::duration<double>			secondsType;
+
+#define BENCHMARK_OUTPUT	"test_IOProfiles_OUT.tif"
+#define BENCHMARK_SIZE		4096
+
+BOOST_AUTO_TEST_CASE(testProfileNames){
+	for(const std::string &profile : GetIOProfileNames()){
+		BOOST_CHECK(IsIOProfile(profile));
+	}
+	BOOST_CHECK(!IsIOProfile("unknown"));
+	BOOST_CHECK_THROW(GetIOProfileCreationOptions("unknown"), itk::ExceptionObject);
+}
+
+BOOST_AUTO_TEST_CASE(testExtendedFilenames){
+	BOOST_CHECK_EQUAL(GetIOProfileExtendedFilename(IO_PROFILE_DEFAULT), "");
+	BOOST_CHECK_EQUAL(GetIOProfileExtendedFilename(IO_PROFILE_DEFAULT, true), "?&gdal:co:COMPRESS=DEFLATE");
+	const std::string fast = GetIOProfileExtendedFilename(IO_PROFILE_TEMP_FAST);
+	BOOST_CHECK(fast.find("&gdal:co:TILED=YES") != std::string::npos);
+	BOOST_CHECK(fast.find("&gdal:co:BLOCKXSIZE=" + std::to_string(IO_PROFILE_BLOCK_SIZE)) != std::string::npos);
+	BOOST_CHECK(fast.find("&gdal:co:COMPRESS=NONE") != std::string::npos);
+	const std::string archive = GetIOProfileExtendedFilename(IO_PROFILE_ARCHIVE);
+	BOOST_CHECK(archive.find("&gdal:co:COMPRESS=DEFLATE") != std::string::npos);
+	BOOST_CHECK(archive.find("&gdal:co:PREDICTOR=2") != std::string::npos);
+	BOOST_CHECK(archive.find("&gdal:co:NUM_THREADS=ALL_CPUS") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkProfiles){
+	// Smooth reflectance-like values, so that compression behaves as on real data
+	ShortImageType::Pointer img = ShortImageType::New();
+	ShortImageType::RegionType region;
+	region.SetSize(0, BENCHMARK_SIZE);
+	region.SetSize(1, BENCHMARK_SIZE);
+	img->SetRegions(region);
+	img->Allocate();
+	itk::ImageRegionIteratorWithIndex<ShortImageType> it(img, region);
+	for(it.GoToBegin(); !it.IsAtEnd(); ++it){
+		it.Set(short(1000 + (it.GetIndex()[0] / 7 + it.GetIndex()[1] / 5) % 2000));
+	}
+	const double sizeMB = double(BENCHMARK_SIZE) * BENCHMARK_SIZE * sizeof(short) / (1024 * 1024);
+
+	for(const std::string &profile : GetIOProfileNames()){
+		auto start = std::chrono::steady_clock::now();
+		ShortImageWriterType::Pointer writer = ShortImageWriterType::New();
+		writer->SetInput(img);
+		writer->SetFileName(std::string(BENCHMARK_OUTPUT) + GetIOProfileExtendedFilename(profile));
+		writer->Update();
+		auto written = std::chrono::steady_clock::now();
+		ShortImageReaderType::Pointer reader = ShortImageReaderType::New();
+		reader->SetFileName(BENCHMARK_OUTPUT);
+		reader->Update();
+		auto read = std::chrono::steady_clock::now();
+		BOOST_CHECK_EQUAL(reader->GetOutput()->GetPixel({{17, 23}}), img->GetPixel({{17, 23}}));
+
+		std::ifstream file(BENCHMARK_OUTPUT, std::ios::binary | std::ios::ate);
+		std::cout << "Profile " << profile << ": Write " << sizeMB / secondsType(written - start).count() << " MB/s, Read "
+				<< sizeMB / secondsType(read - written).count() << " MB/s, File size " << double(file.tellg()) / (1024 * 1024) << " MB" << std::endl;
+		std::remove(BENCHMARK_OUTPUT);
+	}
+}
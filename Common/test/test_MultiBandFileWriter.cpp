@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE MultiBandFileWriter
+#include <boost/test/unit_test.hpp>
+#include "../include/MultiBandFileWriter.h"
+#include "GlobalDefs.h"
+#include "otbImageFileReader.h"
+#include "otbImageFileWriter.h"
+#include "otbVectorImage.h"
+#include "otbImage.h"
+#include "itkCommand.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "gdal_priv.h"
+#include "cpl_vsi.h"
+#include <cstdio>
+#include <string>
+
+using namespace ts;
+
+typedef otb::Image<unsigned char, 2>				ByteImageType;
+typedef otb::Image<short, 2>						ShortImageType;
+typedef otb::VectorImage<short, 2>					ShortVectorImageType;
+typedef otb::ImageFileReader<ShortVectorImageType>	ShortVectorImageReaderType;
+typedef MultiBandFileWriter<ShortVectorImageType>	MultiBandWriterType;
+
+#define TEST_INPUT		"test_MultiBandFileWriter_IN.tif"
+#define TEST_OUTPUT		"test_MultiBandFileWriter_B"
+#define IMAGE_WIDTH		600
+#define IMAGE_HEIGHT	500
+#define IMAGE_BANDS		3
+
+/**
+ * @brief Value of the test image at the given position and band
+ */
+short testValue(const itk::Index<2> &idx, const unsigned int &band){
+	return short((idx[0] + 3 * idx[1] + 100 * band) % 250);
+}
+
+/**
+ * @brief Write a multi-band test image, whose values are given by testValue()
+ */
+std::string writeTestImage(){
+	ShortVectorImageType::Pointer img = ShortVectorImageType::New();
+	ShortVectorImageType::RegionType region;
+	region.SetSize(0, IMAGE_WIDTH);
+	region.SetSize(1, IMAGE_HEIGHT);
+	img->SetRegions(region);
+	img->SetNumberOfComponentsPerPixel(IMAGE_BANDS);
+	img->Allocate();
+	itk::ImageRegionIteratorWithIndex<ShortVectorImageType> it(img, region);
+	for(it.GoToBegin(); !it.IsAtEnd(); ++it){
+		ShortVectorImageType::PixelType pix(IMAGE_BANDS);
+		for(unsigned int b = 0; b < IMAGE_BANDS; b++){
+			pix[b] = testValue(it.GetIndex(), b);
+		}
+		it.Set(pix);
+	}
+	std::string fileName = std::string(TEST_INPUT);
+	otb::ImageFileWriter<ShortVectorImageType>::Pointer writer = otb::ImageFileWriter<ShortVectorImageType>::New();
+	writer->SetInput(img);
+	writer->SetFileName(fileName);
+	writer->Update();
+	return fileName;
+}
+
+/**
+ * @brief Counts how often the observed reader produced data
+ */
+class ReadCounter {
+public:
+	ReadCounter() : m_Count(0) {}
+	void Increment() { m_Count++; }
+	size_t m_Count;
+};
+
+/**
+ * @brief Write the given bands of the input in one pass and return how often the input was read
+ */
+size_t writeBands(const std::string &input, const std::vector<unsigned int> &bands, const unsigned int &ram){
+	ShortVectorImageReaderType::Pointer reader = ShortVectorImageReaderType::New();
+	reader->SetFileName(input);
+	ReadCounter counter;
+	typedef itk::SimpleMemberCommand<ReadCounter> CommandType;
+	CommandType::Pointer command = CommandType::New();
+	command->SetCallbackFunction(&counter, &ReadCounter::Increment);
+	reader->AddObserver(itk::EndEvent(), command);
+
+	MultiBandWriterType::Pointer writer = MultiBandWriterType::New();
+	writer->SetInput(reader->GetOutput());
+	writer->SetAvailableRAMInMB(ram);
+	for(unsigned int band : bands){
+		const std::string fileName = std::string(TEST_OUTPUT) + std::to_string(band) + ".tif";
+		if(band == IMAGE_BANDS - 1){
+			writer->AddBand<unsigned char>(band, fileName + "?&gdal:co:COMPRESS=DEFLATE");
+		}else{
+			writer->AddBand<short>(band, fileName);
+		}
+	}
+	writer->Update();
+	return counter.m_Count;
+}
+
+template<typename TImage>
+void checkBand(const unsigned int &band){
+	const std::string fileName = std::string(TEST_OUTPUT) + std::to_string(band) + ".tif";
+	typename otb::ImageFileReader<TImage>::Pointer reader = otb::ImageFileReader<TImage>::New();
+	reader->SetFileName(fileName);
+	reader->Update();
+	typename TImage::Pointer img = reader->GetOutput();
+	BOOST_REQUIRE_EQUAL(img->GetLargestPossibleRegion().GetSize(0), IMAGE_WIDTH);
+	BOOST_REQUIRE_EQUAL(img->GetLargestPossibleRegion().GetSize(1), IMAGE_HEIGHT);
+	size_t nErrors = 0;
+	itk::ImageRegionConstIteratorWithIndex<TImage> it(img, img->GetLargestPossibleRegion());
+	for(it.GoToBegin(); !it.IsAtEnd(); ++it){
+		if(it.Get() != typename TImage::PixelType(testValue(it.GetIndex(), band))){
+			nErrors++;
+		}
+	}
+	BOOST_CHECK_EQUAL(nErrors, 0);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testWriteBands){
+	std::string input = writeTestImage();
+	writeBands(input, {0, 1, 2}, 0);
+	checkBand<ShortImageType>(0);
+	checkBand<ShortImageType>(1);
+	checkBand<ByteImageType>(2);
+	std::remove(input.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testSingleReadPerRegion){
+	std::string input = writeTestImage();
+	// Little RAM forces the writer to stream the input in several stripes
+	const size_t readsOneBand = writeBands(input, {1}, 1);
+	const size_t readsAllBands = writeBands(input, {0, 1, 2}, 1);
+	BOOST_CHECK_GT(readsOneBand, 1);
+	BOOST_CHECK_EQUAL(readsOneBand, readsAllBands);
+	checkBand<ShortImageType>(0);
+	checkBand<ShortImageType>(1);
+	checkBand<ByteImageType>(2);
+	std::remove(input.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testInvalidBand){
+	std::string input = writeTestImage();
+	BOOST_CHECK_THROW(writeBands(input, {IMAGE_BANDS}, 0), itk::ExceptionObject);
+	std::remove(input.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testCoGeoTiffBands){
+	std::string input = writeTestImage();
+	ShortVectorImageReaderType::Pointer reader = ShortVectorImageReaderType::New();
+	reader->SetFileName(input);
+	MultiBandWriterType::Pointer writer = MultiBandWriterType::New();
+	writer->SetInput(reader->GetOutput());
+	writer->SetAvailableRAMInMB(1);
+	CoGeoTiffWriter::Options options;
+	options.bHasNoData = true;
+	options.noDataValue = NO_DATA_VALUE;
+	writer->AddCoGeoTiffBand<short>(0, std::string(TEST_OUTPUT) + "0.tif", options);
+	options.resamplingMethod = "nearest";
+	options.bHasNoData = false;
+	writer->AddCoGeoTiffBand<unsigned char>(2, std::string(TEST_OUTPUT) + "2.tif", options);
+	CoGeoTiffWriter::SetMaxConcurrentCopies(1);
+	writer->Update();
+	CoGeoTiffWriter::SetMaxConcurrentCopies(2);
+
+	for(unsigned int band : {0, 2}){
+		const std::string fileName = std::string(TEST_OUTPUT) + std::to_string(band) + ".tif";
+		GDALDataset *pDataset = static_cast<GDALDataset *>(GDALOpen(fileName.c_str(), GA_ReadOnly));
+		BOOST_REQUIRE(pDataset != nullptr);
+		GDALRasterBand *pBand = pDataset->GetRasterBand(1);
+		BOOST_CHECK_EQUAL(pBand->GetOverviewCount(), int(options.nLevels));
+		BOOST_CHECK_EQUAL(pBand->GetOverview(0)->GetXSize(), (IMAGE_WIDTH + 1) / 2);
+		// With nearest neighbour, the first overview holds every second pixel of every second row
+		if(band == 2){
+			unsigned char value = 0;
+			pBand->GetOverview(0)->RasterIO(GF_Read, 3, 4, 1, 1, &value, 1, 1, GDT_Byte, 0, 0, nullptr);
+			itk::Index<2> idx = {{6, 8}};
+			BOOST_CHECK_EQUAL(value, testValue(idx, band));
+		}
+		GDALClose(pDataset);
+		// Without a temp directory, the intermediate file is written next to the final one and removed
+		VSIStatBufL stat;
+		const std::string tempName = std::string(TEST_OUTPUT) + std::to_string(band) + ".tmp.tif";
+		BOOST_CHECK(VSIStatL(tempName.c_str(), &stat) != 0);
+	}
+	checkBand<ShortImageType>(0);
+	checkBand<ByteImageType>(2);
+	std::remove(input.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testQuicklook){
+	std::string input = writeTestImage();
+	ShortVectorImageReaderType::Pointer reader = ShortVectorImageReaderType::New();
+	reader->SetFileName(input);
+	MultiBandWriterType::Pointer writer = MultiBandWriterType::New();
+	writer->SetInput(reader->GetOutput());
+	writer->SetAvailableRAMInMB(1);
+	const std::string quicklookName = std::string(TEST_OUTPUT) + "QKL.jpg";
+	writer->AddQuicklook({2, 1, 0}, quicklookName, 100, 50, 0, 255, NO_DATA_VALUE);
+	writer->Update();
+
+	GDALDataset *pDataset = static_cast<GDALDataset *>(GDALOpen(quicklookName.c_str(), GA_ReadOnly));
+	BOOST_REQUIRE(pDataset != nullptr);
+	BOOST_CHECK_EQUAL(pDataset->GetRasterCount(), 3);
+	BOOST_CHECK_EQUAL(pDataset->GetRasterXSize(), 100);
+	BOOST_CHECK_EQUAL(pDataset->GetRasterYSize(), 50);
+	GDALClose(pDataset);
+	std::remove(quicklookName.c_str());
+	std::remove(input.c_str());
+}
+
+/**
+ * @brief Count the values of a band while it is written
+ * @param nThreads The number of threads of the writer, each region is counted by as many threads
+ */
+void checkHistogram(const unsigned int &nThreads){
+	std::string input = writeTestImage();
+	ShortVectorImageReaderType::Pointer reader = ShortVectorImageReaderType::New();
+	reader->SetFileName(input);
+	MultiBandWriterType::Pointer writer = MultiBandWriterType::New();
+	writer->SetInput(reader->GetOutput());
+	writer->SetAvailableRAMInMB(1);
+	writer->SetNumberOfThreads(nThreads);
+	writer->AddBand<short>(1, std::string(TEST_OUTPUT) + "1.tif");
+	BandHistogram::Pointer histogram = std::make_shared<BandHistogram>(200);
+	writer->AddHistogram(1, histogram);
+	writer->Update();
+
+	std::vector<uint64_t> expected(200, 0);
+	for(long y = 0; y < IMAGE_HEIGHT; y++){
+		for(long x = 0; x < IMAGE_WIDTH; x++){
+			itk::Index<2> idx = {{x, y}};
+			short value = testValue(idx, 1);
+			if(value < 200){
+				expected[value]++;
+			}
+		}
+	}
+	BOOST_CHECK_EQUAL(histogram->GetTotalCount(), IMAGE_WIDTH * IMAGE_HEIGHT);
+	for(size_t bin = 0; bin < expected.size(); bin++){
+		BOOST_CHECK_EQUAL(histogram->GetCount(bin), expected[bin]);
+	}
+	checkBand<ShortImageType>(1);
+	std::remove(input.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testHistogram){
+	checkHistogram(1);
+}
+
+BOOST_AUTO_TEST_CASE(testHistogramThreads){
+	// 7 threads do not divide the rows of the stripes evenly
+	checkHistogram(7);
+}
@@ -28,8 +28,10 @@
 #define BOOST_TEST_MODULE MuscateWriter
 #include <boost/test/unit_test.hpp>
 #include "../include/MuscateMetadataHelper.h"
+#include "../include/MetadataHelperFactory.h"
 #include "../include/GlobalDefs.h"
 #include <string>
+#include <boost/filesystem.hpp>
 
 using namespace ts;
 
@@ -201,3 +203,51 @@ BOOST_AUTO_TEST_CASE(TestLoadMetadata_S2B_T31TCH){
 		BOOST_FAIL("Cannot read metadata from" << std::string(TEST_SRC + "/" + TEST_NAME + "/" + INPUT_XML1));
 	}
 }
+
+BOOST_AUTO_TEST_CASE(TestFactoryCache){
+	if(TEST_SRC == ""){
+		BOOST_FAIL("Did not set env-var WASP_TEST!");
+	}
+	const std::string xml = std::string(TEST_SRC + "/" + TEST_NAME + "/" + INPUT_XML2);
+	auto factory = MetadataHelperFactory::New();
+	MetadataHelper::ConstPointer pHelper = factory->GetMetadataHelper(xml);
+	BOOST_REQUIRE(pHelper);
+	BOOST_CHECK_EQUAL(pHelper->GetAcquisitionDate(), "20170923");
+	//The same instance is returned, even by another factory
+	BOOST_CHECK_EQUAL(pHelper.get(), MetadataHelperFactory::New()->GetMetadataHelper(xml).get());
+	//Getters return references to the shared instance
+	BOOST_CHECK_EQUAL(&pHelper->getResolutions(), &factory->GetMetadataHelper(xml)->getResolutions());
+
+	//A modified file is loaded again
+	const std::time_t modificationTime = boost::filesystem::last_write_time(xml);
+	boost::filesystem::last_write_time(xml, modificationTime + 1);
+	MetadataHelper::ConstPointer pReloaded = factory->GetMetadataHelper(xml);
+	boost::filesystem::last_write_time(xml, modificationTime);
+	BOOST_CHECK(pReloaded.get() != pHelper.get());
+	BOOST_CHECK_EQUAL(pReloaded->GetAcquisitionDate(), pHelper->GetAcquisitionDate());
+
+	MetadataHelperFactory::ClearCache();
+	BOOST_CHECK(factory->GetMetadataHelper(xml).get() != pReloaded.get());
+}
+
+BOOST_AUTO_TEST_CASE(TestFactoryContent){
+	if(TEST_SRC == ""){
+		BOOST_FAIL("Did not set env-var WASP_TEST!");
+	}
+	const std::string xml = std::string(TEST_SRC + "/" + TEST_NAME + "/" + INPUT_XML3);
+	MetadataHelperFactory::ClearCache();
+	auto factory = MetadataHelperFactory::New();
+	MetadataHelper::ConstPointer pLight = factory->GetMetadataHelper(xml, MTD_CONTENT_PRODUCT);
+	BOOST_CHECK_EQUAL(pLight->GetLoadedContent(), (unsigned int)MTD_CONTENT_PRODUCT);
+	BOOST_CHECK_EQUAL(pLight->GetMissionName(), "SENTINEL2B");
+	BOOST_CHECK_EQUAL(pLight->getResolutions().getNumberOfResolutions(), size_t(2));
+	BOOST_CHECK(!pLight->HasDetailedAngles());
+	BOOST_CHECK(pLight->GetDetailedViewingAngles().empty());
+
+	//The angles are loaded on request and then shared with the light callers
+	MetadataHelper::ConstPointer pFull = factory->GetMetadataHelper(xml);
+	BOOST_CHECK(pFull.get() != pLight.get());
+	BOOST_CHECK(pFull->HasDetailedAngles());
+	BOOST_CHECK_EQUAL(pFull->GetImageFileNames().size(), pLight->GetImageFileNames().size());
+	BOOST_CHECK_EQUAL(factory->GetMetadataHelper(xml, MTD_CONTENT_PRODUCT).get(), pFull.get());
+}
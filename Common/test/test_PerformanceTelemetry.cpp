@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE PerformanceTelemetry
+#include <boost/test/unit_test.hpp>
+#include "PerformanceTelemetry.h"
+#include "otbImage.h"
+#include "otbImageFileWriter.h"
+#include "itkShiftScaleImageFilter.h"
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+using namespace ts;
+
+typedef otb::Image<short, 2>										ShortImageType;
+typedef itk::ShiftScaleImageFilter<ShortImageType, ShortImageType>	ShiftScaleFilterType;
+typedef otb::ImageFileWriter<ShortImageType>						ShortImageWriterType;
+
+#define TELEMETRY_DIR	"test_PerformanceTelemetry_DIR"
+#define TELEMETRY_OUT	"test_PerformanceTelemetry_OUT.tif"
+
+std::vector<std::string> listRecords(){
+	std::vector<std::string> records;
+	DIR *dir = opendir(TELEMETRY_DIR);
+	if(dir == NULL){
+		return records;
+	}
+	while(struct dirent *entry = readdir(dir)){
+		const std::string name = entry->d_name;
+		if(name.size() > 5 && name.substr(name.size() - 5) == ".json"){
+			records.push_back(std::string(TELEMETRY_DIR) + "/" + name);
+		}
+	}
+	closedir(dir);
+	return records;
+}
+
+void removeRecords(){
+	for(const std::string &record : listRecords()){
+		std::remove(record.c_str());
+	}
+}
+
+void writeImage(PerformanceTelemetry &telemetry, ShiftScaleFilterType::Pointer &filter){
+	ShortImageType::Pointer img = ShortImageType::New();
+	ShortImageType::RegionType region;
+	region.SetSize(0, 100);
+	region.SetSize(1, 80);
+	img->SetRegions(region);
+	img->Allocate();
+	img->FillBuffer(1);
+
+	filter = ShiftScaleFilterType::New();
+	filter->SetInput(img);
+	filter->SetScale(2);
+
+	ShortImageWriterType::Pointer writer = ShortImageWriterType::New();
+	writer->SetFileName(TELEMETRY_OUT);
+	writer->SetInput(filter->GetOutput());
+	writer->SetNumberOfDivisionsStrippedStreaming(4);
+	telemetry.AddOutput("out", TELEMETRY_OUT, filter->GetOutput());
+	telemetry.WatchWriter(writer);
+	writer->Update();
+}
+
+BOOST_AUTO_TEST_CASE(testRecord){
+	mkdir(TELEMETRY_DIR, 0755);
+	removeRecords();
+	{
+		PerformanceTelemetry telemetry;
+		telemetry.Start("test", TELEMETRY_DIR);
+		ShiftScaleFilterType::Pointer filter;
+		writeImage(telemetry, filter);
+
+		// One execution of the filter per stream division
+		const PerformanceTelemetry::FilterRecord *record = telemetry.GetFilterRecord(filter);
+		BOOST_REQUIRE(record != NULL);
+		BOOST_CHECK_EQUAL(record->name, "ShiftScaleImageFilter");
+		BOOST_CHECK_EQUAL(record->executions, 4);
+		BOOST_CHECK_EQUAL(record->pixels, 100 * 80);
+		BOOST_CHECK_GE(record->wallTime, 0);
+		// The telemetry does not keep the pipeline alive
+		BOOST_CHECK_EQUAL(filter->GetReferenceCount(), 1);
+
+		const std::string json = telemetry.ToJSON();
+		BOOST_CHECK(json.find("\"application\": \"test\"") != std::string::npos);
+		BOOST_CHECK(json.find("\"streams\": 4, \"pixels\": 8000") != std::string::npos);
+		BOOST_CHECK(json.find("\"fileSize\": ") != std::string::npos);
+
+		// The record is written once the writer finishes
+		std::vector<std::string> records = listRecords();
+		BOOST_REQUIRE_EQUAL(records.size(), 1);
+		std::ifstream file(records[0].c_str());
+		std::stringstream content;
+		content << file.rdbuf();
+		BOOST_CHECK(content.str().find("\"executions\": 4") != std::string::npos);
+	}
+	removeRecords();
+	std::remove(TELEMETRY_OUT);
+}
+
+BOOST_AUTO_TEST_CASE(testDisabled){
+	mkdir(TELEMETRY_DIR, 0755);
+	removeRecords();
+	{
+		PerformanceTelemetry telemetry;
+		telemetry.Start("test", "");
+		ShiftScaleFilterType::Pointer filter;
+		writeImage(telemetry, filter);
+		BOOST_CHECK(telemetry.GetFilterRecord(filter) == NULL);
+	}
+	BOOST_CHECK(listRecords().empty());
+	std::remove(TELEMETRY_OUT);
+	rmdir(TELEMETRY_DIR);
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE RegionOfInterest
+#include <boost/test/unit_test.hpp>
+#include "RegionOfInterest.h"
+#include "TestImageCreator.h"
+#include "otbImage.h"
+
+using namespace ts;
+
+typedef otb::Image<short, 2>			ShortImageType;
+
+/**
+ * @brief Create an image of size x size pixels, whose first pixel has its upper left corner at (1000, 2000)
+ */
+template <typename TImage>
+typename TImage::Pointer createGeoImage(const size_t &size, const double &spacing){
+	TestImageCreator t;
+	typename TImage::Pointer img = t.createTestImage<TImage>(size, size);
+	typename TImage::SpacingType sp;
+	sp.Fill(spacing);
+	typename TImage::PointType origin;
+	origin[0] = 1000 + spacing / 2;
+	origin[1] = 2000 + spacing / 2;
+	img->SetSpacing(sp);
+	img->SetOrigin(origin);
+	return img;
+}
+
+BOOST_AUTO_TEST_CASE(testAxisRange){
+	long start;
+	size_t count;
+	// Interval aligned to the pixel edges
+	RegionOfInterest::GetAxisRange(1.5, 4.5, 0, 10, start, count);
+	BOOST_CHECK_EQUAL(start, 2);
+	BOOST_CHECK_EQUAL(count, 3);
+	// Only the pixels whose centre is inside are kept
+	RegionOfInterest::GetAxisRange(1.6, 4.4, 0, 10, start, count);
+	BOOST_CHECK_EQUAL(start, 2);
+	BOOST_CHECK_EQUAL(count, 3);
+	RegionOfInterest::GetAxisRange(2.1, 2.9, 0, 10, start, count);
+	BOOST_CHECK_EQUAL(count, 0);
+	// Clipped to the image
+	RegionOfInterest::GetAxisRange(-5, 20, 3, 10, start, count);
+	BOOST_CHECK_EQUAL(start, 3);
+	BOOST_CHECK_EQUAL(count, 10);
+	RegionOfInterest::GetAxisRange(20, 30, 0, 10, start, count);
+	BOOST_CHECK_EQUAL(count, 0);
+}
+
+BOOST_AUTO_TEST_CASE(testParse){
+	RegionOfInterest roi = RegionOfInterest::FromStringList({"1000", "2000", "1040.0", "2060"});
+	BOOST_CHECK(roi.IsSet());
+	BOOST_CHECK(!RegionOfInterest().IsSet());
+	BOOST_CHECK_THROW(RegionOfInterest::FromStringList({"1000", "2000", "1040"}), itk::ExceptionObject);
+	BOOST_CHECK_THROW(RegionOfInterest::FromStringList({"1000", "2000", "abc", "2060"}), itk::ExceptionObject);
+	BOOST_CHECK_THROW(RegionOfInterest::FromStringList({"1040", "2000", "1000", "2060"}), itk::ExceptionObject);
+}
+
+BOOST_AUTO_TEST_CASE(testResolutions){
+	// The same extent covers the same area at 10 and 20m
+	RegionOfInterest roi(1040, 2020, 1120, 2100);
+	ShortImageType::Pointer r1 = createGeoImage<ShortImageType>(20, 10);
+	ShortImageType::Pointer r2 = createGeoImage<ShortImageType>(10, 20);
+	RegionOfInterest::RegionType region1 = roi.GetRegion(r1);
+	RegionOfInterest::RegionType region2 = roi.GetRegion(r2);
+	BOOST_CHECK_EQUAL(region1.GetIndex(0), 4);
+	BOOST_CHECK_EQUAL(region1.GetIndex(1), 2);
+	BOOST_CHECK_EQUAL(region1.GetSize(0), 8);
+	BOOST_CHECK_EQUAL(region1.GetSize(1), 8);
+	BOOST_CHECK_EQUAL(region2.GetIndex(0), 2);
+	BOOST_CHECK_EQUAL(region2.GetIndex(1), 1);
+	BOOST_CHECK_EQUAL(region2.GetSize(0), 4);
+	BOOST_CHECK_EQUAL(region2.GetSize(1), 4);
+
+	BOOST_CHECK(RegionOfInterest().GetRegion(r1) == r1->GetLargestPossibleRegion());
+	BOOST_CHECK_THROW(RegionOfInterest(0, 0, 100, 100).GetRegion(r1), itk::ExceptionObject);
+}
+
+BOOST_AUTO_TEST_CASE(testExtractor){
+	RegionOfInterestExtractor extractor;
+	ShortImageType::Pointer img = createGeoImage<ShortImageType>(20, 10);
+	BOOST_CHECK_EQUAL(extractor.Extract(img.GetPointer()).GetPointer(), img.GetPointer());
+
+	extractor.SetRegionOfInterest(RegionOfInterest(1040, 2020, 1120, 2100));
+	ShortImageType::Pointer cropped = extractor.Extract(img.GetPointer());
+	cropped->Update();
+	BOOST_CHECK_EQUAL(cropped->GetLargestPossibleRegion().GetSize(0), 8);
+	BOOST_CHECK_EQUAL(cropped->GetLargestPossibleRegion().GetSize(1), 8);
+	ShortImageType::IndexType idx;
+	idx.Fill(0);
+	BOOST_CHECK_EQUAL(cropped->GetPixel(idx), 2 * 20 + 4);
+	// The georeferencing follows the crop
+	BOOST_CHECK_CLOSE(cropped->GetOrigin()[0], 1045, 1e-9);
+	BOOST_CHECK_CLOSE(cropped->GetOrigin()[1], 2025, 1e-9);
+
+	// Cropping again to the same extent has no effect
+	ShortImageType::Pointer croppedTwice = extractor.Extract(cropped.GetPointer());
+	BOOST_CHECK(croppedTwice->GetLargestPossibleRegion() == cropped->GetLargestPossibleRegion());
+	BOOST_CHECK_CLOSE(croppedTwice->GetOrigin()[0], 1045, 1e-9);
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE StreamingAlignment
+#include <boost/test/unit_test.hpp>
+#include "StreamingAlignment.h"
+#include "otbImage.h"
+#include "otbImageFileWriter.h"
+#include <cstdio>
+
+using namespace ts;
+
+typedef otb::Image<short, 2>					ShortImageType;
+typedef otb::ImageFileWriter<ShortImageType>	ShortImageWriterType;
+
+#define TILED_OUTPUT	"test_StreamingAlignment_OUT.tif"
+#define CROPPED_OUTPUT	"test_StreamingAlignment_CROPPED_OUT.tif"
+
+StreamingAlignment::BlockLayout createLayout(size_t width, size_t height, size_t blockWidth, size_t blockHeight){
+	StreamingAlignment::BlockLayout layout;
+	layout.width = width;
+	layout.height = height;
+	layout.blockWidth = blockWidth;
+	layout.blockHeight = blockHeight;
+	layout.bytesPerPixel = 2;
+	return layout;
+}
+
+/**
+ * @brief Write a tiled image with pixels of 1 x 1 map units, whose first pixel has its corner at the given position
+ */
+void writeTiledImage(const std::string &filename, size_t width, size_t height, double xCorner, double yCorner){
+	ShortImageType::Pointer img = ShortImageType::New();
+	ShortImageType::RegionType region;
+	region.SetSize(0, width);
+	region.SetSize(1, height);
+	img->SetRegions(region);
+	ShortImageType::PointType origin;
+	origin[0] = xCorner + 0.5;
+	origin[1] = yCorner + 0.5;
+	img->SetOrigin(origin);
+	ShortImageType::SpacingType spacing;
+	spacing.Fill(1);
+	img->SetSpacing(spacing);
+	img->Allocate();
+	img->FillBuffer(0);
+	ShortImageWriterType::Pointer writer = ShortImageWriterType::New();
+	writer->SetFileName(filename + "?&gdal:co:TILED=YES&gdal:co:BLOCKXSIZE=256&gdal:co:BLOCKYSIZE=128");
+	writer->SetInput(img);
+	writer->Update();
+}
+
+BOOST_AUTO_TEST_CASE(testDecodeCounts){
+	// 10980 x 10980 Int16 tile with 512 x 512 blocks: 22 x 22 blocks
+	StreamingAlignment::BlockLayout layout = createLayout(10980, 10980, 512, 512);
+	const uint64_t nBlocks = 22 * 22;
+	// 230 MB do not fit into 128 MB: the default splits into two strips of 5490 lines, the second one starting inside a block
+	StreamingAlignment::Splitting defaultSplitting = StreamingAlignment::GetDefaultSplitting(layout, 128);
+	BOOST_CHECK(!defaultSplitting.bTiled);
+	BOOST_CHECK_EQUAL(defaultSplitting.size, 5490);
+	BOOST_CHECK_EQUAL(StreamingAlignment::CountBlockDecodes(layout, defaultSplitting), nBlocks + 22);
+
+	StreamingAlignment::Splitting tiles = StreamingAlignment::GetAlignedSplitting(layout, 128);
+	BOOST_CHECK(tiles.bTiled);
+	BOOST_CHECK_EQUAL(tiles.size % 512, 0);
+	BOOST_CHECK_LE(tiles.size * tiles.size * layout.bytesPerPixel, 128 * 1024 * 1024);
+	BOOST_CHECK_EQUAL(StreamingAlignment::CountBlockDecodes(layout, tiles), nBlocks);
+
+	StreamingAlignment::Splitting strips = StreamingAlignment::GetAlignedSplitting(layout, 128, false);
+	BOOST_CHECK(!strips.bTiled);
+	BOOST_CHECK_EQUAL(strips.size % 512, 0);
+	BOOST_CHECK_LE(strips.size * layout.width * layout.bytesPerPixel, 128 * 1024 * 1024);
+	BOOST_CHECK_EQUAL(StreamingAlignment::CountBlockDecodes(layout, strips), nBlocks);
+
+	// Too little RAM for a single block row still gives one block row per strip
+	strips = StreamingAlignment::GetAlignedSplitting(layout, 1, false);
+	BOOST_CHECK_EQUAL(strips.size, 512);
+	BOOST_CHECK_EQUAL(StreamingAlignment::CountBlockDecodes(layout, strips), nBlocks);
+
+	// Striped inputs are never split into tiles
+	layout = createLayout(10980, 10980, 10980, 16);
+	BOOST_CHECK(!layout.IsTiled());
+	strips = StreamingAlignment::GetAlignedSplitting(layout, 16);
+	BOOST_CHECK(!strips.bTiled);
+	BOOST_CHECK_EQUAL(strips.size % 16, 0);
+	BOOST_CHECK_EQUAL(StreamingAlignment::CountBlockDecodes(layout, strips), 687);
+}
+
+BOOST_AUTO_TEST_CASE(testExtendedFilename){
+	StreamingAlignment::Splitting splitting;
+	splitting.bTiled = true;
+	splitting.size = 1024;
+	BOOST_CHECK_EQUAL(StreamingAlignment::GetExtendedFilename("out.tif", splitting),
+			"out.tif?&streaming:type=tiled&streaming:sizemode=height&streaming:sizevalue=1024");
+	splitting.bTiled = false;
+	BOOST_CHECK_EQUAL(StreamingAlignment::GetExtendedFilename("out.tif?&gdal:co:COMPRESS=DEFLATE", splitting),
+			"out.tif?&gdal:co:COMPRESS=DEFLATE&streaming:type=stripped&streaming:sizemode=height&streaming:sizevalue=1024");
+	// Streaming options given by the user are kept
+	const std::string userStreaming = "out.tif?&streaming:type=none";
+	BOOST_CHECK_EQUAL(StreamingAlignment::AlignOutput(userStreaming, {TILED_OUTPUT}, 0), userStreaming);
+	// Unreadable inputs leave the output unchanged
+	BOOST_CHECK_EQUAL(StreamingAlignment::AlignOutput("out.tif", {"does_not_exist.tif"}, 0), "out.tif");
+}
+
+BOOST_AUTO_TEST_CASE(testBlockLayout){
+	ShortImageType::Pointer img = ShortImageType::New();
+	ShortImageType::RegionType region;
+	region.SetSize(0, 1000);
+	region.SetSize(1, 700);
+	img->SetRegions(region);
+	img->Allocate();
+	img->FillBuffer(0);
+	ShortImageWriterType::Pointer writer = ShortImageWriterType::New();
+	writer->SetFileName(TILED_OUTPUT "?&gdal:co:TILED=YES&gdal:co:BLOCKXSIZE=256&gdal:co:BLOCKYSIZE=128");
+	writer->SetInput(img);
+	writer->Update();
+
+	StreamingAlignment::BlockLayout layout = StreamingAlignment::GetBlockLayout(TILED_OUTPUT "?&skipgeom=true");
+	BOOST_CHECK_EQUAL(layout.width, 1000);
+	BOOST_CHECK_EQUAL(layout.height, 700);
+	BOOST_CHECK_EQUAL(layout.blockWidth, 256);
+	BOOST_CHECK_EQUAL(layout.blockHeight, 128);
+	BOOST_CHECK_EQUAL(layout.bytesPerPixel, 2);
+	BOOST_CHECK(layout.IsTiled());
+
+	// Two inputs: blocks aligned to both, pixels as large as both together
+	layout = StreamingAlignment::GetCommonBlockLayout({TILED_OUTPUT, "", TILED_OUTPUT});
+	BOOST_CHECK_EQUAL(layout.blockWidth, 256);
+	BOOST_CHECK_EQUAL(layout.blockHeight, 128);
+	BOOST_CHECK_EQUAL(layout.bytesPerPixel, 4);
+
+	StreamingAlignment::Splitting splitting;
+	BOOST_CHECK(StreamingAlignment::ComputeAlignedSplitting(TILED_OUTPUT, {TILED_OUTPUT}, 1, true, RegionOfInterest(), NULL, splitting));
+	BOOST_CHECK(splitting.bTiled);
+	BOOST_CHECK_EQUAL(splitting.size % 256, 0);
+	BOOST_CHECK_EQUAL(StreamingAlignment::CountBlockDecodes(layout, splitting), 4 * 6);
+
+	BOOST_CHECK_THROW(StreamingAlignment::GetBlockLayout("does_not_exist.tif"), itk::ExceptionObject);
+	std::remove(TILED_OUTPUT);
+}
+
+BOOST_AUTO_TEST_CASE(testRegionOfInterest){
+	writeTiledImage(TILED_OUTPUT, 1000, 700, 0, 0);
+	// The same area as the region of interest below, as written by an application cropping to it
+	writeTiledImage(CROPPED_OUTPUT, 301, 150, 300, 100);
+	const RegionOfInterest roi(300.2, 100.3, 600.7, 250.4);
+
+	// Pixels whose centre lies within the extent: columns 300 to 600, rows 100 to 249
+	StreamingAlignment::BlockLayout layout = StreamingAlignment::GetBlockLayout(TILED_OUTPUT, roi);
+	BOOST_CHECK_EQUAL(layout.xStart, 300);
+	BOOST_CHECK_EQUAL(layout.yStart, 100);
+	BOOST_CHECK_EQUAL(layout.width, 301);
+	BOOST_CHECK_EQUAL(layout.height, 150);
+	layout = StreamingAlignment::GetBlockLayout(CROPPED_OUTPUT, roi);
+	BOOST_CHECK_EQUAL(layout.xStart, 0);
+	BOOST_CHECK_EQUAL(layout.yStart, 0);
+	BOOST_CHECK_EQUAL(layout.width, 301);
+	BOOST_CHECK_EQUAL(layout.height, 150);
+
+	// A full tile and an already cropped raster cover the same region of interest
+	layout = StreamingAlignment::GetCommonBlockLayout({TILED_OUTPUT, CROPPED_OUTPUT}, roi);
+	BOOST_CHECK_EQUAL(layout.width, 301);
+	BOOST_CHECK_EQUAL(layout.height, 150);
+	BOOST_CHECK_EQUAL(layout.yStart, 100);
+	BOOST_CHECK_THROW(StreamingAlignment::GetCommonBlockLayout({TILED_OUTPUT, CROPPED_OUTPUT}), itk::ExceptionObject);
+
+	// Rows 100 to 227 touch two block rows, rows 228 to 249 the second one again. Columns 300 to 600 touch two block columns.
+	StreamingAlignment::Splitting strips;
+	strips.bTiled = false;
+	strips.size = 128;
+	BOOST_CHECK_EQUAL(StreamingAlignment::CountBlockDecodes(layout, strips), 3 * 2);
+
+	StreamingAlignment::Splitting splitting;
+	BOOST_CHECK(StreamingAlignment::ComputeAlignedSplitting(TILED_OUTPUT, {TILED_OUTPUT, CROPPED_OUTPUT}, 1, false, roi, NULL, splitting));
+	BOOST_CHECK_EQUAL(splitting.size % 128, 0);
+	// Regions of different sizes fall back to the default splitting
+	BOOST_CHECK(!StreamingAlignment::ComputeAlignedSplitting(TILED_OUTPUT, {TILED_OUTPUT, CROPPED_OUTPUT}, 1, false, RegionOfInterest(), NULL, splitting));
+	BOOST_CHECK_EQUAL(StreamingAlignment::AlignOutput("out.tif", {TILED_OUTPUT, CROPPED_OUTPUT}, 1), "out.tif");
+	// A region of interest outside of the rasters cannot be aligned either
+	BOOST_CHECK_THROW(StreamingAlignment::GetBlockLayout(TILED_OUTPUT, RegionOfInterest(2000, 0, 3000, 100)), itk::ExceptionObject);
+	std::remove(TILED_OUTPUT);
+	std::remove(CROPPED_OUTPUT);
+}
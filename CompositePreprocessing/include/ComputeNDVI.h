@@ -101,8 +101,10 @@ public:
 	/**
 	 * @brief Init the NDVI calculation
 	 * @param xml Metadata-filename
+	 * @param redBand Name of the red band
+	 * @param nirBand Name of the near-infrared band
 	 */
-	void DoInit(const std::string &xml);
+	void DoInit(const std::string &xml, const std::string &redBand = "B4", const std::string &nirBand = "B8");
 
 	/**
 	 * @brief Execute the application
@@ -118,6 +120,8 @@ public:
 
 private:
 	std::string              							            m_inXml;
+	std::string              							            m_redBand;
+	std::string              							            m_nirBand;
 	ShortImageReaderType::Pointer        						    m_InputImageReaderRed;
 	ShortImageReaderType::Pointer							        m_InputImageReaderNIR;
 	NDVIFilterType::Pointer 										m_NDVI;
@@ -45,6 +45,7 @@
 #include "MetadataHelperFactory.h"
 #include "ResamplingBandExtractor.h"
 #include "BaseImageTypes.h"
+#include "FootprintFunctorImageFilter.h"
 
 /**
  * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
@@ -68,7 +69,7 @@ public:
 
 	typedef Functor::DirectionalCorrectionFunctor <FloatVectorImageType::PixelType,
 			ShortVectorImageType::PixelType>                							DirectionalCorrectionFunctorType;
-	typedef itk::UnaryFunctorImageFilter< FloatVectorImageType,
+	typedef FootprintUnaryFunctorImageFilter< FloatVectorImageType,
 			ShortVectorImageType,
 			DirectionalCorrectionFunctorType >      									FunctorFilterType;
 
@@ -96,6 +97,20 @@ public:
 			FloatImageType::Pointer &watImg, FloatImageType::Pointer &snowImg,
 			FloatVectorImageType::Pointer &angles, FloatImageType::Pointer &ndvi);
 
+	/**
+	 * @brief Select the evaluation mode of the directional model
+	 * @param bExact If true, the nadir reference term is evaluated exactly in double precision for each pixel
+	 * instead of being read from the precomputed table
+	 */
+	void SetExactEvaluation(bool bExact);
+
+	/**
+	 * @brief Only correct the pixels within the valid footprint of the product, the others are set to no-data
+	 * @param footprint The footprint, or a null pointer to correct the full extent
+	 * @note Has to be set prior to DoExecute()
+	 */
+	void SetFootprint(const ValidFootprint::ConstPointer &footprint);
+
 	/**
 	 * @brief Execute the application
 	 */
@@ -113,6 +128,13 @@ public:
 	 */
 	const char * GetNameOfClass() { return "DirectionalCorrection"; }
 
+	/**
+	 * @brief Load the scattering coefficients file
+	 * @param strFileName Filename to the scattering-coefficients
+	 * @return Vector containing the coeffs
+	 */
+	static std::vector<Functor::ScatteringFunctionCoefficients> loadScatteringFunctionCoeffs(const std::string &strFileName);
+
 private:
 	/**
 	 * @brief Extract each band from the angles image to the image list
@@ -121,24 +143,19 @@ private:
 	 */
 	int extractBandsFromImage(FloatVectorImageType::Pointer & imageType);
 
-	/**
-	 * @brief Load the scattering coefficients file
-	 * @param strFileName Filename to the scattering-coefficients
-	 * @return Vector containing the coeffs
-	 */
-	std::vector<Functor::ScatteringFunctionCoefficients> loadScatteringFunctionCoeffs(std::string &strFileName);
-
 	/**
 	 * @brief Trim a string with whitespaces
 	 * @param str The input string
 	 * @return The string between the whitespaces
 	 */
-	std::string trim(std::string const& str);
+	static std::string trim(std::string const& str);
 
 private:
 	size_t                                  	m_nRes;
 	std::string                            		m_strXml;
 	std::string                            		m_strScatCoeffs;
+	bool										m_bExactEvaluation;
+	ValidFootprint::ConstPointer				m_Footprint;
 
 	FloatVectorImageType::Pointer               m_L2AIn;
 	FloatVectorImageType::Pointer               m_AnglesImg;
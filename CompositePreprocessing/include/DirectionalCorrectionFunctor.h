@@ -26,6 +26,14 @@
 #ifndef DIRECTIONALCORRECTIONFUNCTOR_H
 #define DIRECTIONALCORRECTIONFUNCTOR_H
 
+#include <vector>
+#include <cmath>
+
+/// Step of the solar zenith angle quantization of the reference term table, in degrees
+#define SUN_ZENITH_LUT_STEP 0.1
+/// Highest solar zenith angle covered by the reference term table, in degrees
+#define SUN_ZENITH_LUT_MAX 85.0
+
 /**
  * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
  */
@@ -48,8 +56,20 @@ public:
     float R1;
 };
 
+/**
+ * @brief Nadir reference term of the directional model for one band and one solar zenith angle.
+ * As kV and kR are linear in the NDVI, the term is stored as dir_mod0 = Offset + Slope * NDVI
+ */
+class DirectionalReferenceTerm {
+public:
+    double Offset;
+    double Slope;
+};
+
 /**
  * @brief Functor to perform the directional correction
+ * @note By default, the nadir reference term is read from a table precomputed per band and per quantized
+ * solar zenith angle. The exact evaluation of both directional models can be forced for validation purposes.
  */
 template< class TInput, class TOutput>
 class DirectionalCorrectionFunctor
@@ -60,7 +80,13 @@ public:
     bool operator!=( const DirectionalCorrectionFunctor & other) const;
     bool operator==( const DirectionalCorrectionFunctor & other ) const;
     TOutput operator()( const TInput & A );
-    void Initialize(const std::vector<ScatteringFunctionCoefficients> &coeffs);
+    /**
+     * @brief Initialize the functor
+     * @param coeffs The scattering coefficients of each reflectance band
+     * @param bExactEvaluation If true, both directional models are evaluated in double precision for each pixel,
+     * otherwise the reference term is taken from the precomputed table
+     */
+    void Initialize(const std::vector<ScatteringFunctionCoefficients> &coeffs, bool bExactEvaluation = false);
 
     const char * GetNameOfClass() { return "DirectionalCorrectionFunctor"; }
 
@@ -71,8 +97,26 @@ public:
     float GetCurrentL2AWeightValue(const TInput & A);
     bool IsNoDataValue(float fValue, float fNoDataValue);
 
+private:
+    /**
+     * @brief Fill the reference term table for all bands and solar zenith bins
+     */
+    void BuildReferenceTable();
+
+    /**
+     * @brief Get the nadir reference term of the directional model
+     * @param nBand The reflectance band index
+     * @param thetaS The solar zenith angle in degrees
+     * @param ndvi The NDVI value of the pixel
+     * @return The value of dir_mod(kV, kR) for the nadir geometry
+     */
+    double GetReferenceTerm(int nBand, double thetaS, double ndvi) const;
+
 private:
     std::vector<ScatteringFunctionCoefficients> m_ScatteringCoeffs;
+    std::vector<DirectionalReferenceTerm> m_ReferenceTable;
+    int m_nSunZenithBinsCount;
+    bool m_bExactEvaluation;
 
     int m_nReflBandsCount;
 
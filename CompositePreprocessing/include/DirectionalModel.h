@@ -56,6 +56,18 @@ public:
     double FR();
     double dir_mod(double kV,double kR);
 
+    /**
+     * @brief Return the Ross-Thick volume kernel computed in the constructor
+     * @return The FV value for the current geometry
+     */
+    inline double GetFV() const { return m_FV_Val; }
+
+    /**
+     * @brief Return the Li-Sparse roughness kernel computed in the constructor
+     * @return The FR value for the current geometry
+     */
+    inline double GetFR() const { return m_FR_Val; }
+
 private:
     double m_theta_s;
     double m_theta_v;
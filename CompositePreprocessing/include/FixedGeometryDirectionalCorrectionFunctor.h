@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMPOSITEPREPROCESSING_INCLUDE_FIXEDGEOMETRYDIRECTIONALCORRECTIONFUNCTOR_H_
+#define COMPOSITEPREPROCESSING_INCLUDE_FIXEDGEOMETRYDIRECTIONALCORRECTIONFUNCTOR_H_
+
+#include <vector>
+#include <cmath>
+#include "DirectionalCorrectionFunctor.h"
+#include "DirectionalModel.h"
+#include "MetadataAngles.h"
+#include "GlobalDefs.h"
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Namespace around Functors to be used in the filters defined below
+ */
+namespace Functor
+{
+
+/**
+ * @brief Functor to perform the directional correction for a sensor with a fixed viewing geometry
+ * @note The sun and viewing angles are constant over the image, so both directional models are evaluated
+ * once per band in Initialize(). The per-pixel work is reduced to two multiply-adds on the NDVI.
+ * The input pixel contains the reflectance bands, followed by the cloud, snow and water masks and the NDVI.
+ */
+template< class TInput, class TOutput>
+class FixedGeometryDirectionalCorrectionFunctor
+{
+public:
+	FixedGeometryDirectionalCorrectionFunctor() : m_nReflBandsCount(0), m_fReflNoDataValue(NO_DATA_VALUE) {}
+	~FixedGeometryDirectionalCorrectionFunctor() {}
+
+	bool operator!=( const FixedGeometryDirectionalCorrectionFunctor & ) const {
+		return true;
+	}
+	bool operator==( const FixedGeometryDirectionalCorrectionFunctor & other ) const {
+		return !(*this != other);
+	}
+
+	/**
+	 * @brief Evaluate the directional models of each band for the given geometry
+	 * @param coeffs The scattering coefficients of each reflectance band
+	 * @param sunAngles The solar zenith and azimuth angles in degrees
+	 * @param viewAngles The viewing zenith and azimuth angles of each band in degrees
+	 */
+	void Initialize(const std::vector<ScatteringFunctionCoefficients> &coeffs, const MeanAngles_Type &sunAngles,
+			const std::vector<MeanAngles_Type> &viewAngles) {
+		m_nReflBandsCount = coeffs.size();
+		m_ReferenceTerms.resize(m_nReflBandsCount);
+		m_ViewTerms.resize(m_nReflBandsCount);
+		DirectionalModel dirModel0(sunAngles.zenith, 0, 0, 0);
+		for(int i = 0; i < m_nReflBandsCount; i++) {
+			DirectionalModel dirModel(sunAngles.zenith, sunAngles.azimuth, viewAngles[i].zenith, viewAngles[i].azimuth);
+			m_ReferenceTerms[i] = ToReferenceTerm(coeffs[i], dirModel0);
+			m_ViewTerms[i] = ToReferenceTerm(coeffs[i], dirModel);
+		}
+	}
+
+	inline TOutput operator()( const TInput & A ) const {
+		TOutput var(m_nReflBandsCount);
+		// if is water, snow or cloud, there is made no correction
+		bool bIsMasked = IsMaskSet(A, m_nReflBandsCount) || IsMaskSet(A, m_nReflBandsCount + 1) ||
+				IsMaskSet(A, m_nReflBandsCount + 2);
+		double ndvi = A[m_nReflBandsCount + 3];
+		for(int i = 0; i < m_nReflBandsCount; i++) {
+			float fReflVal = static_cast<float>(A[i]);
+			if(fabs(fReflVal - m_fReflNoDataValue) < EPSILON) {
+				var[i] = m_fReflNoDataValue;
+			} else if(bIsMasked) {
+				var[i] = fReflVal;
+			} else {
+				const DirectionalReferenceTerm &ref = m_ReferenceTerms[i];
+				const DirectionalReferenceTerm &view = m_ViewTerms[i];
+				float fNewReflVal = fReflVal * (ref.Offset + ref.Slope * ndvi) / (view.Offset + view.Slope * ndvi);
+				if(fNewReflVal < 0) {
+					fNewReflVal = fReflVal;
+				}
+				var[i] = fNewReflVal;
+			}
+		}
+		return var;
+	}
+
+private:
+	/**
+	 * @brief Express dir_mod(kV, kR) of a model as a linear function of the NDVI
+	 */
+	static DirectionalReferenceTerm ToReferenceTerm(const ScatteringFunctionCoefficients &coeffs, const DirectionalModel &model) {
+		DirectionalReferenceTerm term;
+		term.Offset = 1 + coeffs.V0 * model.GetFV() + coeffs.R0 * model.GetFR();
+		term.Slope = coeffs.V1 * model.GetFV() + coeffs.R1 * model.GetFR();
+		return term;
+	}
+
+	inline bool IsMaskSet(const TInput & A, int nIdx) const {
+		return ((int)static_cast<float>(A[nIdx])) != 0;
+	}
+
+	int m_nReflBandsCount;
+	float m_fReflNoDataValue;
+	std::vector<DirectionalReferenceTerm> m_ReferenceTerms;
+	std::vector<DirectionalReferenceTerm> m_ViewTerms;
+};
+
+} //namespace Functor
+} //namespace ts
+
+#endif /* COMPOSITEPREPROCESSING_INCLUDE_FIXEDGEOMETRYDIRECTIONALCORRECTIONFUNCTOR_H_ */
@@ -36,6 +36,7 @@
 
 #include "BaseImageTypes.h"
 #include "MaskExtractorFilter.h"
+#include "ValidFootprint.h"
 
 /**
  * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
@@ -95,6 +96,18 @@ public:
 	 */
 	void setScatteringCoefficients(const std::vector<std::string> &scatteringcoeffs);
 
+	/**
+	 * @brief Force the exact evaluation of the directional model instead of the precomputed reference table
+	 * @param bExact True for the exact double-precision evaluation
+	 */
+	void setExactDirectionalCorrection(const bool &bExact);
+
+	/**
+	 * @brief Restrict the directional correction to the valid footprint of the product
+	 * @param footprint The footprint, or a null pointer to correct the full extent
+	 */
+	void setFootprint(const ValidFootprint::ConstPointer &footprint);
+
 	virtual std::vector<ShortVectorImageType::Pointer> getCorrectedRasters(
 			const std::string &filename,
 			FloatImageType::Pointer cloudImage, FloatImageType::Pointer watImage,
@@ -113,6 +126,8 @@ protected:
 	ByteImageReaderListType::Pointer						m_MaskList;
 	ExtractorListType::Pointer								m_ExtractorList;
 	std::vector<std::string>								m_scatteringCoeffs;
+	bool													m_bExactDirCorr = false;
+	ValidFootprint::ConstPointer							m_footprint;
 };
 
 } // namespace preprocessing
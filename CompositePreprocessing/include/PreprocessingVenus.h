@@ -30,6 +30,7 @@
 
 #include "PreprocessingAdapter.h"
 #include "ComputeNDVI.h"
+#include "VenusDirectionalCorrection.h"
 #include "ResamplingBandExtractor.h"
 #include "otbImageListToVectorImageFilter.h"
 
@@ -78,7 +79,7 @@ public:
 	virtual FloatImageType::Pointer getWaterMask(const std::string &filename, const unsigned char &bit = 0);
 
 	/**
-	 * @brief Extract the rasters of Venus
+	 * @brief Extract the rasters of Venus, using a directional correction if the scattering coefficients are set
 	 * @param xml The filename to the xml-file
 	 * @param cldImg Cloud Image file
 	 * @param watImg Water image file
@@ -96,7 +97,17 @@ private:
 	typedef otb::ImageListToVectorImageFilter<
 			ShortImageListType, ShortVectorImageType> ShortImageListToVectorImageType;
 
+	/**
+	 * @brief Stack the rasters of one resolution without any correction
+	 * @param pHelper The metadata helper of the product
+	 * @param resolution The resolution index
+	 * @return The stacked rasters
+	 */
+	ShortVectorImageType::Pointer getStackedRasters(const MetadataHelper *pHelper, const size_t &resolution);
+
 	ResamplingBandExtractor<FloatPixelType>										m_aotExtractor;
+	ComputeNDVI																	m_computeNdvi;
+	std::vector<std::unique_ptr<VenusDirectionalCorrection>>					m_dirCorr;
 	ShortVectorImageReaderType::Pointer        									m_inputImageReader;
 	ShortImageReaderListType::Pointer											m_ReaderList;
 	std::vector<ShortImageListType::Pointer>       								m_ImageList;
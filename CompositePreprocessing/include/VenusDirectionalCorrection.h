@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMPOSITEPREPROCESSING_INCLUDE_VENUSDIRECTIONALCORRECTION_H_
+#define COMPOSITEPREPROCESSING_INCLUDE_VENUSDIRECTIONALCORRECTION_H_
+
+#include "otbImageListToVectorImageFilter.h"
+#include "FootprintFunctorImageFilter.h"
+#include "FixedGeometryDirectionalCorrectionFunctor.h"
+#include "MetadataHelper.h"
+#include "BaseImageTypes.h"
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Perform the directional correction on the Venus XS bands
+ * @note Venus only provides the mean sun and viewing angles of each product, which are read by band id.
+ * As they are constant over the image, the directional kernels are evaluated once per band.
+ */
+class VenusDirectionalCorrection : public BaseImageTypes {
+public:
+	typedef otb::ImageListToVectorImageFilter<FloatImageListType, FloatVectorImageType>	ListConcatenerFilterType;
+
+	typedef Functor::FixedGeometryDirectionalCorrectionFunctor <FloatVectorImageType::PixelType,
+			ShortVectorImageType::PixelType>											DirectionalCorrectionFunctorType;
+	typedef FootprintUnaryFunctorImageFilter< FloatVectorImageType,
+			ShortVectorImageType,
+			DirectionalCorrectionFunctorType >      									FunctorFilterType;
+
+public:
+	/**
+	 * @brief Init the Directional Correction
+	 * @param res Current resolution
+	 * @param xml Metadata file
+	 * @param scatcoef Scattering coefficient filename
+	 * @param cldImg Cloud Image
+	 * @param watImg Water Image
+	 * @param snowImg Snow Image
+	 * @param ndvi NDVI Image
+	 */
+	void Init(const size_t &res, const std::string &xml, const std::string &scatcoef, FloatImageType::Pointer cldImg,
+			FloatImageType::Pointer watImg, FloatImageType::Pointer snowImg, FloatImageType::Pointer ndvi);
+
+	/**
+	 * @brief Only correct the pixels within the valid footprint of the product, the others are set to no-data
+	 * @param footprint The footprint, or a null pointer to correct the full extent
+	 * @note Has to be set prior to DoExecute()
+	 */
+	void SetFootprint(const ValidFootprint::ConstPointer &footprint);
+
+	/**
+	 * @brief Execute the correction
+	 */
+	void DoExecute();
+
+	/**
+	 * @brief Return the corrected image
+	 * @return ShortVectorImage containing the corrected Venus-rasters
+	 */
+	ShortVectorImageType::Pointer GetCorrectedImg();
+
+	/**
+	 * @brief Return the name of the class
+	 * @return
+	 */
+	const char * GetNameOfClass() { return "VenusDirectionalCorrection"; }
+
+private:
+	/**
+	 * @brief Get the mean viewing angles of the product for each band
+	 * @param pHelper The metadata helper of the product
+	 * @param bandNames The ids of the bands to be corrected
+	 * @return The mean viewing angles for each band
+	 * @note Products giving the angles per detector instead of per band use their mean for all bands
+	 */
+	std::vector<MeanAngles_Type> getViewingAngles(const MetadataHelper *pHelper, const std::vector<std::string> &bandNames);
+
+private:
+	size_t                                  	m_nRes;
+	std::string                            		m_strXml;
+	std::string                            		m_strScatCoeffs;
+	ValidFootprint::ConstPointer				m_Footprint;
+
+	FloatImageType::Pointer                		m_NdviImg, m_CSM, m_WM, m_SM;
+	FloatImageReaderListType::Pointer			m_ReaderList;
+	FloatImageListType::Pointer                	m_ImageList;
+	ListConcatenerFilterType::Pointer       	m_Concat;
+	FunctorFilterType::Pointer              	m_DirectionalCorrectionFunctor;
+	DirectionalCorrectionFunctorType        	m_Functor;
+};
+} //namespace ts
+
+#endif /* COMPOSITEPREPROCESSING_INCLUDE_VENUSDIRECTIONALCORRECTION_H_ */
@@ -29,6 +29,10 @@
 #include "BaseImageTypes.h"
 #include "PreprocessingSentinel.h"
 #include "PreprocessingVenus.h"
+#include "ValidFootprint.h"
+#include "StreamingAlignment.h"
+#include "RegionOfInterest.h"
+#include "PerformanceTelemetry.h"
 
 /**
  * @brief otb Namespace for all OTB-related Filters and Applications
@@ -83,6 +87,14 @@ private:
 		MandatoryOff("scatteringcoeffsr1");
 		AddParameter(ParameterType_String, "scatteringcoeffsr2", "Scattering coefficients filename R2");
 		MandatoryOff("scatteringcoeffsr2");
+		AddParameter(ParameterType_Int, "exactdircorr", "Exact directional correction");
+		SetParameterDescription("exactdircorr", "Evaluate the directional model exactly for each pixel instead of using the precomputed reference table (validation only)");
+		SetDefaultParameterInt("exactdircorr", 0);
+		MandatoryOff("exactdircorr");
+		AddParameter(ParameterType_Int, "footprint", "Restrict to valid footprint");
+		SetParameterDescription("footprint", "Only process the valid pixels given by the edge mask of the product, the rest is set to no-data");
+		SetDefaultParameterInt("footprint", 1);
+		MandatoryOff("footprint");
 		AddParameter(ParameterType_OutputImage, "outr1", "Out Image at R1 resolution");
 		MandatoryOff("outr1");
 		AddParameter(ParameterType_OutputImage, "outr2", "Out Image at R2 resolution");
@@ -95,12 +107,18 @@ private:
 		MandatoryOff("outsnw");
 		AddParameter(ParameterType_OutputImage, "outaot", "Out aot mask image R1 resolution");
 		MandatoryOff("outaot");
+		AddParameter(ParameterType_StringList, "roi", "Region of interest");
+		SetParameterDescription("roi", "Extent xmin ymin xmax ymax in the map coordinates of the product. All outputs but the cloud mask are cropped to the pixels whose centre lies within it. "
+				"The cloud mask keeps the full tile, as the weight on clouds within the extent depends on the clouds around it");
+		MandatoryOff("roi");
 
 		AddRAMParameter();
 
 		SetDocExampleParameterValue("xml", "/path/to/L2Aproduct_muscate.xml");
 		SetDocExampleParameterValue("scatteringcoeffsr1", "/path/to/scattering_coeffs_10m.txt");
 		SetDocExampleParameterValue("scatteringcoeffsr2", "/path/to/scattering_coeffs_20m.txt");
+		SetDocExampleParameterValue("exactdircorr", "0");
+		SetDocExampleParameterValue("footprint", "1");
 
 		SetDocExampleParameterValue("outr1", "/path/to/output_image_r1.tif");
 		SetDocExampleParameterValue("outr2", "/path/to/output_image_r2.tif");
@@ -108,6 +126,7 @@ private:
 		SetDocExampleParameterValue("outwat", "/path/to/output_image_water.tif");
 		SetDocExampleParameterValue("outsnw", "/path/to/output_image_snow.tif");
 		SetDocExampleParameterValue("outaot", "/path/to/output_image_aot.tif");
+		SetDocExampleParameterValue("roi", "300000 4890240 354900 4945140");
 
 	}
 
@@ -125,6 +144,7 @@ private:
 	 */
 	void DoExecute()
 	{
+		m_Telemetry.Start(this);
 		std::string inXml = GetParameterAsString("xml");
 		std::cout << "XML found: " << inXml << std::endl;
 		auto factory = MetadataHelperFactory::New();
@@ -132,27 +152,58 @@ private:
 		m_processor = GetPreprocessor(pHelper->GetMissionName());
 		m_processor->init();
 
+		if(HasValue("roi")){
+			m_RegionOfInterest.SetRegionOfInterest(RegionOfInterest::FromStringList(GetParameterStringList("roi")));
+			std::cout << "Region of interest: " << m_RegionOfInterest.GetRegionOfInterest().ToString() << std::endl;
+		}
 
 		typename FloatImageType::Pointer cldImg = m_processor->getCloudMask(pHelper->GetCloudImageFileNames()[MAIN_RESOLUTION_INDEX]).GetPointer();
 		SetParameterOutputImage("outcld", cldImg.GetPointer());
 		FloatImageType::Pointer watImg = m_processor->getWaterMask(pHelper->GetWaterImageFileNames()[MAIN_RESOLUTION_INDEX]).GetPointer();
-		SetParameterOutputImage("outwat", watImg.GetPointer());
+		SetParameterOutputImage("outwat", m_RegionOfInterest.Extract(watImg.GetPointer()).GetPointer());
 		FloatImageType::Pointer snowImg = m_processor->getSnowMask(pHelper->GetSnowImageFileNames()[MAIN_RESOLUTION_INDEX]).GetPointer();
-		SetParameterOutputImage("outsnw", snowImg.GetPointer());
+		SetParameterOutputImage("outsnw", m_RegionOfInterest.Extract(snowImg.GetPointer()).GetPointer());
 		FloatImageType::Pointer aotImg = m_processor->getAotMask(pHelper->GetAotImageFileNames()[MAIN_RESOLUTION_INDEX]).GetPointer();
-		SetParameterOutputImage("outaot", aotImg.GetPointer());
+		SetParameterOutputImage("outaot", m_RegionOfInterest.Extract(aotImg.GetPointer()).GetPointer());
 
 		size_t totalNRes = pHelper->getResolutions().getNumberOfResolutions();
 
-		if(this->HasValue("scatteringcoeffsr1") && this->HasValue("scatteringcoeffsr2")){
-			std::vector<std::string> scatteringCoeffs = {GetParameterAsString("scatteringcoeffsr1"), GetParameterAsString("scatteringcoeffsr2")};
+		//Venus only has a single resolution, thus only needs the coefficients for R1
+		std::vector<std::string> scatteringCoeffs;
+		for(size_t resolution = 0; resolution < totalNRes; resolution++){
+			std::string parameterStr = "scatteringcoeffsr" + std::to_string(resolution+1);
+			if(!this->HasValue(parameterStr)){
+				break;
+			}
+			scatteringCoeffs.push_back(GetParameterAsString(parameterStr));
+		}
+		if(!scatteringCoeffs.empty()){
 			m_processor->setScatteringCoefficients(scatteringCoeffs);
 		}
+		m_processor->setExactDirectionalCorrection(GetParameterInt("exactdircorr") > 0);
+
+		ValidFootprint::ConstPointer footprint;
+		if(GetParameterInt("footprint") > 0){
+			footprint = ValidFootprint::GetFootprint(pHelper.get());
+			if(!footprint){
+				std::cout << "No edge mask found, processing the full extent" << std::endl;
+			}
+		}
+		m_processor->setFootprint(footprint);
 
 		std::vector<Int16VectorImageType::Pointer> correctedRasters = m_processor->getCorrectedRasters(inXml, cldImg.GetPointer(), watImg.GetPointer(), snowImg.GetPointer());
 		//For all possible resolutions, do
 		for(size_t resolution = 0; resolution < totalNRes; resolution++){
-			SetParameterOutputImage(std::string("outr" + std::to_string(resolution+1)).c_str(), correctedRasters[resolution].GetPointer());
+			SetParameterOutputImage(std::string("outr" + std::to_string(resolution+1)).c_str(), m_RegionOfInterest.Extract(correctedRasters[resolution].GetPointer()).GetPointer());
+		}
+		// Stream along the blocks of the L2A rasters, so that each of them is decoded once
+		const unsigned int ram = GetParameterInt("ram");
+		alignOutput("outcld", {pHelper->GetCloudImageFileNames()[MAIN_RESOLUTION_INDEX]}, ram, false);
+		alignOutput("outwat", {pHelper->GetWaterImageFileNames()[MAIN_RESOLUTION_INDEX]}, ram, true);
+		alignOutput("outsnw", {pHelper->GetSnowImageFileNames()[MAIN_RESOLUTION_INDEX]}, ram, true);
+		alignOutput("outaot", {pHelper->GetAotImageFileNames()[MAIN_RESOLUTION_INDEX]}, ram, true);
+		for(size_t resolution = 0; resolution < totalNRes; resolution++){
+			alignOutput("outr" + std::to_string(resolution+1), pHelper->getResolutions().getNthResolutionFilenames(resolution), ram, true);
 		}
 		std::string parameterStr = "outr2";
 		std::string parameter = GetParameterAsString(parameterStr);
@@ -164,6 +215,21 @@ private:
 
 private:
 
+	/**
+	 * @brief Align the streamed regions of an output to the blocks of the rasters it is computed from
+	 * @param parameter The output parameter. Nothing is done if it is not set.
+	 * @param inputs The input rasters on the grid of the output
+	 * @param ram The available RAM in MB
+	 * @param bCropped True, if the output is cropped to the region of interest
+	 */
+	void alignOutput(const std::string &parameter, const std::vector<std::string> &inputs, const unsigned int &ram, const bool &bCropped){
+		if(!HasValue(parameter)){
+			return;
+		}
+		SetParameterString(parameter, StreamingAlignment::AlignOutput(GetParameterAsString(parameter), inputs, ram,
+				bCropped ? m_RegionOfInterest.GetRegionOfInterest() : RegionOfInterest(), this->GetLogger()));
+	}
+
 	/**
 	 * @brief Get the preprocessor depending on the platform
 	 * @param p The Platform string, which can be: SENTINEL, VENUS
@@ -188,6 +254,8 @@ private:
 	///////////////////////
 
 	std::unique_ptr<preprocessing::PreprocessingAdapter> m_processor;
+	RegionOfInterestExtractor m_RegionOfInterest;
+	PerformanceTelemetry m_Telemetry;
 
 };
 
@@ -31,8 +31,10 @@ using namespace ts;
 ComputeNDVI::ComputeNDVI() {
 }
 
-void ComputeNDVI::DoInit(const std::string &xml) {
+void ComputeNDVI::DoInit(const std::string &xml, const std::string &redBand, const std::string &nirBand) {
 	m_inXml = xml;
+	m_redBand = redBand;
+	m_nirBand = nirBand;
 }
 
 ComputeNDVI::FloatImageType::Pointer ComputeNDVI::DoExecute() {
@@ -41,8 +43,8 @@ ComputeNDVI::FloatImageType::Pointer ComputeNDVI::DoExecute() {
 	//Read all input parameters
 	m_InputImageReaderRed = ShortImageReaderType::New();
 	m_InputImageReaderNIR = ShortImageReaderType::New();
-	std::string imgFileNameRed = pHelper->getFileNameByString(pHelper->GetImageFileNames(), "B4");
-	std::string imgFileNameNIR = pHelper->getFileNameByString(pHelper->GetImageFileNames(), "B8");//Approximation used. Normally B8A should be used here.
+	std::string imgFileNameRed = pHelper->getFileNameByString(pHelper->GetImageFileNames(), m_redBand);
+	std::string imgFileNameNIR = pHelper->getFileNameByString(pHelper->GetImageFileNames(), m_nirBand);//For S2, B8 is an approximation. Normally B8A should be used here.
 
 	std::cout << "ComputeNDVI Filenames found: \n" << imgFileNameRed << "\n" << imgFileNameNIR << std::endl;
 
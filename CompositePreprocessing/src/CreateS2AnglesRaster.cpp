@@ -75,35 +75,35 @@ CreateS2AnglesRaster::FloatVectorImageType::Pointer CreateS2AnglesRaster::DoExec
     region.SetIndex(start);
 
     //Filter the viewingAngles according to their band existence:
-    auto viewingAngles = pHelper->GetDetailedViewingAngles();
-    std::vector<MetadataHelperViewingAnglesGrid> viewingAnglesFiltered;
-    for(auto angle : viewingAngles){
-    	if(pHelper->getResolutions().getResolutionVector()[m_resolutionIndex].doesBandTypeExist(angle.BandId)){
-    		viewingAnglesFiltered.push_back(angle);
+    //The grids are referenced from the shared helper, which outlives this function
+    const Resolution &resolution = pHelper->getResolutions().getResolutionVector()[m_resolutionIndex];
+    std::vector<const MetadataHelperViewingAnglesGrid*> viewingAngles;
+    for(const MetadataHelperViewingAnglesGrid &angle : pHelper->GetDetailedViewingAngles()){
+    	if(resolution.doesBandTypeExist(angle.BandId)){
+    		viewingAngles.push_back(&angle);
     	}
     }
-    viewingAngles = std::move(viewingAnglesFiltered);
 
-    auto solarAngles = pHelper->GetDetailedSolarAngles();
+    const MetadataHelperAngles &solarAngles = pHelper->GetDetailedSolarAngles();
     int nBandsForRes = pHelper->getResolutions().getNthResolutionFilenames(m_resolutionIndex).size();
     std::cout << "Number of Bands for current Resolution: " << nBandsForRes << std::endl;
     if((viewingAngles.size() == 0) || solarAngles.Zenith.Values.size() == 0 || solarAngles.Azimuth.Values.size() == 0) {
         itkExceptionMacro("Mission does not have any detailed viewing or solar angles or viewing angles differ from the number of bands!");
     }
 
-    if(solarAngles.Zenith.Values.size() != (unsigned int)nGridSize ||
-        solarAngles.Azimuth.Values.size() != (unsigned int)nGridSize ) {
+    if(solarAngles.Zenith.Rows != (unsigned int)nGridSize || solarAngles.Zenith.Cols != (unsigned int)nGridSize ||
+        solarAngles.Azimuth.Rows != (unsigned int)nGridSize || solarAngles.Azimuth.Cols != (unsigned int)nGridSize) {
         itkExceptionMacro("The width and/or height of solar angles from the xml file is/are not as expected: "
-                          << solarAngles.Azimuth.Values.size() << " or " <<
-                          solarAngles.Azimuth.Values.size() << " instead " << nGridSize);
+                          << solarAngles.Azimuth.Rows << " or " <<
+                          solarAngles.Azimuth.Cols << " instead " << nGridSize);
     }
 
     for (int band = 0; band < nBandsForRes; band++) {
-        if(viewingAngles[band].Angles.Zenith.Values.size() != (unsigned int)nGridSize ||
-            viewingAngles[band].Angles.Azimuth.Values.size() != (unsigned int)nGridSize )
+        if(viewingAngles[band]->Angles.Zenith.Rows != (unsigned int)nGridSize || viewingAngles[band]->Angles.Zenith.Cols != (unsigned int)nGridSize ||
+            viewingAngles[band]->Angles.Azimuth.Rows != (unsigned int)nGridSize || viewingAngles[band]->Angles.Azimuth.Cols != (unsigned int)nGridSize)
             itkExceptionMacro("The width and/or height of computed angles from the xml file is/are not as expected: "
-                              << viewingAngles[band].Angles.Zenith.Values.size() << " or " <<
-                              viewingAngles[band].Angles.Azimuth.Values.size() << " instead " << nGridSize);
+                              << viewingAngles[band]->Angles.Zenith.Rows << " or " <<
+                              viewingAngles[band]->Angles.Zenith.Cols << " instead " << nGridSize);
     }
 
     m_AnglesRaster->SetRegions(region);
@@ -119,11 +119,11 @@ CreateS2AnglesRaster::FloatVectorImageType::Pointer CreateS2AnglesRaster::DoExec
     for(unsigned int i = 0; i < (unsigned int)nGridSize; i++) {
         for(unsigned int j = 0; j < (unsigned int)nGridSize; j++) {
             itk::VariableLengthVector<float> vct(nTotalAnglesNo);
-            vct[0] = solarAngles.Zenith.Values[i][j];
-            vct[1] = solarAngles.Azimuth.Values[i][j];
+            vct[0] = solarAngles.Zenith.GetValue(i, j);
+            vct[1] = solarAngles.Azimuth.GetValue(i, j);
             for (int band = 0; band < nBandsForRes; band++) {
-                vct[band * 2 + 2] = viewingAngles[band].Angles.Zenith.Values[i][j];
-                vct[band * 2 + 3] = viewingAngles[band].Angles.Azimuth.Values[i][j];
+                vct[band * 2 + 2] = viewingAngles[band]->Angles.Zenith.GetValue(i, j);
+                vct[band * 2 + 3] = viewingAngles[band]->Angles.Azimuth.GetValue(i, j);
             }
 
             FloatVectorImageType::IndexType idx;
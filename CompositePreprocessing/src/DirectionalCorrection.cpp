@@ -28,7 +28,15 @@
 
 using namespace ts;
 
-DirectionalCorrection::DirectionalCorrection() {
+DirectionalCorrection::DirectionalCorrection() : m_nRes(0), m_bExactEvaluation(false) {
+}
+
+void DirectionalCorrection::SetExactEvaluation(bool bExact) {
+    m_bExactEvaluation = bExact;
+}
+
+void DirectionalCorrection::SetFootprint(const ValidFootprint::ConstPointer &footprint) {
+    m_Footprint = footprint;
 }
 
 void DirectionalCorrection::Init(const size_t &res, const std::string &xml, const std::string &scatcoef,
@@ -81,9 +89,11 @@ void DirectionalCorrection::DoExecute() {
                           << " but are expected coefficients for " << nBandsForRes << " bands!");
     }
 
-    m_Functor.Initialize(scatteringCoeffs);
+    m_Functor.Initialize(scatteringCoeffs, m_bExactEvaluation);
     m_DirectionalCorrectionFunctor = FunctorFilterType::New();
     m_DirectionalCorrectionFunctor->SetFunctor(m_Functor);
+    m_DirectionalCorrectionFunctor->SetFootprint(m_Footprint);
+    m_DirectionalCorrectionFunctor->SetOutsideValue(NO_DATA_VALUE);
     m_DirectionalCorrectionFunctor->SetInput(m_Concat->GetOutput());
     m_DirectionalCorrectionFunctor->UpdateOutputInformation();
     m_DirectionalCorrectionFunctor->GetOutput()->SetNumberOfComponentsPerPixel(scatteringCoeffs.size());
@@ -100,13 +110,13 @@ int DirectionalCorrection::extractBandsFromImage(FloatVectorImageType::Pointer &
     return nbBands;
 }
 
-std::vector<Functor::ScatteringFunctionCoefficients> DirectionalCorrection::loadScatteringFunctionCoeffs(std::string &strFileName) {
+std::vector<Functor::ScatteringFunctionCoefficients> DirectionalCorrection::loadScatteringFunctionCoeffs(const std::string &strFileName) {
     std::vector<Functor::ScatteringFunctionCoefficients> scatteringCoeffs;
 
     std::ifstream coeffsFile;
     coeffsFile.open(strFileName);
     if (!coeffsFile.is_open()) {
-        itkExceptionMacro("Need to provide scattering_coeffs file for current resolution!");
+        itkGenericExceptionMacro("Need to provide scattering_coeffs file for current resolution!");
     }
 
     std::string line;
@@ -146,7 +156,7 @@ std::vector<Functor::ScatteringFunctionCoefficients> DirectionalCorrection::load
             if(i >= 4) {
                 scatteringCoeffs.push_back(coeffs);
             } else {
-                itkExceptionMacro("Invalid values line found at position " << curLine);
+                itkGenericExceptionMacro("Invalid values line found at position " << curLine);
             }
         }
         curLine++;
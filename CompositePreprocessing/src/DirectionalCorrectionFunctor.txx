@@ -47,11 +47,16 @@ namespace Functor {
 template< class TInput, class TOutput>
 DirectionalCorrectionFunctor<TInput,TOutput>::DirectionalCorrectionFunctor() {
     m_nReflBandsCount = 0;
+    m_nSunZenithBinsCount = 0;
+    m_bExactEvaluation = false;
 }
 
 template< class TInput, class TOutput>
 DirectionalCorrectionFunctor<TInput,TOutput>& DirectionalCorrectionFunctor<TInput,TOutput>::operator =(const DirectionalCorrectionFunctor& copy) {
     this->m_ScatteringCoeffs = copy.m_ScatteringCoeffs;
+    m_ReferenceTable = copy.m_ReferenceTable;
+    m_nSunZenithBinsCount = copy.m_nSunZenithBinsCount;
+    m_bExactEvaluation = copy.m_bExactEvaluation;
     m_nReflBandsCount = copy.m_nReflBandsCount;
 
     m_nCloudMaskBandIndex = copy.m_nCloudMaskBandIndex;
@@ -67,7 +72,7 @@ DirectionalCorrectionFunctor<TInput,TOutput>& DirectionalCorrectionFunctor<TInpu
 }
 
 template< class TInput, class TOutput>
-void DirectionalCorrectionFunctor<TInput,TOutput>::Initialize(const std::vector<ScatteringFunctionCoefficients> &coeffs) {
+void DirectionalCorrectionFunctor<TInput,TOutput>::Initialize(const std::vector<ScatteringFunctionCoefficients> &coeffs, bool bExactEvaluation) {
     m_nReflBandsCount = coeffs.size();
     m_ScatteringCoeffs = coeffs;
     // first we have the reflectance bands then the cloud mask
@@ -80,6 +85,49 @@ void DirectionalCorrectionFunctor<TInput,TOutput>::Initialize(const std::vector<
     // we have 2 sun angles bands (for azimuth and zenith)
     m_nSensoAnglesBandStartIdx = m_nSunAnglesBandStartIdx+2;
     m_fReflNoDataValue = NO_DATA_VALUE;
+
+    m_bExactEvaluation = bExactEvaluation;
+    if(m_bExactEvaluation) {
+        m_ReferenceTable.clear();
+        m_nSunZenithBinsCount = 0;
+    } else {
+        BuildReferenceTable();
+    }
+}
+
+template< class TInput, class TOutput>
+void DirectionalCorrectionFunctor<TInput,TOutput>::BuildReferenceTable() {
+    m_nSunZenithBinsCount = (int)std::round(SUN_ZENITH_LUT_MAX / SUN_ZENITH_LUT_STEP) + 1;
+    m_ReferenceTable.resize(m_nReflBandsCount * m_nSunZenithBinsCount);
+    for(int nBin = 0; nBin < m_nSunZenithBinsCount; nBin++) {
+        // the nadir model only depends on the solar zenith angle
+        DirectionalModel dirModel0(nBin * SUN_ZENITH_LUT_STEP, 0, 0, 0);
+        double fv0 = dirModel0.GetFV();
+        double fr0 = dirModel0.GetFR();
+        for(int i = 0; i < m_nReflBandsCount; i++) {
+            const ScatteringFunctionCoefficients &coeffs = m_ScatteringCoeffs[i];
+            // dir_mod = 1 + (V0 + V1*ndvi)*FV + (R0 + R1*ndvi)*FR
+            DirectionalReferenceTerm &term = m_ReferenceTable[i * m_nSunZenithBinsCount + nBin];
+            term.Offset = 1 + coeffs.V0 * fv0 + coeffs.R0 * fr0;
+            term.Slope = coeffs.V1 * fv0 + coeffs.R1 * fr0;
+        }
+    }
+}
+
+template< class TInput, class TOutput>
+double DirectionalCorrectionFunctor<TInput,TOutput>::GetReferenceTerm(int nBand, double thetaS, double ndvi) const {
+    double fBinPos = thetaS / SUN_ZENITH_LUT_STEP;
+    int nBin = (int)fBinPos;
+    if(nBin >= m_nSunZenithBinsCount - 1) {
+        nBin = m_nSunZenithBinsCount - 2;
+    }
+    // linear interpolation between the two neighbouring solar zenith bins
+    double fWeight = fBinPos - nBin;
+    const DirectionalReferenceTerm &low = m_ReferenceTable[nBand * m_nSunZenithBinsCount + nBin];
+    const DirectionalReferenceTerm &high = m_ReferenceTable[nBand * m_nSunZenithBinsCount + nBin + 1];
+    double fOffset = low.Offset + fWeight * (high.Offset - low.Offset);
+    double fSlope = low.Slope + fWeight * (high.Slope - low.Slope);
+    return fOffset + fSlope * ndvi;
 }
 
 template< class TInput, class TOutput>
@@ -100,14 +148,27 @@ TOutput DirectionalCorrectionFunctor<TInput,TOutput>::operator()( const TInput &
 
     double thetaS = A[m_nSunAnglesBandStartIdx];
     double phiS = A[m_nSunAnglesBandStartIdx+1];
+    double ndvi = A[m_nNdviBandIdx];
+
+    // if is water, snow or cloud, there is made no correction
+    bool bIsMasked = IsCloudPixel(A) || IsWaterPixel(A) || IsSnowPixel(A);
+    // the table only covers the valid range of solar zenith angles
+    bool bUseTable = !m_bExactEvaluation && thetaS >= 0 && thetaS <= SUN_ZENITH_LUT_MAX;
+    // the nadir model does not depend on the band, thus it is evaluated at most once per pixel
+    double fv0 = 0;
+    double fr0 = 0;
+    if(!bUseTable) {
+        DirectionalModel dirModel0(thetaS, 0, 0, 0);
+        fv0 = dirModel0.GetFV();
+        fr0 = dirModel0.GetFR();
+    }
 
     for(int i = 0; i<bandsNo; i++) {
         float fReflVal = (float)(A[i]);
         if(IsNoDataValue(fReflVal, m_fReflNoDataValue)) {
             var[i] = m_fReflNoDataValue;
         } else {
-            // if is water, snow or cloud, there is made no correction
-            if(IsCloudPixel(A) || IsWaterPixel(A) || IsSnowPixel(A)) {
+            if(bIsMasked) {
                 var[i] = fReflVal;
             } else {
                 double thetaV = A[m_nSensoAnglesBandStartIdx + 2*i];
@@ -115,13 +176,18 @@ TOutput DirectionalCorrectionFunctor<TInput,TOutput>::operator()( const TInput &
                 if(isnan(thetaV) || isnan(phiV)) {
                     var[i] = fReflVal;
                 } else {
-                    DirectionalModel dirModel0(thetaS, 0, 0, 0);
                     DirectionalModel dirModel(thetaS, phiS, thetaV, phiV);
 
                     ScatteringFunctionCoefficients &coeffs = m_ScatteringCoeffs[i];
-                    double kV = coeffs.V0 + coeffs.V1 * A[m_nNdviBandIdx];
-                    double kR = coeffs.R0 + coeffs.R1 * A[m_nNdviBandIdx];
-                    float fNewReflVal = fReflVal * dirModel0.dir_mod(kV, kR)/dirModel.dir_mod(kV, kR);
+                    double kV = coeffs.V0 + coeffs.V1 * ndvi;
+                    double kR = coeffs.R0 + coeffs.R1 * ndvi;
+                    double fRefTerm;
+                    if(bUseTable) {
+                        fRefTerm = GetReferenceTerm(i, thetaS, ndvi);
+                    } else {
+                        fRefTerm = 1 + kV * fv0 + kR * fr0;
+                    }
+                    float fNewReflVal = fReflVal * fRefTerm/dirModel.dir_mod(kV, kR);
                     if(fNewReflVal < 0) {
                         fNewReflVal = fReflVal;
                     }
@@ -45,3 +45,11 @@ PreprocessingAdapter::FloatImageType::Pointer PreprocessingAdapter::getFloatMask
 void PreprocessingAdapter::setScatteringCoefficients(const std::vector<std::string> &scatteringcoeffs){
 	m_scatteringCoeffs = scatteringcoeffs;
 }
+
+void PreprocessingAdapter::setExactDirectionalCorrection(const bool &bExact){
+	m_bExactDirCorr = bExact;
+}
+
+void PreprocessingAdapter::setFootprint(const ValidFootprint::ConstPointer &footprint){
+	m_footprint = footprint;
+}
@@ -63,8 +63,8 @@ std::vector<PreprocessingAdapter::ShortVectorImageType::Pointer> PreprocessingSe
 	auto factory = ts::MetadataHelperFactory::New();
 	auto pHelper = factory->GetMetadataHelper(filename);
 
-	if(m_scatteringCoeffs.empty()){
-		itkExceptionMacro("Need to set scattering coefficients before running correction for S2.");
+	if(m_scatteringCoeffs.size() < size_t(N_RESOLUTIONS_SENTINEL)){
+		itkExceptionMacro("Need to set scattering coefficients for both resolutions before running correction for S2.");
 	}
 
 	// Compute NDVI for Primary resolution
@@ -81,6 +81,8 @@ std::vector<PreprocessingAdapter::ShortVectorImageType::Pointer> PreprocessingSe
 		m_createAngles.push_back(createAngles);
 
 		ts::DirectionalCorrection dirCorr;
+		dirCorr.SetExactEvaluation(m_bExactDirCorr);
+		dirCorr.SetFootprint(m_footprint);
 		//If Resolution is not principal Resolution, then resize the additional images
 		std::cout << "Current resolution: " << pHelper->getResolutions().getResolutionVector()[resolution].getBands()[0].getResolution() << std::endl;
 		if(cloudImage.GetPointer()->GetSpacing()[0] != pHelper->getResolutions().getResolutionVector()[resolution].getBands()[0].getResolution()){
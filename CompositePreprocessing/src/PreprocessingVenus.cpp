@@ -63,24 +63,49 @@ std::vector<PreprocessingAdapter::ShortVectorImageType::Pointer> PreprocessingVe
 
 	size_t totalNRes = pHelper->getResolutions().getNumberOfResolutions();
 
+	bool bCorrect = !m_scatteringCoeffs.empty();
+	if(bCorrect && !pHelper->HasGlobalMeanAngles()){
+		std::cout << "No mean sun angles found in " << filename << ". Skipping the directional correction." << std::endl;
+		bCorrect = false;
+	}
+	PreprocessingAdapter::FloatImageType::Pointer ndviImg;
+	if(bCorrect){
+		// Venus red and near-infrared bands
+		m_computeNdvi.DoInit(filename, "B7", "B11");
+		ndviImg = m_computeNdvi.DoExecute();
+	}
+
 	//For all possible resolutions, do the following
 	for(size_t resolution = 0; resolution < totalNRes; resolution++){
-		std::vector<std::string> inputImageFiles = pHelper->getResolutions().getNthResolutionFilenames(resolution);
-		ShortImageListType::Pointer imgList = ShortImageListType::New();
-		for(auto filename : inputImageFiles){
-			std::cout << "Raster Filename: " << filename << std::endl;
-			ShortImageReaderType::Pointer reader = ShortImageReaderType::New();
-			reader->SetFileName(filename);
-			m_ReaderList->PushBack(reader);
-			ShortImageType::Pointer inputImg = reader->GetOutput();
-			inputImg->UpdateOutputInformation();
-			imgList->PushBack(inputImg);
+		if(bCorrect){
+			std::unique_ptr<VenusDirectionalCorrection> dirCorr(new VenusDirectionalCorrection);
+			dirCorr->Init(resolution, filename, m_scatteringCoeffs[resolution], cloudImage, watImage, snowImage, ndviImg);
+			dirCorr->SetFootprint(m_footprint);
+			dirCorr->DoExecute();
+			outputRasters.push_back(dirCorr->GetCorrectedImg().GetPointer());
+			m_dirCorr.push_back(std::move(dirCorr));
+		}else{
+			outputRasters.push_back(getStackedRasters(pHelper.get(), resolution));
 		}
-		ShortImageListToVectorImageType::Pointer toVec = ShortImageListToVectorImageType::New();
-		toVec->SetInput(imgList);
-		m_ImageList.push_back(imgList);
-		m_RasterExtractorList.push_back(toVec);
-		outputRasters.push_back(toVec->GetOutput());
 	}
 	return outputRasters;
 }
+
+PreprocessingAdapter::ShortVectorImageType::Pointer PreprocessingVenus::getStackedRasters(const MetadataHelper *pHelper, const size_t &resolution){
+	std::vector<std::string> inputImageFiles = pHelper->getResolutions().getNthResolutionFilenames(resolution);
+	ShortImageListType::Pointer imgList = ShortImageListType::New();
+	for(auto filename : inputImageFiles){
+		std::cout << "Raster Filename: " << filename << std::endl;
+		ShortImageReaderType::Pointer reader = ShortImageReaderType::New();
+		reader->SetFileName(filename);
+		m_ReaderList->PushBack(reader);
+		ShortImageType::Pointer inputImg = reader->GetOutput();
+		inputImg->UpdateOutputInformation();
+		imgList->PushBack(inputImg);
+	}
+	ShortImageListToVectorImageType::Pointer toVec = ShortImageListToVectorImageType::New();
+	toVec->SetInput(imgList);
+	m_ImageList.push_back(imgList);
+	m_RasterExtractorList.push_back(toVec);
+	return toVec->GetOutput();
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "VenusDirectionalCorrection.h"
+#include "DirectionalCorrection.h"
+#include "MetadataHelperFactory.h"
+#include <algorithm>
+
+using namespace ts;
+
+void VenusDirectionalCorrection::Init(const size_t &res, const std::string &xml, const std::string &scatcoef,
+		FloatImageType::Pointer cldImg, FloatImageType::Pointer watImg, FloatImageType::Pointer snowImg,
+		FloatImageType::Pointer ndvi) {
+	m_nRes = res;
+	m_strXml = xml;
+	m_strScatCoeffs = scatcoef;
+
+	m_NdviImg = ndvi;
+	m_CSM = cldImg;
+	m_WM = watImg;
+	m_SM = snowImg;
+
+	m_ReaderList = FloatImageReaderListType::New();
+	m_ImageList = FloatImageListType::New();
+	m_Concat = ListConcatenerFilterType::New();
+}
+
+void VenusDirectionalCorrection::SetFootprint(const ValidFootprint::ConstPointer &footprint) {
+	m_Footprint = footprint;
+}
+
+void VenusDirectionalCorrection::DoExecute() {
+	auto factory = ts::MetadataHelperFactory::New();
+	auto pHelper = factory->GetMetadataHelper(m_strXml);
+	if(!pHelper->HasGlobalMeanAngles()) {
+		itkExceptionMacro("No mean sun angles found in " << m_strXml);
+	}
+	std::vector<std::string> bandNames;
+	const std::vector<Band> &bands = pHelper->getResolutions().getResolutionVector()[m_nRes].getBands();
+	std::cout << "Directional Correction Filenames found: " << std::endl;
+	for(const Band &band : bands) {
+		FloatImageReaderType::Pointer reader = FloatImageReaderType::New();
+		reader->SetFileName(band.getPath());
+		std::cout << band.getPath() << std::endl;
+		reader->UpdateOutputInformation();
+		m_ReaderList->PushBack(reader);
+		m_ImageList->PushBack(reader->GetOutput());
+		bandNames.push_back(band.getType());
+	}
+	// the masks and the NDVI follow the reflectance bands
+	m_ImageList->PushBack(m_CSM);
+	m_ImageList->PushBack(m_SM);
+	m_ImageList->PushBack(m_WM);
+	m_ImageList->PushBack(m_NdviImg);
+	m_Concat->SetInput(m_ImageList);
+
+	std::vector<Functor::ScatteringFunctionCoefficients> scatteringCoeffs = DirectionalCorrection::loadScatteringFunctionCoeffs(m_strScatCoeffs);
+	if(bandNames.size() != scatteringCoeffs.size()) {
+		itkExceptionMacro("Scattering coefficients file contains only " << scatteringCoeffs.size()
+						  << " but are expected coefficients for " << bandNames.size() << " bands!");
+	}
+
+	std::vector<MeanAngles_Type> viewAngles = getViewingAngles(pHelper.get(), bandNames);
+	MeanAngles_Type sunAngles = pHelper->GetSolarMeanAngles();
+	std::cout << "Sun angles: " << sunAngles.zenith << " " << sunAngles.azimuth << std::endl;
+
+	m_Functor.Initialize(scatteringCoeffs, sunAngles, viewAngles);
+	m_DirectionalCorrectionFunctor = FunctorFilterType::New();
+	m_DirectionalCorrectionFunctor->SetFunctor(m_Functor);
+	m_DirectionalCorrectionFunctor->SetFootprint(m_Footprint);
+	m_DirectionalCorrectionFunctor->SetOutsideValue(NO_DATA_VALUE);
+	m_DirectionalCorrectionFunctor->SetInput(m_Concat->GetOutput());
+	m_DirectionalCorrectionFunctor->UpdateOutputInformation();
+	m_DirectionalCorrectionFunctor->GetOutput()->SetNumberOfComponentsPerPixel(scatteringCoeffs.size());
+}
+
+VenusDirectionalCorrection::ShortVectorImageType::Pointer VenusDirectionalCorrection::GetCorrectedImg() {
+	return m_DirectionalCorrectionFunctor->GetOutput();
+}
+
+std::vector<MeanAngles_Type> VenusDirectionalCorrection::getViewingAngles(const MetadataHelper *pHelper, const std::vector<std::string> &bandNames) {
+	if(!pHelper->HasBandMeanAngles()) {
+		itkExceptionMacro("No mean viewing angles found in " << m_strXml);
+	}
+	std::vector<MeanAngles_Type> angles(bandNames.size());
+	size_t nBandsFound = 0;
+	for(size_t i = 0; i < bandNames.size(); i++) {
+		if(pHelper->GetSensorMeanAngles(bandNames[i], angles[i])) {
+			nBandsFound++;
+		}
+	}
+	if(nBandsFound == 0) {
+		// the angles are given per detector, which all share the viewing geometry of the site
+		std::fill(angles.begin(), angles.end(), pHelper->GetSensorMeanAngles());
+	} else if(nBandsFound != bandNames.size()) {
+		itkExceptionMacro("Mean viewing angles are only given for " << nBandsFound << " of the " << bandNames.size()
+						  << " bands in " << m_strXml);
+	}
+	return angles;
+}
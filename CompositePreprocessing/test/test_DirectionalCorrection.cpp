@@ -28,6 +28,7 @@
 #define BOOST_TEST_MODULE DirectionalCorrection
 #include <boost/test/unit_test.hpp>
 #include "DirectionalCorrection.h"
+#include "FixedGeometryDirectionalCorrectionFunctor.h"
 #include "GlobalDefs.h"
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
@@ -50,7 +51,109 @@ typedef short										ShortPixelType;
 typedef otb::Wrapper::Int16VectorImageType			ShortVectorImageType;
 typedef otb::ImageFileReader<ShortVectorImageType>	ShortVectorImageReaderType;
 
-BOOST_AUTO_TEST_CASE(testDirectionalCorrectionR2){
+BOOST_AUTO_TEST_CASE(testReferenceTable){
+	typedef DirectionalCorrectionType::DirectionalCorrectionFunctorType FunctorType;
+	std::vector<Functor::ScatteringFunctionCoefficients> coeffs = {{0.340f, 0.1f, 0.134f, -0.05f}, {0.496f, 0.2f, 0.107f, 0.03f}};
+	FunctorType tableFunctor, exactFunctor;
+	tableFunctor.Initialize(coeffs);
+	exactFunctor.Initialize(coeffs, true);
+	// 2 reflectances, cloud, snow, water, NDVI, sun zenith/azimuth, view zenith/azimuth per band
+	FloatVectorImageType::PixelType pix(12);
+	for(float thetaS = 10.0f; thetaS < 60.0f; thetaS += 0.37f){
+		for(float ndvi = -0.5f; ndvi <= 1.0f; ndvi += 0.05f){
+			pix.Fill(0);
+			pix[0] = 1200;
+			pix[1] = 3500;
+			pix[5] = ndvi;
+			pix[6] = thetaS;
+			pix[7] = 140.0f;
+			pix[8] = 5.5f;
+			pix[9] = 105.0f;
+			pix[10] = 8.2f;
+			pix[11] = 287.0f;
+			ShortVectorImageType::PixelType tableVal = tableFunctor(pix);
+			ShortVectorImageType::PixelType exactVal = exactFunctor(pix);
+			for(size_t i = 0; i < coeffs.size(); i++){
+				BOOST_CHECK_LE(std::abs(tableVal[i] - exactVal[i]), 1);
+			}
+		}
+	}
+};
+
+BOOST_AUTO_TEST_CASE(testFixedGeometry){
+	typedef DirectionalCorrectionType::DirectionalCorrectionFunctorType FunctorType;
+	typedef Functor::FixedGeometryDirectionalCorrectionFunctor<FloatVectorImageType::PixelType,
+			ShortVectorImageType::PixelType> FixedGeometryFunctorType;
+	std::vector<Functor::ScatteringFunctionCoefficients> coeffs = {{0.340f, 0.1f, 0.134f, -0.05f}, {0.496f, 0.2f, 0.107f, 0.03f}};
+	MeanAngles_Type sunAngles = {35.2, 140.0};
+	std::vector<MeanAngles_Type> viewAngles = {{5.5, 105.0}, {8.2, 287.0}};
+	FunctorType exactFunctor;
+	exactFunctor.Initialize(coeffs, true);
+	FixedGeometryFunctorType fixedFunctor;
+	fixedFunctor.Initialize(coeffs, sunAngles, viewAngles);
+	// The fixed geometry functor only needs the reflectances, masks and NDVI
+	FloatVectorImageType::PixelType pix(12), pixFixed(6);
+	for(float ndvi = -0.5f; ndvi <= 1.0f; ndvi += 0.01f){
+		pix.Fill(0);
+		pix[0] = 1200;
+		pix[1] = 3500;
+		pix[5] = ndvi;
+		pix[6] = sunAngles.zenith;
+		pix[7] = sunAngles.azimuth;
+		pix[8] = viewAngles[0].zenith;
+		pix[9] = viewAngles[0].azimuth;
+		pix[10] = viewAngles[1].zenith;
+		pix[11] = viewAngles[1].azimuth;
+		for(size_t i = 0; i < 6; i++){
+			pixFixed[i] = pix[i];
+		}
+		ShortVectorImageType::PixelType exactVal = exactFunctor(pix);
+		ShortVectorImageType::PixelType fixedVal = fixedFunctor(pixFixed);
+		for(size_t i = 0; i < coeffs.size(); i++){
+			BOOST_CHECK_EQUAL(exactVal[i], fixedVal[i]);
+		}
+	}
+	// Masked pixels are not corrected
+	pixFixed[2] = 1;
+	ShortVectorImageType::PixelType maskedVal = fixedFunctor(pixFixed);
+	BOOST_CHECK_EQUAL(maskedVal[0], 1200);
+	BOOST_CHECK_EQUAL(maskedVal[1], 3500);
+};
+
+/**
+ * @brief Compare the corrected image to the reference
+ * @param tolerance The maximum difference in DN, e.g. for the reference term table
+ */
+void checkReference(ShortVectorImageType::Pointer output, const std::string &referenceFile, const int &tolerance){
+	ShortVectorImageReaderType::Pointer gReader = ShortVectorImageReaderType::New();
+	gReader->SetFileName(referenceFile);
+	ShortVectorImageType::Pointer reference = gReader->GetOutput();
+	reference->Update();
+	output->Update();
+	itk::ImageRegionIterator<ShortVectorImageType> imageIteratorRef(reference,reference->GetLargestPossibleRegion());
+	itk::ImageRegionIterator<ShortVectorImageType> imageIteratorNew(output,output->GetLargestPossibleRegion());
+
+	BOOST_CHECK_EQUAL(reference->GetLargestPossibleRegion(), output->GetLargestPossibleRegion());
+	while(!imageIteratorRef.IsAtEnd())
+	{
+		itk::VariableLengthVector<short> referenceBands = imageIteratorRef.Get();
+		itk::VariableLengthVector<short> newBands = imageIteratorNew.Get();
+		BOOST_CHECK_EQUAL(referenceBands.GetSize(), newBands.GetSize());
+		for(size_t i = 0; i < referenceBands.GetSize(); i++){
+			if(!std::isnan(referenceBands[i]) && !std::isnan(newBands[i])){
+				BOOST_CHECK_LE(std::abs(referenceBands[i] - newBands[i]), tolerance);
+			}
+		}
+		++imageIteratorRef;
+		++imageIteratorNew;
+	}
+}
+
+/**
+ * @brief Correct the R2 test product and compare it to the reference
+ * @param bExact True for the exact evaluation of the reference term, false for the default table
+ */
+void testR2(const bool &bExact, const int &tolerance){
 	size_t resolution = 1;
 	std::string wasp_test = getEnvVar(WASP_TEST);
 	if(wasp_test.empty()){
@@ -88,34 +191,26 @@ BOOST_AUTO_TEST_CASE(testDirectionalCorrectionR2){
 	ndviReader->UpdateOutputInformation();
 	InputImageType::Pointer ndviImg = resampler.getResampler(ndviReader->GetOutput(), 0.5f)->GetOutput();
 	dirCorr.Init(resolution, xml, scatteringcoeffs, cldImg, watImg, snwImg, anglesImg, ndviImg);
+	dirCorr.SetExactEvaluation(bExact);
 	dirCorr.DoExecute();
-	ShortVectorImageType::Pointer output = dirCorr.GetCorrectedImg();
-	ShortVectorImageReaderType::Pointer gReader = ShortVectorImageReaderType::New();
-	gReader->SetFileName(wasp_test + "/" + TEST_NAME + "/INPUTS/" + "/0_CP_R2.tif");
-	ShortVectorImageType::Pointer reference = gReader->GetOutput();
-	reference->Update();
-	output->Update();
-	itk::ImageRegionIterator<ShortVectorImageType> imageIteratorRef(reference,reference->GetLargestPossibleRegion());
-	itk::ImageRegionIterator<ShortVectorImageType> imageIteratorNew(output,output->GetLargestPossibleRegion());
+	checkReference(dirCorr.GetCorrectedImg(), wasp_test + "/" + TEST_NAME + "/INPUTS/" + "/0_CP_R2.tif", tolerance);
+}
 
-	BOOST_CHECK_EQUAL(reference->GetLargestPossibleRegion(), output->GetLargestPossibleRegion());
-	while(!imageIteratorRef.IsAtEnd())
-	{
-		itk::VariableLengthVector<short> referenceBands = imageIteratorRef.Get();
-		itk::VariableLengthVector<short> newBands = imageIteratorNew.Get();
-		BOOST_CHECK_EQUAL(referenceBands.GetSize(), newBands.GetSize());
-		for(size_t i = 0; i < referenceBands.GetSize(); i++){
-			if(!std::isnan(referenceBands[i]) && !std::isnan(newBands[i])){
-				BOOST_CHECK_EQUAL(referenceBands[i], newBands[i]);
-			}
-		}
-		++imageIteratorRef;
-		++imageIteratorNew;
-	}
+BOOST_AUTO_TEST_CASE(testDirectionalCorrectionR2){
+	// The reference term table is within 1 DN of the exact model
+	testR2(false, 1);
+};
+
+BOOST_AUTO_TEST_CASE(testDirectionalCorrectionR2Exact){
+	testR2(true, 0);
 };
 
 #ifdef R1
-BOOST_AUTO_TEST_CASE(testDirectionalCorrectionR1){
+/**
+ * @brief Correct the R1 test product and compare it to the reference
+ * @param bExact True for the exact evaluation of the reference term, false for the default table
+ */
+void testR1(const bool &bExact, const int &tolerance){
 	size_t resolution = 0;
 	std::string wasp_test = getEnvVar(WASP_TEST);
 	if(wasp_test.empty()){
@@ -152,29 +247,16 @@ BOOST_AUTO_TEST_CASE(testDirectionalCorrectionR1){
 	ndviReader->UpdateOutputInformation();
 	InputImageType::Pointer ndviImg = ndviReader->GetOutput();
 	dirCorr.Init(resolution, xml, scatteringcoeffs, cldImg, watImg, snwImg, anglesImg, ndviImg);
+	dirCorr.SetExactEvaluation(bExact);
 	dirCorr.DoExecute();
-	ShortVectorImageType::Pointer output = dirCorr.GetCorrectedImg();
-	ShortVectorImageReaderType::Pointer gReader = ShortVectorImageReaderType::New();
-	gReader->SetFileName(wasp_test + "/" + TEST_NAME + "/0_CP_R1.tif");
-	ShortVectorImageType::Pointer reference = gReader->GetOutput();
-	reference->Update();
-	output->Update();
-	itk::ImageRegionIterator<ShortVectorImageType> imageIteratorRef(reference,reference->GetLargestPossibleRegion());
-	itk::ImageRegionIterator<ShortVectorImageType> imageIteratorNew(output,output->GetLargestPossibleRegion());
+	checkReference(dirCorr.GetCorrectedImg(), wasp_test + "/" + TEST_NAME + "/0_CP_R1.tif", tolerance);
+}
 
-	BOOST_CHECK_EQUAL(reference->GetLargestPossibleRegion(), output->GetLargestPossibleRegion());
-	while(!imageIteratorRef.IsAtEnd())
-	{
-		itk::VariableLengthVector<short> referenceBands = imageIteratorRef.Get();
-		itk::VariableLengthVector<short> newBands = imageIteratorNew.Get();
-		BOOST_CHECK_EQUAL(referenceBands.GetSize(), newBands.GetSize());
-		for(size_t i = 0; i < referenceBands.GetSize(); i++){
-			if(!std::isnan(referenceBands[i]) && !std::isnan(newBands[i])){
-				BOOST_CHECK_EQUAL(referenceBands[i], newBands[i]);
-			}
-		}
-		++imageIteratorRef;
-		++imageIteratorNew;
-	}
+BOOST_AUTO_TEST_CASE(testDirectionalCorrectionR1){
+	testR1(false, 1);
+};
+
+BOOST_AUTO_TEST_CASE(testDirectionalCorrectionR1Exact){
+	testR1(true, 0);
 };
 #endif
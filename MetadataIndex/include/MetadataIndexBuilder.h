@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef METADATAINDEXBUILDER_H
+#define METADATAINDEXBUILDER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Summary of a single L2A product, as stored in the index
+ */
+struct MetadataIndexEntry {
+    std::string Xml;
+    std::string Tile;
+    std::string Project;
+    std::string Platform;
+    std::string Level;
+    std::string AcquisitionDate;
+    /// Cloud cover in percent, negative if not given in the metadata
+    double CloudPercent;
+    /// Absolute image file paths, keyed by their nature (e.g. Surface_Reflectance)
+    std::map<std::string, std::vector<std::string> > Images;
+    /// Absolute mask file paths, keyed by their nature (e.g. Cloud)
+    std::map<std::string, std::vector<std::string> > Masks;
+    /// Empty if the product could be read, the reason of the failure otherwise
+    std::string Error;
+};
+
+/**
+ * @brief Builds a catalogue of L2A products by reading their metadata in parallel
+ * @note Only the identification, characteristics, organisation and quality sections of each file are decoded.
+ */
+class MetadataIndexBuilder
+{
+public:
+    MetadataIndexBuilder();
+
+    /**
+     * @brief Search a directory tree for MUSCATE metadata files
+     * @param root The directory to start the search in
+     * @return The list of *_MTD_ALL.xml files found, sorted by name
+     */
+    static std::vector<std::string> FindMetadataFiles(const std::string &root);
+
+    /**
+     * @brief Set the number of threads used to read the metadata files
+     * @param nThreads The number of threads. 0 uses all available cores.
+     */
+    void SetNumberOfThreads(const size_t &nThreads);
+
+    /**
+     * @brief Read all given metadata files and replace the current index with them
+     * @param files The list of metadata files
+     * @note Unreadable files are kept in the index with the Error field set.
+     * The entries are sorted by acquisition date, then by filename.
+     */
+    void Build(const std::vector<std::string> &files);
+
+    /**
+     * @brief Get the entries of the index
+     * @return The list of entries, as sorted by Build()
+     */
+    const std::vector<MetadataIndexEntry> &GetEntries() const;
+
+    /**
+     * @brief Write the index as JSON array of objects
+     * @param os The stream to write to
+     */
+    void WriteJson(std::ostream &os) const;
+
+    /**
+     * @brief Write the index as CSV table, one product per line
+     * @param os The stream to write to
+     * @note Images and masks are written as nature:path pairs, separated by semicolons.
+     */
+    void WriteCsv(std::ostream &os) const;
+
+    /**
+     * @brief Read the summary of a single product
+     * @param xml The metadata file
+     * @return The entry, with the Error field set if the file cannot be read
+     */
+    static MetadataIndexEntry ReadEntry(const std::string &xml);
+
+private:
+    size_t m_NumberOfThreads;
+    std::vector<MetadataIndexEntry> m_Entries;
+};
+
+} //namespace ts
+
+#endif // METADATAINDEXBUILDER_H
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "otbWrapperApplication.h"
+#include "otbWrapperApplicationFactory.h"
+#include "MetadataIndexBuilder.h"
+#include "PerformanceTelemetry.h"
+
+#include <fstream>
+#include <chrono>
+
+/**
+ * @brief otb Namespace for all OTB-related Filters and Applications
+ */
+namespace otb
+{
+/**
+ * @brief Wrapper namespace for all OTB-Applications
+ */
+namespace Wrapper
+{
+
+using namespace ts;
+
+/**
+ * @brief Index a set of L2A products by reading their metadata in parallel
+ */
+class MetadataIndex : public Application
+{
+
+public:
+  /** Standard class typedefs. */
+  typedef MetadataIndex                 Self;
+  typedef Application                   Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Standard macro */
+  itkNewMacro(Self);
+
+  itkTypeMacro(MetadataIndex, otb::Application);
+
+private:
+  void DoInit()
+  {
+    SetName("MetadataIndex");
+    SetDescription("Index a set of L2A products by reading their metadata in parallel");
+
+    SetDocName("Metadata Index");
+    SetDocLongDescription("Scans a directory tree and/or a list of MUSCATE metadata files and writes one entry per product "
+                          "(tile, platform, acquisition date, cloud cover, image and mask files) to a JSON or CSV file. "
+                          "The metadata files are read in parallel, only decoding the sections needed for the index.");
+
+    SetDocLimitations("Only extracted products are found, archives are not opened.");
+    SetDocAuthors("Peter KETTIG");
+    SetDocSeeAlso(" ");
+
+    AddParameter(ParameterType_String, "dir", "Input directory");
+    SetParameterDescription("dir", "The directory to be searched recursively for *_MTD_ALL.xml files.");
+    MandatoryOff("dir");
+
+    AddParameter(ParameterType_InputFilenameList, "il", "Input metadata files");
+    SetParameterDescription("il", "The list of L2A metadata files to be indexed, in addition to the ones found in the directory.");
+    MandatoryOff("il");
+
+    AddParameter(ParameterType_String, "out", "Output index file");
+    SetParameterDescription("out", "The file the index is written to.");
+
+    AddParameter(ParameterType_String, "format", "Output format");
+    SetParameterDescription("format", "The format of the index, either json or csv.");
+    SetParameterString("format", "json");
+    MandatoryOff("format");
+
+    AddParameter(ParameterType_Int, "threads", "Number of threads");
+    SetParameterDescription("threads", "The number of threads reading the metadata files. 0 uses all available cores.");
+    SetDefaultParameterInt("threads", 0);
+    SetMinimumParameterIntValue("threads", 0);
+    MandatoryOff("threads");
+
+    SetDocExampleParameterValue("dir", "/path/to/L2A/products");
+    SetDocExampleParameterValue("out", "index.json");
+  }
+
+  void DoUpdateParameters()
+  {
+  }
+
+  void DoExecute()
+  {
+    m_Telemetry.Start(this);
+    std::vector<std::string> files;
+    if(HasValue("dir")){
+      files = MetadataIndexBuilder::FindMetadataFiles(GetParameterString("dir"));
+      std::cout << "Found " << files.size() << " metadata files in " << GetParameterString("dir") << std::endl;
+    }
+    if(HasValue("il")){
+      const std::vector<std::string> inputs = GetParameterStringList("il");
+      files.insert(files.end(), inputs.begin(), inputs.end());
+    }
+    if(files.empty()){
+      itkExceptionMacro("No metadata files given. Please set a directory containing L2A products or a list of xml files");
+    }
+
+    const std::string format = GetParameterString("format");
+    if(format != "json" && format != "csv"){
+      itkExceptionMacro("Unknown output format " << format << ", expected json or csv");
+    }
+
+    MetadataIndexBuilder builder;
+    builder.SetNumberOfThreads(GetParameterInt("threads"));
+    auto start = std::chrono::steady_clock::now();
+    builder.Build(files);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Indexed " << files.size() << " products in " << elapsed.count() << "s" << std::endl;
+
+    for(const MetadataIndexEntry &entry : builder.GetEntries()){
+      if(!entry.Error.empty()){
+        std::cout << "Warning: Cannot index " << entry.Xml << ": " << entry.Error << std::endl;
+      }
+    }
+
+    std::ofstream out(GetParameterString("out"));
+    if(!out){
+      itkExceptionMacro("Cannot open output file " << GetParameterString("out"));
+    }
+    if(format == "csv"){
+      builder.WriteCsv(out);
+    }else{
+      builder.WriteJson(out);
+    }
+    out.close();
+    m_Telemetry.Write();
+  }
+
+  PerformanceTelemetry m_Telemetry;
+};
+
+} // namespace Wrapper
+} // namespace otb
+
+OTB_APPLICATION_EXPORT(otb::Wrapper::MetadataIndex)
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "MetadataIndexBuilder.h"
+#include "MuscateMetadataReader.hpp"
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+
+using namespace ts;
+
+namespace {
+
+const std::string MetadataFileSuffix = "_MTD_ALL.xml";
+
+const unsigned int IndexSections = muscate::SECTION_IDENTIFICATION
+                                 | muscate::SECTION_PRODUCT_CHARACTERISTICS
+                                 | muscate::SECTION_PRODUCT_ORGANISATION
+                                 | muscate::SECTION_QUALITY;
+
+bool endsWith(const std::string &s, const std::string &suffix){
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/**
+ * @brief Collect the absolute file paths of each property, keyed by nature
+ */
+std::map<std::string, std::vector<std::string> > collectFiles(const std::vector<ImageProperty> &properties,
+                                                              const boost::filesystem::path &productDir){
+    std::map<std::string, std::vector<std::string> > result;
+    for(const ImageProperty &property : properties){
+        std::vector<std::string> &paths = result[property.Nature];
+        for(const ImageInformation &file : property.ImageFiles){
+            paths.push_back((productDir / file.path).string());
+        }
+    }
+    return result;
+}
+
+std::string escapeJson(const std::string &s){
+    std::ostringstream os;
+    for(const char c : s){
+        switch(c){
+        case '"': os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\r': os << "\\r"; break;
+        case '\t': os << "\\t"; break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20){
+                os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c);
+            }else{
+                os << c;
+            }
+        }
+    }
+    return os.str();
+}
+
+std::string escapeCsv(const std::string &s){
+    if(s.find_first_of(",\"\n") == std::string::npos){
+        return s;
+    }
+    std::string result = "\"";
+    for(const char c : s){
+        if(c == '"') result += '"';
+        result += c;
+    }
+    return result + "\"";
+}
+
+void writeJsonFiles(std::ostream &os, const std::map<std::string, std::vector<std::string> > &files){
+    os << "{";
+    for(auto it = files.begin(); it != files.end(); ++it){
+        if(it != files.begin()) os << ", ";
+        os << "\"" << escapeJson(it->first) << "\": [";
+        for(size_t i = 0; i < it->second.size(); i++){
+            if(i) os << ", ";
+            os << "\"" << escapeJson(it->second[i]) << "\"";
+        }
+        os << "]";
+    }
+    os << "}";
+}
+
+std::string joinCsvFiles(const std::map<std::string, std::vector<std::string> > &files){
+    std::string result;
+    for(auto it = files.begin(); it != files.end(); ++it){
+        for(const std::string &path : it->second){
+            if(!result.empty()) result += ";";
+            result += it->first + ":" + path;
+        }
+    }
+    return escapeCsv(result);
+}
+
+} //namespace
+
+MetadataIndexBuilder::MetadataIndexBuilder() : m_NumberOfThreads(0) {}
+
+std::vector<std::string> MetadataIndexBuilder::FindMetadataFiles(const std::string &root){
+    std::vector<std::string> result;
+    boost::system::error_code ec;
+    boost::filesystem::recursive_directory_iterator it(root, boost::filesystem::symlink_option::recurse, ec), end;
+    if(ec){
+        return result;
+    }
+    for(; it != end; it.increment(ec)){
+        if(ec){
+            continue;
+        }
+        const boost::filesystem::path &p = it->path();
+        if(endsWith(p.filename().string(), MetadataFileSuffix) && boost::filesystem::is_regular_file(p, ec)){
+            result.push_back(p.string());
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void MetadataIndexBuilder::SetNumberOfThreads(const size_t &nThreads){
+    m_NumberOfThreads = nThreads;
+}
+
+MetadataIndexEntry MetadataIndexBuilder::ReadEntry(const std::string &xml){
+    MetadataIndexEntry entry;
+    entry.Xml = xml;
+    entry.CloudPercent = -1;
+
+    auto reader = muscate::MuscateMetadataReader::New();
+    std::unique_ptr<MuscateFileMetadata> metadata;
+    try{
+        metadata = reader->ReadMetadata(xml, IndexSections);
+    }catch(const std::exception &e){
+        entry.Error = e.what();
+        return entry;
+    }
+    if(!metadata){
+        entry.Error = "Cannot read metadata file";
+        return entry;
+    }
+
+    entry.Tile = metadata->DatasetIdentification.GeographicalZone;
+    entry.Project = metadata->DatasetIdentification.Project;
+    entry.Platform = metadata->ProductCharacteristics.Platform;
+    entry.Level = metadata->ProductCharacteristics.ProductLevel;
+    entry.AcquisitionDate = metadata->ProductCharacteristics.AcquisitionDate;
+    for(const MuscateQualityIndex &index : metadata->QualityInformations.CurrentProduct.GlobalIndexList){
+        if(index.name == "CloudPercent"){
+            entry.CloudPercent = std::atof(index.value.c_str());
+        }
+    }
+    const boost::filesystem::path productDir = boost::filesystem::path(xml).parent_path();
+    entry.Images = collectFiles(metadata->ProductOrganisation.ImageProperties, productDir);
+    entry.Masks = collectFiles(metadata->ProductOrganisation.MaskProperties, productDir);
+    return entry;
+}
+
+void MetadataIndexBuilder::Build(const std::vector<std::string> &files){
+    std::vector<MetadataIndexEntry> entries(files.size());
+    size_t nThreads = m_NumberOfThreads ? m_NumberOfThreads : std::max(1u, std::thread::hardware_concurrency());
+    nThreads = std::min(nThreads, std::max(size_t(1), files.size()));
+
+    //Each worker picks the next unread file, so slow files do not stall a whole block of the list
+    std::atomic<size_t> next(0);
+    auto worker = [&](){
+        for(size_t i = next++; i < files.size(); i = next++){
+            entries[i] = ReadEntry(files[i]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for(size_t i = 1; i < nThreads; i++){
+        pool.emplace_back(worker);
+    }
+    worker();
+    for(std::thread &t : pool){
+        t.join();
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), [](const MetadataIndexEntry &lhs, const MetadataIndexEntry &rhs){
+        if(lhs.AcquisitionDate != rhs.AcquisitionDate) return lhs.AcquisitionDate < rhs.AcquisitionDate;
+        return lhs.Xml < rhs.Xml;
+    });
+    m_Entries.swap(entries);
+}
+
+const std::vector<MetadataIndexEntry> &MetadataIndexBuilder::GetEntries() const{
+    return m_Entries;
+}
+
+void MetadataIndexBuilder::WriteJson(std::ostream &os) const{
+    os << "[";
+    for(size_t i = 0; i < m_Entries.size(); i++){
+        const MetadataIndexEntry &entry = m_Entries[i];
+        os << (i ? ",\n " : "\n ") << "{";
+        os << "\"xml\": \"" << escapeJson(entry.Xml) << "\", ";
+        os << "\"tile\": \"" << escapeJson(entry.Tile) << "\", ";
+        os << "\"project\": \"" << escapeJson(entry.Project) << "\", ";
+        os << "\"platform\": \"" << escapeJson(entry.Platform) << "\", ";
+        os << "\"level\": \"" << escapeJson(entry.Level) << "\", ";
+        os << "\"date\": \"" << escapeJson(entry.AcquisitionDate) << "\", ";
+        os << "\"cloud_percent\": ";
+        if(entry.CloudPercent < 0){
+            os << "null";
+        }else{
+            os << entry.CloudPercent;
+        }
+        os << ", \"images\": ";
+        writeJsonFiles(os, entry.Images);
+        os << ", \"masks\": ";
+        writeJsonFiles(os, entry.Masks);
+        if(!entry.Error.empty()){
+            os << ", \"error\": \"" << escapeJson(entry.Error) << "\"";
+        }
+        os << "}";
+    }
+    os << (m_Entries.empty() ? "]\n" : "\n]\n");
+}
+
+void MetadataIndexBuilder::WriteCsv(std::ostream &os) const{
+    os << "xml,tile,project,platform,level,date,cloud_percent,images,masks,error\n";
+    for(const MetadataIndexEntry &entry : m_Entries){
+        os << escapeCsv(entry.Xml) << "," << escapeCsv(entry.Tile) << "," << escapeCsv(entry.Project) << ","
+           << escapeCsv(entry.Platform) << "," << escapeCsv(entry.Level) << "," << escapeCsv(entry.AcquisitionDate) << ",";
+        if(entry.CloudPercent >= 0){
+            os << entry.CloudPercent;
+        }
+        os << "," << joinCsvFiles(entry.Images) << "," << joinCsvFiles(entry.Masks) << "," << escapeCsv(entry.Error) << "\n";
+    }
+}
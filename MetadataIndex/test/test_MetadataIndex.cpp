@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE MetadataIndex
+#include <boost/test/unit_test.hpp>
+#include "GlobalDefs.h"
+#include "MetadataIndexBuilder.h"
+#include "MuscateMetadataReader.hpp"
+#include <algorithm>
+#include <sstream>
+
+using namespace ts;
+
+#define TEST_NAME	"test_MuscateMetadata"
+#define TEST_SRC	ts::getEnvVar("WASP_TEST")
+#define EXAMPLE_XML1 "SENTINEL2A_20170402-093844-724_L2A_T32MNE_D_V1-4_MTD_ALL.xml"
+#define EXAMPLE_XML4 "VENUS-XS_20180202-105554-000_L2A_FR-LUS_C_V1-0_MTD_ALL.xml"
+
+BOOST_AUTO_TEST_CASE(TestFindMetadataFiles)
+{
+	if(TEST_SRC == ""){
+		BOOST_FAIL("Did not set env-var WASP_TEST!");
+	}
+	const std::string dir = std::string(TEST_SRC + "/" + TEST_NAME);
+	std::vector<std::string> files = MetadataIndexBuilder::FindMetadataFiles(dir);
+	BOOST_REQUIRE(!files.empty());
+	BOOST_CHECK(std::is_sorted(files.begin(), files.end()));
+	BOOST_CHECK(std::find(files.begin(), files.end(), dir + "/" + EXAMPLE_XML1) != files.end());
+	BOOST_CHECK(std::find(files.begin(), files.end(), dir + "/" + EXAMPLE_XML4) != files.end());
+
+	BOOST_CHECK(MetadataIndexBuilder::FindMetadataFiles(dir + "/does_not_exist").empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestBuildIndex)
+{
+	if(TEST_SRC == ""){
+		BOOST_FAIL("Did not set env-var WASP_TEST!");
+	}
+	const std::string dir = std::string(TEST_SRC + "/" + TEST_NAME);
+	std::vector<std::string> files = MetadataIndexBuilder::FindMetadataFiles(dir);
+	files.push_back(dir + "/does_not_exist_MTD_ALL.xml");
+
+	MetadataIndexBuilder serial;
+	serial.SetNumberOfThreads(1);
+	serial.Build(files);
+	MetadataIndexBuilder parallel;
+	parallel.SetNumberOfThreads(4);
+	parallel.Build(files);
+
+	const std::vector<MetadataIndexEntry> &entries = parallel.GetEntries();
+	BOOST_REQUIRE_EQUAL(entries.size(), files.size());
+	BOOST_REQUIRE_EQUAL(serial.GetEntries().size(), files.size());
+	for(size_t i = 0; i < entries.size(); i++){
+		BOOST_CHECK_EQUAL(entries[i].Xml, serial.GetEntries()[i].Xml);
+		if(i > 0){
+			BOOST_CHECK(entries[i - 1].AcquisitionDate <= entries[i].AcquisitionDate);
+		}
+	}
+
+	auto reader = muscate::MuscateMetadataReader::New();
+	for(const MetadataIndexEntry &entry : entries){
+		if(entry.Xml == files.back()){
+			BOOST_CHECK(!entry.Error.empty());
+			continue;
+		}
+		BOOST_CHECK(entry.Error.empty());
+		auto m = reader->ReadMetadata(entry.Xml);
+		BOOST_REQUIRE(m);
+		BOOST_CHECK_EQUAL(entry.Tile, m->DatasetIdentification.GeographicalZone);
+		BOOST_CHECK_EQUAL(entry.Project, m->DatasetIdentification.Project);
+		BOOST_CHECK_EQUAL(entry.Platform, m->ProductCharacteristics.Platform);
+		BOOST_CHECK_EQUAL(entry.AcquisitionDate, m->ProductCharacteristics.AcquisitionDate);
+		BOOST_CHECK(!entry.Images.empty() && entry.Images.size() <= m->ProductOrganisation.ImageProperties.size());
+	}
+
+	auto s2 = std::find_if(entries.begin(), entries.end(), [&](const MetadataIndexEntry &e){
+		return e.Xml == dir + "/" + EXAMPLE_XML1;
+	});
+	BOOST_REQUIRE(s2 != entries.end());
+	BOOST_CHECK_EQUAL(s2->Tile, "T32MNE");
+	BOOST_CHECK_EQUAL(s2->Project, "SENTINEL2");
+	BOOST_CHECK_EQUAL(s2->CloudPercent, 0);
+	BOOST_REQUIRE(s2->Images.count("Aerosol_Optical_Thickness"));
+	BOOST_CHECK_EQUAL(s2->Images.at("Aerosol_Optical_Thickness").front().compare(0, dir.size(), dir), 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestWriteIndex)
+{
+	if(TEST_SRC == ""){
+		BOOST_FAIL("Did not set env-var WASP_TEST!");
+	}
+	const std::string dir = std::string(TEST_SRC + "/" + TEST_NAME);
+	MetadataIndexBuilder builder;
+	builder.Build(std::vector<std::string>(1, dir + "/" + EXAMPLE_XML1));
+
+	std::ostringstream json;
+	builder.WriteJson(json);
+	BOOST_CHECK(json.str().find("\"tile\": \"T32MNE\"") != std::string::npos);
+	BOOST_CHECK(json.str().find("\"cloud_percent\": 0") != std::string::npos);
+	BOOST_CHECK_EQUAL(json.str().front(), '[');
+
+	std::ostringstream csv;
+	builder.WriteCsv(csv);
+	const std::string table = csv.str();
+	BOOST_CHECK_EQUAL(std::count(table.begin(), table.end(), '\n'), 2);
+	BOOST_CHECK(table.find(",T32MNE,SENTINEL2,") != std::string::npos);
+}
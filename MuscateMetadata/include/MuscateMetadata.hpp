@@ -152,13 +152,39 @@ struct MuscateGeopositionInformations{
 };
 
 
+/**
+ * @brief Grid of angles, stored row by row in a single contiguous vector
+ */
 struct MuscateAngleList
 {
+	MuscateAngleList() : Rows(0), Cols(0) {}
+
+	/**
+	 * @brief Resize the grid to rows*cols values, all set to the given value
+	 */
+	void Resize(const size_t &rows, const size_t &cols, const double &value = 0.0){
+		Rows = rows;
+		Cols = cols;
+		Values.assign(rows * cols, value);
+	}
+
+	/**
+	 * @return Pointer to the first of the Cols values of the given row
+	 */
+	const double *GetRow(const size_t &row) const { return Values.data() + row * Cols; }
+	double *GetRow(const size_t &row) { return Values.data() + row * Cols; }
+
+	double GetValue(const size_t &row, const size_t &col) const { return Values[row * Cols + col]; }
+
+	bool IsEmpty() const { return Values.empty(); }
+
 	std::string ColumnUnit;
 	std::string ColumnStep;
 	std::string RowUnit;
 	std::string RowStep;
-	std::vector<std::vector<double> > Values;
+	size_t Rows;
+	size_t Cols;
+	std::vector<double> Values;
 };
 
 struct MuscateAngles
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <iosfwd>
+#include <cstdint>
+
+#include "itkObjectFactory.h"
+
+#include "MuscateMetadata.hpp"
+
+/**
+ * @brief Temporal synthesis namespace
+ */
+namespace ts {
+
+/**
+ * @brief Muscate Metadata namespace
+ */
+namespace muscate {
+
+/**
+ * @brief Stores binary snapshots of parsed metadata files in a cache directory
+ * @note A snapshot is keyed by the canonical path, the size and the modification time of the XML.
+ * It is ignored as soon as the XML changes or the snapshot format version differs.
+ * Snapshots are written to a temporary file first and then renamed, so several processes can share the directory.
+ */
+class MuscateMetadataCache : public itk::LightObject
+{
+public:
+	/* ITK typedefs */
+	typedef MuscateMetadataCache Self;
+	typedef itk::LightObject Superclass;
+	typedef itk::SmartPointer<Self> Pointer;
+	typedef itk::SmartPointer<const Self> ConstPointer;
+
+	/* ITK macros */
+	itkNewMacro(Self)
+	itkTypeMacro(MuscateMetadataCache, itk::LightObject)
+
+	/**
+	 * @brief Set the directory the snapshots are stored in. It is created on the first store.
+	 */
+	void SetDirectory(const std::string &dir);
+
+	const std::string &GetDirectory() const;
+
+	/**
+	 * @brief Load the snapshot of the given metadata file
+	 * @param path The metadata XML
+	 * @param sections Mask of MetadataSectionType values which have to be contained in the snapshot
+	 * @param storedSections If not null, receives the sections of an existing, up-to-date snapshot. 0 if there is none.
+	 * @return The metadata, or nullptr if there is no up-to-date snapshot containing all requested sections
+	 */
+	std::unique_ptr<MuscateFileMetadata> Load(const std::string &path, const unsigned int &sections, unsigned int *storedSections = nullptr) const;
+
+	/**
+	 * @brief Store the snapshot of the given metadata file
+	 * @param path The metadata XML the snapshot was read from
+	 * @param sections Mask of MetadataSectionType values contained in the metadata
+	 * @param metadata The metadata to be stored
+	 * @return True if the snapshot could be written, false otherwise
+	 */
+	bool Store(const std::string &path, const unsigned int &sections, const MuscateFileMetadata &metadata) const;
+
+	/**
+	 * @brief Write the metadata to a binary stream, without any key
+	 */
+	static void Serialize(const MuscateFileMetadata &metadata, std::ostream &os);
+
+	/**
+	 * @brief Read the metadata from a binary stream written by Serialize()
+	 * @return The metadata, or nullptr if the stream is truncated
+	 */
+	static std::unique_ptr<MuscateFileMetadata> Deserialize(std::istream &is);
+
+private:
+	/**
+	 * @brief Key of a metadata file, identifying its current state on disk
+	 */
+	struct SnapshotKey {
+		std::string Path;
+		uint64_t Size;
+		int64_t ModificationTime;
+	};
+
+	/**
+	 * @brief Get the key of the given metadata file
+	 * @return False if the file cannot be accessed
+	 */
+	static bool getKey(const std::string &path, SnapshotKey &key);
+
+	/**
+	 * @brief Get the snapshot filename for the given key
+	 */
+	std::string getSnapshotPath(const SnapshotKey &key) const;
+
+	std::string m_Directory;
+
+}; /* class MuscateMetadataCache */
+} /* namespace muscate */
+} /* namespace ts */
@@ -33,6 +33,7 @@
 #include "otb_tinyxml.h"
 
 #include "MuscateMetadata.hpp"
+#include "MuscateMetadataCache.hpp"
 
 /**
  * @brief Temporal synthesis namespace
@@ -44,6 +45,21 @@ namespace ts {
 
 namespace muscate {
 
+/**
+ * @brief Sections of the metadata file, which can be selected for reading
+ * @note SECTION_IDENTIFICATION covers the header, the Metadata_Identification and the Dataset_Identification
+ */
+typedef enum {
+	SECTION_IDENTIFICATION = 1,
+	SECTION_PRODUCT_CHARACTERISTICS = 2,
+	SECTION_PRODUCT_ORGANISATION = 4,
+	SECTION_GEOPOSITION = 8,
+	SECTION_GEOMETRIC = 16,
+	SECTION_RADIOMETRIC = 32,
+	SECTION_QUALITY = 64,
+	SECTION_ALL = 0x7F
+} MetadataSectionType;
+
 /**
  * @brief Reads muscate metadata files in format Muscate 3.1 (unified) and the old one (distributed)
  */
@@ -63,16 +79,29 @@ public:
 	/**
 	 * @brief Read the main metadata file
 	 * @param path Reference to the input string
+	 * @param sections Mask of MetadataSectionType values to be decoded. The other sections are left empty.
 	 * @return Pointer to the Muscate metadata file
 	 */
-	std::unique_ptr<MuscateFileMetadata> ReadMetadata(const std::string &path);
+	std::unique_ptr<MuscateFileMetadata> ReadMetadata(const std::string &path, const unsigned int &sections = SECTION_ALL);
 
 	/**
-	 * @brief Read all metadata fields inside the TiXml Document
+	 * @brief Read the metadata fields inside the TiXml Document
 	 * @param doc The metadata file opened with TiXml
+	 * @param sections Mask of MetadataSectionType values to be decoded. The other sections are left empty.
 	 * @return Pointer to the Muscate metadata file
 	 */
-	std::unique_ptr<MuscateFileMetadata> ReadMetadataXml(const TiXmlDocument &doc);
+	std::unique_ptr<MuscateFileMetadata> ReadMetadataXml(const TiXmlDocument &doc, const unsigned int &sections = SECTION_ALL);
+
+	/**
+	 * @brief Set the directory binary snapshots of the read files are cached in
+	 * @param dir The cache directory. An empty string disables the cache.
+	 * @note Defaults to the value of the environment variable WASP_METADATA_CACHE.
+	 * A cached snapshot may contain more sections than requested.
+	 */
+	void SetCacheDirectory(const std::string &dir);
+
+protected:
+	MuscateMetadataReader();
 
 private:
 
@@ -140,6 +169,8 @@ private:
 	 */
 	MuscateQualityInformations readQualityInformations(TiXmlElement *el);
 
+	MuscateMetadataCache::Pointer m_Cache;
+
 }; /* class MuscateMetadataReader */
 } /* namespace muscate */
 } /* namespace ts */
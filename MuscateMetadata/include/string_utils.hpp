@@ -41,6 +41,15 @@ std::vector<std::string> split(const std::string &s, char delim);
  */
 double ReadDouble(const std::string &s);
 
+/**
+ * @brief Read the whitespace separated doubles of a string in place and append them to a vector
+ * @param s The null-terminated string, can be null
+ * @param values The vector the values are appended to
+ * @return The number of values read
+ * @note Same conversion as ReadDouble, without copying the string or each of its tokens
+ */
+size_t AppendDoubleList(const char *s, std::vector<double> &values);
+
 /**
  * @brief Check if a string contains only digits
  * @param s The string to be checked
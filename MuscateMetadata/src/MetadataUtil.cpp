@@ -45,16 +45,16 @@ bool compareImageProperties(const bool &a,const bool &b, const std::string &as,
 std::string MuscateAnglesToString(const MuscateAngles &angles){
 	std::string ret;
 	ret = "AZ: : " + angles.Azimuth.ColumnStep + " " + angles.Azimuth.ColumnUnit + "\n";
-	for(auto line : angles.Azimuth.Values){
-		for(auto angle : line){
-			ret += std::to_string(angle) + " ";
+	for(size_t row = 0; row < angles.Azimuth.Rows; row++){
+		for(size_t col = 0; col < angles.Azimuth.Cols; col++){
+			ret += std::to_string(angles.Azimuth.GetValue(row, col)) + " ";
 		}
 		ret += "\n";
 	}
 	ret += "\nZE: " + angles.Zenith.ColumnStep + " " + angles.Zenith.ColumnUnit + "\n";
-	for(auto line : angles.Zenith.Values){
-		for(auto angle : line){
-			ret += std::to_string(angle) + " ";
+	for(size_t row = 0; row < angles.Zenith.Rows; row++){
+		for(size_t col = 0; col < angles.Zenith.Cols; col++){
+			ret += std::to_string(angles.Zenith.GetValue(row, col)) + " ";
 		}
 		ret += "\n";
 	}
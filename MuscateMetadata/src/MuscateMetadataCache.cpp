@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <functional>
+
+#include <boost/filesystem.hpp>
+
+#include "MuscateMetadataCache.hpp"
+
+namespace ts {
+namespace muscate {
+
+namespace {
+
+/// Increase whenever one of the metadata structs changes
+const uint32_t SnapshotVersion = 1;
+const char SnapshotMagic[8] = {'W', 'A', 'S', 'P', 'M', 'T', 'D', '\0'};
+const char *SnapshotExtension = ".mtd";
+
+/**
+ * @brief Writes the metadata fields in native byte order. Snapshots are not meant to be exchanged between machines.
+ */
+class OutArchive {
+public:
+	explicit OutArchive(std::ostream &os) : m_os(os) {}
+
+	OutArchive &operator&(const std::string &s){
+		*this & static_cast<uint64_t>(s.size());
+		m_os.write(s.data(), s.size());
+		return *this;
+	}
+	OutArchive &operator&(const bool &b){
+		const char c = b ? 1 : 0;
+		m_os.write(&c, 1);
+		return *this;
+	}
+	OutArchive &operator&(const uint32_t &v){ return writePod(v); }
+	OutArchive &operator&(const uint64_t &v){ return writePod(v); }
+	OutArchive &operator&(const int64_t &v){ return writePod(v); }
+	OutArchive &operator&(const double &v){ return writePod(v); }
+	OutArchive &operator&(const std::vector<double> &v){
+		*this & static_cast<uint64_t>(v.size());
+		m_os.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(double));
+		return *this;
+	}
+	template<typename T>
+	OutArchive &operator&(const std::vector<T> &v){
+		*this & static_cast<uint64_t>(v.size());
+		for(const T &item : v){
+			*this & item;
+		}
+		return *this;
+	}
+	template<typename T>
+	OutArchive &operator&(const T &t){
+		serialize(*this, const_cast<T&>(t));
+		return *this;
+	}
+
+private:
+	template<typename T>
+	OutArchive &writePod(const T &v){
+		m_os.write(reinterpret_cast<const char*>(&v), sizeof(T));
+		return *this;
+	}
+	std::ostream &m_os;
+};
+
+/**
+ * @brief Reads the metadata fields written by OutArchive. Stops reading as soon as the stream fails.
+ */
+class InArchive {
+public:
+	explicit InArchive(std::istream &is) : m_is(is) {}
+
+	bool good() const { return m_is.good(); }
+
+	InArchive &operator&(std::string &s){
+		uint64_t size = 0;
+		*this & size;
+		if(!checkSize(size)) return *this;
+		s.resize(size);
+		m_is.read(&s[0], size);
+		return *this;
+	}
+	InArchive &operator&(bool &b){
+		char c = 0;
+		m_is.read(&c, 1);
+		b = c != 0;
+		return *this;
+	}
+	InArchive &operator&(uint32_t &v){ return readPod(v); }
+	InArchive &operator&(uint64_t &v){ return readPod(v); }
+	InArchive &operator&(int64_t &v){ return readPod(v); }
+	InArchive &operator&(double &v){ return readPod(v); }
+	InArchive &operator&(std::vector<double> &v){
+		uint64_t size = 0;
+		*this & size;
+		if(!checkSize(size * sizeof(double))) return *this;
+		v.resize(size);
+		m_is.read(reinterpret_cast<char*>(v.data()), size * sizeof(double));
+		return *this;
+	}
+	template<typename T>
+	InArchive &operator&(std::vector<T> &v){
+		uint64_t size = 0;
+		*this & size;
+		v.clear();
+		if(!checkSize(size)) return *this;
+		v.reserve(size);
+		for(uint64_t i = 0; i < size && good(); i++){
+			v.push_back(makeDefault<T>());
+			*this & v.back();
+		}
+		return *this;
+	}
+	template<typename T>
+	InArchive &operator&(T &t){
+		serialize(*this, t);
+		return *this;
+	}
+
+private:
+	template<typename T>
+	static T makeDefault(){ return T(); }
+
+	template<typename T>
+	InArchive &readPod(T &v){
+		m_is.read(reinterpret_cast<char*>(&v), sizeof(T));
+		return *this;
+	}
+
+	/**
+	 * @brief Guard against allocating huge buffers when reading a corrupt snapshot
+	 */
+	bool checkSize(const uint64_t &size){
+		const uint64_t maxSize = uint64_t(1) << 32;
+		if(!good() || size > maxSize){
+			m_is.setstate(std::ios::failbit);
+			return false;
+		}
+		return true;
+	}
+	std::istream &m_is;
+};
+
+template<>
+MuscateQualityIndex InArchive::makeDefault<MuscateQualityIndex>(){ return MuscateQualityIndex("", ""); }
+
+/////////////////////////////////////////////////////////////////////
+/// FIELDS OF ALL METADATA STRUCTS, USED FOR READING AND WRITING ///
+///////////////////////////////////////////////////////////////////
+
+template<class Archive> void serialize(Archive &ar, MuscateHeaderMetadata &m){
+	ar & m.xsi & m.SchemaLocation;
+}
+template<class Archive> void serialize(Archive &ar, MuscateMetadataIdentification &m){
+	ar & m.MetadataFormat & m.version & m.MetadataProfile & m.MetadataInformation;
+}
+template<class Archive> void serialize(Archive &ar, MuscateDatasetIdentification &m){
+	ar & m.Identifier & m.Authority & m.Producer & m.Project & m.GeographicalZone & m.GeographicalZoneType & m.Title & m.Description;
+}
+template<class Archive> void serialize(Archive &ar, BandList &m){
+	uint64_t count = m.Count;
+	ar & count & m.bandIDs;
+	m.Count = count;
+}
+template<class Archive> void serialize(Archive &ar, BandGroup &m){
+	ar & m.GroupID & m.GroupList;
+}
+template<class Archive> void serialize(Archive &ar, MuscateProductCharacteristics &m){
+	ar & m.ProductID & m.AcquisitionDate & m.ProductionDate & m.ProductVersion & m.ProductLevel & m.Platform
+	   & m.SpectralContent & m.OrbitNumber & m.OrbitType & m.MeanAcquisitionRange & m.hasSynthesisDate
+	   & m.SynthesisPeriodBegin & m.SynthesisPeriodEnd & m.SynthesisDate & m.DatePrecision & m.DatePrecisionUnit
+	   & m.BandGlobalList & m.BandGroupList;
+}
+template<class Archive> void serialize(Archive &ar, ImageInformation &m){
+	ar & m.path & m.isMask & m.bandIDs & m.isGroup & m.bandNum & m.hasBandNum & m.bitNumber & m.hasBitNum
+	   & m.detectorID & m.hasDetectorID;
+}
+template<class Archive> void serialize(Archive &ar, ImageProperty &m){
+	ar & m.Nature & m.Format & m.Encoding & m.Endianness & m.Compression & m.Description & m.hasCompression & m.ImageFiles;
+}
+template<class Archive> void serialize(Archive &ar, MuscateProductOrganisation &m){
+	ar & m.Quicklook & m.ImageProperties & m.MaskProperties & m.DataProperties;
+}
+template<class Archive> void serialize(Archive &ar, CSInfo &m){
+	ar & m.CSType & m.PixelOrigin;
+}
+template<class Archive> void serialize(Archive &ar, GeoPoint &m){
+	ar & m.name & m.lat & m.lon & m.Xpos & m.Ypos;
+}
+template<class Archive> void serialize(Archive &ar, GroupPositioning &m){
+	ar & m.groupID & m.ULX & m.ULY & m.XDim & m.YDim & m.nrows & m.ncols;
+}
+template<class Archive> void serialize(Archive &ar, MuscateGeopositionInformations &m){
+	ar & m.GeoTables & m.HorizontalCSType & m.HorizontalCSName & m.HorizontalCSCode & m.RasterCS & m.MetadataCS
+	   & m.GlobalGeoposition & m.GroupPosition;
+}
+template<class Archive> void serialize(Archive &ar, MuscateAngleList &m){
+	uint64_t rows = m.Rows, cols = m.Cols;
+	ar & m.ColumnUnit & m.ColumnStep & m.RowUnit & m.RowStep & rows & cols & m.Values;
+	m.Rows = rows;
+	m.Cols = cols;
+}
+template<class Archive> void serialize(Archive &ar, MuscateAngles &m){
+	ar & m.Zenith & m.Azimuth;
+}
+template<class Archive> void serialize(Archive &ar, MuscateViewingAnglesGrid &m){
+	ar & m.bandID & m.detectorID & m.ViewIncidenceAnglesGrid;
+}
+template<class Archive> void serialize(Archive &ar, MuscateAnglePair &m){
+	ar & m.ZenithUnit & m.AzimuthUnit & m.ZenithValue & m.AzimuthValue & m.bandId & m.detectorId;
+}
+template<class Archive> void serialize(Archive &ar, MuscateGeometricInformations &m){
+	ar & m.MeanSunAngle & m.SolarAngles & m.MeanViewingIncidenceAngles & m.ViewingAngles;
+}
+template<class Archive> void serialize(Archive &ar, SpecialValue &m){
+	ar & m.name & m.value;
+}
+template<class Archive> void serialize(Archive &ar, BandInformation &m){
+	ar & m.bandID & m.PhysicalGain & m.LuminanceMax & m.LuminanceMin & m.QuantizeCalMax & m.QuantizeCalMin
+	   & m.RadianceAdd & m.RadianceMult & m.ReflectanceAdd & m.ReflectanceMult & m.SolarIrradiance
+	   & m.SpatialResolution & m.SpatialResolutionUnit & m.WavelengthMin & m.WavelengthMax & m.WavelengthCentral
+	   & m.SpectralResponseStep & m.SpectralResponseValues;
+}
+template<class Archive> void serialize(Archive &ar, MuscateRadiometricInformations &m){
+	ar & m.quantificationValues & m.specialValues & m.Bands;
+}
+template<class Archive> void serialize(Archive &ar, MuscateQualityIndex &m){
+	ar & m.name & m.value;
+}
+template<class Archive> void serialize(Archive &ar, MuscateQualityProduct &m){
+	ar & m.Level & m.ProductID & m.AcquisitionDate & m.ProductionDate & m.GlobalIndexList;
+}
+template<class Archive> void serialize(Archive &ar, MuscateQualityInformations &m){
+	ar & m.CurrentProduct & m.ContributingProducts;
+}
+template<class Archive> void serialize(Archive &ar, MuscateFileMetadata &m){
+	ar & m.Header & m.MetadataIdentification & m.DatasetIdentification & m.ProductCharacteristics
+	   & m.ProductOrganisation & m.GeopositionInformations & m.GeometricInformations
+	   & m.RadiometricInformations & m.QualityInformations & m.ProductPath;
+}
+
+} //namespace
+
+void MuscateMetadataCache::SetDirectory(const std::string &dir){
+	m_Directory = dir;
+}
+
+const std::string &MuscateMetadataCache::GetDirectory() const{
+	return m_Directory;
+}
+
+void MuscateMetadataCache::Serialize(const MuscateFileMetadata &metadata, std::ostream &os){
+	OutArchive ar(os);
+	ar & metadata;
+}
+
+std::unique_ptr<MuscateFileMetadata> MuscateMetadataCache::Deserialize(std::istream &is){
+	std::unique_ptr<MuscateFileMetadata> metadata(new MuscateFileMetadata());
+	InArchive ar(is);
+	ar & *metadata;
+	if(!ar.good()){
+		return nullptr;
+	}
+	return metadata;
+}
+
+bool MuscateMetadataCache::getKey(const std::string &path, SnapshotKey &key){
+	boost::system::error_code ec;
+	const boost::filesystem::path canonicalPath = boost::filesystem::canonical(path, ec);
+	if(ec) return false;
+	key.Path = canonicalPath.string();
+	key.Size = boost::filesystem::file_size(canonicalPath, ec);
+	if(ec) return false;
+	key.ModificationTime = boost::filesystem::last_write_time(canonicalPath, ec);
+	return !ec;
+}
+
+std::string MuscateMetadataCache::getSnapshotPath(const SnapshotKey &key) const{
+	std::ostringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>()(key.Path) << SnapshotExtension;
+	return (boost::filesystem::path(m_Directory) / name.str()).string();
+}
+
+std::unique_ptr<MuscateFileMetadata> MuscateMetadataCache::Load(const std::string &path, const unsigned int &sections, unsigned int *storedSections) const{
+	if(storedSections) *storedSections = 0;
+	SnapshotKey key;
+	if(m_Directory.empty() || !getKey(path, key)){
+		return nullptr;
+	}
+	std::ifstream is(getSnapshotPath(key), std::ios::binary);
+	if(!is){
+		return nullptr;
+	}
+
+	//Header: Magic, version, key and the sections contained
+	char magic[sizeof(SnapshotMagic)];
+	uint32_t version = 0, snapshotSections = 0;
+	SnapshotKey snapshotKey;
+	is.read(magic, sizeof(magic));
+	InArchive ar(is);
+	ar & version & snapshotKey.Path & snapshotKey.Size & snapshotKey.ModificationTime & snapshotSections;
+	if(!ar.good() || std::memcmp(magic, SnapshotMagic, sizeof(magic)) != 0 || version != SnapshotVersion ||
+	   snapshotKey.Path != key.Path || snapshotKey.Size != key.Size || snapshotKey.ModificationTime != key.ModificationTime){
+		return nullptr;
+	}
+	if(storedSections) *storedSections = snapshotSections;
+	if((snapshotSections & sections) != sections){
+		return nullptr;
+	}
+
+	auto metadata = Deserialize(is);
+	if(metadata){
+		metadata->ProductPath = path;
+	}
+	return metadata;
+}
+
+bool MuscateMetadataCache::Store(const std::string &path, const unsigned int &sections, const MuscateFileMetadata &metadata) const{
+	SnapshotKey key;
+	if(m_Directory.empty() || !getKey(path, key)){
+		return false;
+	}
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(m_Directory, ec);
+	const std::string snapshotPath = getSnapshotPath(key);
+	const boost::filesystem::path tempPath = boost::filesystem::unique_path(snapshotPath + ".%%%%-%%%%-%%%%.tmp", ec);
+	if(ec){
+		return false;
+	}
+	{
+		std::ofstream os(tempPath.string(), std::ios::binary | std::ios::trunc);
+		if(!os){
+			return false;
+		}
+		os.write(SnapshotMagic, sizeof(SnapshotMagic));
+		OutArchive ar(os);
+		ar & SnapshotVersion & key.Path & key.Size & key.ModificationTime & static_cast<uint32_t>(sections);
+		Serialize(metadata, os);
+		if(!os.good()){
+			os.close();
+			boost::filesystem::remove(tempPath, ec);
+			return false;
+		}
+	}
+	boost::filesystem::rename(tempPath, snapshotPath, ec);
+	if(ec){
+		boost::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
+
+} /* namespace muscate */
+} /* namespace ts */
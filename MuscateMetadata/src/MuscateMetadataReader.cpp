@@ -26,6 +26,7 @@
  */
 
 #include <limits>
+#include <cstdlib>
 #include <libgen.h>
 
 #include <boost/algorithm/string/predicate.hpp>
@@ -41,14 +42,44 @@
 namespace ts {
 namespace muscate {
 
-std::unique_ptr<MuscateFileMetadata> MuscateMetadataReader::ReadMetadata(const std::string &path){
+MuscateMetadataReader::MuscateMetadataReader(){
+	const char *cacheDir = std::getenv("WASP_METADATA_CACHE");
+	if(cacheDir){
+		SetCacheDirectory(cacheDir);
+	}
+}
+
+void MuscateMetadataReader::SetCacheDirectory(const std::string &dir){
+	if(dir.empty()){
+		m_Cache = nullptr;
+		return;
+	}
+	m_Cache = MuscateMetadataCache::New();
+	m_Cache->SetDirectory(dir);
+}
+
+std::unique_ptr<MuscateFileMetadata> MuscateMetadataReader::ReadMetadata(const std::string &path, const unsigned int &sections){
+	unsigned int sectionsToRead = sections;
+	if(m_Cache){
+		unsigned int storedSections = 0;
+		auto cached = m_Cache->Load(path, sections, &storedSections);
+		if(cached){
+			return cached;
+		}
+		//Keep the sections of an outdated or smaller snapshot, so that alternating readers do not overwrite each other
+		sectionsToRead |= storedSections;
+	}
+
 	TiXmlDocument doc(path);
 	if (!doc.LoadFile()) {
 		return nullptr;
 	}
-	auto metadata = ReadMetadataXml(doc);
+	auto metadata = ReadMetadataXml(doc, sectionsToRead);
 	if (metadata) {
 		metadata->ProductPath = path;
+		if(m_Cache){
+			m_Cache->Store(path, sectionsToRead, *metadata);
+		}
 	}
 
 	return metadata;
@@ -376,19 +407,30 @@ MuscateAnglePair getMeanViewingIncidenceAngle(TiXmlElement *el){
 }
 
 /**
- * @brief Read a list of space separated doubles to a double-vector
- * @param s The line containing doubles, of any size
- * @return A vector containing the double-values
+ * @brief Read the VALUES rows of a Values_List into a flat grid
+ * @param valuesList The Values_List element
+ * @param grid The grid to be filled
+ * @note The rows are parsed in place from the TinyXML text buffers. A grid with rows of different sizes is left empty.
  */
-std::vector<double> ReadDoubleList(const std::string &s){
-	std::vector<double> result;
-	std::istringstream is(s);
-	std::string value;
-	while (is >> value) {
-		result.emplace_back(ReadDouble(value));
+void ReadAngleGrid(TiXmlElement *valuesList, MuscateAngleList &grid){
+	size_t nRows = 0;
+	for(auto value = valuesList->FirstChildElement("VALUES");
+			value; value = value->NextSiblingElement("VALUES")){
+		nRows++;
+	}
+	for(auto value = valuesList->FirstChildElement("VALUES");
+			value; value = value->NextSiblingElement("VALUES")){
+		size_t nCols = AppendDoubleList(value->GetText(), grid.Values);
+		if(grid.Rows == 0){
+			grid.Cols = nCols;
+			grid.Values.reserve(nRows * nCols);
+		}else if(nCols != grid.Cols){
+			otbMsgDevMacro("Angle grid rows differ in size: " << nCols << " instead of " << grid.Cols);
+			grid.Resize(0, 0);
+			return;
+		}
+		grid.Rows++;
 	}
-
-	return result;
 }
 
 MuscateAngles getMuscateAngles(TiXmlElement * el){
@@ -401,10 +443,7 @@ MuscateAngles getMuscateAngles(TiXmlElement * el){
 		result.Zenith.ColumnStep = GetChildText(zenith, "COL_STEP");
 		result.Zenith.RowStep = GetChildText(zenith, "ROW_STEP");
 		if(auto valuesList = zenith->FirstChildElement("Values_List")){
-			for(auto value = valuesList->FirstChildElement("VALUES");
-					value; value = value->NextSiblingElement("VALUES")){
-				result.Zenith.Values.emplace_back(ReadDoubleList(value->GetText()));
-			}
+			ReadAngleGrid(valuesList, result.Zenith);
 		}
 	}
 	if(auto azimuth = el->FirstChildElement("Azimuth")){
@@ -414,10 +453,7 @@ MuscateAngles getMuscateAngles(TiXmlElement * el){
 		result.Azimuth.ColumnStep = GetChildText(azimuth, "COL_STEP");
 		result.Azimuth.RowStep = GetChildText(azimuth, "ROW_STEP");
 		if(auto valuesList = azimuth->FirstChildElement("Values_List")){
-			for(auto value = valuesList->FirstChildElement("VALUES");
-					value; value = value->NextSiblingElement("VALUES")){
-				result.Azimuth.Values.emplace_back(ReadDoubleList(value->GetText()));
-			}
+			ReadAngleGrid(valuesList, result.Azimuth);
 		}
 	}
 	if(!hasAzimuth || !hasZenith){
@@ -576,7 +612,7 @@ MuscateQualityInformations MuscateMetadataReader::readQualityInformations(TiXmlE
 	return result;
 }
 
-std::unique_ptr<MuscateFileMetadata> MuscateMetadataReader::ReadMetadataXml(const TiXmlDocument &doc){
+std::unique_ptr<MuscateFileMetadata> MuscateMetadataReader::ReadMetadataXml(const TiXmlDocument &doc, const unsigned int &sections){
 	TiXmlHandle hDoc(const_cast<TiXmlDocument *>(&doc));
 
 	// BUG: TinyXML can't properly read stylesheet declarations, see
@@ -589,16 +625,30 @@ std::unique_ptr<MuscateFileMetadata> MuscateMetadataReader::ReadMetadataXml(cons
 	}
 
 	auto file = std::unique_ptr<MuscateFileMetadata>(new MuscateFileMetadata);
-	file->Header.xsi = GetAttribute(rootElement, "xmlns:xsi");
-	file->Header.SchemaLocation = GetAttribute(rootElement, "xsi:noNamespaceSchemaLocation");
-	file->MetadataIdentification = readMetadataIdentification(rootElement->FirstChildElement("Metadata_Identification"));
-	file->DatasetIdentification = readDatasetIdentification(rootElement->FirstChildElement("Dataset_Identification"));
-	file->ProductCharacteristics = readProductCharacteristics(rootElement->FirstChildElement("Product_Characteristics"));
-	file->ProductOrganisation = readProductOrganisation(rootElement->FirstChildElement("Product_Organisation"));
-	file->GeopositionInformations = readGeopositionInformations(rootElement->FirstChildElement("Geoposition_Informations"));
-	file->GeometricInformations = readGeometricInformations(rootElement->FirstChildElement("Geometric_Informations"));
-	file->RadiometricInformations = readRadiometricInformations(rootElement->FirstChildElement("Radiometric_Informations"));
-	file->QualityInformations = readQualityInformations(rootElement->FirstChildElement("Quality_Informations"));
+	if(sections & SECTION_IDENTIFICATION){
+		file->Header.xsi = GetAttribute(rootElement, "xmlns:xsi");
+		file->Header.SchemaLocation = GetAttribute(rootElement, "xsi:noNamespaceSchemaLocation");
+		file->MetadataIdentification = readMetadataIdentification(rootElement->FirstChildElement("Metadata_Identification"));
+		file->DatasetIdentification = readDatasetIdentification(rootElement->FirstChildElement("Dataset_Identification"));
+	}
+	if(sections & SECTION_PRODUCT_CHARACTERISTICS){
+		file->ProductCharacteristics = readProductCharacteristics(rootElement->FirstChildElement("Product_Characteristics"));
+	}
+	if(sections & SECTION_PRODUCT_ORGANISATION){
+		file->ProductOrganisation = readProductOrganisation(rootElement->FirstChildElement("Product_Organisation"));
+	}
+	if(sections & SECTION_GEOPOSITION){
+		file->GeopositionInformations = readGeopositionInformations(rootElement->FirstChildElement("Geoposition_Informations"));
+	}
+	if(sections & SECTION_GEOMETRIC){
+		file->GeometricInformations = readGeometricInformations(rootElement->FirstChildElement("Geometric_Informations"));
+	}
+	if(sections & SECTION_RADIOMETRIC){
+		file->RadiometricInformations = readRadiometricInformations(rootElement->FirstChildElement("Radiometric_Informations"));
+	}
+	if(sections & SECTION_QUALITY){
+		file->QualityInformations = readQualityInformations(rootElement->FirstChildElement("Quality_Informations"));
+	}
 	return file;
 }
 
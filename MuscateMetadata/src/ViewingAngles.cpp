@@ -51,30 +51,29 @@ static void checkDimensions(std::string expectedColumnUnit,
         throw std::runtime_error("The angle grids must have the same row step");
     }
 
-    if (grid.Values.size() != expectedHeight) {
+    if (grid.Rows != expectedHeight) {
         throw std::runtime_error("The angle grids must have the same height");
     }
 
-    for (const auto &row : grid.Values) {
-        if (row.size() != expectedWidth) {
-            throw std::runtime_error("The angle grids must have the same width");
-        }
+    if (grid.Cols != expectedWidth) {
+        throw std::runtime_error("The angle grids must have the same width");
     }
 }
 
-static std::vector<std::vector<double> > makeGrid(size_t height, size_t width)
+static MuscateAngleList makeGrid(const MuscateAngleList &reference)
 {
-    std::vector<std::vector<double> > r(height);
-
-    for (auto &row : r) {
-        row.resize(width);
-    }
+    MuscateAngleList r;
+    r.ColumnUnit = reference.ColumnUnit;
+    r.ColumnStep = reference.ColumnStep;
+    r.RowUnit = reference.RowUnit;
+    r.RowStep = reference.RowStep;
+    r.Resize(reference.Rows, reference.Cols, std::numeric_limits<double>::quiet_NaN());
 
     return r;
 }
 
 std::vector<MuscateBandViewingAnglesGrid> ComputeViewingAngles(const std::vector<MuscateViewingAnglesGrid> &angleGrids) {
-    if (angleGrids.empty() || angleGrids.front().ViewIncidenceAnglesGrid.Zenith.Values.empty()) {
+    if (angleGrids.empty() || angleGrids.front().ViewIncidenceAnglesGrid.Zenith.IsEmpty()) {
         return {};
     }
 
@@ -83,8 +82,8 @@ std::vector<MuscateBandViewingAnglesGrid> ComputeViewingAngles(const std::vector
     auto columnStep = firstGrid.ColumnStep;
     auto rowUnit = firstGrid.RowUnit;
     auto rowStep = firstGrid.RowStep;
-    auto width = firstGrid.Values.front().size();
-    auto height = firstGrid.Values.size();
+    auto width = firstGrid.Cols;
+    auto height = firstGrid.Rows;
     std::map<std::string, int> bandPos;
     std::map<std::string, MuscateBandViewingAnglesGrid> resultGrids;
     auto endBandPos = std::end(bandPos);
@@ -101,34 +100,28 @@ std::vector<MuscateBandViewingAnglesGrid> ComputeViewingAngles(const std::vector
         if (it == endResultGrids) {
             resultGrids.emplace(
                 grid.bandID,
-                MuscateBandViewingAnglesGrid{ grid.bandID,
-                                            { { columnUnit, columnStep, rowUnit, rowStep, makeGrid(height, width) },
-                                              { columnUnit, columnStep, rowUnit, rowStep, makeGrid(height, width) } } });
+                MuscateBandViewingAnglesGrid{ grid.bandID, { makeGrid(firstGrid), makeGrid(firstGrid) } });
         }
     }
 
+    // Where the detectors of a band overlap, the last valid value is kept
+    const size_t nValues = height * width;
     for (auto &resultGrid : resultGrids) {
-        for (size_t j = 0; j < height; j++) {
-            for (size_t i = 0; i < width; i++) {
-                auto zenith = std::numeric_limits<double>::quiet_NaN();
-                auto azimuth = std::numeric_limits<double>::quiet_NaN();
-
-                for (const auto &grid : angleGrids) {
-                    if (grid.bandID == resultGrid.first) {
-                        auto z = grid.ViewIncidenceAnglesGrid.Zenith.Values[j][i];
-                        auto a = grid.ViewIncidenceAnglesGrid.Azimuth.Values[j][i];
-
-                        if (!std::isnan(z)) {
-                            zenith = z;
-                        }
-                        if (!std::isnan(a)) {
-                            azimuth = a;
-                        }
-                    }
+        double *zenith = resultGrid.second.Angles.Zenith.Values.data();
+        double *azimuth = resultGrid.second.Angles.Azimuth.Values.data();
+        for (const auto &grid : angleGrids) {
+            if (grid.bandID != resultGrid.first) {
+                continue;
+            }
+            const double *z = grid.ViewIncidenceAnglesGrid.Zenith.Values.data();
+            const double *a = grid.ViewIncidenceAnglesGrid.Azimuth.Values.data();
+            for (size_t k = 0; k < nValues; k++) {
+                if (!std::isnan(z[k])) {
+                    zenith[k] = z[k];
+                }
+                if (!std::isnan(a[k])) {
+                    azimuth[k] = a[k];
                 }
-
-                resultGrid.second.Angles.Zenith.Values[j][i] = zenith;
-                resultGrid.second.Angles.Azimuth.Values[j][i] = azimuth;
             }
         }
     }
@@ -25,6 +25,8 @@
 
 #include <limits>
 #include <sstream>
+#include <cstdlib>
+#include <cctype>
 
 #include <otbMacro.h>
 #include <algorithm>
@@ -59,6 +61,37 @@ double ReadDouble(const std::string &s)
 	}
 }
 
+size_t AppendDoubleList(const char *s, std::vector<double> &values)
+{
+	if (!s) {
+		return 0;
+	}
+	size_t nRead = 0;
+	const char *p = s;
+	while (true) {
+		while (*p && std::isspace(static_cast<unsigned char>(*p))) {
+			++p;
+		}
+		if (!*p) {
+			break;
+		}
+		char *end;
+		double value = std::strtod(p, &end);
+		if (end == p) {
+			otbMsgDevMacro("Invalid double value at " << p);
+			value = std::numeric_limits<double>::quiet_NaN();
+		}
+		// Skip any trailing characters of the token, as std::stod does
+		p = end;
+		while (*p && !std::isspace(static_cast<unsigned char>(*p))) {
+			++p;
+		}
+		values.push_back(value);
+		nRead++;
+	}
+	return nRead;
+}
+
 bool is_number(const std::string& s)
 {
 	return !s.empty() && std::find_if(s.begin(),
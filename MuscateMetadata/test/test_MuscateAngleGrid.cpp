@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE MuscateAngleGrid
+#include <boost/test/unit_test.hpp>
+#include "GlobalDefs.h"
+#include "MuscateMetadataReader.hpp"
+#include "ViewingAngles.hpp"
+#include "string_utils.hpp"
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+using namespace ts::muscate;
+
+#define TEST_NAME	"test_MuscateMetadata"
+#define TEST_SRC	ts::getEnvVar("WASP_TEST")
+#define EXAMPLE_XML1 "SENTINEL2A_20170402-093844-724_L2A_T32MNE_D_V1-4_MTD_ALL.xml"
+
+typedef std::chrono::duration<double, std::milli> msType;
+
+/**
+ * @brief Previous implementation of the VALUES parser, used as reference
+ */
+std::vector<double> ReadDoubleListStream(const std::string &s){
+	std::vector<double> result;
+	std::istringstream is(s);
+	std::string value;
+	while (is >> value) {
+		result.emplace_back(ReadDouble(value));
+	}
+	return result;
+}
+
+bool isSameValue(const double &a, const double &b){
+	return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+BOOST_AUTO_TEST_CASE(TestAppendDoubleList)
+{
+	const std::vector<std::string> rows = {"", "  ", "1 2.5 -3e2", "\t12.25\n NaN 7", "1.5abc 2", "abc 4 ", "-0.000125 89.987654321"};
+	for(const std::string &row : rows){
+		std::vector<double> expected = ReadDoubleListStream(row);
+		std::vector<double> values = {42.0};
+		BOOST_REQUIRE_EQUAL(AppendDoubleList(row.c_str(), values), expected.size());
+		BOOST_REQUIRE_EQUAL(values.size(), expected.size() + 1);
+		BOOST_CHECK_EQUAL(values[0], 42.0);
+		for(size_t i = 0; i < expected.size(); i++){
+			BOOST_CHECK_MESSAGE(isSameValue(values[i + 1], expected[i]), row << ": " << values[i + 1] << " != " << expected[i]);
+		}
+	}
+	std::vector<double> values;
+	BOOST_CHECK_EQUAL(AppendDoubleList(nullptr, values), size_t(0));
+	BOOST_CHECK(values.empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestFlatAngleGrids)
+{
+	if(TEST_SRC == ""){
+		BOOST_FAIL("Did not set env-var WASP_TEST!");
+	}
+	auto reader = MuscateMetadataReader::New();
+	auto m = reader->ReadMetadata(std::string(TEST_SRC + "/" + TEST_NAME + "/" + EXAMPLE_XML1));
+	BOOST_REQUIRE(m);
+
+	const MuscateAngleList &sunZenith = m->GeometricInformations.SolarAngles.Zenith;
+	BOOST_CHECK_EQUAL(sunZenith.Rows, size_t(23));
+	BOOST_CHECK_EQUAL(sunZenith.Cols, size_t(23));
+	BOOST_CHECK_EQUAL(sunZenith.Values.size(), sunZenith.Rows * sunZenith.Cols);
+	BOOST_CHECK_EQUAL(sunZenith.GetRow(1)[2], sunZenith.GetValue(1, 2));
+	BOOST_REQUIRE(!m->GeometricInformations.ViewingAngles.empty());
+	for(const MuscateViewingAnglesGrid &grid : m->GeometricInformations.ViewingAngles){
+		BOOST_CHECK_EQUAL(grid.ViewIncidenceAnglesGrid.Zenith.Rows, size_t(23));
+		BOOST_CHECK_EQUAL(grid.ViewIncidenceAnglesGrid.Azimuth.Cols, size_t(23));
+	}
+	std::vector<MuscateBandViewingAnglesGrid> bandGrids = ComputeViewingAngles(m->GeometricInformations.ViewingAngles);
+	BOOST_REQUIRE(!bandGrids.empty());
+	BOOST_CHECK_EQUAL(bandGrids.front().Angles.Zenith.Values.size(), size_t(23 * 23));
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkAngleGridParsing)
+{
+	// Rows of an S2 product: 13 bands x 12 detectors x 2 angles x 23 rows of 23 values
+	const size_t nRows = 13 * 12 * 2 * 23;
+	std::ostringstream os;
+	for(size_t i = 0; i < 23; i++){
+		os << (i % 3 == 0 ? "NaN" : std::to_string(5.0 + i * 0.123456789)) << " ";
+	}
+	const std::string row = os.str();
+
+	auto start = std::chrono::steady_clock::now();
+	size_t nStream = 0;
+	std::vector<std::vector<double> > nested;
+	for(size_t i = 0; i < nRows; i++){
+		nested.emplace_back(ReadDoubleListStream(row));
+		nStream += nested.back().size();
+	}
+	auto streamed = std::chrono::steady_clock::now();
+	std::vector<double> flat;
+	size_t nFlat = 0;
+	for(size_t i = 0; i < nRows; i++){
+		nFlat += AppendDoubleList(row.c_str(), flat);
+	}
+	auto parsed = std::chrono::steady_clock::now();
+	BOOST_CHECK_EQUAL(nStream, nFlat);
+	std::cout << "Angle rows of one S2 product: istringstream " << msType(streamed - start).count()
+			<< " ms, in place " << msType(parsed - streamed).count() << " ms" << std::endl;
+
+	if(TEST_SRC == ""){
+		BOOST_FAIL("Did not set env-var WASP_TEST!");
+	}
+	const size_t nProducts = 20;
+	auto reader = MuscateMetadataReader::New();
+	start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < nProducts; i++){
+		auto m = reader->ReadMetadata(std::string(TEST_SRC + "/" + TEST_NAME + "/" + EXAMPLE_XML1));
+		BOOST_REQUIRE(m);
+		ComputeViewingAngles(m->GeometricInformations.ViewingAngles);
+	}
+	std::cout << "Read metadata and viewing angles: " << msType(std::chrono::steady_clock::now() - start).count() / nProducts
+			<< " ms per product" << std::endl;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE MuscateMetadataCache
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include "GlobalDefs.h"
+#include "MuscateMetadataReader.hpp"
+#include "MuscateMetadataCache.hpp"
+#include "MetadataUtil.hpp"
+#include <chrono>
+#include <cstring>
+
+using namespace ts::muscate;
+
+#define TEST_NAME	"test_MuscateMetadata"
+#define TEST_SRC	ts::getEnvVar("WASP_TEST")
+#define EXAMPLE_XML1 "SENTINEL2A_20170402-093844-724_L2A_T32MNE_D_V1-4_MTD_ALL.xml"
+
+typedef std::chrono::duration<double, std::milli> msType;
+
+/**
+ * @brief Copy of the example XML inside a temporary directory, so that its modification time can be changed
+ */
+struct CacheFixture {
+	CacheFixture(){
+		if(TEST_SRC == ""){
+			BOOST_FAIL("Did not set env-var WASP_TEST!");
+		}
+		tempDir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("wasp-cache-%%%%-%%%%");
+		boost::filesystem::create_directories(tempDir);
+		xml = (tempDir / EXAMPLE_XML1).string();
+		boost::filesystem::copy_file(std::string(TEST_SRC + "/" + TEST_NAME + "/" + EXAMPLE_XML1), xml);
+		cacheDir = (tempDir / "cache").string();
+	}
+	~CacheFixture(){
+		boost::system::error_code ec;
+		boost::filesystem::remove_all(tempDir, ec);
+	}
+	size_t countSnapshots() const{
+		if(!boost::filesystem::exists(cacheDir)) return 0;
+		return std::distance(boost::filesystem::directory_iterator(cacheDir), boost::filesystem::directory_iterator());
+	}
+
+	boost::filesystem::path tempDir;
+	std::string xml;
+	std::string cacheDir;
+};
+
+void checkAngleList(const MuscateAngleList &lhs, const MuscateAngleList &rhs){
+	BOOST_CHECK_EQUAL(lhs.Rows, rhs.Rows);
+	BOOST_CHECK_EQUAL(lhs.Cols, rhs.Cols);
+	BOOST_CHECK_EQUAL(lhs.ColumnStep, rhs.ColumnStep);
+	BOOST_CHECK_EQUAL(lhs.RowUnit, rhs.RowUnit);
+	BOOST_REQUIRE_EQUAL(lhs.Values.size(), rhs.Values.size());
+	//NaN marks invalid angles and is not equal to itself, so compare the bits
+	BOOST_CHECK(lhs.Values.empty() || std::memcmp(lhs.Values.data(), rhs.Values.data(), lhs.Values.size() * sizeof(double)) == 0);
+}
+
+void checkMetadataEqual(const MuscateFileMetadata &lhs, const MuscateFileMetadata &rhs){
+	BOOST_CHECK(lhs.Header == rhs.Header);
+	BOOST_CHECK(lhs.MetadataIdentification == rhs.MetadataIdentification);
+	BOOST_CHECK(lhs.DatasetIdentification == rhs.DatasetIdentification);
+	BOOST_CHECK(lhs.ProductCharacteristics == rhs.ProductCharacteristics);
+	BOOST_CHECK(lhs.ProductOrganisation == rhs.ProductOrganisation);
+	BOOST_CHECK(lhs.GeopositionInformations == rhs.GeopositionInformations);
+	BOOST_CHECK(lhs.RadiometricInformations == rhs.RadiometricInformations);
+	BOOST_CHECK(lhs.QualityInformations == rhs.QualityInformations);
+	BOOST_CHECK_EQUAL(lhs.ProductPath, rhs.ProductPath);
+
+	const MuscateGeometricInformations &lg = lhs.GeometricInformations, &rg = rhs.GeometricInformations;
+	BOOST_CHECK_EQUAL(lg.MeanSunAngle.ZenithValue, rg.MeanSunAngle.ZenithValue);
+	BOOST_CHECK_EQUAL(lg.MeanViewingIncidenceAngles.size(), rg.MeanViewingIncidenceAngles.size());
+	checkAngleList(lg.SolarAngles.Zenith, rg.SolarAngles.Zenith);
+	checkAngleList(lg.SolarAngles.Azimuth, rg.SolarAngles.Azimuth);
+	BOOST_REQUIRE_EQUAL(lg.ViewingAngles.size(), rg.ViewingAngles.size());
+	for(size_t i = 0; i < lg.ViewingAngles.size(); i++){
+		BOOST_CHECK_EQUAL(lg.ViewingAngles[i].bandID, rg.ViewingAngles[i].bandID);
+		BOOST_CHECK_EQUAL(lg.ViewingAngles[i].detectorID, rg.ViewingAngles[i].detectorID);
+		checkAngleList(lg.ViewingAngles[i].ViewIncidenceAnglesGrid.Zenith, rg.ViewingAngles[i].ViewIncidenceAnglesGrid.Zenith);
+		checkAngleList(lg.ViewingAngles[i].ViewIncidenceAnglesGrid.Azimuth, rg.ViewingAngles[i].ViewIncidenceAnglesGrid.Azimuth);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(TestSnapshotRoundTrip, CacheFixture)
+{
+	auto reader = MuscateMetadataReader::New();
+	reader->SetCacheDirectory("");
+	auto parsed = reader->ReadMetadata(xml);
+	BOOST_REQUIRE(parsed);
+
+	auto cache = MuscateMetadataCache::New();
+	cache->SetDirectory(cacheDir);
+	BOOST_CHECK(!cache->Load(xml, SECTION_ALL));
+	BOOST_REQUIRE(cache->Store(xml, SECTION_ALL, *parsed));
+	BOOST_CHECK_EQUAL(countSnapshots(), 1);
+
+	auto loaded = cache->Load(xml, SECTION_ALL);
+	BOOST_REQUIRE(loaded);
+	checkMetadataEqual(*parsed, *loaded);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestReaderUsesCache, CacheFixture)
+{
+	auto reader = MuscateMetadataReader::New();
+	reader->SetCacheDirectory(cacheDir);
+	auto first = reader->ReadMetadata(xml);
+	BOOST_REQUIRE(first);
+	BOOST_CHECK_EQUAL(countSnapshots(), 1);
+	auto second = reader->ReadMetadata(xml);
+	BOOST_REQUIRE(second);
+	checkMetadataEqual(*first, *second);
+
+	//A modified XML invalidates the snapshot, which is then replaced
+	auto cache = MuscateMetadataCache::New();
+	cache->SetDirectory(cacheDir);
+	BOOST_CHECK(cache->Load(xml, SECTION_ALL));
+	boost::filesystem::last_write_time(xml, boost::filesystem::last_write_time(xml) + 10);
+	BOOST_CHECK(!cache->Load(xml, SECTION_ALL));
+	auto third = reader->ReadMetadata(xml);
+	BOOST_REQUIRE(third);
+	checkMetadataEqual(*first, *third);
+	BOOST_CHECK(cache->Load(xml, SECTION_ALL));
+	BOOST_CHECK_EQUAL(countSnapshots(), 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestSnapshotSections, CacheFixture)
+{
+	auto reader = MuscateMetadataReader::New();
+	reader->SetCacheDirectory(cacheDir);
+	auto cache = MuscateMetadataCache::New();
+	cache->SetDirectory(cacheDir);
+	unsigned int storedSections = 0;
+
+	BOOST_REQUIRE(reader->ReadMetadata(xml, SECTION_IDENTIFICATION));
+	BOOST_CHECK(cache->Load(xml, SECTION_IDENTIFICATION, &storedSections));
+	BOOST_CHECK_EQUAL(storedSections, SECTION_IDENTIFICATION);
+	BOOST_CHECK(!cache->Load(xml, SECTION_IDENTIFICATION | SECTION_GEOMETRIC, &storedSections));
+	BOOST_CHECK_EQUAL(storedSections, SECTION_IDENTIFICATION);
+
+	//A second reader needing more sections extends the snapshot instead of replacing it
+	auto geometric = reader->ReadMetadata(xml, SECTION_GEOMETRIC);
+	BOOST_REQUIRE(geometric);
+	BOOST_CHECK(!geometric->GeometricInformations.ViewingAngles.empty());
+	auto identification = cache->Load(xml, SECTION_IDENTIFICATION | SECTION_GEOMETRIC, &storedSections);
+	BOOST_REQUIRE(identification);
+	BOOST_CHECK_EQUAL(storedSections, SECTION_IDENTIFICATION | SECTION_GEOMETRIC);
+	BOOST_CHECK_EQUAL(identification->DatasetIdentification.GeographicalZone, "T32MNE");
+}
+
+BOOST_FIXTURE_TEST_CASE(BenchmarkSnapshot, CacheFixture)
+{
+	const size_t nRuns = 20;
+	auto parser = MuscateMetadataReader::New();
+	parser->SetCacheDirectory("");
+	auto reader = MuscateMetadataReader::New();
+	reader->SetCacheDirectory(cacheDir);
+	BOOST_REQUIRE(reader->ReadMetadata(xml));
+
+	auto start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < nRuns; i++){
+		BOOST_REQUIRE(parser->ReadMetadata(xml));
+	}
+	auto parsed = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < nRuns; i++){
+		BOOST_REQUIRE(reader->ReadMetadata(xml));
+	}
+	auto loaded = std::chrono::steady_clock::now();
+
+	std::cout << "Parsing the XML: " << msType(parsed - start).count() / nRuns << " ms. Loading the snapshot: "
+			<< msType(loaded - parsed).count() / nRuns << " ms" << std::endl;
+}
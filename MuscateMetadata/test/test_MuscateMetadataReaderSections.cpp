@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE MuscateReaderSections
+#include <boost/test/unit_test.hpp>
+#include "GlobalDefs.h"
+#include "MuscateMetadataReader.hpp"
+#include <chrono>
+
+using namespace ts::muscate;
+
+#define TEST_NAME	"test_MuscateMetadata"
+#define TEST_SRC	ts::getEnvVar("WASP_TEST")
+#define EXAMPLE_XML1 "SENTINEL2A_20170402-093844-724_L2A_T32MNE_D_V1-4_MTD_ALL.xml"
+
+#define LIGHT_SECTIONS	(SECTION_IDENTIFICATION | SECTION_PRODUCT_CHARACTERISTICS | SECTION_PRODUCT_ORGANISATION | SECTION_RADIOMETRIC)
+
+typedef std::chrono::duration<double, std::milli> msType;
+
+BOOST_AUTO_TEST_CASE(TestReadSections)
+{
+	if(TEST_SRC == ""){
+		BOOST_FAIL("Did not set env-var WASP_TEST!");
+	}
+	const std::string xml = std::string(TEST_SRC + "/" + TEST_NAME + "/" + EXAMPLE_XML1);
+	auto reader = MuscateMetadataReader::New();
+	auto full = reader->ReadMetadata(xml);
+	auto light = reader->ReadMetadata(xml, LIGHT_SECTIONS);
+	BOOST_REQUIRE(full);
+	BOOST_REQUIRE(light);
+
+	BOOST_CHECK_EQUAL(light->ProductPath, full->ProductPath);
+	BOOST_CHECK_EQUAL(light->DatasetIdentification.GeographicalZone, full->DatasetIdentification.GeographicalZone);
+	BOOST_CHECK_EQUAL(light->ProductCharacteristics.Platform, full->ProductCharacteristics.Platform);
+	BOOST_CHECK_EQUAL(light->ProductCharacteristics.AcquisitionDate, full->ProductCharacteristics.AcquisitionDate);
+	BOOST_CHECK_EQUAL(light->ProductOrganisation.ImageProperties.size(), full->ProductOrganisation.ImageProperties.size());
+	BOOST_CHECK_EQUAL(light->RadiometricInformations.quantificationValues.size(), full->RadiometricInformations.quantificationValues.size());
+
+	//The skipped sections are left empty
+	BOOST_CHECK(!full->GeometricInformations.ViewingAngles.empty());
+	BOOST_CHECK(light->GeometricInformations.ViewingAngles.empty());
+	BOOST_CHECK(light->GeometricInformations.SolarAngles.Zenith.IsEmpty());
+	BOOST_CHECK(light->GeopositionInformations.GroupPosition.empty());
+
+	auto identification = reader->ReadMetadata(xml, SECTION_IDENTIFICATION);
+	BOOST_REQUIRE(identification);
+	BOOST_CHECK_EQUAL(identification->DatasetIdentification.GeographicalZone, full->DatasetIdentification.GeographicalZone);
+	BOOST_CHECK(identification->ProductCharacteristics.Platform.empty());
+}
+
+BOOST_AUTO_TEST_CASE(BenchmarkReadSections)
+{
+	if(TEST_SRC == ""){
+		BOOST_FAIL("Did not set env-var WASP_TEST!");
+	}
+	const std::string xml = std::string(TEST_SRC + "/" + TEST_NAME + "/" + EXAMPLE_XML1);
+	const size_t nRuns = 20;
+	auto reader = MuscateMetadataReader::New();
+
+	// The document is loaded once, to separate the TinyXML parsing from the decoding of the sections
+	auto start = std::chrono::steady_clock::now();
+	TiXmlDocument doc(xml);
+	BOOST_REQUIRE(doc.LoadFile());
+	auto loaded = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < nRuns; i++){
+		BOOST_REQUIRE(reader->ReadMetadataXml(doc));
+	}
+	auto decodedFull = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < nRuns; i++){
+		BOOST_REQUIRE(reader->ReadMetadataXml(doc, LIGHT_SECTIONS));
+	}
+	auto decodedLight = std::chrono::steady_clock::now();
+
+	std::cout << "TinyXML load: " << msType(loaded - start).count() << " ms. Decoding all sections: "
+			<< msType(decodedFull - loaded).count() / nRuns << " ms, product sections only: "
+			<< msType(decodedLight - decodedFull).count() / nRuns << " ms" << std::endl;
+}
@@ -33,8 +33,12 @@
 #include "MuscateMetadataWriter.hpp"
 #include "ProductDefinitions.h"
 #include "BaseImageTypes.h"
-#include "otbVectorImageToImageListFilter.h"
+#include "MultiBandFileWriter.h"
+#include "RegionOfInterest.h"
+#include "PerformanceTelemetry.h"
+#include "BandHistogram.h"
 #include "itkLightObject.h"
+#include "itkLogger.h"
 
 /**
  * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
@@ -57,6 +61,7 @@ public:
 	 * @param xml L2A XML input list
 	 * @param cog Write all rasters as Cloud-Optimized GeoTiff or not
 	 * @param cogtemp Temporary CoG filepath to be used
+	 * @param ioProfile The I/O profile of the rasters, see GetIOProfileNames(). The profile "cog" implies cog.
 	 */
 	virtual void init(
 			const std::vector<std::string> &products,
@@ -67,7 +72,8 @@ public:
 			const std::string &gipp,
 			const std::vector<std::string> &xml,
 			const bool &cog,
-			const std::string &cogtemp
+			const std::string &cogtemp,
+			const std::string &ioProfile = IO_PROFILE_DEFAULT
 	) {
 		m_products = products;
 		m_syntDate = syntdate;
@@ -76,10 +82,36 @@ public:
 		m_version = version;
 		m_gipp = gipp;
 		m_xml = xml;
-		m_cog = cog;
+		m_cog = cog || ioProfile == IO_PROFILE_COG;
 		m_cogtemp = cogtemp;
+		m_ioProfile = ioProfile;
+		m_telemetry = NULL;
+		m_logger = NULL;
 	}
 
+	/**
+	 * @brief Restrict the product to a region of interest
+	 * @param roi The extent in the map coordinates of the products
+	 */
+	void setRegionOfInterest(const RegionOfInterest &roi) { m_RegionOfInterest.SetRegionOfInterest(roi); }
+
+	/**
+	 * @brief Record the performance of the writers of the product
+	 * @param telemetry The telemetry of the application, owned by it
+	 */
+	void setTelemetry(PerformanceTelemetry *telemetry) { m_telemetry = telemetry; }
+
+	/**
+	 * @brief Log the details of the product creation through the logger of the application
+	 * @param logger The logger of the application, owned by it
+	 */
+	void setLogger(itk::Logger *logger) { m_logger = logger; }
+
+	/**
+	 * @brief The logger of the application, used by the otbAppLog-macros. Can be NULL.
+	 */
+	itk::Logger *GetLogger() const { return m_logger; }
+
 	/**
 	 * @brief Create the product to the specified destination
 	 * @param destination The destination directory
@@ -90,8 +122,7 @@ public:
 protected:
 	typedef muscate::MuscateMetadataReader MuscateMetadataReaderType;
 	typedef muscate::MuscateMetadataWriter MuscateMetadataWriterType;
-	typedef otb::VectorImageToImageListFilter<ShortVectorImageType, ByteImageListType>   		ExtractMaskType;
-	typedef otb::VectorImageToImageListFilter<ShortVectorImageType, ShortImageListType>			ExtractRasterType;
+	typedef MultiBandFileWriter<ShortVectorImageType>											MultiBandWriterType;
 
 	/**
 	 * @brief Read all metadata files and FillMetadataInfo for each file. Also determines the GeoInfo to be used
@@ -150,58 +181,45 @@ protected:
 	bool mkPath(const std::string &path);
 
 	/**
-	 * @brief Extract an image and write it to the given filename
-	 * @param splitter VectorImageToImageList-Filter containing the desired image
-	 * @param filename The path to write the image to
-	 * @param index The index of the image list. It is not checked, whether the index exists - An error will be thrown by ITK in this case
-	 * @return True, if writing succeeded.
+	 * @brief Add a band of the composite product to the writer
+	 * @param writer The writer of all bands of the composite product
+	 * @param index The index of the band inside the composite product
+	 * @param filename The final output filename
+	 * @param bIsMask True, if the band is a mask. The creation options of the I/O profile depend on it.
+	 * @note Cloud-Optimized GeoTiffs are written in-process, their overviews are built while the band is written
 	 */
-	template<typename ExtractorType>
-	bool writeExtractedImage(typename ExtractorType::Pointer splitter, const std::string &filename, const size_t &index){
-		typedef otb::ImageFileWriter<typename ExtractorType::OutputImageType> WriterType;
-		typename WriterType::Pointer writer = WriterType::New();
-		writer->SetInput(splitter->GetOutput()->GetNthElement(index));
-		writer->SetFileName(filename);
-
-		writer->Update();
-		return true;
+	template<typename TOutputValue>
+	void addBandToWriter(MultiBandWriterType::Pointer writer, const size_t &index, const std::string &filename, const bool &bIsMask){
+		if(m_cog){
+			GeoTiffConfig_t geo;
+			geo.initToDefaultValues(m_cogtemp, bIsMask);
+			writer->AddCoGeoTiffBand<TOutputValue>(index, filename, geo.toWriterOptions());
+		}else{
+			writer->AddBand<TOutputValue>(index, filename + GetIOProfileExtendedFilename(m_ioProfile, bIsMask));
+		}
 	}
 
 	/**
-	 * @brief Extract an image and write it to the given filename as CO-GeoTiff
-	 * @param splitter VectorImageToImageList-Filter containing the desired image
-	 * @param filename The path to write the image to
-	 * @param index The index of the image list. It is not checked, whether the index exists - An error will be thrown by ITK in this case
-	 * @return True, if writing succeeded.
-	 * @note Writes the image two times: Once for creating the overviews to temp-dir and second as the final output
+	 * @brief Get the compression of the rasters for the metadata
+	 * @param bIsMask True, if the raster is a mask
+	 * @return The GDAL name of the compression, or "None"
 	 */
-	template<typename ExtractorType>
-	bool writeExtractedImageCoGeoTiff(typename ExtractorType::Pointer splitter, const std::string &temp,
-			const std::string &filename, const size_t &index){
-		typedef otb::ImageFileWriter<typename ExtractorType::OutputImageType> WriterType;
-		typename WriterType::Pointer writer = WriterType::New();
-		writer->SetInput(splitter->GetOutput()->GetNthElement(index));
-		std::string tempName = temp + "/tempGeotiff.tif";
-		writer->SetFileName(tempName + CoG_TRANSLATE_PREPARE);
-		writer->Update();
-		GeoTiffConfig_t geo;
-		geo.initToDefaultValues(tempName); //Init gdaladdo config
-		std::vector<std::string> addoGenerator = geo.toString();
-		if(!ExecuteExternalProgram(GDAL_ADDO, addoGenerator)){
-			itkExceptionMacro("Error when executing " << GDAL_ADDO);
-		}
-		std::vector<std::string> cogGenerator = {tempName, filename};
-		std::vector<std::string> cogGeneratorConfig = geo.getTranslateConfig();
-		std::move(cogGenerator.begin(), cogGenerator.end(), std::back_inserter(cogGeneratorConfig));
+	std::string getCompressionName(const bool &bIsMask);
 
-		if(!ExecuteExternalProgram(GDAL_TRANSLATE, cogGeneratorConfig)){
-			itkExceptionMacro("Error when executing " << GDAL_TRANSLATE);
-		}
-		//remove tempfile
-		remove(tempName.c_str());
+	/**
+	 * @brief Write all bands added to the writer, reading the composite product only once
+	 * @param writer The writer of all bands of the composite product
+	 * @return True, if writing succeeded.
+	 */
+	bool writeBands(MultiBandWriterType::Pointer writer);
 
-		return true;
-	}
+	/**
+	 * @brief Set the geopositioning of a band group to the extent of its raster, if it covers less than the L2A products,
+	 * e.g. if the synthesis was restricted to a region of interest
+	 * @param groupID The ID of the group, e.g. R1 or XS
+	 * @param image The composite product of the group
+	 */
+	void updateGroupPositioning(const std::string &groupID, ShortVectorImageType *image);
 
 	/**
 	 * @brief Copy File from source to destination
@@ -245,14 +263,11 @@ protected:
 	bool createAllFolders(const std::string &strMainFolderPath);
 
 	/**
-	 * @brief Count Cloudy, Snowy pixels in the L3-Product
-	 * @param image The input FLG-image
-	 * @param cloudCounter Counter for clouds
-	 * @param snowCounter Counter for snow
-	 * @param fullCounter Counter for the full image
-	 * @return True, if the counting succeeded.
+	 * @brief Get the share of each flag in the L3-Product
+	 * @param histogram The histogram of the FLG-image, filled while it was written
+	 * @return One <Flag>Percent quality index per value of the FLG-image: NoData, Cloud, Snow, Water, Land, CloudShadow and Saturation
 	 */
-	bool countSpecialPixels(ByteImageType::Pointer image, uint64_t &cloudCounter, uint64_t &snowCounter, uint64_t &fullCounter);
+	std::vector<MuscateQualityIndex> getFlagStatistics(const BandHistogram &histogram);
 
 	/**
 	 * @brief determines the BandGlobalList depending on which mission was chosen
@@ -275,22 +290,22 @@ protected:
 	bool copyGIPPFile(const std::string &gippPathIn);
 
 	/**
-	 * @brief Creates Quicklook using the otbApp from an RGB image
-	 * @param rasterFullFilePath The input RGB image with band order Ch1=Red,Ch2=Green,Ch3=Blue
+	 * @brief Add the Quicklook to the writer of the composite product, so that it is decimated while the bands are written
+	 * @param writer The writer of all bands of the composite product
 	 * @param jpegFilename The output filename for the jpeg. The full path is prepended in this function
+	 * @param bandIDs The IDs (starting at 1) of the composite bands to be used, in the order red, green, blue
 	 * @param offset the offset of the bandIDs
-	 * @param bandIDs The IDs of the bands to be used
-	 * @return Bool True, if the creation succeeded, false if not
+	 * @return Bool True, if the Quicklook could be added, false if not
 	 */
-	bool generateQuicklook(const std::string &rasterFullFilePath, const std::string &jpegFilename, const std::vector<int> &bandIDs, const int &offset);
+	bool addQuicklookToWriter(MultiBandWriterType::Pointer writer, const std::string &jpegFilename, const std::vector<int> &bandIDs, const int &offset);
 
 	/**
 	 * @brief Generates the metadata file for the output product in Muscate Unified format
 	 * @param strProductMetadataFilePath The path where the metadata file shall be written to
-	 * @param cloudPercent The percentage of clouds in the image
+	 * @param qualityIndexes The global quality indexes of the product
 	 * @return void - Writes Metadata inside the product folder, named {}_MTD_ALL.xml
 	 */
-	virtual void generateMetadataFile(const std::string &strProductMetadataFilePath, const std::string &cloudPercent, const std::string &snowPercent) = 0;
+	virtual void generateMetadataFile(const std::string &strProductMetadataFilePath, const std::vector<MuscateQualityIndex> &qualityIndexes) = 0;
 
 	std::vector<std::string> m_products;
 	versionType m_version;
@@ -298,6 +313,7 @@ protected:
 	std::vector<std::string> m_xml;
 	std::string m_cogtemp;
 	bool m_cog;
+	std::string m_ioProfile;
 
 	//Synthesis period informations
 	std::string m_syntDate;
@@ -305,9 +321,12 @@ protected:
 	std::string m_syntPeriodEnd;
 	//The main metadata file
 	MuscateFileMetadata m_productMetadata;
+	RegionOfInterestExtractor m_RegionOfInterest;
+	PerformanceTelemetry *m_telemetry;
+	itk::Logger *m_logger;
 	size_t m_totalRes;
 	//ImgInformation about each of the masks/images to be set in the metadata.
-	//These vec's are filled in the copyRaster method
+	//These vec's are filled in the addRaster method
 	std::vector<ImageInformation> m_FRCs;
 	std::vector<ImageInformation> m_FLGs;
 	std::vector<ImageInformation> m_WGTs;
@@ -83,15 +83,18 @@ private:
 	std::string BuildFileNameSentinel(const std::string &datetime, const std::string &productType, const std::string &productVersion);
 
 	/**
-	 * @brief Copy raster files and create metadata-info for each
-	 * @param raster The raster input name
-	 * @param rasterTypes The type of raster file to be copied (See rasterTypes enum)
+	 * @brief Add a band of the composite product to the writer and create the metadata-info for it
+	 * @param writer The writer of all bands of the composite product
+	 * @param index The index of the band inside the composite product
+	 * @param rasterType The type of raster file to be written (See rasterTypes enum)
+	 * @param resolution The band or resolution the raster belongs to
 	 * @param bIsMask True if it's a mask file, false if not
-	 * @note If copying fails, the metadata info is also not created
-	 * @return true, if both copying and metadata creating succeeded, false if not
+	 * @tparam TOutputValue The pixel type of the written raster
+	 * @return true, if the metadata-info could be created, false if not
+	 * @note The raster itself is only written by writeBands()
 	 */
-	template<typename ExtractorType>
-	bool copyRaster(typename ExtractorType::Pointer splitter, const size_t &index,
+	template<typename TOutputValue>
+	bool addRaster(MultiBandWriterType::Pointer writer, const size_t &index,
 			const rasterTypes &rasterType, resolutionTypesS2 resolution, const bool &bIsMask);
 
 	/**
@@ -103,10 +106,10 @@ private:
 	/**
 	 * @brief Generates the metadata file for the output product in Muscate Unified format
 	 * @param strProductMetadataFilePath The path where the metadata file shall be written to
-	 * @param cloudPercent The percentage of clouds in the image
+	 * @param qualityIndexes The global quality indexes of the image, e.g. the percentage of clouds
 	 * @return void - Writes Metadata inside the product folder, named {}_MTD_ALL.xml
 	 */
-	virtual void generateMetadataFile(const std::string &strProductMetadataFilePath, const std::string &cloudPercent = "1", const std::string &snowPercent = "1");
+	virtual void generateMetadataFile(const std::string &strProductMetadataFilePath, const std::vector<MuscateQualityIndex> &qualityIndexes);
 };
 } /* namespace ts */
 
@@ -28,12 +28,19 @@
 #ifndef PRODUCTFORMATTER_INCLUDE_PRODUCTDEFINITIONS_H_
 #define PRODUCTFORMATTER_INCLUDE_PRODUCTDEFINITIONS_H_
 
+#include "GlobalDefs.h"
+#include "CoGeoTiffWriter.h"
+#include "IOProfiles.h"
+#include "itkMacro.h"
+#include <string>
+
 #define DEFAULT_PRODUCT_VERSION					"0-8"
 #define PRODUCT_DISTRIBUTION_FLAG				"C"
-#define CLOUD_INDEX								1
-#define SNOW_INDEX								2
 #define S2_RESOLUTION_R1						10
 #define S2_RESOLUTION_R2						20
+#define QUICKLOOK_SIZE							1000
+#define QUICKLOOK_SCALE_MIN						0
+#define QUICKLOOK_SCALE_MAX						3000
 
 /**
  * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
@@ -115,55 +122,71 @@ typedef enum{
 /// CO-GeoTiff Config ///
 ////////////////////////
 
-#define GDAL_ADDO					"gdaladdo"
-#define GDAL_TRANSLATE				"gdal_translate"
-#define CoG_TRANSLATE_PREPARE		"?&gdal:co:TILED=YES&gdal:co:COMPRESS=DEFLATE"
-
 /**
  * @brief Struct to store the Geotiff config for all rasters
  */
 struct GeoTiffConfig_t{
 	std::string resamplingMethod;
-	std::string filename;
-	std::vector<size_t> levels;
-	std::string tiled;
+	std::string tempDir;
+	size_t nLevels;
 	std::string compress;
-	std::string copySrcOverviews;
-	bool quiet;
+	bool bHasNoData;
+	CreationOptionsType creationOptions;
 	/**
 	 * @brief Init the struct to the default values according to the GeoTiff-Doc
+	 * @param dir Directory of the intermediate files. If empty, they are written next to the final files.
+	 * @param bIsMask True, if the band is a mask. Masks are averaged and carry the no-data value like all bands,
+	 * only the creation options of the I/O profile depend on it.
 	 * @note Doc can be found under https://trac.osgeo.org/gdal/wiki/CloudOptimizedGeoTIFF#Performancetesting
 	 */
-	void initToDefaultValues(const std::string &f){
+	void initToDefaultValues(const std::string &dir, const bool &bIsMask){
 		resamplingMethod = "average";
-		levels = {2,4,8,16,32};
-		filename = f;
-		tiled = "YES";
+		tempDir = dir;
+		nLevels = 5; // Levels 2, 4, 8, 16 and 32
 		compress = "DEFLATE";
-		copySrcOverviews = "YES";
+		bHasNoData = true;
+		creationOptions = GetIOProfileCreationOptions(IO_PROFILE_COG, bIsMask);
 	}
 
 	/**
-	 * @brief Create config to be used with gdaladdo
-	 * @return Vector containing string of current values
+	 * @brief Create the config to be used with the CoGeoTiffWriter
+	 * @return The options of the writer
 	 */
-	std::vector<std::string> toString(){
-		std::vector<std::string> str {"-r", resamplingMethod, filename};
-		for(auto level : levels){
-			str.push_back(std::to_string(level));
-		}
-		str.push_back("-q");
-		return str;
+	CoGeoTiffWriter::Options toWriterOptions() const{
+		CoGeoTiffWriter::Options options;
+		options.tempDir = tempDir;
+		options.nLevels = nLevels;
+		options.compress = compress;
+		options.resamplingMethod = resamplingMethod;
+		options.bHasNoData = bHasNoData;
+		options.noDataValue = NO_DATA_VALUE;
+		options.creationOptions = creationOptions;
+		return options;
 	}
+};
 
-	/**
-	 * @brief Return the config for gdal_translate
-	 * @return Vector containing the config strings
-	 */
-	std::vector<std::string> getTranslateConfig(){
-		return {"-co", "TILED=" + tiled, "-co", "COPY_SRC_OVERVIEWS=" + copySrcOverviews, "-co", "COMPRESS=" + compress, "-a_nodata", NO_DATA_VALUE_STR, "-q"};
+/**
+ * @brief Select the bands of a single synthesis in a product containing several of them one after the other
+ * @param product The filename of the product
+ * @param nBands The number of bands of the product
+ * @param synthesis The index of the synthesis
+ * @param nSyntheses The number of syntheses in the product
+ * @return The filename with the band range of the synthesis as reader option, unchanged if empty
+ */
+inline std::string getSynthesisBands(const std::string &product, int nBands, int synthesis, int nSyntheses){
+	if(product.empty()){
+		return product;
 	}
-};
+	if(synthesis < 0 || synthesis >= nSyntheses){
+		itkGenericExceptionMacro("Synthesis " << synthesis << " out of range for " << nSyntheses << " syntheses");
+	}
+	if(nBands % nSyntheses != 0){
+		itkGenericExceptionMacro("The " << nBands << " bands of " << product << " cannot be split into " << nSyntheses << " syntheses");
+	}
+	const int nSynthesisBands = nBands / nSyntheses;
+	const std::string separator = product.find('?') == std::string::npos ? "?&" : "&";
+	return product + separator + "bands=" + std::to_string(synthesis * nSynthesisBands + 1) + ":" + std::to_string((synthesis + 1) * nSynthesisBands);
+}
 
 } /* namespace ts */
 
@@ -32,8 +32,12 @@
 #include <sys/time.h>
 #include <spawn.h>
 #include <fstream>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
 #include "itkImageRegionConstIterator.h"
 #include "itkImageFileWriter.h"
+#include "otbWrapperMacros.h"
 
 using namespace ts;
 
@@ -96,18 +100,51 @@ bool ProductCreatorAdapter::mkPath(const std::string &path) {
 	boost::filesystem::create_directories(path, ec);
 	return !ec;
 }
-/*
-template<typename ExtractorType>
-bool ProductCreatorAdapter::writeExtractedImage(typename ExtractorType::Pointer splitter, const std::string &filename, const size_t &index){
-	typedef otb::ImageFileWriter<typename ExtractorType::OutputImageType> WriterType;
-	typename WriterType::Pointer writer = WriterType::New();
-	writer->SetInput(splitter->GetOutput()->GetNthElement(index));
-	writer->SetFileName(filename);
 
+std::string ProductCreatorAdapter::getCompressionName(const bool &bIsMask){
+	const std::string profile = m_cog ? std::string(IO_PROFILE_COG) : m_ioProfile;
+	for(const auto &option : GetIOProfileCreationOptions(profile, bIsMask)){
+		if(option.first == "COMPRESS" && option.second != "NONE"){
+			return option.second;
+		}
+	}
+	return "None";
+}
+
+bool ProductCreatorAdapter::writeBands(MultiBandWriterType::Pointer writer){
+	std::cout << "Writing " << writer->GetNumberOfBands() << " bands of the composite product" << std::endl;
+	writer->SetLogger(m_logger);
+	if(m_telemetry != NULL){
+		for(const std::string &filename : writer->GetFileNames()){
+			m_telemetry->AddOutput("product", filename, const_cast<MultiBandWriterType::InputImageType*>(writer->GetInput()));
+		}
+		m_telemetry->WatchWriter(writer);
+	}
 	writer->Update();
 	return true;
 }
- */
+
+void ProductCreatorAdapter::updateGroupPositioning(const std::string &groupID, ShortVectorImageType *image){
+	image->UpdateOutputInformation();
+	const ShortVectorImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
+	for(GroupPositioning &group : m_productMetadata.GeopositionInformations.GroupPosition){
+		if(group.groupID != groupID || (group.ncols == std::to_string(size[0]) && group.nrows == std::to_string(size[1]))){
+			continue;
+		}
+		// The origin is the centre of the upper left pixel, the YDIM is negative for north-up rasters
+		std::ostringstream ulx, uly;
+		ulx.precision(12);
+		uly.precision(12);
+		ulx << image->GetOrigin()[0] - std::stod(group.XDim) / 2;
+		uly << image->GetOrigin()[1] - std::stod(group.YDim) / 2;
+		std::cout << "Group " << groupID << " restricted to " << size[0] << "x" << size[1] << " pixels at " << ulx.str() << " " << uly.str() << std::endl;
+		group.ULX = ulx.str();
+		group.ULY = uly.str();
+		group.ncols = std::to_string(size[0]);
+		group.nrows = std::to_string(size[1]);
+	}
+}
+
 bool ProductCreatorAdapter::CopyFile(const std::string &strDest, const std::string &strSrc) {
 	struct stat buf;
 	if (stat(strSrc.c_str(), &buf) != -1) {
@@ -189,22 +226,25 @@ bool ProductCreatorAdapter::createAllFolders(const std::string &strMainFolderPat
 	return bResult;
 }
 
-bool ProductCreatorAdapter::countSpecialPixels(ByteImageType::Pointer image, uint64_t &cloudCounter, uint64_t &snowCounter, uint64_t &fullCounter){
-	image->Update();
-	itk::ImageRegionConstIterator<ByteImageType> MyIt(image,image->GetLargestPossibleRegion());
-	MyIt.GoToBegin();
-	while (!MyIt.IsAtEnd()) {
-		fullCounter += 1;
-		ByteImageType::PixelType pixel = MyIt.Get();
-		if (pixel == CLOUD_INDEX) {
-			cloudCounter+=1;
-		}
-		if (pixel == SNOW_INDEX) {
-			snowCounter +=1;
+std::vector<MuscateQualityIndex> ProductCreatorAdapter::getFlagStatistics(const BandHistogram &histogram){
+	// Named after the values of the FLG mask, CloudPercent and SnowPercent keep their former meaning
+	const std::vector<std::pair<FlagType, std::string> > flags = {
+			{IMG_FLG_NO_DATA, "NoData"},
+			{IMG_FLG_CLOUD, "Cloud"},
+			{IMG_FLG_SNOW, "Snow"},
+			{IMG_FLG_WATER, "Water"},
+			{IMG_FLG_LAND, "Land"},
+			{IMG_FLG_CLOUD_SHADOW, "CloudShadow"},
+			{IMG_FLG_SATURATION, "Saturation"}};
+	std::vector<MuscateQualityIndex> indexes;
+	for(const std::pair<FlagType, std::string> &flag : flags){
+		const double percent = histogram.GetPercent(flag.first);
+		if(GetLogger()){
+			otbAppLogDEBUG("Amount of " << flag.second << " in the final image: " << std::fixed << std::setprecision(3) << percent << "%");
 		}
-		++MyIt;
+		indexes.emplace_back(flag.second + "Percent", std::to_string(int(std::round(percent))));
 	}
-	return true;
+	return indexes;
 }
 
 bool ProductCreatorAdapter::copyGIPPFile(const std::string &gippPathIn){
@@ -243,34 +283,17 @@ BandList ProductCreatorAdapter::getBandGlobalList(const std::vector<BandInformat
 	return result;
 }
 
-bool ProductCreatorAdapter::generateQuicklook(const std::string &rasterFullFilePath, const std::string &jpegFilename, const std::vector<int> &bandIDs, const int &offset){
+bool ProductCreatorAdapter::addQuicklookToWriter(MultiBandWriterType::Pointer writer, const std::string &jpegFilename, const std::vector<int> &bandIDs, const int &offset){
 	std::string jpegFullFilePath = m_strProductFullPathOut + "/" + jpegFilename;
-	std::vector<std::string> args;
 
 	if(bandIDs.size() != 3){
 		itkWarningMacro("WARNING: Quicklook does not contain three bands")
 	}
-	for(size_t i = 0; i < bandIDs.size(); i++){
-		args.emplace_back("-b");
-		args.emplace_back(std::to_string(bandIDs[i]));
+	std::vector<unsigned int> bands;
+	for(auto bandID : bandIDs){
+		bands.push_back(bandID - 1);
 	}
-	args.emplace_back("-ot");
-	args.emplace_back("Byte");
-	args.emplace_back("-of");
-	args.emplace_back("JPEG");
-	args.emplace_back("-scale");
-	args.emplace_back("0");
-	args.emplace_back("3000");
-	args.emplace_back("0");
-	args.emplace_back("255");
-	args.emplace_back("-outsize");
-	args.emplace_back("1000");
-	args.emplace_back("1000");
-	args.emplace_back("-q");
-	args.emplace_back(rasterFullFilePath);
-	args.emplace_back(jpegFullFilePath);
-
-	bool bRet = ExecuteExternalProgram("gdal_translate", args);
+	writer->AddQuicklook(bands, jpegFullFilePath, QUICKLOOK_SIZE, QUICKLOOK_SIZE, QUICKLOOK_SCALE_MIN, QUICKLOOK_SCALE_MAX, NO_DATA_VALUE);
 	ImageInformation quicklook;
 	quicklook.hasBandNum = false;
 	quicklook.hasBitNum = false;
@@ -282,8 +305,5 @@ bool ProductCreatorAdapter::generateQuicklook(const std::string &rasterFullFileP
 	quicklook.isMask = false;
 	quicklook.path = jpegFilename;
 	m_productMetadata.ProductOrganisation.Quicklook = quicklook; //Attach to main metadata file
-	//remove file with extension .jpg.aux.xml generated after preview obtained
-	std::string strFileToBeRemoved = jpegFullFilePath + ".aux.xml";
-	remove(strFileToBeRemoved.c_str());
-	return bRet;
+	return true;
 }
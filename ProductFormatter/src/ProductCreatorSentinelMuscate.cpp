@@ -75,23 +75,27 @@ bool ProductCreatorSentinelMuscate::createProduct(const std::string &destination
 	/// R1 ///
 	/////////
 
+	//All bands of a resolution are written in a single pass over the UpdateSynthesis raster
 	ShortVectorImageReaderType::Pointer readerR1 = ShortVectorImageReaderType::New();
 	readerR1->SetFileName(productr1);
-	ShortVectorImageType::Pointer reflsImgR1 = readerR1->GetOutput();
-
-	ExtractRasterType::Pointer splitterReflsR1 = ExtractRasterType::New();
-	ExtractMaskType::Pointer splitterMasksR1 = ExtractMaskType::New();
-	splitterReflsR1->SetInput(reflsImgR1);
-	splitterReflsR1->UpdateOutputInformation();
-	splitterMasksR1->SetInput(reflsImgR1);
-	splitterMasksR1->UpdateOutputInformation();
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR1, 0, COMPOSITE_WEIGHTS_RASTER, S2_R1, true);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR1, 1, COMPOSITE_DATES_MASK, S2_R1, true);
-	bDirStructBuiltOk = copyRaster<ExtractMaskType>(splitterMasksR1, 2, COMPOSITE_FLAGS_MASK, S2_R1, true);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR1, 3, COMPOSITE_REFLECTANCE_RASTER, S2_B2, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR1, 4, COMPOSITE_REFLECTANCE_RASTER, S2_B3, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR1, 5, COMPOSITE_REFLECTANCE_RASTER, S2_B4, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR1, 6, COMPOSITE_REFLECTANCE_RASTER, S2_B8, false);
+	ShortVectorImageType::Pointer compositeR1 = m_RegionOfInterest.Extract(readerR1->GetOutput());
+	updateGroupPositioning("R1", compositeR1);
+	MultiBandWriterType::Pointer writerR1 = MultiBandWriterType::New();
+	writerR1->SetInput(compositeR1);
+	writerR1->SetAlignedInputFileNames({productr1}, m_RegionOfInterest.GetRegionOfInterest());
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR1, 0, COMPOSITE_WEIGHTS_RASTER, S2_R1, true);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR1, 1, COMPOSITE_DATES_MASK, S2_R1, true);
+	bDirStructBuiltOk = addRaster<BytePixelType>(writerR1, 2, COMPOSITE_FLAGS_MASK, S2_R1, true);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR1, 3, COMPOSITE_REFLECTANCE_RASTER, S2_B2, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR1, 4, COMPOSITE_REFLECTANCE_RASTER, S2_B3, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR1, 5, COMPOSITE_REFLECTANCE_RASTER, S2_B4, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR1, 6, COMPOSITE_REFLECTANCE_RASTER, S2_B8, false);
+	//Quicklook - Decimated from the RGB bands while they are written
+	std::string quicklookPath = m_strProductDirectoryName + "_" + QUICKLOOK_SUFFIX + JPEG_EXTENSION;
+	std::vector<int> s2RGBBands = {6,5,4};
+	int offset = 2;
+	bDirStructBuiltOk = addQuicklookToWriter(writerR1, quicklookPath, s2RGBBands, offset);
+	bDirStructBuiltOk = writeBands(writerR1);
 
 	///////////
 	/// R2 ///
@@ -99,47 +103,30 @@ bool ProductCreatorSentinelMuscate::createProduct(const std::string &destination
 
 	ShortVectorImageReaderType::Pointer readerR2 = ShortVectorImageReaderType::New();
 	readerR2->SetFileName(productr2);
-	ShortVectorImageType::Pointer reflsImgR2 = readerR2->GetOutput();
-
-	ExtractRasterType::Pointer splitterReflsR2 = ExtractRasterType::New();
-	ExtractMaskType::Pointer splitterMasksR2 = ExtractMaskType::New();
-	splitterReflsR2->SetInput(reflsImgR2);
-	splitterReflsR2->UpdateOutputInformation();
-	splitterMasksR2->SetInput(reflsImgR2);
-	splitterMasksR2->UpdateOutputInformation();
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR2, 0, COMPOSITE_WEIGHTS_RASTER, S2_R2, true);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR2, 1, COMPOSITE_DATES_MASK, S2_R2, true);
-	bDirStructBuiltOk = copyRaster<ExtractMaskType>(splitterMasksR2,   2, COMPOSITE_FLAGS_MASK, S2_R2, true);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR2, 3, COMPOSITE_REFLECTANCE_RASTER, S2_B5, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR2, 4, COMPOSITE_REFLECTANCE_RASTER, S2_B6, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR2, 5, COMPOSITE_REFLECTANCE_RASTER, S2_B7, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsR2, 6, COMPOSITE_REFLECTANCE_RASTER, S2_B8A, false);
-	copyRaster<ExtractRasterType>(splitterReflsR2, 7, COMPOSITE_REFLECTANCE_RASTER, S2_B11, false);
-	copyRaster<ExtractRasterType>(splitterReflsR2, 8, COMPOSITE_REFLECTANCE_RASTER, S2_B12, false);
-
-	//////////////////////////////////
-	/// Count Cloudy/Snowy Pixels ///
-	////////////////////////////////
-
-	uint64_t cloudCounter = 0, snowCounter = 0, fullCounter = 0;
-	size_t maskIndex = 2; //FLG is the third image of the UpdateSynthesis raster
-	bDirStructBuiltOk = countSpecialPixels(splitterMasksR2->GetOutput()->GetNthElement(maskIndex).GetPointer(), cloudCounter, snowCounter, fullCounter);
-	double valCloudPercent = 100.0 * cloudCounter/fullCounter;
-	double valSnowPercent = 100.0 * snowCounter/fullCounter;
-	std::cout.setf(std::ios::fixed,std::ios::floatfield);
-	std::cout.precision(3);
-	std::cout << "Amount of snow   in the final image: " << valSnowPercent << "%" << std::endl;
-	std::cout << "Amount of clouds in the final image: " << valCloudPercent << "%" << std::endl;
-
-	///////////////////////////
-	/// Generate Quicklook ///
-	/////////////////////////
-
-	//Quicklook - Has to be an rgb image cause OTBQuicklook can not take multiple separate images as input
-	std::string quicklookPath = m_strProductDirectoryName + "_" + QUICKLOOK_SUFFIX + JPEG_EXTENSION;
-	std::vector<int> s2RGBBands = {6,5,4};
-	int offset = 2;
-	bDirStructBuiltOk = bDirStructBuiltOk? generateQuicklook(productr1, quicklookPath, s2RGBBands, offset) : false;
+	ShortVectorImageType::Pointer compositeR2 = m_RegionOfInterest.Extract(readerR2->GetOutput());
+	updateGroupPositioning("R2", compositeR2);
+	MultiBandWriterType::Pointer writerR2 = MultiBandWriterType::New();
+	writerR2->SetInput(compositeR2);
+	writerR2->SetAlignedInputFileNames({productr2}, m_RegionOfInterest.GetRegionOfInterest());
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR2, 0, COMPOSITE_WEIGHTS_RASTER, S2_R2, true);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR2, 1, COMPOSITE_DATES_MASK, S2_R2, true);
+	bDirStructBuiltOk = addRaster<BytePixelType>(writerR2, 2, COMPOSITE_FLAGS_MASK, S2_R2, true);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR2, 3, COMPOSITE_REFLECTANCE_RASTER, S2_B5, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR2, 4, COMPOSITE_REFLECTANCE_RASTER, S2_B6, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR2, 5, COMPOSITE_REFLECTANCE_RASTER, S2_B7, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerR2, 6, COMPOSITE_REFLECTANCE_RASTER, S2_B8A, false);
+	addRaster<ShortPixelType>(writerR2, 7, COMPOSITE_REFLECTANCE_RASTER, S2_B11, false);
+	addRaster<ShortPixelType>(writerR2, 8, COMPOSITE_REFLECTANCE_RASTER, S2_B12, false);
+	//The flags are counted while they are written
+	BandHistogram::Pointer flagHistogram = std::make_shared<BandHistogram>(IMG_FLG_SATURATION + 1);
+	writerR2->AddHistogram(2, flagHistogram);
+	bDirStructBuiltOk = writeBands(writerR2);
+
+	//////////////////////////
+	/// Flag Statistics ///
+	////////////////////////
+
+	std::vector<MuscateQualityIndex> flagStatistics = getFlagStatistics(*flagHistogram);
 
 	if(m_gipp.empty() == false){
 		bDirStructBuiltOk = bDirStructBuiltOk? copyGIPPFile(m_gipp) : false;
@@ -148,9 +135,7 @@ bool ProductCreatorSentinelMuscate::createProduct(const std::string &destination
 	if(bDirStructBuiltOk)
 	{
 		const std::string strMetadataFileName = m_strProductFullPathOut + "/" + m_strProductDirectoryName + "_" + METADATA_CATEG + XML_EXTENSION;
-		std::string cloudPercent = std::to_string(int(std::round(valCloudPercent)));
-		std::string snowPercent = std::to_string(int(std::round(valSnowPercent)));
-		generateMetadataFile(strMetadataFileName, cloudPercent, snowPercent);
+		generateMetadataFile(strMetadataFileName, flagStatistics);
 		std::cout << "Successfully created the L3A product" << std::endl;
 		return true;
 	}
@@ -254,8 +239,8 @@ std::string ProductCreatorSentinelMuscate::BuildFileNameSentinel(const std::stri
 }
 
 
-template<typename ExtractorType>
-bool ProductCreatorSentinelMuscate::copyRaster(typename ExtractorType::Pointer splitter, const size_t &index,
+template<typename TOutputValue>
+bool ProductCreatorSentinelMuscate::addRaster(MultiBandWriterType::Pointer writer, const size_t &index,
 		const rasterTypes &rasterType, resolutionTypesS2 resolution, const bool &bIsMask){
 
 	std::unordered_map<int, std::string> rasterNameMap = {
@@ -282,76 +267,65 @@ bool ProductCreatorSentinelMuscate::copyRaster(typename ExtractorType::Pointer s
 			bandType[resolution] +
 			TIF_EXTENSION;
 	std::string maskFullPathOut = m_strProductFullPathOut + "/" + filename;
-	std::cout << "Writing " << maskFullPathOut << std::endl;
-	bool copied = false;
-	if(m_cog){
-		copied = writeExtractedImageCoGeoTiff<ExtractorType>(splitter, m_cogtemp, maskFullPathOut, index);
-	}else{
-		copied = writeExtractedImage<ExtractorType>(splitter,
-				maskFullPathOut + (bIsMask ? "?&gdal:co:COMPRESS=DEFLATE" : ""),
-				index);
+	std::cout << "Adding " << maskFullPathOut << std::endl;
+	addBandToWriter<TOutputValue>(writer, index, maskFullPathOut, bIsMask);
+	//create Metadatafile
+	switch(rasterType){
+	case COMPOSITE_REFLECTANCE_RASTER:
+	{
+		ImageInformation imageFile;
+		imageFile.hasBandNum = false;
+		imageFile.hasBitNum = false;
+		imageFile.hasDetectorID = false;
+		imageFile.isMask = false;
+		imageFile.isGroup = false;
+		imageFile.bandIDs = bandType[resolution];
+		imageFile.path = filename;
+		m_FRCs.emplace_back(imageFile);
+		return true;
 	}
-	if(copied){
-		//create Metadatafile
-		switch(rasterType){
-		case COMPOSITE_REFLECTANCE_RASTER:
-		{
-			ImageInformation imageFile;
-			imageFile.hasBandNum = false;
-			imageFile.hasBitNum = false;
-			imageFile.hasDetectorID = false;
-			imageFile.isMask = false;
-			imageFile.isGroup = false;
-			imageFile.bandIDs = bandType[resolution];
-			imageFile.path = filename;
-			m_FRCs.emplace_back(imageFile);
-			return true;
-		}
-		case COMPOSITE_DATES_MASK:
-		{
-			ImageInformation imageFile;
-			imageFile.hasBandNum = false;
-			imageFile.hasBitNum = false;
-			imageFile.hasDetectorID = false;
-			imageFile.isMask = false;
-			imageFile.isGroup = true;
-			imageFile.bandIDs = bandType[resolution];
-			imageFile.path = filename;
-			m_DTSs.emplace_back(imageFile);
-			return true;
-		}
-		case COMPOSITE_FLAGS_MASK:
-		{
-			ImageInformation imageFile;
-			imageFile.hasBandNum = false;
-			imageFile.hasBitNum = false;
-			imageFile.hasDetectorID = false;
-			imageFile.isMask = false;
-			imageFile.isGroup = true;
-			imageFile.bandIDs = bandType[resolution];
-			imageFile.path = filename;
-			m_FLGs.emplace_back(imageFile);
-			return true;
-		}
-		case COMPOSITE_WEIGHTS_RASTER:
-		{
-			ImageInformation imageFile;
-			imageFile.hasBandNum = false;
-			imageFile.hasBitNum = false;
-			imageFile.hasDetectorID = false;
-			imageFile.isMask = false;
-			imageFile.isGroup = true;
-			imageFile.bandIDs = bandType[resolution];
-			imageFile.path = filename;
-			m_WGTs.emplace_back(imageFile);
-			return true;
-		}
-		default:
-			itkExceptionMacro("Unkown Raster Type found: " << rasterNameMap[rasterType]);
-		}
+	case COMPOSITE_DATES_MASK:
+	{
+		ImageInformation imageFile;
+		imageFile.hasBandNum = false;
+		imageFile.hasBitNum = false;
+		imageFile.hasDetectorID = false;
+		imageFile.isMask = false;
+		imageFile.isGroup = true;
+		imageFile.bandIDs = bandType[resolution];
+		imageFile.path = filename;
+		m_DTSs.emplace_back(imageFile);
+		return true;
+	}
+	case COMPOSITE_FLAGS_MASK:
+	{
+		ImageInformation imageFile;
+		imageFile.hasBandNum = false;
+		imageFile.hasBitNum = false;
+		imageFile.hasDetectorID = false;
+		imageFile.isMask = false;
+		imageFile.isGroup = true;
+		imageFile.bandIDs = bandType[resolution];
+		imageFile.path = filename;
+		m_FLGs.emplace_back(imageFile);
+		return true;
+	}
+	case COMPOSITE_WEIGHTS_RASTER:
+	{
+		ImageInformation imageFile;
+		imageFile.hasBandNum = false;
+		imageFile.hasBitNum = false;
+		imageFile.hasDetectorID = false;
+		imageFile.isMask = false;
+		imageFile.isGroup = true;
+		imageFile.bandIDs = bandType[resolution];
+		imageFile.path = filename;
+		m_WGTs.emplace_back(imageFile);
+		return true;
+	}
+	default:
+		itkExceptionMacro("Unkown Raster Type found: " << rasterNameMap[rasterType]);
 	}
-	itkWarningMacro("Error creating metadata info for " << filename);
-
 	return false;
 }
 
@@ -381,7 +355,7 @@ std::vector<BandGroup> ProductCreatorSentinelMuscate::getBandGroupList(const std
 
 }
 
-void ProductCreatorSentinelMuscate::generateMetadataFile(const std::string &strProductMetadataFilePath, const std::string &cloudPercent, const std::string &snowPercent){
+void ProductCreatorSentinelMuscate::generateMetadataFile(const std::string &strProductMetadataFilePath, const std::vector<MuscateQualityIndex> &qualityIndexes){
 	auto writer = ts::muscate::MuscateMetadataWriter::New();
 
 	//Header
@@ -422,21 +396,20 @@ void ProductCreatorSentinelMuscate::generateMetadataFile(const std::string &strP
 	m_productMetadata.ProductCharacteristics.BandGroupList = getBandGroupList(m_productMetadata.RadiometricInformations.Bands);
 
 	ImageProperty frc;
-	frc.Compression = "None";
+	frc.Compression = getCompressionName(false);
 	frc.Encoding = "int16";
 	frc.Endianness = "LittleEndian";
 	frc.Format = "image/tiff";
 	frc.Nature = "Flat_Reflectance_Composite";
 	frc.hasCompression = true;
 	if(m_cog){
-		frc.Compression = "DEFLATE";
 		frc.Description = "CloudOptimized-GeoTiff";
 	}
 	frc.ImageFiles = m_FRCs;
 	m_productMetadata.ProductOrganisation.ImageProperties.emplace_back(frc);
 	ImageProperty dts;
 	dts.hasCompression = true;
-	dts.Compression = "DEFLATE";
+	dts.Compression = getCompressionName(true);
 	dts.Nature = "Weighted_Average_Dates";
 	dts.Format = "image/tiff";
 	dts.Endianness = "LittleEndian";
@@ -448,7 +421,7 @@ void ProductCreatorSentinelMuscate::generateMetadataFile(const std::string &strP
 	m_productMetadata.ProductOrganisation.MaskProperties.emplace_back(dts);
 	ImageProperty wgt;
 	wgt.hasCompression = true;
-	wgt.Compression = "DEFLATE";
+	wgt.Compression = getCompressionName(true);
 	wgt.Nature = "Pixel_Weight";
 	wgt.Format = "image/tiff";
 	wgt.Endianness = "LittleEndian";
@@ -460,7 +433,7 @@ void ProductCreatorSentinelMuscate::generateMetadataFile(const std::string &strP
 	m_productMetadata.ProductOrganisation.MaskProperties.emplace_back(wgt);
 	ImageProperty flg;
 	flg.hasCompression = true;
-	flg.Compression = "DEFLATE";
+	flg.Compression = getCompressionName(true);
 	flg.Nature = "Pixel_Status_Flag";
 	flg.Format = "image/tiff";
 	flg.Endianness = "LittleEndian";
@@ -478,7 +451,7 @@ void ProductCreatorSentinelMuscate::generateMetadataFile(const std::string &strP
 	current.AcquisitionDate = m_syntDate;
 	current.ProductionDate = m_currentDateTime;
 	current.ProductID = m_strProductDirectoryName;
-	current.GlobalIndexList = {MuscateQualityIndex("CloudPercent", cloudPercent), MuscateQualityIndex("SnowPercent", snowPercent)};
+	current.GlobalIndexList = qualityIndexes;
 	m_productMetadata.QualityInformations.CurrentProduct = current;
 	writer->WriteMetadata(m_productMetadata, strProductMetadataFilePath);
 
@@ -58,54 +58,42 @@ bool ProductCreatorVenusMuscate::createProduct(const std::string &destination){
 
 	ShortVectorImageReaderType::Pointer readerXS = ShortVectorImageReaderType::New();
 	readerXS->SetFileName(productxs);
-	ShortVectorImageType::Pointer reflsImgXS = readerXS->GetOutput();
-
-	ExtractRasterType::Pointer splitterReflsXS = ExtractRasterType::New();
-	ExtractMaskType::Pointer splitterMasksXS = ExtractMaskType::New();
-	splitterReflsXS->SetInput(reflsImgXS);
-	splitterReflsXS->UpdateOutputInformation();
-	splitterMasksXS->SetInput(reflsImgXS);
-	splitterMasksXS->UpdateOutputInformation();
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 0, COMPOSITE_WEIGHTS_RASTER, VNS_XS, true);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 1, COMPOSITE_DATES_MASK, VNS_XS, true);
-	bDirStructBuiltOk = copyRaster<ExtractMaskType>(splitterMasksXS, 2, COMPOSITE_FLAGS_MASK, VNS_XS, true);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 3, COMPOSITE_REFLECTANCE_RASTER, VNS_B1, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 4, COMPOSITE_REFLECTANCE_RASTER, VNS_B2, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 5, COMPOSITE_REFLECTANCE_RASTER, VNS_B3, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 6, COMPOSITE_REFLECTANCE_RASTER, VNS_B4, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 7, COMPOSITE_REFLECTANCE_RASTER, VNS_B5, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 8, COMPOSITE_REFLECTANCE_RASTER, VNS_B6, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 9, COMPOSITE_REFLECTANCE_RASTER, VNS_B7, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 10, COMPOSITE_REFLECTANCE_RASTER, VNS_B8, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 11, COMPOSITE_REFLECTANCE_RASTER, VNS_B9, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 12, COMPOSITE_REFLECTANCE_RASTER, VNS_B10, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 13, COMPOSITE_REFLECTANCE_RASTER, VNS_B11, false);
-	bDirStructBuiltOk = copyRaster<ExtractRasterType>(splitterReflsXS, 14, COMPOSITE_REFLECTANCE_RASTER, VNS_B12, false);
-
-
-	//////////////////////////////////
-	/// Count Cloudy/Snowy Pixels ///
-	////////////////////////////////
-
-	uint64_t cloudCounter = 0, snowCounter = 0, fullCounter = 0;
-	size_t maskIndex = 2; //FLG is the third image of the UpdateSynthesis raster
-	bDirStructBuiltOk = countSpecialPixels(splitterMasksXS->GetOutput()->GetNthElement(maskIndex).GetPointer(), cloudCounter, snowCounter, fullCounter);
-	double valCloudPercent = 100.0 * cloudCounter/fullCounter;
-	double valSnowPercent = 100.0 * snowCounter/fullCounter;
-	std::cout.setf(std::ios::fixed,std::ios::floatfield);
-	std::cout.precision(3);
-	std::cout << "Amount of snow   in the final image: " << valSnowPercent << "%" << std::endl;
-	std::cout << "Amount of clouds in the final image: " << valCloudPercent << "%" << std::endl;
-
-	///////////////////////////
-	/// Generate Quicklook ///
-	/////////////////////////
-
-	//Quicklook - Has to be an rgb image cause OTBQuicklook can not take multiple separate images as input
+	ShortVectorImageType::Pointer compositeXS = m_RegionOfInterest.Extract(readerXS->GetOutput());
+	updateGroupPositioning("XS", compositeXS);
+	//All bands are written in a single pass over the UpdateSynthesis raster
+	MultiBandWriterType::Pointer writerXS = MultiBandWriterType::New();
+	writerXS->SetInput(compositeXS);
+	writerXS->SetAlignedInputFileNames({productxs}, m_RegionOfInterest.GetRegionOfInterest());
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 0, COMPOSITE_WEIGHTS_RASTER, VNS_XS, true);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 1, COMPOSITE_DATES_MASK, VNS_XS, true);
+	bDirStructBuiltOk = addRaster<BytePixelType>(writerXS, 2, COMPOSITE_FLAGS_MASK, VNS_XS, true);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 3, COMPOSITE_REFLECTANCE_RASTER, VNS_B1, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 4, COMPOSITE_REFLECTANCE_RASTER, VNS_B2, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 5, COMPOSITE_REFLECTANCE_RASTER, VNS_B3, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 6, COMPOSITE_REFLECTANCE_RASTER, VNS_B4, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 7, COMPOSITE_REFLECTANCE_RASTER, VNS_B5, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 8, COMPOSITE_REFLECTANCE_RASTER, VNS_B6, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 9, COMPOSITE_REFLECTANCE_RASTER, VNS_B7, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 10, COMPOSITE_REFLECTANCE_RASTER, VNS_B8, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 11, COMPOSITE_REFLECTANCE_RASTER, VNS_B9, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 12, COMPOSITE_REFLECTANCE_RASTER, VNS_B10, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 13, COMPOSITE_REFLECTANCE_RASTER, VNS_B11, false);
+	bDirStructBuiltOk = addRaster<ShortPixelType>(writerXS, 14, COMPOSITE_REFLECTANCE_RASTER, VNS_B12, false);
+	//Quicklook - Decimated from the RGB bands while they are written
 	std::string quicklookPath = m_strProductDirectoryName + "_" + QUICKLOOK_SUFFIX + JPEG_EXTENSION;
 	std::vector<int> vnsRGBBands = {10,7,6};
 	int offset = 3;
-	bDirStructBuiltOk = bDirStructBuiltOk? generateQuicklook(productxs, quicklookPath, vnsRGBBands, offset) : false;
+	bDirStructBuiltOk = addQuicklookToWriter(writerXS, quicklookPath, vnsRGBBands, offset);
+	//The flags are counted while they are written
+	BandHistogram::Pointer flagHistogram = std::make_shared<BandHistogram>(IMG_FLG_SATURATION + 1);
+	writerXS->AddHistogram(2, flagHistogram);
+	bDirStructBuiltOk = writeBands(writerXS);
+
+	//////////////////////////
+	/// Flag Statistics ///
+	////////////////////////
+
+	std::vector<MuscateQualityIndex> flagStatistics = getFlagStatistics(*flagHistogram);
 
 	if(m_gipp.empty() == false){
 		bDirStructBuiltOk = bDirStructBuiltOk? copyGIPPFile(m_gipp) : false;
@@ -114,9 +102,7 @@ bool ProductCreatorVenusMuscate::createProduct(const std::string &destination){
 	if(bDirStructBuiltOk)
 	{
 		const std::string strMetadataFileName = m_strProductFullPathOut + "/" + m_strProductDirectoryName + "_" + METADATA_CATEG + XML_EXTENSION;
-		std::string cloudPercent = std::to_string(int(std::round(valCloudPercent)));
-		std::string snowPercent = std::to_string(int(std::round(valSnowPercent)));
-		generateMetadataFile(strMetadataFileName, cloudPercent, snowPercent);
+		generateMetadataFile(strMetadataFileName, flagStatistics);
 		std::cout << "Successfully created the L3A product" << std::endl;
 		return true;
 	}
@@ -195,8 +181,8 @@ std::string ProductCreatorVenusMuscate::BuildFileNameVenus(const std::string &da
 	return strFileName;
 }
 
-template<typename ExtractorType>
-bool ProductCreatorVenusMuscate::copyRaster(typename ExtractorType::Pointer splitter, const size_t &index,
+template<typename TOutputValue>
+bool ProductCreatorVenusMuscate::addRaster(MultiBandWriterType::Pointer writer, const size_t &index,
 		const rasterTypes &rasterType, resolutionTypesVenus resolution, const bool &bIsMask){
 	std::unordered_map<int, std::string> rasterNameMap = {
 			{COMPOSITE_REFLECTANCE_RASTER, std::string(COMPOSITE_REFLECTANCE_SUFFIX)},
@@ -222,76 +208,65 @@ bool ProductCreatorVenusMuscate::copyRaster(typename ExtractorType::Pointer spli
 			bandType[resolution] +
 			TIF_EXTENSION;
 	std::string maskFullPathOut = m_strProductFullPathOut + "/" + filename;
-	std::cout << "Writing " << maskFullPathOut << std::endl;
-	bool copied = false;
-	if(m_cog){
-		copied = writeExtractedImageCoGeoTiff<ExtractorType>(splitter, m_cogtemp, maskFullPathOut, index);
-	}else{
-		copied = writeExtractedImage<ExtractorType>(splitter,
-				maskFullPathOut + (bIsMask ? "?&gdal:co:COMPRESS=DEFLATE" : ""),
-				index);
+	std::cout << "Adding " << maskFullPathOut << std::endl;
+	addBandToWriter<TOutputValue>(writer, index, maskFullPathOut, bIsMask);
+	//create Metadatafile
+	switch(rasterType){
+	case COMPOSITE_REFLECTANCE_RASTER:
+	{
+		ImageInformation imageFile;
+		imageFile.hasBandNum = false;
+		imageFile.hasBitNum = false;
+		imageFile.hasDetectorID = false;
+		imageFile.isMask = false;
+		imageFile.isGroup = false;
+		imageFile.bandIDs = bandType[resolution];
+		imageFile.path = filename;
+		m_FRCs.emplace_back(imageFile);
+		return true;
 	}
-	if(copied){
-		//create Metadatafile
-		switch(rasterType){
-		case COMPOSITE_REFLECTANCE_RASTER:
-		{
-			ImageInformation imageFile;
-			imageFile.hasBandNum = false;
-			imageFile.hasBitNum = false;
-			imageFile.hasDetectorID = false;
-			imageFile.isMask = false;
-			imageFile.isGroup = false;
-			imageFile.bandIDs = bandType[resolution];
-			imageFile.path = filename;
-			m_FRCs.emplace_back(imageFile);
-			return true;
-		}
-		case COMPOSITE_DATES_MASK:
-		{
-			ImageInformation imageFile;
-			imageFile.hasBandNum = false;
-			imageFile.hasBitNum = false;
-			imageFile.hasDetectorID = false;
-			imageFile.isMask = false;
-			imageFile.isGroup = true;
-			imageFile.bandIDs = bandType[resolution];
-			imageFile.path = filename;
-			m_DTSs.emplace_back(imageFile);
-			return true;
-		}
-		case COMPOSITE_FLAGS_MASK:
-		{
-			ImageInformation imageFile;
-			imageFile.hasBandNum = false;
-			imageFile.hasBitNum = false;
-			imageFile.hasDetectorID = false;
-			imageFile.isMask = false;
-			imageFile.isGroup = true;
-			imageFile.bandIDs = bandType[resolution];
-			imageFile.path = filename;
-			m_FLGs.emplace_back(imageFile);
-			return true;
-		}
-		case COMPOSITE_WEIGHTS_RASTER:
-		{
-			ImageInformation imageFile;
-			imageFile.hasBandNum = false;
-			imageFile.hasBitNum = false;
-			imageFile.hasDetectorID = false;
-			imageFile.isMask = false;
-			imageFile.isGroup = true;
-			imageFile.bandIDs = bandType[resolution];
-			imageFile.path = filename;
-			m_WGTs.emplace_back(imageFile);
-			return true;
-		}
-		default:
-			itkExceptionMacro("Unkown Raster Type found: " << rasterNameMap[rasterType]);
-		}
+	case COMPOSITE_DATES_MASK:
+	{
+		ImageInformation imageFile;
+		imageFile.hasBandNum = false;
+		imageFile.hasBitNum = false;
+		imageFile.hasDetectorID = false;
+		imageFile.isMask = false;
+		imageFile.isGroup = true;
+		imageFile.bandIDs = bandType[resolution];
+		imageFile.path = filename;
+		m_DTSs.emplace_back(imageFile);
+		return true;
+	}
+	case COMPOSITE_FLAGS_MASK:
+	{
+		ImageInformation imageFile;
+		imageFile.hasBandNum = false;
+		imageFile.hasBitNum = false;
+		imageFile.hasDetectorID = false;
+		imageFile.isMask = false;
+		imageFile.isGroup = true;
+		imageFile.bandIDs = bandType[resolution];
+		imageFile.path = filename;
+		m_FLGs.emplace_back(imageFile);
+		return true;
+	}
+	case COMPOSITE_WEIGHTS_RASTER:
+	{
+		ImageInformation imageFile;
+		imageFile.hasBandNum = false;
+		imageFile.hasBitNum = false;
+		imageFile.hasDetectorID = false;
+		imageFile.isMask = false;
+		imageFile.isGroup = true;
+		imageFile.bandIDs = bandType[resolution];
+		imageFile.path = filename;
+		m_WGTs.emplace_back(imageFile);
+		return true;
+	}
+	default:
+		itkExceptionMacro("Unkown Raster Type found: " << rasterNameMap[rasterType]);
 	}
-	itkWarningMacro("Error creating metadata info for " << filename);
-
 	return false;
 }
 
@@ -315,7 +290,7 @@ std::vector<BandGroup> ProductCreatorVenusMuscate::getBandGroupList(const std::v
 }
 
 
-void ProductCreatorVenusMuscate::generateMetadataFile(const std::string &strProductMetadataFilePath, const std::string &cloudPercent, const std::string &snowPercent){
+void ProductCreatorVenusMuscate::generateMetadataFile(const std::string &strProductMetadataFilePath, const std::vector<MuscateQualityIndex> &qualityIndexes){
 	auto writer = ts::muscate::MuscateMetadataWriter::New();
 
 	//Header
@@ -351,21 +326,20 @@ void ProductCreatorVenusMuscate::generateMetadataFile(const std::string &strProd
 	m_productMetadata.ProductCharacteristics.BandGroupList = getBandGroupList(m_productMetadata.RadiometricInformations.Bands);
 
 	ImageProperty frc;
-	frc.Compression = "None";
+	frc.Compression = getCompressionName(false);
 	frc.Encoding = "int16";
 	frc.Endianness = "LittleEndian";
 	frc.Format = "image/tiff";
 	frc.Nature = "Flat_Reflectance_Composite";
 	frc.hasCompression = true;
 	if(m_cog){
-		frc.Compression = "DEFLATE";
 		frc.Description = "CloudOptimized-GeoTiff";
 	}
 	frc.ImageFiles = m_FRCs;
 	m_productMetadata.ProductOrganisation.ImageProperties.emplace_back(frc);
 	ImageProperty dts;
 	dts.hasCompression = true;
-	dts.Compression = "DEFLATE";
+	dts.Compression = getCompressionName(true);
 	dts.Nature = "Weighted_Average_Dates";
 	dts.Format = "image/tiff";
 	dts.Endianness = "LittleEndian";
@@ -377,7 +351,7 @@ void ProductCreatorVenusMuscate::generateMetadataFile(const std::string &strProd
 	m_productMetadata.ProductOrganisation.MaskProperties.emplace_back(dts);
 	ImageProperty wgt;
 	wgt.hasCompression = true;
-	wgt.Compression = "DEFLATE";
+	wgt.Compression = getCompressionName(true);
 	wgt.Nature = "Pixel_Weight";
 	wgt.Format = "image/tiff";
 	wgt.Endianness = "LittleEndian";
@@ -389,7 +363,7 @@ void ProductCreatorVenusMuscate::generateMetadataFile(const std::string &strProd
 	m_productMetadata.ProductOrganisation.MaskProperties.emplace_back(wgt);
 	ImageProperty flg;
 	flg.hasCompression = true;
-	flg.Compression = "DEFLATE";
+	flg.Compression = getCompressionName(true);
 	flg.Nature = "Pixel_Status_Flag";
 	flg.Format = "image/tiff";
 	flg.Endianness = "LittleEndian";
@@ -407,7 +381,7 @@ void ProductCreatorVenusMuscate::generateMetadataFile(const std::string &strProd
 	current.AcquisitionDate = m_syntDate;
 	current.ProductionDate = m_currentDateTime;
 	current.ProductID = m_strProductDirectoryName;
-	current.GlobalIndexList = {MuscateQualityIndex("CloudPercent", cloudPercent), MuscateQualityIndex("SnowPercent", snowPercent)};
+	current.GlobalIndexList = qualityIndexes;
 	m_productMetadata.QualityInformations.CurrentProduct = current;
 	writer->WriteMetadata(m_productMetadata, strProductMetadataFilePath);
 
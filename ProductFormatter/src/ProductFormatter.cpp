@@ -28,6 +28,8 @@
 #include "string_utils.hpp"
 #include "ProductCreatorSentinelMuscate.h"
 #include "ProductCreatorVenusMuscate.h"
+#include "RegionOfInterest.h"
+#include "PerformanceTelemetry.h"
 
 /**
  * @brief otb Namespace for all OTB-related Filters and Applications
@@ -80,8 +82,10 @@ private:
 		// Other parameters
 		AddParameter(ParameterType_Int, "cog", "Create all raster as Cloud-Optimized GeoTiffs");
 		MandatoryOff("cog");
-		AddParameter(ParameterType_String, "cogtemp", "Temp-Directory for the creation of Cloud-Optimized GeoTiffs");
+		AddParameter(ParameterType_String, "cogtemp", "Temp-Directory for the creation of Cloud-Optimized GeoTiffs. If not set, the intermediate files are written next to the final files");
 		MandatoryOff("cogtemp");
+		AddParameter(ParameterType_String, "ioprofile", "I/O profile of the rasters: default, temp-fast, archive or cog. Default is default");
+		MandatoryOff("ioprofile");
 		AddParameter(ParameterType_String, "destination", "Destination root directory");
 		AddParameter(ParameterType_String, "syntdate", "Synthesis date of the final product in the format YYYY-MM-DDTHH:mm:SS.sssZ");
 		AddParameter(ParameterType_String, "begin", "Begin of the synthesis period in the format YYYY-MM-DDTHH:mm:SS.sssZ");
@@ -89,6 +93,16 @@ private:
 		AddParameter(ParameterType_InputFilenameList, "xml", "The L2A/L3A MUSCATE xml files");
 		AddParameter(ParameterType_String, "vcurrent", "Current version of the Processing chain in format 'N.N'");
 		MandatoryOff("vcurrent");
+		AddParameter(ParameterType_Int, "nsyntheses", "Number of syntheses in the products, as updated in the same pass by UpdateSynthesis with several l3adates. Default is 1");
+		SetDefaultParameterInt("nsyntheses", 1);
+		MandatoryOff("nsyntheses");
+		AddParameter(ParameterType_Int, "synthesis", "Index of the synthesis to create the product of, starting at 0. Default is 0");
+		SetDefaultParameterInt("synthesis", 0);
+		MandatoryOff("synthesis");
+		AddParameter(ParameterType_StringList, "roi", "Region of interest");
+		SetParameterDescription("roi", "Extent xmin ymin xmax ymax in the map coordinates of the products. The product is restricted to the pixels whose centre lies within it, "
+				"its group geopositioning follows the extent");
+		MandatoryOff("roi");
 
 		SetDocExampleParameterValue("products", "L3AResult0_10m.tif L3AResult0_20m.tif");
 		SetDocExampleParameterValue("platform", "SENTINEL");
@@ -99,6 +113,8 @@ private:
 		SetDocExampleParameterValue("begin", "2017-04-02T09:38:44.724Z");
 		SetDocExampleParameterValue("end", "2017-04-02T09:38:44.724Z");
 		SetDocExampleParameterValue("vcurrent", "1-1");
+		SetDocExampleParameterValue("ioprofile", "archive");
+		SetDocExampleParameterValue("roi", "300000 4890240 354900 4945140");
 	}
 
 	void DoUpdateParameters()
@@ -108,6 +124,7 @@ private:
 
 	void DoExecute()
 	{
+		m_Telemetry.Start(this);
 		versionType version;
 		if(HasValue("vcurrent")){
 			std::string versionStr = GetParameterString("vcurrent");
@@ -117,6 +134,13 @@ private:
 		}
 
 		std::vector<std::string> products = this->GetParameterStringList("products");
+		const int nSyntheses = GetParameterInt("nsyntheses");
+		if(nSyntheses > 1){
+			const int synthesis = GetParameterInt("synthesis");
+			for(std::string &product : products){
+				product = getSynthesisBands(product, synthesis, nSyntheses);
+			}
+		}
 
 		//get destination root
 		std::string destination = this->GetParameterString("destination");
@@ -132,16 +156,32 @@ private:
 
 		std::string cogtemp = "";
 		bool cog = false;
-		if(HasValue("cog") && HasValue("cogtemp")){
-			cogtemp = this->GetParameterString("cogtemp");
+		if(HasValue("cog")){
 			cog = this->GetParameterInt("cog") > 0 ? true : false;
 		}
+		if(HasValue("cogtemp")){
+			cogtemp = this->GetParameterString("cogtemp");
+		}
+		std::string ioProfile = IO_PROFILE_DEFAULT;
+		if(HasValue("ioprofile")){
+			ioProfile = this->GetParameterString("ioprofile");
+			if(!IsIOProfile(ioProfile)){
+				itkExceptionMacro("Unknown I/O profile: " << ioProfile);
+			}
+		}
 
 		//read .xml or .HDR files to fill the metadata structures
 		// Get the list of input files
 		std::vector<std::string> descriptors = this->GetParameterStringList("xml");
 		m_creator = GetProductCreator(GetParameterAsString("platform"));
-		m_creator->init(products, syntdate, syntPeriodBegin, syntPeriodEnd, version, gippFilename, descriptors, cog, cogtemp);
+		m_creator->init(products, syntdate, syntPeriodBegin, syntPeriodEnd, version, gippFilename, descriptors, cog, cogtemp, ioProfile);
+		if(HasValue("roi")){
+			const RegionOfInterest roi = RegionOfInterest::FromStringList(GetParameterStringList("roi"));
+			std::cout << "Region of interest: " << roi.ToString() << std::endl;
+			m_creator->setRegionOfInterest(roi);
+		}
+		m_creator->setTelemetry(&m_Telemetry);
+		m_creator->setLogger(this->GetLogger());
 		if(m_creator->createProduct(destination) == false){
 			itkExceptionMacro("Error in product creation of " << destination);
 		}
@@ -172,6 +212,23 @@ private:
 	}
 
 
+	/**
+	 * @brief Select the bands of a single synthesis in a product containing several of them one after the other
+	 * @param product The filename of the product
+	 * @param synthesis The index of the synthesis
+	 * @param nSyntheses The number of syntheses in the product
+	 * @return The filename with the band range of the synthesis as reader option, unchanged if empty
+	 */
+	std::string getSynthesisBands(const std::string &product, int synthesis, int nSyntheses){
+		if(product.empty()){
+			return product;
+		}
+		BaseImageTypes::ShortVectorImageReaderType::Pointer reader = BaseImageTypes::ShortVectorImageReaderType::New();
+		reader->SetFileName(product);
+		reader->UpdateOutputInformation();
+		return ts::getSynthesisBands(product, reader->GetOutput()->GetNumberOfComponentsPerPixel(), synthesis, nSyntheses);
+	}
+
 	/**
 	 * @brief Get the product creator depending on the platform
 	 * @param p The Platform string, which can be: Sentinel, Venus
@@ -195,6 +252,7 @@ private:
 
 	//Product Creator
 	std::unique_ptr<ProductCreatorAdapter> m_creator;
+	PerformanceTelemetry m_Telemetry;
 };
 } //namespace Wrapper
 } //namespace otb
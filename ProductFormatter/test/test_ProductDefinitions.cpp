@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE ProductDefinitions
+#include <boost/test/unit_test.hpp>
+#include "ProductDefinitions.h"
+
+using namespace ts;
+
+BOOST_AUTO_TEST_CASE(testSynthesisBands){
+	// Two syntheses of 4 reflectances, weight, date and flag
+	BOOST_CHECK_EQUAL(getSynthesisBands("composite.tif", 14, 0, 2), "composite.tif?&bands=1:7");
+	BOOST_CHECK_EQUAL(getSynthesisBands("composite.tif", 14, 1, 2), "composite.tif?&bands=8:14");
+	BOOST_CHECK_EQUAL(getSynthesisBands("weights.tif", 3, 2, 3), "weights.tif?&bands=3:3");
+	// Existing reader options are kept
+	BOOST_CHECK_EQUAL(getSynthesisBands("composite.tif?&skipgeom=true", 14, 1, 2), "composite.tif?&skipgeom=true&bands=8:14");
+	// A product which is not given is left as is
+	BOOST_CHECK_EQUAL(getSynthesisBands("", 0, 1, 2), "");
+}
+
+BOOST_AUTO_TEST_CASE(testSynthesisBandsInvalid){
+	BOOST_CHECK_THROW(getSynthesisBands("composite.tif", 13, 0, 2), itk::ExceptionObject);
+	BOOST_CHECK_THROW(getSynthesisBands("composite.tif", 14, 2, 2), itk::ExceptionObject);
+	BOOST_CHECK_THROW(getSynthesisBands("composite.tif", 14, -1, 2), itk::ExceptionObject);
+}
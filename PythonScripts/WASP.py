@@ -28,11 +28,23 @@ SPDX-License-Identifier: GPL-3.0-or-later
 """
 
 import os, sys
+import math
 import logging
 import argparse
 from lxml import etree
 from timeit import default_timer as timer
 import subprocess
+import tempfile
+import glob
+import json
+import hashlib
+import shutil
+import copy
+import time
+import resource
+import multiprocessing
+import multiprocessing.connection
+import fcntl
 import datetime as dt
 import numpy as np
 
@@ -43,6 +55,407 @@ class OTBApplicationError(Exception):
             # Call the base class constructor with the parameters it needs
             super(OTBApplicationError, self).__init__("OTB App {0} failed with error code {1}".format(name, returnCode))
 
+class IntermediateCache():
+    """
+    @brief Directory of the per-date intermediate products, shared between runs.
+           Each entry is keyed by a hash of the L2A XML, of the files of its product and of the parameters its products depend on.
+           The least recently used entries are evicted once the cache exceeds its size budget.
+           Each run holds a shared lock on the entries it uses, so that concurrent runs never evict an entry another one reads.
+    """
+    markerName = "entry.json"
+    stagingSuffix = ".staging"
+    lockSuffix = ".lock"
+
+    def __init__(self, path, maxSizeGB):
+        """
+        @param path The cache directory. It is created if it does not exist.
+        @param maxSizeGB The size budget in GB
+        """
+        self.path = os.path.abspath(path)
+        self.maxSize = int(maxSizeGB * 1024**3)
+        #Open lock files of the entries used by this run, holding a shared lock until the run ends
+        self.locks = {}
+        if(not os.path.isdir(self.path)):
+            os.makedirs(self.path)
+
+    def getLockPath(self, key):
+        """
+        @brief Get the lock file of an entry. It is kept next to the entry, as the entry itself may be removed.
+        """
+        return os.path.join(self.path, key + self.lockSuffix)
+
+    def acquire(self, key):
+        """
+        @brief Hold a shared lock on an entry until the run ends, so that no other run evicts it.
+               Waits while another run evicts the entry.
+        """
+        if(key not in self.locks):
+            lockFile = open(self.getLockPath(key), "a")
+            fcntl.flock(lockFile, fcntl.LOCK_SH)
+            self.locks[key] = lockFile
+
+    def getKey(self, xml, parameters):
+        """
+        @brief Compute the key of the products of an L2A input
+        @param xml The L2A XML, whose product is fingerprinted, see getProductFingerprint
+        @param parameters List of the parameters and auxiliary files the products depend on. Existing files are hashed by content.
+        @return The key as hex-string
+        """
+        h = hashlib.sha256()
+        h.update(self.getProductFingerprint(xml).encode("utf-8"))
+        for parameter in parameters:
+            if(os.path.isfile(str(parameter))):
+                with open(str(parameter), "rb") as f:
+                    h.update(f.read())
+            else:
+                h.update(str(parameter).encode("utf-8"))
+            h.update(b"\0")
+        return h.hexdigest()
+
+    @staticmethod
+    def getProductFingerprint(xml):
+        """
+        @brief Compute the fingerprint of a product from the content of its XML and the files of its folder
+        @return The fingerprint as hex-string
+        @note The rasters of the product are too large to be hashed by content, their paths, sizes and modification times are hashed instead
+        """
+        h = hashlib.sha256()
+        with open(xml, "rb") as f:
+            h.update(f.read())
+        productDir = os.path.dirname(os.path.abspath(xml))
+        for root, dirs, files in os.walk(productDir):
+            dirs.sort()
+            for filename in sorted(files):
+                filepath = os.path.join(root, filename)
+                try:
+                    stat = os.stat(filepath)
+                except OSError:
+                    continue
+                h.update("{0}:{1}:{2}".format(os.path.relpath(filepath, productDir), stat.st_size, stat.st_mtime).encode("utf-8"))
+                h.update(b"\0")
+        return h.hexdigest()
+
+    def lookup(self, key):
+        """
+        @brief Search the cache for an entry
+        @param key The key of the entry
+        @return The directory of the entry, None if it is not cached
+        """
+        entryPath = os.path.join(self.path, key)
+        marker = os.path.join(entryPath, self.markerName)
+        #Lock before checking the entry, so that it cannot be evicted in between
+        self.acquire(key)
+        if(not os.path.exists(marker)):
+            return None
+        #The modification time of the marker tells when the entry was used last
+        os.utime(marker, None)
+        return entryPath
+
+    def stage(self, key):
+        """
+        @brief Create a directory to write the products of a new entry to
+        @param key The key of the entry
+        @return The staging directory, which is moved into the cache by store()
+        """
+        stagingPath = os.path.join(self.path, key + self.stagingSuffix + str(os.getpid()))
+        if(os.path.isdir(stagingPath)):
+            shutil.rmtree(stagingPath)
+        os.makedirs(stagingPath)
+        return stagingPath
+
+    def store(self, key, stagingPath, description):
+        """
+        @brief Move a staged entry into the cache and evict old entries if the budget is exceeded
+        @param key The key of the entry
+        @param stagingPath The directory returned by stage()
+        @param description Dict describing the entry, written to its marker
+        @return The directory of the entry
+        """
+        with open(os.path.join(stagingPath, self.markerName), "w") as f:
+            json.dump(description, f, indent=2)
+        entryPath = os.path.join(self.path, key)
+        self.acquire(key)
+        try:
+            os.rename(stagingPath, entryPath)
+        except OSError:
+            #Another run stored the same entry in the meantime
+            shutil.rmtree(stagingPath, ignore_errors=True)
+        self.evict()
+        return entryPath
+
+    def discard(self, stagingPath):
+        """
+        @brief Remove a staging directory, e.g. after a failed App
+        """
+        shutil.rmtree(stagingPath, ignore_errors=True)
+
+    def getDirectorySize(self, path):
+        """
+        @brief Get the size of all files in a directory
+        """
+        size = 0
+        for root, _, files in os.walk(path):
+            for filename in files:
+                try:
+                    size += os.path.getsize(os.path.join(root, filename))
+                except OSError:
+                    pass
+        return size
+
+    def evict(self):
+        """
+        @brief Remove the least recently used entries until the cache fits into its budget.
+               Entries locked by this or by another run are kept.
+        """
+        entries = []
+        for key in os.listdir(self.path):
+            marker = os.path.join(self.path, key, self.markerName)
+            if(os.path.exists(marker)):
+                entries.append((os.path.getmtime(marker), key, self.getDirectorySize(os.path.join(self.path, key))))
+        totalSize = sum(size for _, _, size in entries)
+        for _, key, size in sorted(entries):
+            if(totalSize <= self.maxSize):
+                break
+            if(key in self.locks):
+                continue
+            with open(self.getLockPath(key), "a") as lockFile:
+                try:
+                    fcntl.flock(lockFile, fcntl.LOCK_EX | fcntl.LOCK_NB)
+                except (IOError, OSError):
+                    #Used by another run
+                    continue
+                logging.info("Evicting cache entry {0} of {1} MB".format(key, size // 1024**2))
+                shutil.rmtree(os.path.join(self.path, key), ignore_errors=True)
+                totalSize -= size
+        if(totalSize > self.maxSize):
+            logging.warning("Cache {0} exceeds its budget of {1} GB with the entries in use".format(self.path, self.maxSize / 1024.**3))
+        return
+
+class StageTuner():
+    """
+    @brief Chooses the RAM and the number of threads of each OTB-App.
+           The RAM is sized so that each thread processes linesPerThread lines of each stream region, given the size of a pixel
+           over all bands the App reads and writes, and is bounded by the RAM budget.
+           The number of threads is searched by halving it from the maximum, as long as the throughput stays close to the best one,
+           and the smallest number reaching most of the best throughput is chosen.
+           The throughput is the number of pixels per second of wall time of the whole App, including its I/O, as this is what the chain waits for:
+           Apps bound by their I/O gain little from more threads and get fewer of them.
+           The measurements are kept in a json file between runs if given, shared by concurrent runs.
+    """
+    linesPerThread = 64
+    minRAM = 64
+    #Share of the best throughput a smaller number of threads has to reach to be chosen
+    throughputTolerance = 0.9
+    #Number of measurements kept for each App and number of threads
+    maxMeasurements = 5
+
+    def __init__(self, path, ramBudget, threads, tuneThreads):
+        """
+        @param path The json file to keep the measured throughputs in. If None, they are only kept during the run
+        @param ramBudget The maximum RAM of an App in MB
+        @param threads The maximum number of threads of an App
+        @param tuneThreads False, if the number of threads cannot be set for each App
+        """
+        self.path = path
+        self.ramBudget = ramBudget
+        self.threads = threads
+        self.tuneThreads = tuneThreads
+        self.layouts = {}
+        self.measurements = {}
+        if(path and os.path.exists(path)):
+            try:
+                with open(path) as f:
+                    self.measurements = json.load(f)
+            except ValueError:
+                logging.warning("Cannot read the measured throughputs in {0}, starting over".format(path))
+
+    def setLayout(self, name, width, height, bytesPerPixel):
+        """
+        @brief Set the size of the rasters of an App
+        @param bytesPerPixel The size of a pixel over all bands read and written by the App
+        """
+        self.layouts[name] = (width, height, bytesPerPixel)
+
+    def getThreadCandidates(self):
+        """
+        @brief Get the numbers of threads to try: The maximum and its halvings down to a single thread
+        @return The list of numbers of threads, in decreasing order
+        """
+        candidates = [self.threads]
+        while(candidates[-1] > 1):
+            candidates.append(candidates[-1] // 2)
+        return candidates
+
+    def getThreads(self, name):
+        """
+        @brief Get the number of threads of an App. The candidates are tried once each in decreasing order,
+               until one falls below the tolerance of the best throughput. Then the measured throughputs decide.
+        """
+        if(not self.tuneThreads):
+            return self.threads
+        measured = self.measurements.get(name, {})
+        throughputs = {}
+        for threads in self.getThreadCandidates():
+            if(str(threads) not in measured):
+                return threads
+            throughputs[threads] = sum(measured[str(threads)]) / len(measured[str(threads)])
+            #Fewer threads are not expected to be faster again
+            if(throughputs[threads] < self.throughputTolerance * max(throughputs.values())):
+                break
+        best = max(throughputs.values())
+        return min(threads for threads in throughputs if throughputs[threads] >= self.throughputTolerance * best)
+
+    def getRAM(self, name, threads):
+        """
+        @brief Get the RAM of an App in MB
+        """
+        if(name not in self.layouts):
+            return int(self.ramBudget)
+        width, height, bytesPerPixel = self.layouts[name]
+        lines = min(height, self.linesPerThread * threads)
+        ram = int(math.ceil(width * lines * bytesPerPixel / (1024. * 1024.)))
+        return int(min(max(ram, self.minRAM), self.ramBudget))
+
+    def record(self, name, threads, seconds):
+        """
+        @brief Record the throughput of an App and save it to the json file
+        """
+        if(name not in self.layouts or seconds <= 0):
+            return
+        width, height, _ = self.layouts[name]
+        throughputs = self.measurements.setdefault(name, {}).setdefault(str(threads), [])
+        throughputs.append(width * height / seconds)
+        del throughputs[:-self.maxMeasurements]
+        logging.info("Throughput of {0} with {1} threads: {2:.0f} pixels/s".format(name, threads, throughputs[-1]))
+        if(self.path):
+            self.save(name, threads, throughputs[-1])
+
+    def save(self, name, threads, throughput):
+        """
+        @brief Add a measured throughput to the json file. The file is shared by concurrent runs, e.g. shards and tiles,
+               thus it is locked and the measurement is merged with the ones they saved in the meantime.
+        """
+        with open(self.path + ".lock", "a") as lockFile:
+            fcntl.flock(lockFile, fcntl.LOCK_EX)
+            measurements = {}
+            if(os.path.exists(self.path)):
+                try:
+                    with open(self.path) as f:
+                        measurements = json.load(f)
+                except ValueError:
+                    logging.warning("Cannot read the measured throughputs in {0}, starting over".format(self.path))
+            throughputs = measurements.setdefault(name, {}).setdefault(str(threads), [])
+            throughputs.append(throughput)
+            del throughputs[:-self.maxMeasurements]
+            with open(self.path + ".tmp", "w") as f:
+                json.dump(measurements, f)
+            os.rename(self.path + ".tmp", self.path)
+            self.measurements = measurements
+
+class RunTelemetry():
+    """
+    @brief Collects the performance records of a run as JSON in the directory given by WASP_TELEMETRY.
+           The OTB-Apps write one record each, see Common/include/PerformanceTelemetry.h, and every WASP process
+           the runs of its Apps. The process the report is requested in creates the directory,
+           the shards and tiles run in other processes inherit it and only add their records.
+    """
+    variableName = "WASP_TELEMETRY"
+    waspPrefix = "wasp_"
+
+    def __init__(self, report):
+        """
+        @param report The json file to write the report of the run to. If None, the records are only
+               written if the directory is inherited from a parent process
+        """
+        self.report = os.path.abspath(report) if report else None
+        self.directory = os.environ.get(self.variableName)
+        self.isRoot = False
+        if(self.report and not self.directory):
+            self.directory = tempfile.mkdtemp(prefix = "wasp_telemetry_", dir = os.path.dirname(self.report))
+            os.environ[self.variableName] = self.directory
+            self.isRoot = True
+        self.start = time.time()
+        self.startTimer = timer()
+        self.runs = []
+
+    def isEnabled(self):
+        return bool(self.directory)
+
+    def record(self, name, backend, start, seconds, returnCode, threads, ram):
+        """
+        @brief Record the run of an OTB-App and write all runs of this process to its file
+        """
+        if(not self.isEnabled()):
+            return
+        self.runs.append({"application": name, "backend": backend, "pid": os.getpid(), "start": start, "wallTime": seconds,
+                          "returnCode": returnCode, "threads": threads, "ram": ram})
+        path = os.path.join(self.directory, "{0}{1}.json".format(self.waspPrefix, os.getpid()))
+        with open(path + ".tmp", "w") as f:
+            json.dump(self.runs, f)
+        os.rename(path + ".tmp", path)
+
+    def readRecords(self):
+        """
+        @brief Read the records of all Apps and WASP processes of the run
+        @return The lists of App records and of WASP runs, each sorted by start time
+        """
+        applications, runs = [], []
+        for path in glob.glob(os.path.join(self.directory, "*.json")):
+            try:
+                with open(path) as f:
+                    content = json.load(f)
+            except ValueError:
+                logging.warning("Cannot read the telemetry record {0}".format(path))
+                continue
+            if(os.path.basename(path).startswith(self.waspPrefix)):
+                runs += content
+            else:
+                applications.append(content)
+        return sorted(applications, key = lambda r: r["start"]), sorted(runs, key = lambda r: r["start"])
+
+    def summarize(self, applications):
+        """
+        @brief Sum up the App records per App and the filter records per filter class
+        """
+        summary, filters = {}, {}
+        for record in applications:
+            entry = summary.setdefault(record["application"], {"runs": 0, "wallTime": 0, "cpuTime": 0, "peakRSS": 0,
+                                                               "inputFileSize": 0, "outputFileSize": 0, "streams": 0, "pixels": 0})
+            entry["runs"] += 1
+            entry["wallTime"] += record["wallTime"]
+            entry["cpuTime"] += record["cpuTime"]
+            entry["peakRSS"] = max(entry["peakRSS"], record["peakRSS"])
+            #The sizes of the files on disk, not the bytes actually read or written
+            entry["inputFileSize"] += sum(f["fileSize"] for f in record["inputs"])
+            entry["outputFileSize"] += sum(f["fileSize"] for f in record["outputs"])
+            entry["streams"] += sum(f["streams"] for f in record["outputs"])
+            entry["pixels"] += sum(f["pixels"] for f in record["outputs"])
+            for f in record["filters"]:
+                entry = filters.setdefault(f["name"], {"executions": 0, "wallTime": 0, "pixels": 0})
+                for key in entry:
+                    entry[key] += f[key]
+        return summary, filters
+
+    def writeReport(self, status):
+        """
+        @brief Aggregate the records of the run to the report and remove the directory. Only done by the process which created it.
+        @param status The status of the run, e.g. finished or failed
+        """
+        if(not self.isRoot):
+            return
+        applications, runs = self.readRecords()
+        summary, filters = self.summarize(applications)
+        usage = [resource.getrusage(who) for who in [resource.RUSAGE_SELF, resource.RUSAGE_CHILDREN]]
+        report = {"command": sys.argv, "status": status, "start": self.start, "wallTime": timer() - self.startTimer,
+                  #The processes of the Apps, shards and tiles are included once they have been waited for
+                  "cpuTime": sum(u.ru_utime + u.ru_stime for u in usage),
+                  "summary": summary, "filters": filters, "applications": applications, "runs": runs}
+        with open(self.report, "w") as f:
+            json.dump(report, f, indent = 2)
+        shutil.rmtree(self.directory, ignore_errors = True)
+        del os.environ[self.variableName]
+        logging.info("Telemetry report of {0} App runs written to {1}".format(len(applications), self.report))
+
 class TemporalSynthesis():
     """
     @brief The Class to run the Level-3A Temporal Synthesis chain for Sentinel-2A/B products
@@ -59,6 +472,19 @@ class TemporalSynthesis():
     defRemoveTemp = True
     defVerbose = logging.DEBUG
     defCoG = False
+    defIOProfile = "default"
+    defTempIOProfile = "default"
+    #Execution backends of the OTB Apps: In-process with the OTB Python API or one otbApplicationLauncherCommandLine each
+    defBackend = "inprocess"
+    backends = ["inprocess", "subprocess"]
+    #Size budget of the cache of per-date intermediate products in GB
+    defCacheSize = float(50)
+    #GeoTiff creation options of the I/O profiles, as defined in Common/include/IOProfiles.h. All but default are tiled.
+    ioProfileBlockSize = 512
+    ioProfiles = {"default": [],
+                  "temp-fast": [("COMPRESS", "NONE")],
+                  "archive": [("COMPRESS", "DEFLATE"), ("PREDICTOR", "2"), ("NUM_THREADS", "ALL_CPUS")],
+                  "cog": [("COMPRESS", "DEFLATE"), ("PREDICTOR", "2"), ("NUM_THREADS", "ALL_CPUS")]}
     #Default GIP-Parameters:
     ParameterVersion = "1.1"
     defS2Syntperiod = int(23)
@@ -71,46 +497,77 @@ class TemporalSynthesis():
     defSigmaSmallCLD = float(2)
     defSigmaLargeCLD = float(10)
     defWeightDateMin = float(0.5)
+    #Arguments which do not change the pixels of a shard, thus not part of its manifest
+    shardIndependentArgs = ["verbose", "out", "tempout", "version", "logging", "shard", "shardjobs", "removeTemp", "cog", "ioprofile",
+                            "tempioprofile", "backend", "nthreads", "ram", "tuning", "telemetry", "metadatacache", "cache", "cachesize",
+                            "batch", "batchcores", "batchram"]
 
     venusPlatform = "VENUS"
     s2Platform = "SENTINEL2"
+    #Number of L2A reflectance bands, as in UpdateSynthesis/include/BandsDefs.h
+    S2_L2A_10M_BANDS = 4
+    S2_L2A_20M_BANDS = 6
+    VNS_L2A_BANDS = 12
     # =========================================================================
     # Environment Variables
     # =========================================================================
     # GDAL RAM usage
     GDAL_CACHEMAX=16384
+    #RAM in MB of each OTB-App and of the GDAL cache of a tile in batch mode
+    defBatchRAM = 2048
     # Set the number of available CPUs for each OTB-App
     ITK_GLOBAL_DEFAULT_NUMBER_OF_THREADS = 8
 
     def __init__(self, defArgs):
-        self.initLoggers(filepath = defArgs.logging)
+        #The shards are run with the arguments as given on the command line
+        self.defArgs = copy.deepcopy(defArgs)
+        #Shards running at the same time log to their own files
+        self.initLoggers(filepath = defArgs.logging, filename = "TS-INFO.log" if defArgs.shard is None else "TS-INFO_Shard_{0}.log".format(defArgs.shard))
+        self.otbApplication = None
+        #The tuner is created once the parameters are known, the Apps run before use the default RAM and threads
+        self.tuner = None
+        #The parameters are read once the platform is known, the Apps run before use the default threads as well
+        self.args = None
+        self.telemetry = RunTelemetry(defArgs.telemetry)
 
         self.execPath = os.path.dirname(os.path.realpath(__file__))
         self.setupEnvironmentVariable(variableName="PATH", path=os.path.join(self.execPath))
         self.setupEnvironmentVariable(variableName="LD_LIBRARY_PATH", path=os.path.join(self.execPath, "../lib"))
         self.setupEnvironmentVariable(variableName="OTB_APPLICATION_PATH", path=os.path.join(self.execPath, "../lib/otb/applications"))
+        if(defArgs.metadatacache):
+            self.setupEnvironmentVariable(variableName="WASP_METADATA_CACHE", path=os.path.abspath(defArgs.metadatacache), reset = True, ignoreWarning=True)
+        self.metadataIndex = self.loadMetadataIndex(defArgs.input)
         self.platform = self.getPlatformIdentifier(defArgs.input)
         if(self.platform not in [self.venusPlatform, self.s2Platform]):
             raise ValueError("Unknown platform found: {0}".format(self.platform))
         logging.info("Platform found: {0}".format(self.platform))
         self.args = self.getParameters(defArgs)
 
-        self.setupEnvironmentVariable(variableName="GDAL_CACHEMAX", path=str(self.GDAL_CACHEMAX), reset = True, ignoreWarning=True)
+        #In batch mode, the GDAL cache of each tile is bounded by the RAM budget as well
+        gdalCacheMax = self.args.ram if self.args.batch and self.args.ram else self.GDAL_CACHEMAX
+        self.setupEnvironmentVariable(variableName="GDAL_CACHEMAX", path=str(gdalCacheMax), reset = True, ignoreWarning=True)
         self.setupEnvironmentVariable(variableName="ITK_GLOBAL_DEFAULT_NUMBER_OF_THREADS", path=str(self.args.nthreads), reset = True, ignoreWarning=True)
+        #The Python API has to be loaded after the environment is set up, as OTB and ITK read it on initialisation
+        if(self.args.backend == "inprocess"):
+            self.otbApplication = self.loadOTBPythonAPI()
+            if(self.otbApplication is None):
+                self.args.backend = "subprocess"
+        logging.info("Running the OTB Apps with the {0} backend".format(self.args.backend))
+        self.cache = IntermediateCache(self.args.cache, self.args.cachesize) if self.args.cache else None
+        self.tuner = self.getStageTuner()
 
         try:
             self.checkApplicationAvailability()
         except OSError:
             raise OSError("Cannot find otbApplicationLauncherCommandLine executable")
 
-    def initLoggers(self, msgLevel = logging.DEBUG, filepath = ""):
+    def initLoggers(self, msgLevel = logging.DEBUG, filepath = "", filename = "TS-INFO.log"):
         """
         @brief Init a file and a stdout logger
         @param msgLevel Standard msgLevel for both loggers. Default is DEBUG
         @param filepath The path to save the log-file to. If none, the current directory is used"
+        @param filename The name of the log-file
         """
-        filename = "TS-INFO.log"
-
         #Create default path or get the pathname without the extension, if there is one
 
         logger=logging.getLogger()
@@ -158,7 +615,10 @@ class TemporalSynthesis():
         @brief Check if all TemporalSynthesis Applications can be found
         @return none, but throws exception if App is missing.
         """
-        availableApplications = self.runOTBApplication("test", [], testRun = True)[1]
+        if(self.otbApplication):
+            availableApplications = self.otbApplication.Registry.GetAvailableApplications()
+        else:
+            availableApplications = self.runOTBApplication("test", [], testRun = True)[1]
 
         if(not availableApplications):
             raise NameError("List of available OTB applications is empty.")
@@ -168,6 +628,41 @@ class TemporalSynthesis():
                 raise NameError("Cannot find {0} in the list of OTB Apps".format(item))
         return
 
+    def loadMetadataIndex(self, xmllist):
+        """
+        @brief Read the summary of all L2A products at once using the MetadataIndex-App
+        @param xmllist the list of filenames containing an XML
+        @return The index entries keyed by the absolute XML path, an empty dict if the App is not available
+        """
+        fd, indexFile = tempfile.mkstemp(suffix=".json")
+        os.close(fd)
+        index = {}
+        try:
+            self.runOTBApplication("MetadataIndex", ["-il"] + [str(xml) for xml in xmllist] + ["-out", indexFile, "-format", "json"])
+            with open(indexFile) as f:
+                for entry in json.load(f):
+                    if("error" not in entry):
+                        index[os.path.abspath(entry["xml"])] = entry
+        except (OTBApplicationError, OSError, ValueError) as e:
+            logging.warning("Cannot build the metadata index, reading the XMLs one by one: {0}".format(e))
+        finally:
+            os.remove(indexFile)
+        return index
+
+    def getMetadataField(self, key, xpath, xml):
+        """
+        @brief Get a field of an L2A product, either from the metadata index or from the XML itself
+        @param key The name of the field in the metadata index
+        @param xpath The path to the field inside the XML
+        @param xml The filename of the XML
+        @return The text of the field
+        """
+        entry = self.metadataIndex.get(os.path.abspath(str(xml)))
+        if(entry is not None and entry.get(key)):
+            return entry[key]
+        tree = etree.parse(str(xml))
+        return tree.xpath(xpath)[0].text
+
     def getAcquisitionPeriod(self, xmllist):
         """
         @brief Calculate Min, Max and Middle-datetimes from a Muscate-XML list
@@ -187,8 +682,7 @@ class TemporalSynthesis():
 
         for xml in xmllist:
             try:
-                tree = etree.parse(str(xml))
-                acqDate = str(tree.xpath(xpath)[0].text)
+                acqDate = str(self.getMetadataField("date", xpath, xml))
                 dates.append(self.stringToDatetime(acqDate))
             except:
                 logging.warning("Cannot open XML {0}".format(xml))
@@ -269,6 +763,19 @@ class TemporalSynthesis():
             args.cog = self.defCoG
         if(args.tempout == None):
             args.tempout = args.out
+        if(args.ioprofile == None):
+            args.ioprofile = self.defIOProfile
+        if(args.tempioprofile == None):
+            args.tempioprofile = self.defTempIOProfile
+        if(args.cachesize == None):
+            args.cachesize = self.defCacheSize
+        if(args.backend == None):
+            args.backend = self.defBackend
+        if(args.backend not in self.backends):
+            raise ValueError("Unknown backend {0}. Possible values are: {1}".format(args.backend, ", ".join(self.backends)))
+        for profile in [args.ioprofile, args.tempioprofile]:
+            if(profile not in self.ioProfiles):
+                raise ValueError("Unknown I/O profile {0}. Possible values are: {1}".format(profile, ", ".join(sorted(self.ioProfiles))))
         if(args.weightaotmin == None):
             args.weightaotmin = self.defWeightAOTMin
         if(args.weightaotmax == None):
@@ -292,6 +799,12 @@ class TemporalSynthesis():
                 args.synthalf = self.defVnsSyntperiod
         if(args.nthreads == None):
             args.nthreads = self.ITK_GLOBAL_DEFAULT_NUMBER_OF_THREADS
+        if(args.shards == None):
+            args.shards = 1
+        if(args.shardjobs == None):
+            args.shardjobs = args.shards
+        if(args.shard != None and not 0 <= args.shard < args.shards):
+            raise ValueError("The shard {0} is not within the {1} shards".format(args.shard, args.shards))
         if(args.pathprevL3A == None):
             args.pathprevL3A = ""
         if(args.scatteringcoeffpath == None):
@@ -300,7 +813,9 @@ class TemporalSynthesis():
             for path in applicationPath:
                 searchPath = os.path.join(path, "../../../", "share")
                 scatteringCoeffs = [self.scatteringCoeffBasePath + str(res) + "m.txt" for res in [10, 20]]
-                #Check if both scatteringcoeff-files exist:
+                if(self.platform == self.venusPlatform):
+                    scatteringCoeffs = [self.scatteringCoeffBasePath + "venus.txt"]
+                #Check if the scatteringcoeff-files of the platform exist:
                 if(all(os.path.exists(os.path.join(searchPath, scatteringCoeff)) == True
                        for scatteringCoeff in scatteringCoeffs)):
                     args.scatteringcoeffpath = searchPath
@@ -318,6 +833,12 @@ class TemporalSynthesis():
         if(args.version):
             self.setParameterVersion(args.version)
 
+        #A synthesis initialised with a finished product continues at its synthesis date by default
+        if(args.pathprevL3A and args.date == None and not args.dates):
+            xpath = "/Muscate_Metadata_Document/Product_Characteristics/ACQUISITION_DATE"
+            l3aDate = self.getMetadataField("date", xpath, self.getL3AProductXML(args.pathprevL3A))
+            args.date = self.datetimeToString(self.stringToDatetime(str(l3aDate)), short = True)
+
         #Calculate temporal parameters
         acqPeriod, synthalf, datesAsDatetime = self.getAcquisitionPeriod(args.input)
         #Set temporal parameters to either default values or to user-defined ones
@@ -334,12 +855,22 @@ class TemporalSynthesis():
             args.date = self.datetimeToString(date)
             args.mindate = self.datetimeToString(date - dt.timedelta(days=args.synthalf))
             args.maxdate = self.datetimeToString(date + dt.timedelta(days=args.synthalf))
+        #Several syntheses are updated in the same pass over the inputs, each of them with its own period
+        args.syntheses = [[args.date, args.mindate, args.maxdate]]
+        if(args.dates):
+            args.syntheses = []
+            for synthesisDate in args.dates:
+                date = self.stringToDatetime(synthesisDate.replace("-", ""), short = True)
+                args.syntheses.append([self.datetimeToString(date),
+                                       self.datetimeToString(date - dt.timedelta(days=args.synthalf)),
+                                       self.datetimeToString(date + dt.timedelta(days=args.synthalf))])
+            args.date, args.mindate, args.maxdate = args.syntheses[0]
         #Print warning to indicate wrongly set synthesis parameters
         if(abs(args.synthalf - synthalf) > 2):
             logging.warning("The given Half synthesis period of " + str(args.synthalf) +
                             " days differs from the one in the datelist with " + str(synthalf) + " days.")
         #Standard info message about synthesis date and period
-        logging.info("Synthesis date is: " + args.date)
+        logging.info("Synthesis date is: " + ", ".join([synthesis[0] for synthesis in args.syntheses]))
         logging.info("Half synthesis period in days is: " + str(args.synthalf))
 
         return args
@@ -357,9 +888,11 @@ class TemporalSynthesis():
             self.ParameterVersion = version
         return
 
-    def checkMetadataFieldsEqual(self, xpath, xmllist):
+    def checkMetadataFieldsEqual(self, key, xpath, xmllist):
         """
         @brief Check, whether all field of each XML are the same
+        @param key The name of the field in the metadata index
+        @param xpath The path to the field inside the XML, used if the XML is not indexed
         @return True if a single string is found, False if not
                 If True, the value of the field is returned as well, None if not
         """
@@ -368,10 +901,9 @@ class TemporalSynthesis():
             if(not xml):
                 fieldList.append("")
             try:
-                tree = etree.parse(str(xml))
+                fieldList.append(self.getMetadataField(key, xpath, xml))
             except:
                 raise IOError("Cannot open XML " + xml)
-            fieldList.append(tree.xpath(xpath)[0].text)
         #Check if all items are identical
         if(fieldList.count(fieldList[0]) == len(fieldList)):
             return True, fieldList[0]
@@ -385,7 +917,7 @@ class TemporalSynthesis():
         @return True if a single tile is found, False if not
         """
         xPathToTile = "/Muscate_Metadata_Document/Dataset_Identification/GEOGRAPHICAL_ZONE"
-        return self.checkMetadataFieldsEqual(xPathToTile, xmllist)[0]
+        return self.checkMetadataFieldsEqual("tile", xPathToTile, xmllist)[0]
 
     def getPlatformIdentifier(self, xmllist):
         """
@@ -393,42 +925,71 @@ class TemporalSynthesis():
         @return True if a single tile is found, False if not
         """
         xPathToPlatform = "/Muscate_Metadata_Document/Dataset_Identification/PROJECT"
-        allEqual, platform = self.checkMetadataFieldsEqual(xPathToPlatform, xmllist)
+        allEqual, platform = self.checkMetadataFieldsEqual("project", xPathToPlatform, xmllist)
         if(not allEqual):
             raise ValueError("Multiple platforms found in L2A XML!")
         return platform
 
-    def getL3AProductPath(self, xml):
+    def getL3AProductXML(self, path):
         """
-        @brief find finished Level-3A masks and rasters to be used for the manual-mode
-        @TODO Find a way to feed the rasters into UpdateSynthesis. Modify Parameters maybe?
+        @brief Get the MUSCATE XML of a finished Level-3A product
+        @param path The folder of the product or its XML
+        @return The path to the XML, an empty string if no path is given
         """
-        xmlBase = os.path.dirname(xml)
+        if(not path):
+            return ""
+        if(os.path.isdir(path)):
+            xmls = glob.glob(os.path.join(path, "*_MTD_ALL.xml"))
+            if(len(xmls) != 1):
+                raise IOError("Cannot find a unique MTD_ALL.xml in the L3A product folder " + path)
+            return xmls[0]
+        return path
+
+    def getL3AProductPath(self, path):
+        """
+        @brief Find the rasters of a finished Level-3A product to initialise the synthesis with
+        @param path The folder of the product or its XML
+        @return For each resolution, in the order of the band groups: The weights, dates, list of the FRC reflectances
+                in the band order of the group and flags. An empty list if no product is given.
+        """
+        xml = self.getL3AProductXML(path)
         if(not xml):
             return []
+        xmlBase = os.path.dirname(xml)
         try:
             tree = etree.parse(str(xml))
         except:
             raise IOError("Cannot open XML " + xml)
 
-        l3aProductArguments = []
         xPathBase = "/Muscate_Metadata_Document/Product_Organisation/Muscate_Product"
-        xPathImgs = os.path.join(xPathBase, "Image_List/Image/Image_File_List/IMAGE_FILE")
-        rastersL3A = [img.text for img in tree.xpath(xPathImgs)]
-        nSentinelBands = 10
-        if(len(rastersL3A) != nSentinelBands):
-            raise ValueError("Number of Bands in existing L3 product is not equal to the number of Sentinel-2 bands of" + str(nSentinelBands))
-
-        masksNature = {"Weighted_Average_Dates" : " -prevl3datesr", "Pixel_Weight" : " -prevl3weightsr", "Pixel_Status_Flag" : " -prevl3flagsr"}
-        xPathMaskBase = os.path.join(xPathBase, "Mask_List/Mask")
-        for mask in tree.xpath(xPathMaskBase):
-            currentNature =  mask.xpath("Mask_Properties/NATURE")[0].text
-            currentPaths = mask.xpath("Mask_File_List/MASK_FILE")
-            resolutions = ["1" if(maskFile.attrib["group_id"] == "R1") else "2" for maskFile in currentPaths]
+        reflectances = {}
+        for image in tree.xpath(os.path.join(xPathBase, "Image_List/Image")):
+            if(image.xpath("Image_Properties/NATURE")[0].text == "Flat_Reflectance_Composite"):
+                for imageFile in image.xpath("Image_File_List/IMAGE_FILE"):
+                    reflectances[imageFile.attrib["band_id"]] = os.path.join(xmlBase, imageFile.text)
+
+        masksNature = ["Pixel_Weight", "Weighted_Average_Dates", "Pixel_Status_Flag"]
+        masks = {}
+        for mask in tree.xpath(os.path.join(xPathBase, "Mask_List/Mask")):
+            currentNature = mask.xpath("Mask_Properties/NATURE")[0].text
             if(currentNature in masksNature):
-                [l3aProductArguments.append(masksNature[currentNature] + resolutions[i] + " " + os.path.join(xmlBase, currentPaths[i].text)) for i in range(len(currentPaths))]
-
-        return []
+                for maskFile in mask.xpath("Mask_File_List/MASK_FILE"):
+                    masks.setdefault(maskFile.attrib["group_id"], {})[currentNature] = os.path.join(xmlBase, maskFile.text)
+
+        l3aProduct = []
+        for group in tree.xpath("//Band_Group_List/Group"):
+            groupId = group.attrib["group_id"]
+            bands = [band.text for band in group.xpath("Band_List/BAND_ID")]
+            groupMasks = masks.get(groupId, {})
+            missing = [band for band in bands if band not in reflectances] + [nature for nature in masksNature if nature not in groupMasks]
+            if(missing):
+                raise ValueError("Missing {0} of group {1} in L3A product {2}".format(", ".join(missing), groupId, xml))
+            l3aProduct.append([groupMasks["Pixel_Weight"], groupMasks["Weighted_Average_Dates"],
+                               [reflectances[band] for band in bands], groupMasks["Pixel_Status_Flag"]])
+        if(not l3aProduct):
+            raise ValueError("No band group found in L3A product " + xml)
+        logging.info("Initialising the synthesis with the L3A product " + xml)
+        return l3aProduct
 
     def createDirectory(self, path):
         """
@@ -447,13 +1008,19 @@ class TemporalSynthesis():
                 logging.debug("Cannot create directory " + path)
         return
 
-    def writeGIPP(self, args, path):
+    def writeGIPP(self, args, path, synthesis = None, inputs = None):
         """
         @brief Write the given GIPPs to a temporary XML file
         @param args The argument list, containing all necessary parameters for the processing chain
         @path The path where the GIPP shall be written to
+        @param synthesis The synthesis date, begin and end of its period. If None, the ones of args are used
+        @param inputs The XMLs used for the synthesis. If None, all inputs of args are used
         @return Writing the file TS_GIPP_x-x.xml to the desired folder
         """
+        if(synthesis is None):
+            synthesis = [args.date, args.mindate, args.maxdate]
+        if(inputs is None):
+            inputs = args.input
 
         paramsFilenameXML= path + "/TS_GIPP_v"+ self.ParameterVersion.replace(".","-") +".xml"
         with open(paramsFilenameXML, "wb") as xmlfile:
@@ -474,12 +1041,12 @@ class TemporalSynthesis():
             etree.SubElement(wCLD, "SIGMA_LARGE_CLD").text = str(args.sigmalargecld)
             wDATE = etree.SubElement(gipps, "Weight_On_Date")
             etree.SubElement(wDATE, "WEIGHT_DATE_MIN").text = str(args.weightdatemin)
-            etree.SubElement(wDATE, "SYNTHESIS_DATE").text = str(args.date)
-            etree.SubElement(wDATE, "SYNTHESIS_PERIOD_MIN").text = str(args.mindate)
-            etree.SubElement(wDATE, "SYNTHESIS_PERIOD_MAX").text = str(args.maxdate)
+            etree.SubElement(wDATE, "SYNTHESIS_DATE").text = str(synthesis[0])
+            etree.SubElement(wDATE, "SYNTHESIS_PERIOD_MIN").text = str(synthesis[1])
+            etree.SubElement(wDATE, "SYNTHESIS_PERIOD_MAX").text = str(synthesis[2])
             etree.SubElement(wDATE, "HALF_SYNTHESIS").text = str(args.synthalf)
             usedXMLs = etree.SubElement(gipps, "XML_INPUTS")
-            for index, xml in enumerate(args.input):
+            for index, xml in enumerate(inputs):
                 XMLElement = etree.SubElement(usedXMLs, "XML")
                 XMLElement.text = os.path.basename(xml)
                 XMLElement.set("id", str(index))
@@ -487,21 +1054,56 @@ class TemporalSynthesis():
             et.write(xmlfile, xml_declaration=True, encoding="UTF-8", pretty_print=True)
         return paramsFilenameXML
 
-    def runOTBApplication(self, name, args, testRun = False):
+    def loadOTBPythonAPI(self):
+        """
+        @brief Import the OTB Python API for the in-process backend
+        @return The otbApplication module, None if it cannot be imported
+        """
+        pythonPath = os.path.join(self.execPath, "../lib/otb/python")
+        if(os.path.isdir(pythonPath) and pythonPath not in sys.path):
+            sys.path.append(pythonPath)
+        try:
+            import otbApplication
+        except ImportError as e:
+            logging.warning("Cannot import the OTB Python API, running the OTB Apps as subprocesses: {0}".format(e))
+            return None
+        return otbApplication
+
+    def isInMemory(self):
         """
-        @brief Run an OTB app using the otbApplicationLauncherCommandLine
+        @brief Check, if the images passed between the OTB Apps can be kept in memory
+        @return True for the in-process backend, False otherwise
+        """
+        return self.otbApplication is not None
+
+    def runOTBApplication(self, name, args, testRun = False, inputs = None, write = True):
+        """
+        @brief Run an OTB app, either in-process or using the otbApplicationLauncherCommandLine
         @param name the Name of the application
         @param args The list of arguments to run the app with
         @param testRun True, if only a list of current apps shall be displayed, False otherwise
-        @return The return code of the App, as it is being spawned using subprocess.Popen()
+        @param inputs Dict of input image parameters linked in memory to an output of a previous app, as (app, outputKey).
+               Only used with the in-process backend.
+        @param write False to only execute the app, keeping all its outputs in memory for the following apps.
+               Only used with the in-process backend.
+        @return The return code of the App and either the App itself for the in-process backend
+                or the list of available Apps for a testRun
         """
 
+        if(self.otbApplication and not testRun):
+            return self.runInProcessApplication(name, args, inputs or {}, write)
         fullArgs = ["otbApplicationLauncherCommandLine", name] + args + ["-progress", str(1)]
+        env = None
+        threads = None
         if(not testRun):
             logging.info(" ".join(a for a in fullArgs))
             fullArgs = fullArgs #Prepend other programs here
+            if(self.tuner):
+                threads = self.tuner.getThreads(name)
+                env = dict(os.environ, ITK_GLOBAL_DEFAULT_NUMBER_OF_THREADS=str(threads))
+        startTime = time.time()
         start = timer()
-        proc = subprocess.Popen(fullArgs, shell=False, bufsize=1, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+        proc = subprocess.Popen(fullArgs, shell=False, bufsize=1, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, env=env)
         output = []
         while (True):
             # Read line from stdout, break if EOF reached, append line to output
@@ -517,36 +1119,201 @@ class TemporalSynthesis():
                 if(start >= 0): output.append(str(line[start+1:-1]))
         end = timer()
         returnCode = proc.returncode
+        if(not testRun): self.recordApplication(name, "subprocess", args, startTime, end - start, returnCode, threads)
         #If this is not the testRun, raise an Error:
         if(not testRun and returnCode != 0):
             raise OTBApplicationError(name, returnCode)
         #Print total execution time for the App:
         if(not testRun): logging.info("OTB App {0} took: {1}s".format(name, end - start))
+        if(threads): self.tuner.record(name, threads, end - start)
         return returnCode, output
 
-    def compositePreprocessing(self, platform, xml, scatteringcoeffpath, out, outcld, outwat, outsnw, outaot):
+    def runInProcessApplication(self, name, args, inputs, write):
+        """
+        @brief Run an OTB app in this process using the OTB Python API
+        @param name the Name of the application
+        @param args The list of arguments in the command line format
+        @param inputs Dict of input image parameters linked in memory to an output of a previous app, as (app, outputKey)
+        @param write True to write the outputs having a filename, False to only execute the app
+        @return The return code of the App and the App itself. It has to be kept as long as its outputs are used.
+        """
+
+        logging.info(" ".join([name] + args + ["-{0} <{1}:{2}>".format(key, producer.GetName(), outputKey) for key, (producer, outputKey) in inputs.items()]))
+        app = self.otbApplication.Registry.CreateApplication(name)
+        if(app is None):
+            raise NameError("Cannot create the OTB App {0}".format(name))
+        self.setApplicationParameters(app, args)
+        for key, (producer, outputKey) in inputs.items():
+            app.SetParameterInputImage(key, producer.GetParameterOutputImage(outputKey))
+        startTime = time.time()
+        start = timer()
+        try:
+            returnCode = app.ExecuteAndWriteOutput() if write else app.Execute()
+        except RuntimeError as e:
+            logging.error(str(e))
+            self.recordApplication(name, "inprocess", args, startTime, timer() - start, -1, self.args.nthreads)
+            raise OTBApplicationError(name, -1)
+        end = timer()
+        #Newer versions of the API return nothing and raise on errors
+        returnCode = 0 if returnCode is None else returnCode
+        self.recordApplication(name, "inprocess", args, startTime, end - start, returnCode, self.args.nthreads)
+        if(returnCode != 0):
+            raise OTBApplicationError(name, returnCode)
+        logging.info("OTB App {0} took: {1}s".format(name, end - start))
+        return returnCode, app
+
+    def recordApplication(self, name, backend, args, startTime, seconds, returnCode, threads):
+        """
+        @brief Record the run of an OTB app in the telemetry
+        @param args The list of arguments in the command line format, to read the RAM from
+        """
+        ram = int(args[args.index("-ram") + 1]) if "-ram" in args else None
+        if(threads is None and self.args):
+            threads = self.args.nthreads
+        self.telemetry.record(name, backend, startTime, seconds, returnCode, threads, ram)
+
+    def setApplicationParameters(self, app, args):
+        """
+        @brief Set the parameters of an in-process OTB app from a list of arguments in the command line format
+        @param app The OTB app
+        @param args The list of arguments, each key being prefixed by "-" and followed by its values
+        """
+
+        listTypes = [self.otbApplication.ParameterType_StringList,
+                     self.otbApplication.ParameterType_InputFilenameList,
+                     self.otbApplication.ParameterType_InputImageList]
+        parameters = []
+        for arg in args:
+            if(arg.startswith("-") and not self.isNumber(arg)):
+                parameters.append((arg[1:], []))
+            elif(parameters):
+                parameters[-1][1].append(arg)
+            else:
+                raise ValueError("Value {0} given before any parameter of {1}".format(arg, app.GetName()))
+        for key, values in parameters:
+            if(app.GetParameterType(key) in listTypes):
+                app.SetParameterStringList(key, values)
+            else:
+                app.SetParameterString(key, values[0] if values else "")
+        return
+
+    def isNumber(self, value):
+        """
+        @brief Check, if a string is a number, e.g. to tell negative values from parameter keys
+        """
+        try:
+            float(value)
+            return True
+        except ValueError:
+            return False
+
+    def tempOutput(self, filename):
+        """
+        @brief Append the creation options of the temporary I/O profile to an output filename of an OTB app
+        @param filename The output filename
+        @return The filename, followed by the extended filename options of the profile.
+                The default profile keeps the GDAL defaults.
+        """
+
+        profile = self.args.tempioprofile
+        if(profile == "default"):
+            return str(filename)
+        blockSize = str(self.ioProfileBlockSize)
+        options = [("TILED", "YES"), ("BLOCKXSIZE", blockSize), ("BLOCKYSIZE", blockSize), ("BIGTIFF", "IF_SAFER")] + self.ioProfiles[profile]
+        return str(filename) + "?" + "".join("&gdal:co:{0}={1}".format(key, value) for key, value in options)
+
+    def getRegionOfInterestParameters(self):
+        """
+        @brief Get the parameters restricting an App to the region of interest
+        @return The -roi parameter, or an empty list if the full tile is processed
+        """
+        if(self.args.roi):
+            return ["-roi"] + [str(value) for value in self.args.roi]
+        return []
+
+    def getStageTuner(self):
+        """
+        @brief Create the tuner of the RAM and threads of the Apps.
+               The RAM budget is --ram or half of the available memory. The threads can only be set for each App
+               with the subprocess backend, the in-process backend uses --nthreads for all of them.
+        """
+        ramBudget = self.args.ram
+        if(not ramBudget):
+            ramBudget = max(StageTuner.minRAM, os.sysconf("SC_PAGE_SIZE") * os.sysconf("SC_AVPHYS_PAGES") / (2 * 1024 * 1024))
+        path = self.args.tuning
+        if(path is None and self.args.cache):
+            path = os.path.join(self.args.cache, "tuning.json")
+        return StageTuner(path, ramBudget, self.args.nthreads, self.args.backend == "subprocess")
+
+    def setStageLayouts(self):
+        """
+        @brief Set the size of the rasters of each App and of a pixel over all bands read and written, at the finest resolution
+        """
+        extent, _, _, pixelWidth = self.getTileExtent(self.args.input[0])
+        if(self.args.roi):
+            extent = [max(extent[0], self.args.roi[0]), max(extent[1], self.args.roi[1]),
+                      min(extent[2], self.args.roi[2]), min(extent[3], self.args.roi[3])]
+        width, height = [max(1, int(round(size / pixelWidth))) for size in [extent[2] - extent[0], extent[3] - extent[1]]]
+        #Reflectance bands per pixel of the finest resolution, the S2 20m bands covering four of them
+        reflBands = self.S2_L2A_10M_BANDS + self.S2_L2A_20M_BANDS / 4. if self.platform == self.s2Platform else self.VNS_L2A_BANDS
+        synthesisBands = (reflBands + 3) * len(self.args.syntheses)
+        float32, int16 = 4, 2
+        bytesPerPixel = {"CompositePreprocessing": reflBands * (int16 + float32) + 4 * float32,
+                         #Binarized mask, padded and oversampled Gaussian weights
+                         "WeightOnClouds": 5 * float32,
+                         "WeightAOT": 2 * float32,
+                         "TotalWeight": 3 * float32,
+                         "UpdateSynthesis": reflBands * float32 + 4 * float32 + 2 * synthesisBands * int16}
+        for name, size in bytesPerPixel.items():
+            self.tuner.setLayout(name, width, height, size)
+
+    def getRAMParameters(self, name):
+        """
+        @brief Get the parameters setting the RAM of an App, chosen by the tuner
+        @param name The name of the App
+        @return The -ram parameter
+        """
+        threads = self.tuner.getThreads(name)
+        ram = self.tuner.getRAM(name, threads)
+        logging.info("Tuning {0}: {1} MB of RAM and {2} threads".format(name, ram, threads))
+        return ["-ram", str(ram)]
+
+    def compositePreprocessing(self, platform, xml, scatteringcoeffpath, out, outcld, outwat, outsnw, outaot, writeAll = False):
         """
         @brief Run the compositePreprocessing-App
+        @param writeAll True to write all outputs even with the in-process backend, e.g. to cache them
+        @return The App, if outputs are kept in memory, None otherwise. With the in-process backend, only the cloud and AOT masks
+                are written, as they are read by filename. The other outputs are kept in memory for the UpdateSynthesis.
         """
 
+        inMemory = self.isInMemory() and not writeAll
+
         scatteringcoeffs = [os.path.join(scatteringcoeffpath, self.scatteringCoeffBasePath + str(res) + "m.txt") for res in [10, 20]]
         appName = "CompositePreprocessing"
 
         args = ["-xml", str(xml),
-                "-outcld", str(outcld),
-                "-outwat", str(outwat),
-                "-outsnw", str(outsnw),
-                "-outaot", str(outaot),
-                "-outr1", str(out[0]),]
+                "-outcld", self.tempOutput(outcld),
+                "-outaot", self.tempOutput(outaot)] + self.getRegionOfInterestParameters() + self.getRAMParameters(appName)
+        if(not inMemory):
+            args += ["-outwat", self.tempOutput(outwat),
+                     "-outsnw", self.tempOutput(outsnw),
+                     "-outr1", self.tempOutput(out[0])]
 
         if(platform == self.s2Platform):
-              args += ["-outr2", str(out[1])]
+              if(not inMemory):
+                  args += ["-outr2", self.tempOutput(out[1])]
               args += ["-scatteringcoeffsr1", str(scatteringcoeffs[0]),
                            "-scatteringcoeffsr2", str(scatteringcoeffs[1])]
-        self.runOTBApplication(appName, args)
-        return
-
-    def weightOnClouds(self, cldpath, coarseres, sigmasmallcld, sigmalargecld, kernelwidth, out, cut):
+        else:
+            #The Venus products are directionally corrected like the S2 ones, with the coefficients shipped next to them
+            scatteringcoeffsVns = os.path.join(scatteringcoeffpath, self.scatteringCoeffBasePath + "venus.txt")
+            if(not os.path.exists(scatteringcoeffsVns)):
+                raise OSError("Cannot find the Venus scattering coefficients {0}. Please verify --scatteringcoeffpath".format(scatteringcoeffsVns))
+            args += ["-scatteringcoeffsr1", str(scatteringcoeffsVns)]
+        app = self.runOTBApplication(appName, args)[1]
+        return app if inMemory else None
+
+    def weightOnClouds(self, cldpath, coarseres, sigmasmallcld, sigmalargecld, kernelwidth, out, cut, xmlInput=None):
         """
         @brief Run the WeightOnClouds-App
         """
@@ -557,8 +1324,10 @@ class TemporalSynthesis():
                 "-sigmasmallcld", str(sigmasmallcld),
                 "-sigmalargecld", str(sigmalargecld),
                 "-kernelwidth", str(kernelwidth),
-                "-out", str(out),
-                "-cut", str(cut)]
+                "-out", self.tempOutput(out),
+                "-cut", str(cut)] + self.getRegionOfInterestParameters() + self.getRAMParameters(appName)
+        if(xmlInput):
+            args += ["-xml", str(xmlInput)]
 
         self.runOTBApplication(appName, args)
         return
@@ -571,67 +1340,98 @@ class TemporalSynthesis():
         appName = "WeightAOT"
         args = ["-in", str(aotmsk),
                 "-xml", str(xmlInput),
-                "-out", str(weightAot),
+                "-out", self.tempOutput(weightAot),
                 "-waotmin", str(waotmin),
                 "-waotmax", str(waotmax),
-                "-aotmax", str(aotmax)]
+                "-aotmax", str(aotmax)] + self.getRegionOfInterestParameters() + self.getRAMParameters(appName)
         self.runOTBApplication(appName, args)
         return
 
     def totalWeight(self, xmlInput, weightAot, weightClouds, l3adate, halfsynthesis, wdatemin, out):
         """
         @brief Run the TotalWeight-App
+        @param l3adate The synthesis date. If None, the weights are computed without weight on date
+        @return The App for the in-process backend, None otherwise. With the in-process backend, the weights are not written
+                but kept in memory for the UpdateSynthesis.
         """
 
         appName = "TotalWeight"
         args = ["-xml", str(xmlInput),
                 "-waotfile", str(weightAot),
                 "-wcldfile", str(weightClouds),
-                "-l3adate", str(l3adate),
-                "-halfsynthesis", str(halfsynthesis),
                 "-wdatemin", str(wdatemin),
-                "-out", out]
-        self.runOTBApplication(appName, args)
-        return
-
-    def updateSynthesis(self, platform, reflsIn, xmlInput, cldmsk, watmsk, snwmsk, weightl2a, previousL3Product, finishedL3Product, out):
+                "-out", self.tempOutput(out)] + self.getRegionOfInterestParameters() + self.getRAMParameters(appName)
+        if(l3adate):
+            args += ["-l3adate", str(l3adate),
+                     "-halfsynthesis", str(halfsynthesis)]
+        app = self.runOTBApplication(appName, args, write = not self.isInMemory())[1]
+        return app if self.isInMemory() else None
+
+    def updateSynthesis(self, platform, reflsIn, xmlInput, cldmsk, watmsk, snwmsk, weightl2a, previousL3Product, finishedL3Product, out,
+                        preprocessingApp = None, totalWeightApp = None, synthesisDates = None, halfsynthesis = None, wdatemin = None):
         """
         @brief Run the UpdateSynthesis-App
+        @param preprocessingApp The executed CompositePreprocessing-App to read the reflectances and masks from in memory.
+               If None, they are read from the given files.
+        @param totalWeightApp The executed TotalWeight-App to read the weights from in memory. If None, they are read from weightl2a.
+        @param synthesisDates The dates in the format YYYYMMDD of several syntheses to update in the same pass,
+               which are then written one after the other in the outputs. If None, a single synthesis is updated.
         """
 
         appName = "UpdateSynthesis"
-        args = ["-inr1", str(reflsIn[0]),
-                "-xml", str(xmlInput),
-                "-cld", str(cldmsk),
-                "-wat", str(watmsk),
-                "-snw", str(snwmsk),
-                "-weightl2a", str(weightl2a),
-                "-outr1", str(out[0])]
+        args = ["-xml", str(xmlInput),
+                "-outr1", self.tempOutput(out[0])] + self.getRegionOfInterestParameters() + self.getRAMParameters(appName)
+        inputs = {}
+        if(preprocessingApp):
+            inputs.update({"inr1": (preprocessingApp, "outr1"),
+                           "cld": (preprocessingApp, "outcld"),
+                           "wat": (preprocessingApp, "outwat"),
+                           "snw": (preprocessingApp, "outsnw")})
+        else:
+            args += ["-inr1", str(reflsIn[0]),
+                     "-cld", str(cldmsk),
+                     "-wat", str(watmsk),
+                     "-snw", str(snwmsk)]
+        if(totalWeightApp):
+            inputs["weightl2a"] = (totalWeightApp, "out")
+        else:
+            args += ["-weightl2a", str(weightl2a)]
+        if(synthesisDates):
+            args += ["-l3adates"] + [str(date) for date in synthesisDates] + \
+                    ["-halfsynthesis", str(halfsynthesis),
+                     "-wdatemin", str(wdatemin)]
 
         if(previousL3Product):
-                args += ["-prevproductr1", previousL3Product[0]]
+            args += ["-prevproductr1", previousL3Product[0]]
         elif(finishedL3Product):
-                args += ["-prevl3weightsr1", previousL3Product[0],
-                         "-prevl3datesr1", previousL3Product[1],
-                         "-prevl3reflr1", finishedL3Product[2],
-                         "-prevl3flagsr1", finishedL3Product[3]]
+            weights, dates, refls, flags = finishedL3Product[0]
+            args += ["-prevl3weightsr1", weights,
+                     "-prevl3datesr1", dates,
+                     "-prevl3reflr1"] + refls + \
+                    ["-prevl3flagsr1", flags]
         if(platform == self.s2Platform):
-            args += ["-inr2", str(reflsIn[1]),
-                         "-outr2", str(out[1])]
+            args += ["-outr2", self.tempOutput(out[1])]
+            if(preprocessingApp):
+                inputs["inr2"] = (preprocessingApp, "outr2")
+            else:
+                args += ["-inr2", str(reflsIn[1])]
             if(previousL3Product):
                 args += ["-prevproductr2", previousL3Product[1]]
             elif(finishedL3Product):
-                args += [
-                         "-prevl3weightsr2", finishedL3Product[4],
-                         "-prevl3datesr2", finishedL3Product[5],
-                         "-prevl3reflr2", finishedL3Product[6],
-                         "-prevl3flagsr2", finishedL3Product[7]]
-        self.runOTBApplication(appName, args)
+                weights, dates, refls, flags = finishedL3Product[1]
+                args += ["-prevl3weightsr2", weights,
+                         "-prevl3datesr2", dates,
+                         "-prevl3reflr2"] + refls + \
+                        ["-prevl3flagsr2", flags]
+        self.runOTBApplication(appName, args, inputs = inputs)
         return
 
-    def productFormatter(self, dirrCorr, platform, destination, syntdate, begin, end, xmllist, vcurrent, gipp, cog, cogtemp):
+    def productFormatter(self, dirrCorr, platform, destination, syntdate, begin, end, xmllist, vcurrent, gipp, cog, cogtemp, ioprofile,
+                         synthesis = 0, nsyntheses = 1):
         """
         @brief Run the ProductFormatter-App
+        @param synthesis The index of the synthesis to create the product of, if the files contain several of them
+        @param nsyntheses The number of syntheses in the files
         """
 
         appName = "ProductFormatter"
@@ -645,7 +1445,11 @@ class TemporalSynthesis():
                 "-gipp", gipp,
                 "-cog", str(1 if cog == True else 0),
                 "-cogtemp", str(cogtemp),
-                "-xml"] + xmllist
+                "-ioprofile", str(ioprofile),
+                "-xml"] + xmllist + self.getRegionOfInterestParameters()
+        if(nsyntheses > 1):
+            args += ["-synthesis", str(synthesis),
+                     "-nsyntheses", str(nsyntheses)]
 
         self.runOTBApplication(appName, args)
         return
@@ -677,119 +1481,534 @@ class TemporalSynthesis():
             pass
         return
 
-    def run(self):
+    def getCacheParameters(self):
         """
-        @brief Run the whole synthesis. This is the function to run WASP completely:
-                - Creates the output directories
-                - Writes the GIPP file
-                - Runs the Apps CompositePreprocessing, WeightOnClouds, WeightAOT,
-                    TotalWeight and UpdateSynthis for each input product as a loop
-                - Runs the ProductFormatter after all products have been looped over
-                - Prints the total execution time for the whole synthesis.
-        @note Currently, no Level-3 product can be given as an init.
+        @brief Get the parameters the per-date products depend on, next to the L2A product itself
+        @return List of values and auxiliary files, used to compute the cache key
         """
+        scatteringCoeffs = [os.path.join(self.args.scatteringcoeffpath, self.scatteringCoeffBasePath + suffix)
+                            for suffix in ["10m.txt", "20m.txt", "venus.txt"]]
+        return [self.ExeVersion, self.platform, self.scatteringCoeffsVersion,
+                self.args.coarseres, self.args.sigmasmallcld, self.args.sigmalargecld, self.args.kernelwidth,
+                self.args.weightaotmin, self.args.weightaotmax, self.args.aotmax, self.args.roi] + scatteringCoeffs
 
-        totalTimeStart = timer()
-        logging.info("================= This is WASP Version " + str(self.ExeVersion) + " =================")
+    def computePerDateProducts(self, xmlInput, dirrCorr, cldmsk, watmsk, snwmsk, aotmsk, weightClouds, weightAot, writeAll = False):
+        """
+        @brief Run the Apps whose products only depend on the L2A input: CompositePreprocessing, WeightOnClouds and WeightAOT
+        @param writeAll True to write all products, e.g. to cache them
+        @return The CompositePreprocessing-App, if its outputs are kept in memory, None otherwise
+        """
 
-        # =====================================================================
-        # Output directory creation
-        # =====================================================================
-        self.createDirectory(self.args.out)
-        self.createDirectory(self.args.tempout)
-        gippPath = self.writeGIPP(self.args, self.args.tempout)
+        preprocessingApp = self.compositePreprocessing(self.platform, xmlInput, self.args.scatteringcoeffpath, dirrCorr, cldmsk, watmsk, snwmsk, aotmsk, writeAll)
+
+        coarseres = self.args.coarseres
+        sigmasmallcld = self.args.sigmasmallcld
+        sigmalargecld = self.args.sigmalargecld
+        kernelwidth = self.args.kernelwidth
+        cut = 1 if self.platform == self.s2Platform else 0
+        self.weightOnClouds(cldmsk, coarseres, sigmasmallcld, sigmalargecld, kernelwidth, weightClouds, cut, xmlInput)
+
+        waotmin = self.args.weightaotmin
+        waotmax = self.args.weightaotmax
+        aotmax = self.args.aotmax
+        self.weightAot(aotmsk, xmlInput, weightAot, waotmin, waotmax, aotmax)
+        return preprocessingApp
+
+    def getPerDateProducts(self, index, xmlInput):
+        """
+        @brief Get the products which only depend on the L2A input, either from the cache or by computing them
+        @param index The index of the input, prepended to the temporary files
+        @param xmlInput The L2A XML
+        @return The filenames of the corrected reflectances, the cloud, water, snow and AOT masks, the cloud and AOT weights
+                and the CompositePreprocessing-App, if its outputs are kept in memory
+        """
+
+        perDateFolder, perDateIndex = self.args.tempout, index
+        cacheKey, stagingPath = None, None
+        if(self.cache):
+            cacheKey = self.cache.getKey(xmlInput, self.getCacheParameters())
+            perDateIndex = 0
+            perDateFolder = self.cache.lookup(cacheKey)
+            if(perDateFolder):
+                logging.info("Using the cached products of {0} in {1}".format(xmlInput, perDateFolder))
+            else:
+                stagingPath = self.cache.stage(cacheKey)
+                perDateFolder = stagingPath
+        if(self.platform == self.s2Platform):
+            dirrCorr = self.getFilepath(perDateFolder, "CP_R.tif", perDateIndex, resolution = [1,2])
+        else:
+            dirrCorr = self.getFilepath(perDateFolder, "CP_XS.tif", perDateIndex, resolution = [1])
+        masks = [self.getFilepath(perDateFolder, name, perDateIndex) for name in ["cld10.tif", "wat10.tif", "snw10.tif", "aot10.tif"]]
+        weights = [self.getFilepath(perDateFolder, name, perDateIndex) for name in ["WeightOnCloud.tif", "WeightAot.tif"]]
+
+        preprocessingApp = None
+        if(not self.cache or stagingPath):
+            try:
+                preprocessingApp = self.computePerDateProducts(xmlInput, dirrCorr, *(masks + weights), writeAll = stagingPath is not None)
+            except:
+                if(stagingPath): self.cache.discard(stagingPath)
+                raise
+        if(stagingPath):
+            perDateFolder = self.cache.store(cacheKey, stagingPath, {"xml": os.path.abspath(xmlInput),
+                                                                     "parameters": [str(p) for p in self.getCacheParameters()],
+                                                                     "created": dt.datetime.now().isoformat()})
+            #Point to the files at their final location
+            dirrCorr, masks, weights = [[os.path.join(perDateFolder, os.path.basename(filename)) for filename in filenames]
+                                        for filenames in [dirrCorr, masks, weights]]
+        return [dirrCorr] + masks + weights + [preprocessingApp]
+
+    def getSynthesisInputs(self, synthesis):
+        """
+        @brief Get the inputs acquired within the period of a synthesis
+        @param synthesis The synthesis date, begin and end of its period
+        @return The list of XMLs of these inputs
+        """
+        xpath = "/Muscate_Metadata_Document/Product_Characteristics/ACQUISITION_DATE"
+        begin, end = [self.stringToDatetime(d).date() for d in synthesis[1:]]
+        return [xml for xml in self.args.input
+                if begin <= self.stringToDatetime(str(self.getMetadataField("date", xpath, xml))).date() <= end]
+
+    def getTileExtent(self, xml):
+        """
+        @brief Get the extent of the tile from the geopositioning of its L2A product
+        @param xml The L2A XML
+        @return The extent as xmin, ymin, xmax, ymax, the upper edge of the pixel grid, the largest pixel height
+                and the smallest pixel width of the band groups
+        """
+        tree = etree.parse(str(xml))
+        groups = tree.xpath("//Group_Geopositioning_List/Group_Geopositioning")
+        if(not groups):
+            raise ValueError("No Group_Geopositioning found in " + str(xml))
+        field = lambda group, name: float(group.xpath(name)[0].text)
+        group = groups[0]
+        ulx, uly = field(group, "ULX"), field(group, "ULY")
+        xmax = ulx + field(group, "NCOLS") * field(group, "XDIM")
+        ymin = uly + field(group, "NROWS") * field(group, "YDIM")
+        return [ulx, ymin, xmax, uly], uly, max(abs(field(group, "YDIM")) for group in groups), min(abs(field(group, "XDIM")) for group in groups)
+
+    def getShardExtent(self, shard):
+        """
+        @brief Get the extent of a shard, a horizontal band of the tile or of the region of interest.
+               The bands are cut at the edges of the pixels of all resolutions, thus each pixel belongs to exactly one of them.
+               They do not overlap: WeightOnClouds reads the clouds around its region of interest needed by the Gaussian filters itself.
+        @param shard The index of the shard, starting at the top
+        @return The extent as xmin, ymin, xmax, ymax
+        """
+        extent, top, rowHeight, _ = self.getTileExtent(self.args.input[0])
+        if(self.args.roi):
+            extent = [max(extent[0], self.args.roi[0]), max(extent[1], self.args.roi[1]),
+                      min(extent[2], self.args.roi[2]), min(extent[3], self.args.roi[3])]
+        firstRow = (top - extent[3]) / rowHeight
+        nRows = (extent[3] - extent[1]) / rowHeight
+        if(nRows < self.args.shards):
+            raise ValueError("Cannot split {0} rows of {1}m into {2} shards".format(int(nRows), rowHeight, self.args.shards))
+        edges = [extent[3]] + [top - round(firstRow + i * nRows / self.args.shards) * rowHeight for i in range(1, self.args.shards)] + [extent[1]]
+        return [extent[0], edges[shard + 1], extent[2], edges[shard]]
+
+    def getShardFolder(self, shard):
+        """
+        @brief Get the temporary folder of a shard, shared by all machines running the shards of the same synthesis
+        """
+        return os.path.join(self.args.tempout, "Shard_{0}_of_{1}".format(shard, self.args.shards))
+
+    def getShardStatusFile(self, shard):
+        """
+        @brief Get the file written once a shard is finished, containing the list of its UpdateSynthesis products
+        """
+        return os.path.join(self.getShardFolder(shard), "shard.json")
+
+    def getShardManifest(self, shard):
+        """
+        @brief Get the manifest of a shard: Its extent, all arguments of the run its products depend on and the fingerprints of the input products
+        @return The manifest as it is read back from the status file
+        """
+        arguments = dict((key, value) for key, value in vars(self.args).items() if key not in self.shardIndependentArgs)
+        arguments["input"] = [os.path.abspath(xml) for xml in self.args.input]
+        for key in ["pathprevL3A", "scatteringcoeffpath"]:
+            if(arguments.get(key)):
+                arguments[key] = os.path.abspath(arguments[key])
+        products = list(self.args.input)
+        if(self.args.pathprevL3A):
+            products.append(self.getL3AProductXML(self.args.pathprevL3A))
+        manifest = {"extent": self.getShardExtent(shard),
+                    "arguments": arguments,
+                    "products": dict((os.path.abspath(xml), IntermediateCache.getProductFingerprint(xml)) for xml in products)}
+        return json.loads(json.dumps(manifest))
+
+    def getShardProducts(self, shard):
+        """
+        @brief Get the UpdateSynthesis products of a finished shard
+        @return The list of products per resolution, None if the shard is not finished or was run with other arguments or inputs
+        """
+        try:
+            with open(self.getShardStatusFile(shard)) as f:
+                status = json.load(f)
+        except (IOError, ValueError):
+            return None
+        if(status.get("manifest") != self.getShardManifest(shard) or
+           not all(os.path.exists(product) for product in status.get("products", []))):
+            return None
+        return status["products"]
+
+    def runShards(self):
+        """
+        @brief Run the synthesis of the shards which are not yet finished, each in its own process.
+               Shards can also be run on other machines sharing the temporary directory using --shard.
+        @return For each shard, the list of its UpdateSynthesis products per resolution
+        """
+        missing = [shard for shard in range(self.args.shards) if self.getShardProducts(shard) is None]
+        if(missing):
+            jobs = max(1, min(self.args.shardjobs, len(missing)))
+            logging.info("Running the shards {0} in {1} processes".format(", ".join(str(shard) for shard in missing), jobs))
+            shardArgs = []
+            for shard in missing:
+                args = copy.deepcopy(self.defArgs)
+                args.shard = shard
+                #Share the threads between the processes
+                args.nthreads = max(1, self.args.nthreads // jobs)
+                shardArgs.append(args)
+            #Spawn fresh interpreters, as the OTB Python API cannot be shared with forked processes
+            pool = multiprocessing.get_context("spawn").Pool(jobs)
+            try:
+                pool.map(runSynthesis, shardArgs, chunksize = 1)
+            finally:
+                pool.close()
+                pool.join()
+        shardProducts = [self.getShardProducts(shard) for shard in range(self.args.shards)]
+        if(None in shardProducts):
+            raise RuntimeError("The shards {0} did not finish".format(", ".join(str(shard) for shard, products in enumerate(shardProducts) if products is None)))
+        return shardProducts
+
+    def stitchShards(self, shardProducts):
+        """
+        @brief Stitch the UpdateSynthesis products of the shards to a virtual raster per resolution using gdalbuildvrt.
+               The pixels are only referenced, thus the product is bit-identical to the one of an unsharded synthesis.
+        @param shardProducts For each shard, the list of its UpdateSynthesis products per resolution
+        @return The list of the stitched products per resolution
+        """
+        stitched = []
+        for products in zip(*shardProducts):
+            vrt = os.path.join(self.args.tempout, os.path.splitext(os.path.basename(products[0]))[0] + "_stitched.vrt")
+            fullArgs = ["gdalbuildvrt", "-q", "-srcnodata", "None", "-vrtnodata", "None", vrt] + list(products)
+            logging.info(" ".join(fullArgs))
+            subprocess.check_call(fullArgs)
+            stitched.append(vrt)
+        return stitched
+
+    def synthesize(self, finishedL3AProduct):
+        """
+        @brief Run the Apps CompositePreprocessing, WeightOnClouds, WeightAOT, TotalWeight and UpdateSynthesis
+               for each input product as a loop
+        @param finishedL3AProduct The rasters of a finished L3A product to initialise the synthesis with, see getL3AProductPath
+        @return The list of the UpdateSynthesis products per resolution
+        """
         previousL3AProduct = []
-        finishedL3AProduct = self.getL3AProductPath(self.args.pathprevL3A)
+        synthesisDates = self.getSynthesisDates()
+        self.setStageLayouts()
         for index, xmlInput in enumerate(self.args.input):
-            if(self.platform == self.s2Platform):
-                dirrCorr = self.getFilepath(self.args.tempout, "CP_R.tif", index, resolution = [1,2])
-            else:
-                dirrCorr = self.getFilepath(self.args.tempout, "CP_XS.tif", index, resolution = [1])
-            cldmsk = self.getFilepath(self.args.tempout, "cld10.tif", index)
-            watmsk = self.getFilepath(self.args.tempout, "wat10.tif", index)
-            snwmsk = self.getFilepath(self.args.tempout, "snw10.tif", index)
-            aotmsk = self.getFilepath(self.args.tempout, "aot10.tif", index)
-
-            self.compositePreprocessing(self.platform, xmlInput, self.args.scatteringcoeffpath, dirrCorr, cldmsk, watmsk, snwmsk, aotmsk)
-
-            coarseres = self.args.coarseres
-            sigmasmallcld = self.args.sigmasmallcld
-            sigmalargecld = self.args.sigmalargecld
-            kernelwidth = self.args.kernelwidth
-            weightClouds = self.getFilepath(self.args.tempout, "WeightOnCloud.tif", index)
-            cut = 1 if self.platform == self.s2Platform else 0
-            self.weightOnClouds(cldmsk, coarseres, sigmasmallcld, sigmalargecld, kernelwidth, weightClouds, cut)
-
-            waotmin = self.args.weightaotmin
-            waotmax = self.args.weightaotmax
-            aotmax = self.args.aotmax
-            weightAot = self.getFilepath(self.args.tempout, "WeightAot.tif", index)
-
-            self.weightAot(aotmsk, xmlInput, weightAot, waotmin, waotmax, aotmax)
-
-            l3adate = self.datetimeToString(self.stringToDatetime(self.args.date), short=True) #Convert to short datetime
+            dirrCorr, cldmsk, watmsk, snwmsk, aotmsk, weightClouds, weightAot, preprocessingApp = self.getPerDateProducts(index, xmlInput)
+
+            l3adate = None if synthesisDates else self.datetimeToString(self.stringToDatetime(self.args.date), short=True) #Convert to short datetime
             halfsynthesis = self.args.synthalf
             wdatemin = self.args.weightdatemin
             weightTotal = self.getFilepath(self.args.tempout, "WeightTotal.tif", index)
 
-            self.totalWeight(xmlInput, weightAot, weightClouds, l3adate, halfsynthesis, wdatemin, weightTotal)
+            totalWeightApp = self.totalWeight(xmlInput, weightAot, weightClouds, l3adate, halfsynthesis, wdatemin, weightTotal)
 
             if(self.platform == self.s2Platform):
                 updateSynthesis = self.getFilepath(self.args.tempout, "UpdateSynthesis_R.tif", index, resolution = [1,2])
             else:
                 updateSynthesis = self.getFilepath(self.args.tempout, "UpdateSynthesis_XS.tif", index, resolution = [1])
 
-            self.updateSynthesis(self.platform, dirrCorr, xmlInput, cldmsk, watmsk, snwmsk, weightTotal, previousL3AProduct, finishedL3AProduct, updateSynthesis)
+            self.updateSynthesis(self.platform, dirrCorr, xmlInput, cldmsk, watmsk, snwmsk, weightTotal, previousL3AProduct, finishedL3AProduct, updateSynthesis,
+                                 preprocessingApp, totalWeightApp, synthesisDates, halfsynthesis, wdatemin)
+            #Release the in-memory pipelines of this product
+            preprocessingApp = totalWeightApp = None
 
             if(self.args.removeTemp):
-                [self.removeFile(filename) for filename in dirrCorr]
-                self.removeFile(cldmsk)
-                self.removeFile(watmsk)
-                self.removeFile(snwmsk)
-                self.removeFile(aotmsk)
-                self.removeFile(weightClouds)
-                self.removeFile(weightAot)
+                #Cached products are kept for the next runs
+                if(not self.cache):
+                    [self.removeFile(filename) for filename in dirrCorr]
+                    self.removeFile(cldmsk)
+                    self.removeFile(watmsk)
+                    self.removeFile(snwmsk)
+                    self.removeFile(aotmsk)
+                    self.removeFile(weightClouds)
+                    self.removeFile(weightAot)
                 self.removeFile(weightTotal)
                 [self.removeFile(filename) for filename in previousL3AProduct]
 
             previousL3AProduct = updateSynthesis
             pass
+        return previousL3AProduct
 
+    def getSynthesisDates(self):
+        """
+        @brief Get the dates of the syntheses in the format YYYYMMDD, if several syntheses are updated in the same pass
+        @return The list of dates, None for a single synthesis
+        """
+        #With several synthesis dates, UpdateSynthesis applies the weight on date of each of them
+        syntheses = self.args.syntheses
+        return [self.datetimeToString(self.stringToDatetime(synthesis[0]), short=True) for synthesis in syntheses] \
+               if len(syntheses) > 1 else None
+
+    def run(self):
+        """
+        @brief Run the whole synthesis. This is the function to run WASP completely:
+                - Creates the output directories
+                - Writes the GIPP file
+                - Runs the Apps CompositePreprocessing, WeightOnClouds, WeightAOT,
+                    TotalWeight and UpdateSynthis for each input product as a loop
+                - With several shards, runs this loop for each of them and stitches their products
+                - Runs the ProductFormatter after all products have been looped over, once for each synthesis date
+                - Prints the total execution time for the whole synthesis.
+        @note With --shard, only the loop over the input products is run for the given shard.
+        """
+
+        totalTimeStart = timer()
+        logging.info("================= This is WASP Version " + str(self.ExeVersion) + " =================")
+
+        # =====================================================================
+        # Output directory creation
+        # =====================================================================
+        self.createDirectory(self.args.out)
+        self.createDirectory(self.args.tempout)
+        finishedL3AProduct = self.getL3AProductPath(self.args.pathprevL3A)
+        #The finished product contributes to all syntheses
+        finishedL3AXML = [self.getL3AProductXML(self.args.pathprevL3A)] if finishedL3AProduct else []
+
+        if(self.args.shard != None):
+            roi = self.getShardExtent(self.args.shard)
+            logging.info("Running the shard {0} of {1} with the extent {2}".format(self.args.shard, self.args.shards, " ".join(str(v) for v in roi)))
+            statusFile = self.getShardStatusFile(self.args.shard)
+            manifest = self.getShardManifest(self.args.shard)
+            self.args.roi = roi
+            self.args.tempout = self.getShardFolder(self.args.shard)
+            self.createDirectory(self.args.tempout)
+            updateSynthesis = self.synthesize(finishedL3AProduct)
+            with open(statusFile, "w") as f:
+                json.dump({"manifest": manifest, "products": updateSynthesis}, f)
+            logging.info("================= WASP shard {0} of {1} finished in {2}s =================".format(self.args.shard, self.args.shards, timer() - totalTimeStart))
+            return
+        shardProducts = []
+        if(self.args.shards > 1):
+            shardProducts = self.runShards()
+            updateSynthesis = self.stitchShards(shardProducts)
+        else:
+            updateSynthesis = self.synthesize(finishedL3AProduct)
+
+        syntheses = self.args.syntheses
+        synthesisDates = self.getSynthesisDates()
         platform = self.platform
         destination = self.args.out
-        syntdate = self.args.date
-        begin = self.args.mindate
-        end = self.args.maxdate
-        xmllist = self.args.input
         vcurrent = self.ParameterVersion.replace(".", "-")
-        gipp = gippPath
         cog = self.args.cog
         cogtemp = self.args.tempout
 
         logging.info("COG: {0} Temp: {1}".format(cog ,self.args.tempout))
-        self.productFormatter(updateSynthesis, platform, destination, syntdate, begin, end, xmllist, vcurrent, gipp, cog, cogtemp)
+        for index, synthesis in enumerate(syntheses):
+            syntdate, begin, end = synthesis
+            xmllist = (self.getSynthesisInputs(synthesis) if synthesisDates else self.args.input) + finishedL3AXML
+            if(not xmllist):
+                logging.warning("No input acquired within the synthesis period of {0}, skipping it".format(syntdate))
+                continue
+            gippPath = self.writeGIPP(self.args, self.args.tempout, synthesis, xmllist)
+            self.productFormatter(updateSynthesis, platform, destination, syntdate, begin, end, xmllist, vcurrent, gippPath, cog, cogtemp, self.args.ioprofile,
+                                  index, len(syntheses))
+            if(self.args.removeTemp):
+                self.removeFile(gippPath)
         if(self.args.removeTemp):
             [self.removeFile(filename) for filename in updateSynthesis]
-            self.removeFile(gippPath)
+            for shard in range(len(shardProducts)):
+                shutil.rmtree(self.getShardFolder(shard), ignore_errors = True)
 
         totalTimeEnd = timer()
 
         logging.info("================= WASP synthesis of " + str(len(self.args.input)) + " inputs finished in " + str(totalTimeEnd - totalTimeStart) + "s =================")
         return
 
+class BatchScheduler():
+    """
+    @brief Run the syntheses of many tiles, one process for the products of each tile and period, see getPeriods.
+           The processes are started as long as the RAM and cores budgets allow it, the next one as soon as one finishes.
+    """
+
+    def __init__(self, args):
+        self.args = args
+        self.telemetry = RunTelemetry(args.telemetry)
+        logging.basicConfig(level=logging.INFO, format="%(asctime)s [%(levelname)-5.5s] %(message)s", stream=sys.stdout)
+        if(args.pathprevL3A or args.shard != None):
+            raise ValueError("--pathprevL3A and --shard cannot be used in batch mode")
+        self.cores = args.batchcores if args.batchcores else multiprocessing.cpu_count()
+        self.ramBudget = args.batchram if args.batchram else self.getPhysicalMemory() * 0.8
+        self.threadsPerJob = args.nthreads if args.nthreads else TemporalSynthesis.ITK_GLOBAL_DEFAULT_NUMBER_OF_THREADS
+        self.ramPerApp = args.ram if args.ram else TemporalSynthesis.defBatchRAM
+        #Each job uses the RAM of the running App and as much for the GDAL cache
+        self.ramPerJob = 2 * self.ramPerApp
+
+    def getPhysicalMemory(self):
+        """
+        @brief Get the physical memory of the machine in MB
+        """
+        return os.sysconf("SC_PAGE_SIZE") * os.sysconf("SC_PHYS_PAGES") / (1024 * 1024)
+
+    def findInputs(self):
+        """
+        @brief Find the L2A products of the inputs, which are either XMLs, folders searched recursively for them
+               or indexes written by the MetadataIndex-App in json format
+        @return The list of products, each as dict with the xml, tile, project and date
+        """
+        products = []
+        for path in self.args.input:
+            if(os.path.isdir(path)):
+                xmls = glob.glob(os.path.join(path, "**", "*_MTD_ALL.xml"), recursive = True)
+            elif(os.path.splitext(path)[1] == ".json"):
+                with open(path) as f:
+                    products += [entry for entry in json.load(f) if "error" not in entry]
+                continue
+            else:
+                xmls = [path]
+            for xml in sorted(xmls):
+                tree = etree.parse(xml)
+                field = lambda xpath: tree.xpath("/Muscate_Metadata_Document/" + xpath)[0].text
+                products.append({"xml": os.path.abspath(xml),
+                                 "tile": field("Dataset_Identification/GEOGRAPHICAL_ZONE"),
+                                 "project": field("Dataset_Identification/PROJECT"),
+                                 "date": field("Product_Characteristics/ACQUISITION_DATE")})
+        return products
+
+    def getPeriods(self, acquisitions, dates, synthalf):
+        """
+        @brief Get the synthesis periods of a tile. The periods of synthesis dates which overlap are merged,
+               as their syntheses are updated in the same pass over the inputs.
+               Without synthesis dates, the acquisitions are split into consecutive periods of 2 * synthalf + 1 days.
+        @param acquisitions The acquisition dates of the products of the tile
+        @param dates The synthesis dates, can be empty
+        @param synthalf The half synthesis period in days
+        @return The list of periods as begin, end and synthesis dates
+        """
+        halfPeriod = dt.timedelta(days = synthalf)
+        periods = []
+        if(dates):
+            for date in sorted(dates):
+                if(periods and date - halfPeriod <= periods[-1][1]):
+                    periods[-1][1] = date + halfPeriod
+                    periods[-1][2].append(date)
+                else:
+                    periods.append([date - halfPeriod, date + halfPeriod, [date]])
+            return periods
+        for acquisition in sorted(acquisitions):
+            if(not periods or acquisition > periods[-1][1]):
+                periods.append([acquisition, acquisition + 2 * halfPeriod, []])
+        return periods
+
+    def getJobs(self, products):
+        """
+        @brief Group the products by tile and synthesis period, see getPeriods. Products outside of the periods of the synthesis dates are skipped.
+        @return The list of jobs as name, list of XMLs and synthesis dates, the largest first
+        """
+        dates = self.args.dates if self.args.dates else [self.args.date] if self.args.date else []
+        dates = [dt.datetime.strptime(date.replace("-", ""), "%Y%m%d") for date in dates]
+        tiles = {}
+        for product in products:
+            acquisition = dt.datetime.strptime(str(product["date"])[:10], "%Y-%m-%d")
+            tiles.setdefault((str(product["project"]), str(product["tile"])), []).append((acquisition, product["xml"]))
+        jobs = []
+        for (project, tile), group in tiles.items():
+            synthalf = self.args.synthalf if self.args.synthalf else \
+                       TemporalSynthesis.defS2Syntperiod if project == TemporalSynthesis.s2Platform else TemporalSynthesis.defVnsSyntperiod
+            for begin, end, periodDates in self.getPeriods([acquisition for acquisition, _ in group], dates, synthalf):
+                xmls = [xml for acquisition, xml in sorted(group) if begin <= acquisition <= end]
+                if(xmls):
+                    name = "{0}_{1}_{2}".format(project, tile, begin.strftime("%Y%m%d"))
+                    jobs.append((name, xmls, [date.strftime("%Y%m%d") for date in periodDates]))
+        return sorted(jobs, key = lambda job: len(job[1]), reverse = True)
+
+    def getJobArgs(self, name, xmls, dates, threads):
+        """
+        @brief Get the arguments of the synthesis of a single tile and period
+        @param dates The synthesis dates of the period. If empty, the synthesis date is the middle of the acquisitions
+        """
+        args = copy.deepcopy(self.args)
+        #The job is still part of the batch, which bounds its GDAL cache by --ram
+        args.batch = True
+        args.input = xmls
+        args.date = None
+        args.dates = dates if dates else None
+        args.tempout = os.path.join(args.tempout if args.tempout else args.out, name)
+        args.logging = os.path.join(args.logging, name) if args.logging else ""
+        args.nthreads = threads
+        args.ram = self.ramPerApp
+        return args
+
+    def run(self):
+        """
+        @brief Run the syntheses of all tiles
+        """
+        totalTimeStart = timer()
+        jobs = self.getJobs(self.findInputs())
+        logging.info("Running {0} tile and period jobs with {1} cores and {2} MB of RAM: {3}".format(len(jobs), self.cores, int(self.ramBudget),
+                                                                                      ", ".join(job[0] for job in jobs)))
+        if(self.ramPerJob > self.ramBudget):
+            logging.warning("A job needs {0} MB, more than the RAM budget. Running one job at a time".format(self.ramPerJob))
+        #Spawn fresh interpreters, as the OTB Python API cannot be shared with forked processes
+        context = multiprocessing.get_context("spawn")
+        pending = list(jobs)
+        running = {}
+        failed = []
+        freeCores, freeRAM = self.cores, self.ramBudget
+        while(pending or running):
+            while(pending and freeCores > 0 and (freeRAM >= self.ramPerJob or not running)):
+                #The last jobs share the cores left idle by the finished ones
+                threads = min(max(self.threadsPerJob, freeCores // len(pending)), freeCores)
+                name, xmls, dates = pending.pop(0)
+                process = context.Process(target = runSynthesis, args = (self.getJobArgs(name, xmls, dates, threads),), name = name)
+                process.start()
+                logging.info("Started {0} with {1} inputs and {2} threads".format(name, len(xmls), threads))
+                running[process.sentinel] = (process, threads, timer())
+                freeCores -= threads
+                freeRAM -= self.ramPerJob
+            for sentinel in multiprocessing.connection.wait(list(running)):
+                process, threads, start = running.pop(sentinel)
+                process.join()
+                freeCores += threads
+                freeRAM += self.ramPerJob
+                if(process.exitcode != 0):
+                    logging.error("{0} failed with exit code {1}".format(process.name, process.exitcode))
+                    failed.append(process.name)
+                else:
+                    logging.info("{0} finished in {1}s".format(process.name, timer() - start))
+        logging.info("================= WASP batch of {0} tiles finished in {1}s =================".format(len(jobs), timer() - totalTimeStart))
+        if(failed):
+            raise RuntimeError("The syntheses of {0} failed".format(", ".join(failed)))
+
+def runSynthesis(args):
+    """
+    @brief Run a synthesis in a new process, e.g. of a shard or of a tile in batch mode
+    @param args The command line arguments
+    """
+    TemporalSynthesis(args).run()
+
 if __name__ == "__main__":
     parser = argparse.ArgumentParser()
-    parser.add_argument("-i", "--input",help="The Metadata input products in MUSCATE format. Required.", nargs="+", required=True, type=str)
+    parser.add_argument("-i", "--input",help="The Metadata input products in MUSCATE format. In batch mode, they can be of several tiles. Required.", nargs="+", required=True, type=str)
     parser.add_argument("--verbose", help="Verbose output of the processing. Default is True", default="True", type=str)
     parser.add_argument("-o", "--out", help="Output directory. Required.", required=True, type=str)
     parser.add_argument("-t", "--tempout", help="Temporary output directory. If none is given, it is set to the value of --out", required=False, type=str)
     parser.add_argument("-v", "--version", help="Parameter version. Default is 1.0", required = False, type=str)
     parser.add_argument("-log", "--logging", help="Path to log-file. Default is in the current directory. If none is given, no log-file will be created.", required = False, default="", type=str)
     parser.add_argument("-d" ,"--date", help="L3A synthesis date in the format 'YYYYMMDD'. If none, then the middle date between all products is used", required=False, type=str)
+    parser.add_argument("--dates", help="Several L3A synthesis dates in the format 'YYYYMMDD', which are all updated in the same pass over the inputs. One product is created for each of them. Overrides --date", nargs="+", required=False, type=str)
+    parser.add_argument("--roi", help="Extent xmin ymin xmax ymax in the map coordinates of the products to restrict the processing to, e.g. for tests or small areas. The product contains the pixels whose centre lies within it. If none, the full tile is processed", nargs=4, required=False, type=float)
+    parser.add_argument("--shards", help="Number of horizontal bands to split the tile or the region of interest into, each synthesised in its own process before they are stitched. The product is identical to the unsharded one. Default is 1", required=False, type=int)
+    parser.add_argument("--shardjobs", help="Number of shards run in parallel on this machine. Default is the number of shards", required=False, type=int)
+    parser.add_argument("--shard", help="Only synthesise this shard, starting at 0, e.g. to run the shards on several machines sharing the temporary directory. Run again with --shards only to stitch them and create the product", required=False, type=int)
     parser.add_argument("--synthalf", help="Half synthesis period in days. Default for S2 is 23, for Venus is 9", required=False, type=int)
-    parser.add_argument("--pathprevL3A", help="Path to the previous L3A product folder. Does not have to be set.", required=False, type=str)
+    parser.add_argument("--pathprevL3A", help="Path to a finished L3A product folder or its XML to initialise the synthesis with, e.g. to add late L2A products to it. If --date is not set, its synthesis date is used. Does not have to be set.", required=False, type=str)
     parser.add_argument("-r", "--removeTemp", help="Removes the temporary created files after use. Default is true", required=False)
     parser.add_argument("--cog", help="Write the product conform to the CloudOptimized-Geotiff format. Default is false", required=False)
+    parser.add_argument("--ioprofile", help="I/O profile of the product rasters: default, archive or cog. Default is default", required=False, type=str)
+    parser.add_argument("--tempioprofile", help="I/O profile of the temporary rasters: default, temp-fast or archive. Default is default", required=False, type=str)
     parser.add_argument("--weightaotmin", help="AOT minimum weight. Default is 0.33", required=False, type=float)
     parser.add_argument("--weightaotmax", help="AOT maximum weight. Default is 1", required=False, type=float)
     parser.add_argument("--aotmax", help="AOT Maximum value. Default is 0.8", required=False, type=float)
@@ -798,9 +2017,27 @@ if __name__ == "__main__":
     parser.add_argument("--sigmasmallcld", help="Sigma for small Clouds. Default is 2", required=False, type=float)
     parser.add_argument("--sigmalargecld",  help="Sigma for large Clouds. Default is 10", required=False, type=float)
     parser.add_argument("--weightdatemin", help="Minimum Weight for Dates. Default is 0.5", required=False, type=float)
+    parser.add_argument("--backend", help="Execution backend of the OTB Apps: inprocess runs them with the OTB Python API and keeps the intermediate images in memory, subprocess runs each of them with otbApplicationLauncherCommandLine, e.g. for debugging. Default is inprocess", required=False, type=str)
     parser.add_argument("--nthreads", help="Number of threads to be used for running the chain. Default is 8.", required=False, type=int)
+    parser.add_argument("--ram", help="Maximum RAM in MB of each OTB App. The RAM of each App is chosen from the size of its pixels and its number of threads. In batch mode, it is also the RAM of the GDAL cache of each tile, which is 16384 MB otherwise. Default is half of the available memory, or 2048 MB in batch mode", required=False, type=int)
+    parser.add_argument("--tuning", help="Json file to keep the throughputs measured for each App and number of threads in between runs, used to choose the number of threads of each App with the subprocess backend. Default is tuning.json in the --cache directory if set", required=False, type=str)
+    parser.add_argument("--batch", help="Batch mode: The inputs can be folders searched for L2A products or indexes of the MetadataIndex App in json format. A synthesis is run for each tile and period: The periods of the synthesis dates if given, merged if they overlap, otherwise consecutive periods of 2 * --synthalf + 1 days covering the acquisitions", action="store_true")
+    parser.add_argument("--batchcores", help="Number of cores shared by the tiles in batch mode, each using --nthreads of them. Default is the number of cores of the machine", required=False, type=int)
+    parser.add_argument("--batchram", help="RAM in MB shared by the tiles in batch mode, each using twice --ram. Default is 80%% of the physical memory", required=False, type=int)
+    parser.add_argument("--telemetry", help="Json file to write a performance report of the run to: The wall and CPU time, peak memory, sizes of the files read and written, stream divisions and pixels of each OTB App, and the wall time and pixels of the filters of its pipeline, summed up per App. Includes the shards and the tiles in batch mode. If none, no telemetry is recorded", required=False, type=str)
+    parser.add_argument("--metadatacache", help="Directory to cache binary snapshots of the parsed L2A metadata in. Can be shared between runs. If none, the XMLs are parsed in every step.", required=False, type=str)
+    parser.add_argument("--cache", help="Directory to cache the per-date products in, which do not depend on the synthesis date. Can be shared between runs. If none, they are recomputed in every run.", required=False, type=str)
+    parser.add_argument("--cachesize", help="Size budget of the cache in GB. The least recently used entries are evicted beyond it. Default is 50", required=False, type=float)
     parser.add_argument("--scatteringcoeffpath", help="Path to the scattering coefficients files. If none, it will be searched for using the OTB-App path. Only has to be set for testing-purposes", required=False, type=str)
 
     args = parser.parse_args()
-    TemporalSynthesisApplication = TemporalSynthesis(args)
-    TemporalSynthesisApplication.run()
+    if(args.batch):
+        TemporalSynthesisApplication = BatchScheduler(args)
+    else:
+        TemporalSynthesisApplication = TemporalSynthesis(args)
+    status = "failed"
+    try:
+        TemporalSynthesisApplication.run()
+        status = "finished"
+    finally:
+        TemporalSynthesisApplication.telemetry.writeReport(status)
@@ -45,6 +45,18 @@ class BaseComparison():
         args.version = "1.0"
         args.synthalf = synthalf
         args.date = date
+        args.dates = None
+        args.roi = None
+        args.shards = None
+        args.shard = None
+        args.shardjobs = None
+        args.batch = False
+        args.batchcores = None
+        args.batchram = None
+        args.nthreads = None
+        args.ram = None
+        args.tuning = None
+        args.telemetry = None
         args.cog = "False"
         args.pathprevL3A = None
         args.weightaotmin = None
@@ -56,6 +68,12 @@ class BaseComparison():
         args.sigmalargecld = None
         args.weightdatemin = None
         args.scatteringcoeffpath = None
+        args.metadatacache = None
+        args.ioprofile = None
+        args.tempioprofile = None
+        args.backend = None
+        args.cache = None
+        args.cachesize = None
         args.logging = "" #Disable logging
         return args
 
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+All rights reserved
+
+This file is part of Weighted Average Synthesis Processor (WASP)
+
+Authors:
+- Peter KETTIG <peter.kettig@cnes.fr>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+See the LICENSE.md file for more details.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+SPDX-License-Identifier: GPL-3.0-or-later
+"""
+
+
+import unittest
+import os
+import WASP
+from base_comparison import BaseComparison
+
+class T31TCH_20171008_Init(unittest.TestCase, BaseComparison):
+    """
+    @brief Set up the synthesis from the default arguments, without running it
+    """
+    test_name = "test_S2B_T31TCH_1_20171008"
+    inputs = [os.path.join("SENTINEL2B_20171008-105012-463_L2A_T31TCH_C_V1-0",
+                                  "SENTINEL2B_20171008-105012-463_L2A_T31TCH_C_V1-0_MTD_ALL.xml")]
+
+    def setUp(self):
+        self.setupEnvironment()
+        self.input_path = [os.path.join(self.wasp_test_path,
+                                       self.test_name, "INPUTS", i) for i in self.inputs]
+
+    def test_defaults(self):
+        for backend in [None, "subprocess"]:
+            args = self.createArgs(self.input_path, os.path.join(self.execPath, "init"))
+            args.backend = backend
+            ts = WASP.TemporalSynthesis(args)
+            self.assertEqual(ts.platform, ts.s2Platform)
+            self.assertEqual(ts.args.synthalf, ts.defS2Syntperiod)
+            self.assertEqual(ts.args.nthreads, ts.ITK_GLOBAL_DEFAULT_NUMBER_OF_THREADS)
+            self.assertEqual(ts.args.shards, 1)
+            self.assertEqual(len(ts.args.syntheses), 1)
+        return
+
+    def test_telemetry(self):
+        #The Apps run before the parameters are read are recorded as well, e.g. the MetadataIndex
+        report = os.path.join(self.execPath, "init_telemetry.json")
+        args = self.createArgs(self.input_path, os.path.join(self.execPath, "init"))
+        args.telemetry = report
+        ts = WASP.TemporalSynthesis(args)
+        self.assertTrue(ts.telemetry.isEnabled())
+        ts.telemetry.writeReport("finished")
+        self.assertTrue(os.path.exists(report))
+        os.remove(report)
+        return
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+All rights reserved
+
+This file is part of Weighted Average Synthesis Processor (WASP)
+
+Authors:
+- Peter KETTIG <peter.kettig@cnes.fr>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+See the LICENSE.md file for more details.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+SPDX-License-Identifier: GPL-3.0-or-later
+"""
+
+
+import unittest
+import os
+import WASP
+import CompareL3AProducts
+from base_comparison import BaseComparison
+
+class T31TCH_20171008_Shards(unittest.TestCase, BaseComparison):
+    """
+    @brief Compare the synthesis of a region of a tile split into shards to the unsharded one
+    """
+    test_name = "test_S2B_T31TCH_1_20171008"
+    out_path = os.path.join("SENTINEL2B_20171008-105012-463_L3A_T31TCH_C_V1-0",
+                                "SENTINEL2B_20171008-105012-463_L3A_T31TCH_C_V1-0_MTD_ALL.xml")
+    inputs = [os.path.join("SENTINEL2B_20171008-105012-463_L2A_T31TCH_C_V1-0",
+                                  "SENTINEL2B_20171008-105012-463_L2A_T31TCH_C_V1-0_MTD_ALL.xml")]
+    #Size of the region of interest in m, 192 rows of the 20m bands
+    roiSize = 3840
+    shards = 3
+
+    def setUp(self):
+        self.setupEnvironment()
+
+    def createShardArgs(self, input_path, out, shards = None, synthalf = None):
+        args = self.createArgs(input_path, out, synthalf = synthalf)
+        args.roi = self.roi
+        args.shards = shards
+        args.tempout = os.path.join(out, "temp")
+        args.removeTemp = "False"
+        return args
+
+    def test_run(self):
+        input_path = [os.path.join(self.wasp_test_path,
+                                  self.test_name, "INPUTS", i) for i in self.inputs]
+        for xml in input_path:
+            self.assertTrue(os.path.exists(xml))
+        out_unsharded = os.path.join(self.execPath, "unsharded")
+        out_sharded = os.path.join(self.execPath, "sharded")
+        #Upper left corner of the tile
+        extent = WASP.TemporalSynthesis(self.createArgs(input_path, out_unsharded)).getTileExtent(input_path[0])[0]
+        self.roi = [extent[0], extent[3] - self.roiSize, extent[0] + self.roiSize, extent[3]]
+
+        WASP.TemporalSynthesis(self.createShardArgs(input_path, out_unsharded)).run()
+        ts = WASP.TemporalSynthesis(self.createShardArgs(input_path, out_sharded, shards = self.shards))
+        ts.run()
+        self.assertTrue(os.path.exists(os.path.join(out_unsharded, self.out_path)))
+        self.assertTrue(os.path.exists(os.path.join(out_sharded, self.out_path)))
+
+        #The shards are only reused with the same arguments
+        self.assertIsNotNone(ts.getShardProducts(0))
+        other = WASP.TemporalSynthesis(self.createShardArgs(input_path, out_sharded, shards = self.shards, synthalf = 10))
+        self.assertIsNone(other.getShardProducts(0))
+
+        #The stitched product is bit-identical to the unsharded one
+        comparator = CompareL3AProducts.Comparator(os.path.join(out_unsharded, self.out_path),
+                                                   os.path.join(out_sharded, self.out_path), mse = 0)
+        self.assertTrue(comparator.run())
+        return
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef SYNTHESISACCUMULATORFUNCTOR_H
+#define SYNTHESISACCUMULATORFUNCTOR_H
+
+#include <vector>
+#include "UpdateSynthesisFunctor.h"
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Namespace around Functors to be used in the filters defined below
+ */
+namespace Functor
+{
+
+/**
+ * @brief Band layout of the accumulator state of a single synthesis, stored as float32:
+ * - The sum of the weighted dates of the land observations
+ * - The sum of the weights of the land observations
+ * - The sum of the weights for each reflectance band
+ * - The sum of the weighted reflectances for each reflectance band
+ * - For each class of observations without weight (water, snow, land without weight and cloud):
+ * the number of observations, the sum of their dates, and for each reflectance band
+ * the number of valid reflectances and their sum
+ * @note Only sums are stored, thus the state does not depend on the order in which the dates are added and removed
+ */
+class SynthesisAccumulatorLayout
+{
+public:
+    SynthesisAccumulatorLayout(int nReflBands) : m_nReflBands(nReflBands) {}
+
+    /**
+     * @brief The classes of observations used when no weighted land observation is available.
+     * The cloud class is only used if none of the others was observed
+     */
+    typedef enum {
+        FALLBACK_WATER,
+        FALLBACK_SNOW,
+        FALLBACK_LAND,
+        FALLBACK_CLOUD,
+        FALLBACK_CLASSES_NO
+    } FallbackClass;
+
+    static FlagType GetFallbackFlag(int fallback) {
+        static const FlagType flags[FALLBACK_CLASSES_NO] = {IMG_FLG_WATER, IMG_FLG_SNOW, IMG_FLG_LAND, IMG_FLG_CLOUD};
+        return flags[fallback];
+    }
+
+    int GetNbOfComponents() const { return GetFallbackStartIndex(FALLBACK_CLASSES_NO); }
+    int GetWeightedDateIndex() const { return 0; }
+    int GetObservationWeightIndex() const { return 1; }
+    int GetWeightIndex(int band) const { return 2 + band; }
+    int GetWeightedReflectanceIndex(int band) const { return 2 + m_nReflBands + band; }
+    int GetFallbackCountIndex(int fallback) const { return GetFallbackStartIndex(fallback); }
+    int GetFallbackDateIndex(int fallback) const { return GetFallbackStartIndex(fallback) + 1; }
+    int GetFallbackReflectanceCountIndex(int fallback, int band) const { return GetFallbackStartIndex(fallback) + 2 + band; }
+    int GetFallbackReflectanceIndex(int fallback, int band) const { return GetFallbackStartIndex(fallback) + 2 + m_nReflBands + band; }
+
+    /**
+     * @brief Get the state of an empty accumulator, e.g. outside of the footprint
+     */
+    std::vector<double> GetEmptyState() const {
+        return std::vector<double>(GetNbOfComponents(), 0);
+    }
+
+private:
+    int GetFallbackStartIndex(int fallback) const { return 2 + 2 * m_nReflBands + fallback * (2 + 2 * m_nReflBands); }
+
+    int m_nReflBands;
+};
+
+/**
+ * @brief Functor to add the contribution of an L2A product to the accumulator state of the syntheses, or to remove it.
+ * Unlike the quantified L3A product, the state keeps the sums of the weighted average, thus the contribution of a date
+ * can be removed exactly when a synthesis window slides.
+ * @note Input: L2A reflectances, cloud, water and snow masks, L2A weight, followed by the previous state of each synthesis if available.
+ * Output: the new state of each synthesis, see SynthesisAccumulatorLayout.
+ * Adding and then removing an L2A product gives back the previous state, up to the rounding of the float32 sums.
+ */
+template< class TInput, class TOutput>
+class SynthesisAccumulatorFunctor
+{
+public:
+    SynthesisAccumulatorFunctor();
+    bool operator!=( const SynthesisAccumulatorFunctor & other) const;
+    bool operator==( const SynthesisAccumulatorFunctor & other ) const;
+    TOutput operator()( const TInput & A );
+
+    /**
+     * @brief Initialize the functor
+     * @param presenceVect The relative L2A band index of each L3A reflectance band, -1 if missing
+     * @param nExtractedL2ABandsNo The number of L2A reflectance bands in the input
+     * @param bPrevStateAvailable True, if the input contains the previous state of the syntheses
+     * @param nDate The date of the L2A product as day of year
+     * @param fReflQuantifVal The quantification value of the L2A reflectances
+     * @param bRemove True to remove the contribution of the L2A product, false to add it
+     */
+    void Initialize(const std::vector<int> &presenceVect, int nExtractedL2ABandsNo, bool bPrevStateAvailable,
+                    int nDate, float fReflQuantifVal, bool bRemove);
+
+    /**
+     * @brief Set the weights on date of the syntheses, see UpdateSynthesisFunctor::SetSynthesisWeights
+     */
+    void SetSynthesisWeights(const std::vector<float> &weights);
+
+    int GetNbOfOutputComponents() { return SynthesisAccumulatorLayout(m_nNbOfL3AReflectanceBands).GetNbOfComponents() * static_cast<int>(m_vecSynthesisWeights.size()); }
+
+    const char * GetNameOfClass() { return "SynthesisAccumulatorFunctor"; }
+
+private:
+    void UpdateState(const TInput & A, float fWeight, TOutput & var, int nOffset, int nPrevOffset);
+    void AddToSum(TOutput & var, int nTotalIndex, float fValue, int nSumIndex, float fMinTotal);
+    bool IsMaskSet(const TInput & A, int nIndex);
+    float GetL2AReflectance(const TInput & A, int band);
+
+private:
+    float m_fReflQuantifValue;
+    int m_nCurrentDate;
+    int m_nNbL2ABands;
+    int m_nNbOfL3AReflectanceBands;
+    bool m_bPrevStateAvailable;
+    bool m_bRemove;
+
+    int m_nCloudMaskBandIndex;
+    int m_nWaterMaskBandIndex;
+    int m_nSnowMaskBandIndex;
+    int m_nCurrentL2AWeightBandIndex;
+    int m_nPrevStateBandStartIndex;
+
+    std::vector<int> m_arrL2ABandPresence;
+    std::vector<float> m_vecSynthesisWeights;
+};
+
+/**
+ * @brief Functor to compute the L3A product of each synthesis from its accumulator state,
+ * with the same bands and quantification as the output of UpdateSynthesisFunctor
+ * @note Without weighted land observation, the pixel is the average of the class of observations with the latest average date,
+ * instead of the last observation as with the UpdateSynthesisFunctor, since the last one cannot be restored when its date is removed
+ */
+template< class TInput, class TOutput>
+class SynthesisAccumulatorToL3AFunctor
+{
+public:
+    SynthesisAccumulatorToL3AFunctor() : m_nNbOfL3AReflectanceBands(0), m_nNbOfSyntheses(1) {}
+    bool operator!=( const SynthesisAccumulatorToL3AFunctor & other) const;
+    bool operator==( const SynthesisAccumulatorToL3AFunctor & other ) const;
+    TOutput operator()( const TInput & A );
+
+    /**
+     * @brief Initialize the functor
+     * @param nReflBands The number of L3A reflectance bands
+     * @param nSyntheses The number of syntheses in the accumulator state
+     */
+    void Initialize(int nReflBands, int nSyntheses);
+
+    int GetNbOfOutputComponents() { return (m_nNbOfL3AReflectanceBands + 3) * m_nNbOfSyntheses; }
+
+    const char * GetNameOfClass() { return "SynthesisAccumulatorToL3AFunctor"; }
+
+private:
+    int GetFallback(const TInput & A, int nOffset, const SynthesisAccumulatorLayout & layout);
+
+    int m_nNbOfL3AReflectanceBands;
+    int m_nNbOfSyntheses;
+};
+
+} //namespace Functor
+} //namespace ts
+
+#include "../src/SynthesisAccumulatorFunctor.txx"
+
+#endif // SYNTHESISACCUMULATORFUNCTOR_H
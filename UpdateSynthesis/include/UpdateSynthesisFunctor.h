@@ -84,33 +84,81 @@ public:
     void Initialize(const std::vector<int> presenceVect, int nExtractedL2ABandsNo, int nBlueBandIdx,
                     bool bHasAppendedPrevL2ABlueBand, bool bPrevL3ABandsAvailable,
                     int nDate, float fReflQuantifVal);
+
+    /**
+     * @brief Set the weights on date of the syntheses updated in the same pass
+     * @param weights One factor per synthesis, by which the L2A weight is scaled. A factor that is not positive
+     * excludes the L2A from this synthesis, whose previous values are kept.
+     * @note The previous L3A bands as well as the output contain one block of GetNbOfSynthesisComponents() bands per synthesis
+     */
+    void SetSynthesisWeights(const std::vector<float> &weights);
     void printDebugInfo();
     int GetNbOfL3AReflectanceBands() { return m_nNbOfL3AReflectanceBands; }
 
     /**
      * @brief Get the number of bands in the Output image
-     * @return The band number, which is the original naumber of inputs and the three masks WGT, DTS, FLG
+     * @return The band number, which is the original naumber of inputs and the three masks WGT, DTS, FLG for each synthesis
+     */
+    int GetNbOfOutputComponents() { return GetNbOfSynthesisComponents() * static_cast<int>(m_vecSynthesisWeights.size());}
+
+    /**
+     * @brief Get the number of bands of a single synthesis
+     * @return The number of reflectance bands and the three masks WGT, DTS, FLG
      */
-    int GetNbOfOutputComponents() { return m_nNbOfL3AReflectanceBands + 3;}
+    int GetNbOfSynthesisComponents() { return m_nNbOfL3AReflectanceBands + 3;}
 
     const char * GetNameOfClass() { return "UpdateSynthesisFunctor"; }
 
 private:
-    void ResetCurrentPixelValues(const TInput & A, OutFunctorInfos& outInfos);
+    /**
+     * @brief The input pixel as seen by the update of a single synthesis, without copying it.
+     * The L2A weight is scaled by the weight on date of the synthesis, and the previous L3A bands are read
+     * from the block of the synthesis. Outside of the synthesis period, the L2A is seen as a land pixel without data.
+     */
+    class SynthesisInput
+    {
+    public:
+        typedef typename TInput::ValueType ValueType;
+
+        SynthesisInput(const TInput & A, const UpdateSynthesisFunctor & functor, float fWeightOnDate, int nPrevL3AOffset) :
+            m_Input(A), m_Functor(functor), m_fWeightOnDate(fWeightOnDate), m_nPrevL3AOffset(nPrevL3AOffset) {}
+
+        ValueType operator[](int i) const {
+            if(i >= m_Functor.m_nPrevL3AWeightBandStartIndex) {
+                return m_Input[i + m_nPrevL3AOffset];
+            }
+            if(m_fWeightOnDate <= 0) {
+                return (i < m_Functor.m_nL2ABandStartIndex + m_Functor.m_nNbL2ABands) ? ValueType(NO_DATA_VALUE) : ValueType(0);
+            }
+            if(i == m_Functor.m_nCurrentL2AWeightBandIndex && m_Input[i] > 0) {
+                return m_Input[i] * m_fWeightOnDate;
+            }
+            return m_Input[i];
+        }
+
+    private:
+        const TInput & m_Input;
+        const UpdateSynthesisFunctor & m_Functor;
+        float m_fWeightOnDate;
+        int m_nPrevL3AOffset;
+    };
+
+    void ComputeSynthesis(const SynthesisInput & A, TOutput & var, int nOffset);
+    void ResetCurrentPixelValues(const SynthesisInput & A, OutFunctorInfos& outInfos);
     int GetAbsoluteL2ABandIndex(int index);
     float GetL2AReflectanceForPixelVal(float fPixelVal);
-    void HandleLandPixel(const TInput & A, OutFunctorInfos& outInfos);
-    void HandleSnowOrWaterPixel(const TInput & A, OutFunctorInfos& outInfos);
-    void HandleCloudOrShadowPixel(const TInput & A, OutFunctorInfos& outInfos);
-    bool IsSnowPixel(const TInput & A);
-    bool IsWaterPixel(const TInput & A);
-    bool IsCloudPixel(const TInput & A);
-    bool IsLandPixel(const TInput & A);
-    float GetCurrentL2AWeightValue(const TInput & A);
-    float GetPrevL3AWeightValue(const TInput & A, int offset);
-    short GetPrevL3AWeightedAvDateValue(const TInput & A, int offset);
-    float GetPrevL3AReflectanceValue(const TInput & A, int offset);
-    short GetPrevL3APixelFlagValue(const TInput & A, int offset);
+    void HandleLandPixel(const SynthesisInput & A, OutFunctorInfos& outInfos);
+    void HandleSnowOrWaterPixel(const SynthesisInput & A, OutFunctorInfos& outInfos);
+    void HandleCloudOrShadowPixel(const SynthesisInput & A, OutFunctorInfos& outInfos);
+    bool IsSnowPixel(const SynthesisInput & A);
+    bool IsWaterPixel(const SynthesisInput & A);
+    bool IsCloudPixel(const SynthesisInput & A);
+    bool IsLandPixel(const SynthesisInput & A);
+    float GetCurrentL2AWeightValue(const SynthesisInput & A);
+    float GetPrevL3AWeightValue(const SynthesisInput & A, int offset);
+    short GetPrevL3AWeightedAvDateValue(const SynthesisInput & A, int offset);
+    float GetPrevL3AReflectanceValue(const SynthesisInput & A, int offset);
+    short GetPrevL3APixelFlagValue(const SynthesisInput & A, int offset);
     int GetBlueBandIndex();
     bool IsNoDataValue(float fValue, float fNoDataValue);
 
@@ -138,6 +186,7 @@ private:
     bool m_bHasAppendedPrevL2ABlueBand;
 
     std::vector<int> m_arrL2ABandPresence;
+    std::vector<float> m_vecSynthesisWeights;
 
 };
 } //namespace Functor
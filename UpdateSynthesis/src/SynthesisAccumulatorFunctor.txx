@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "SynthesisAccumulatorFunctor.h"
+
+/**
+ * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
+ */
+namespace ts {
+
+/**
+ * @brief Namespace around Functors to be used in the filters defined below
+ */
+namespace Functor
+{
+
+template< class TInput, class TOutput>
+SynthesisAccumulatorFunctor<TInput,TOutput>::SynthesisAccumulatorFunctor()
+{
+	m_fReflQuantifValue = -1;
+	m_nCurrentDate = 0;
+	m_nNbL2ABands = 0;
+	m_nNbOfL3AReflectanceBands = 0;
+	m_bPrevStateAvailable = false;
+	m_bRemove = false;
+	m_nCloudMaskBandIndex = -1;
+	m_nWaterMaskBandIndex = -1;
+	m_nSnowMaskBandIndex = -1;
+	m_nCurrentL2AWeightBandIndex = -1;
+	m_nPrevStateBandStartIndex = -1;
+	m_vecSynthesisWeights = {1};
+}
+
+template< class TInput, class TOutput>
+void SynthesisAccumulatorFunctor<TInput,TOutput>::Initialize(const std::vector<int> &presenceVect, int nExtractedL2ABandsNo,
+		bool bPrevStateAvailable, int nDate, float fReflQuantifVal, bool bRemove) {
+	m_arrL2ABandPresence = presenceVect;
+	m_nNbOfL3AReflectanceBands = presenceVect.size();
+	m_nNbL2ABands = nExtractedL2ABandsNo;
+	m_bPrevStateAvailable = bPrevStateAvailable;
+	m_nCurrentDate = nDate;
+	m_fReflQuantifValue = fReflQuantifVal;
+	m_bRemove = bRemove;
+
+	// Same input order as for the UpdateSynthesisFunctor: L2A reflectances, masks and weight, then the previous state
+	m_nCloudMaskBandIndex = m_nNbL2ABands;
+	m_nWaterMaskBandIndex = m_nCloudMaskBandIndex + 1;
+	m_nSnowMaskBandIndex = m_nWaterMaskBandIndex + 1;
+	m_nCurrentL2AWeightBandIndex = m_nSnowMaskBandIndex + 1;
+	m_nPrevStateBandStartIndex = m_nCurrentL2AWeightBandIndex + 1;
+}
+
+template< class TInput, class TOutput>
+void SynthesisAccumulatorFunctor<TInput,TOutput>::SetSynthesisWeights(const std::vector<float> &weights) {
+	m_vecSynthesisWeights = weights;
+	if(m_vecSynthesisWeights.empty()) {
+		m_vecSynthesisWeights = {1};
+	}
+}
+
+template< class TInput, class TOutput>
+bool SynthesisAccumulatorFunctor<TInput,TOutput>::operator!=( const SynthesisAccumulatorFunctor & other) const
+{
+	UNUSED(other);
+	return true;
+}
+
+template< class TInput, class TOutput>
+bool SynthesisAccumulatorFunctor<TInput,TOutput>::operator==( const SynthesisAccumulatorFunctor & other ) const
+{
+	return !(*this != other);
+}
+
+template< class TInput, class TOutput>
+TOutput SynthesisAccumulatorFunctor<TInput,TOutput>::operator()( const TInput & A )
+{
+	int nTotalOutBandsNo = GetNbOfOutputComponents();
+	TOutput var(nTotalOutBandsNo);
+	var.SetSize(nTotalOutBandsNo);
+
+	const int nStateBandsNo = SynthesisAccumulatorLayout(m_nNbOfL3AReflectanceBands).GetNbOfComponents();
+	for(size_t k = 0; k < m_vecSynthesisWeights.size(); k++) {
+		UpdateState(A, m_vecSynthesisWeights[k], var, k * nStateBandsNo, m_nPrevStateBandStartIndex + k * nStateBandsNo);
+	}
+	return var;
+}
+
+template< class TInput, class TOutput>
+void SynthesisAccumulatorFunctor<TInput,TOutput>::UpdateState(const TInput & A, float fWeightOnDate, TOutput & var, int nOffset, int nPrevOffset)
+{
+	const SynthesisAccumulatorLayout layout(m_nNbOfL3AReflectanceBands);
+
+	// Start from the previous state
+	if(m_bPrevStateAvailable) {
+		for(int i = 0; i < layout.GetNbOfComponents(); i++) {
+			var[nOffset + i] = A[nPrevOffset + i];
+		}
+	} else {
+		const std::vector<double> emptyState = layout.GetEmptyState();
+		for(int i = 0; i < layout.GetNbOfComponents(); i++) {
+			var[nOffset + i] = emptyState[i];
+		}
+	}
+	// The L2A product is outside of the synthesis period
+	if(fWeightOnDate <= 0) {
+		return;
+	}
+
+	bool bHasValidRefl = false;
+	for(int i = 0; i < m_nNbOfL3AReflectanceBands; i++) {
+		if(GetL2AReflectance(A, i) >= 0) {
+			bHasValidRefl = true;
+		}
+	}
+	if(!bHasValidRefl) {
+		return;
+	}
+
+	const bool bIsCloud = IsMaskSet(A, m_nCloudMaskBandIndex);
+	const bool bIsWater = IsMaskSet(A, m_nWaterMaskBandIndex);
+	const bool bIsSnow = IsMaskSet(A, m_nSnowMaskBandIndex);
+	const float fWeight = static_cast<float>(A[m_nCurrentL2AWeightBandIndex]) * fWeightOnDate;
+	const float fSign = m_bRemove ? -1 : 1;
+
+	if(!bIsCloud && !bIsWater && !bIsSnow && fWeight > 0) {
+		// Land pixels contribute to the sums of the weighted average
+		var[nOffset + layout.GetWeightedDateIndex()] += fSign * fWeight * m_nCurrentDate;
+		AddToSum(var, nOffset + layout.GetObservationWeightIndex(), fSign * fWeight, nOffset + layout.GetWeightedDateIndex(), EPSILON);
+		for(int i = 0; i < m_nNbOfL3AReflectanceBands; i++) {
+			float fRefl = GetL2AReflectance(A, i);
+			if(fRefl >= 0) {
+				var[nOffset + layout.GetWeightedReflectanceIndex(i)] += fSign * fWeight * fRefl;
+				AddToSum(var, nOffset + layout.GetWeightIndex(i), fSign * fWeight, nOffset + layout.GetWeightedReflectanceIndex(i), EPSILON);
+			}
+		}
+		return;
+	}
+
+	// The other observations are counted per class, land without weight being only kept until a weighted one is available
+	int nFallback = SynthesisAccumulatorLayout::FALLBACK_LAND;
+	if(bIsCloud) {
+		nFallback = SynthesisAccumulatorLayout::FALLBACK_CLOUD;
+	} else if(bIsWater) {
+		nFallback = SynthesisAccumulatorLayout::FALLBACK_WATER;
+	} else if(bIsSnow) {
+		nFallback = SynthesisAccumulatorLayout::FALLBACK_SNOW;
+	}
+	var[nOffset + layout.GetFallbackDateIndex(nFallback)] += fSign * m_nCurrentDate;
+	AddToSum(var, nOffset + layout.GetFallbackCountIndex(nFallback), fSign, nOffset + layout.GetFallbackDateIndex(nFallback), 0.5);
+	for(int i = 0; i < m_nNbOfL3AReflectanceBands; i++) {
+		float fRefl = GetL2AReflectance(A, i);
+		if(fRefl >= 0) {
+			var[nOffset + layout.GetFallbackReflectanceIndex(nFallback, i)] += fSign * fRefl;
+			AddToSum(var, nOffset + layout.GetFallbackReflectanceCountIndex(nFallback, i), fSign,
+					nOffset + layout.GetFallbackReflectanceIndex(nFallback, i), 0.5);
+		}
+	}
+}
+
+template< class TInput, class TOutput>
+void SynthesisAccumulatorFunctor<TInput,TOutput>::AddToSum(TOutput & var, int nTotalIndex, float fValue, int nSumIndex, float fMinTotal)
+{
+	var[nTotalIndex] += fValue;
+	// Removing the last contribution only leaves the rounding errors of the sums
+	if(var[nTotalIndex] < fMinTotal) {
+		var[nTotalIndex] = 0;
+		var[nSumIndex] = 0;
+	}
+}
+
+template< class TInput, class TOutput>
+bool SynthesisAccumulatorFunctor<TInput,TOutput>::IsMaskSet(const TInput & A, int nIndex)
+{
+	// No data should not be considered as set
+	return (int)static_cast<float>(A[nIndex]) > 0;
+}
+
+template< class TInput, class TOutput>
+float SynthesisAccumulatorFunctor<TInput,TOutput>::GetL2AReflectance(const TInput & A, int band)
+{
+	int relIdx = m_arrL2ABandPresence[band];
+	if(relIdx == -1) {
+		return NO_DATA_VALUE;
+	}
+	float fPixelVal = static_cast<float>(A[relIdx]);
+	if(fPixelVal < 0) {
+		return NO_DATA_VALUE;
+	}
+	return fPixelVal / m_fReflQuantifValue;
+}
+
+template< class TInput, class TOutput>
+void SynthesisAccumulatorToL3AFunctor<TInput,TOutput>::Initialize(int nReflBands, int nSyntheses) {
+	m_nNbOfL3AReflectanceBands = nReflBands;
+	m_nNbOfSyntheses = nSyntheses;
+}
+
+template< class TInput, class TOutput>
+bool SynthesisAccumulatorToL3AFunctor<TInput,TOutput>::operator!=( const SynthesisAccumulatorToL3AFunctor & other) const
+{
+	UNUSED(other);
+	return true;
+}
+
+template< class TInput, class TOutput>
+bool SynthesisAccumulatorToL3AFunctor<TInput,TOutput>::operator==( const SynthesisAccumulatorToL3AFunctor & other ) const
+{
+	return !(*this != other);
+}
+
+template< class TInput, class TOutput>
+TOutput SynthesisAccumulatorToL3AFunctor<TInput,TOutput>::operator()( const TInput & A )
+{
+	int nTotalOutBandsNo = GetNbOfOutputComponents();
+	TOutput var(nTotalOutBandsNo);
+	var.SetSize(nTotalOutBandsNo);
+
+	const SynthesisAccumulatorLayout layout(m_nNbOfL3AReflectanceBands);
+	int cnt = 0;
+	for(int k = 0; k < m_nNbOfSyntheses; k++) {
+		const int nOffset = k * layout.GetNbOfComponents();
+		const int nFallback = GetFallback(A, nOffset, layout);
+		const float fSumWeights = A[nOffset + layout.GetObservationWeightIndex()];
+		// The same bands as written by the UpdateSynthesisFunctor: Weight, date, flag and reflectances
+		if(fSumWeights > 0) {
+			var[cnt++] = short(fSumWeights * WEIGHT_QUANTIF_VALUE);
+			var[cnt++] = short(A[nOffset + layout.GetWeightedDateIndex()] / fSumWeights);
+			var[cnt++] = IMG_FLG_LAND;
+		} else if(nFallback != -1) {
+			var[cnt++] = 0;
+			var[cnt++] = short(A[nOffset + layout.GetFallbackDateIndex(nFallback)] / A[nOffset + layout.GetFallbackCountIndex(nFallback)] + 0.5);
+			var[cnt++] = SynthesisAccumulatorLayout::GetFallbackFlag(nFallback);
+		} else {
+			var[cnt++] = short(WEIGHT_NO_DATA * WEIGHT_QUANTIF_VALUE);
+			var[cnt++] = short(DATE_NO_DATA);
+			var[cnt++] = IMG_FLG_NO_DATA;
+		}
+		for(int i = 0; i < m_nNbOfL3AReflectanceBands; i++) {
+			const float fBandWeights = A[nOffset + layout.GetWeightIndex(i)];
+			float fRefl = NO_DATA_VALUE;
+			if(fBandWeights > 0) {
+				fRefl = A[nOffset + layout.GetWeightedReflectanceIndex(i)] / fBandWeights;
+			} else if(nFallback != -1 && A[nOffset + layout.GetFallbackReflectanceCountIndex(nFallback, i)] > 0) {
+				fRefl = A[nOffset + layout.GetFallbackReflectanceIndex(nFallback, i)] /
+						A[nOffset + layout.GetFallbackReflectanceCountIndex(nFallback, i)];
+			}
+			if(fRefl < 0) {
+				var[cnt++] = NO_DATA_VALUE;
+			} else {
+				// we save back the pixel value but as digital value and not as reflectance
+				var[cnt++] = short(fRefl * DEFAULT_COMPOSITION_QUANTIF_VALUE);
+			}
+		}
+	}
+	return var;
+}
+
+template< class TInput, class TOutput>
+int SynthesisAccumulatorToL3AFunctor<TInput,TOutput>::GetFallback(const TInput & A, int nOffset, const SynthesisAccumulatorLayout & layout)
+{
+	// The class with the latest average date, clouds only replace pixels without any other observation
+	int nFallback = -1;
+	float fLatestDate = 0;
+	for(int c = 0; c < SynthesisAccumulatorLayout::FALLBACK_CLOUD; c++) {
+		const float fCount = A[nOffset + layout.GetFallbackCountIndex(c)];
+		if(fCount <= 0) {
+			continue;
+		}
+		const float fDate = A[nOffset + layout.GetFallbackDateIndex(c)] / fCount;
+		if(nFallback == -1 || fDate > fLatestDate) {
+			nFallback = c;
+			fLatestDate = fDate;
+		}
+	}
+	if(nFallback == -1 && A[nOffset + layout.GetFallbackCountIndex(SynthesisAccumulatorLayout::FALLBACK_CLOUD)] > 0) {
+		nFallback = SynthesisAccumulatorLayout::FALLBACK_CLOUD;
+	}
+	return nFallback;
+}
+
+} //namespace Functor
+} //namespace ts
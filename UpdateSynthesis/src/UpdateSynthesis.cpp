@@ -34,6 +34,11 @@
 #include "MetadataHelperFactory.h"
 #include "ResamplingBandExtractor.h"
 #include "UpdateSynthesisFunctor.h"
+#include "SynthesisAccumulatorFunctor.h"
+#include "FootprintFunctorImageFilter.h"
+#include "StreamingAlignment.h"
+#include "RegionOfInterest.h"
+#include "PerformanceTelemetry.h"
 #include "BandsDefs.h"
 #include "string_utils.hpp"
 
@@ -78,9 +83,14 @@ public:
 	typedef ObjectList<ConcatenatorFilterType>										ConcatenatorListType;
 
 	typedef ts::Functor::UpdateSynthesisFunctor <InputVectorImageType::PixelType, OutputVectorImageType::PixelType> UpdateSynthesisFunctorType;
-	typedef itk::UnaryFunctorImageFilter< InputVectorImageType, OutputVectorImageType, UpdateSynthesisFunctorType >      UpdateSynthesisFilterType;
+	typedef FootprintUnaryFunctorImageFilter< InputVectorImageType, OutputVectorImageType, UpdateSynthesisFunctorType >      UpdateSynthesisFilterType;
 	typedef ObjectList<UpdateSynthesisFilterType>		UpdateSynthesisListType;
 
+	typedef ts::Functor::SynthesisAccumulatorFunctor <InputVectorImageType::PixelType, InputVectorImageType::PixelType> AccumulatorFunctorType;
+	typedef FootprintUnaryFunctorImageFilter< InputVectorImageType, InputVectorImageType, AccumulatorFunctorType >      AccumulatorFilterType;
+	typedef ts::Functor::SynthesisAccumulatorToL3AFunctor <InputVectorImageType::PixelType, OutputVectorImageType::PixelType> AccumulatorToL3AFunctorType;
+	typedef FootprintUnaryFunctorImageFilter< InputVectorImageType, OutputVectorImageType, AccumulatorToL3AFunctorType >      AccumulatorToL3AFilterType;
+
 private:
 
 	void DoInit()
@@ -113,7 +123,8 @@ private:
 		MandatoryOff("prevl3weightsr1");
 		AddParameter(ParameterType_InputImage, "prevl3datesr1", "Previous l3a product dates R1");
 		MandatoryOff("prevl3datesr1");
-		AddParameter(ParameterType_InputImage, "prevl3reflr1", "Previous l3a product reflectances R1");
+		AddParameter(ParameterType_InputImageList, "prevl3reflr1", "Previous l3a product reflectances R1");
+		SetParameterDescription("prevl3reflr1", "Either a single image with all reflectances, or one image per band as the FRC files of a finished product, in the order of the bands of the resolution");
 		MandatoryOff("prevl3reflr1");
 		AddParameter(ParameterType_InputImage, "prevl3flagsr1", "Previous l3a product flags R1");
 		MandatoryOff("prevl3flagsr1");
@@ -121,7 +132,8 @@ private:
 		MandatoryOff("prevl3weightsr2");
 		AddParameter(ParameterType_InputImage, "prevl3datesr2", "Previous l3a product dates R2");
 		MandatoryOff("prevl3datesr2");
-		AddParameter(ParameterType_InputImage, "prevl3reflr2", "Previous l3a product reflectances R2");
+		AddParameter(ParameterType_InputImageList, "prevl3reflr2", "Previous l3a product reflectances R2");
+		SetParameterDescription("prevl3reflr2", "Either a single image with all reflectances, or one image per band as the FRC files of a finished product, in the order of the bands of the resolution");
 		MandatoryOff("prevl3reflr2");
 		AddParameter(ParameterType_InputImage, "prevl3flagsr2", "Previous l3a product flags R2");
 		MandatoryOff("prevl3flagsr2");
@@ -131,6 +143,46 @@ private:
 		AddParameter(ParameterType_OutputImage, "outr2", "Out image containing all updated synthesis rasters in R2");
 		MandatoryOff("outr2");
 
+		AddParameter(ParameterType_Int, "footprint", "Restrict to valid footprint");
+		SetParameterDescription("footprint", "Without previous L3A product, only process the valid pixels given by the edge mask of the L2A product, the rest is set to no-data");
+		SetDefaultParameterInt("footprint", 1);
+		MandatoryOff("footprint");
+
+		AddParameter(ParameterType_StringList, "l3adates", "Synthesis dates");
+		SetParameterDescription("l3adates", "Dates of the syntheses to update in the same pass, in the format YYYYMMDD. "
+				"Each of them scales the L2A weights by its own weight on date, thus the weightl2a have to be computed without one. "
+				"The outputs and previous products contain the bands of each synthesis one after the other. If not set, a single synthesis is updated with the weights as they are.");
+		MandatoryOff("l3adates");
+		AddParameter(ParameterType_Int, "halfsynthesis", "Half synthesis period");
+		SetParameterDescription("halfsynthesis", "Half synthesis period expressed in days. L2A products outside of the period of a synthesis date do not contribute to it");
+		MandatoryOff("halfsynthesis");
+		AddParameter(ParameterType_Float, "wdatemin", "Minimum date weight");
+		SetParameterDescription("wdatemin", "Minimum weight at edge of synthesis time window.");
+		SetDefaultParameterFloat("wdatemin", 0.5);
+		MandatoryOff("wdatemin");
+
+		AddParameter(ParameterType_InputImage, "prevaccr1", "Previous accumulator state R1");
+		SetParameterDescription("prevaccr1", "Float32 sums of the weighted average written to outaccr1 by a previous execution");
+		MandatoryOff("prevaccr1");
+		AddParameter(ParameterType_InputImage, "prevaccr2", "Previous accumulator state R2");
+		MandatoryOff("prevaccr2");
+		AddParameter(ParameterType_OutputImage, "outaccr1", "Out accumulator state R1");
+		SetParameterDescription("outaccr1", "If set, the synthesis is updated in the float32 accumulator state instead of the previous L3A product. "
+				"The contribution of a date can then be removed exactly, e.g. for sliding synthesis windows. outr1 is computed from the state, if set.");
+		MandatoryOff("outaccr1");
+		AddParameter(ParameterType_OutputImage, "outaccr2", "Out accumulator state R2");
+		MandatoryOff("outaccr2");
+		AddParameter(ParameterType_Int, "remove", "Remove the L2A product from the accumulator state");
+		SetParameterDescription("remove", "Remove the contribution of the L2A product from prevacc instead of adding it. The L2A weights have to be the same as when it was added");
+		SetDefaultParameterInt("remove", 0);
+		MandatoryOff("remove");
+		AddParameter(ParameterType_StringList, "roi", "Region of interest");
+		SetParameterDescription("roi", "Extent xmin ymin xmax ymax in the map coordinates of the inputs. All inputs are cropped to the pixels whose centre lies within it, "
+				"thus they may cover the full tile or already be cropped to the same extent");
+		MandatoryOff("roi");
+
+		AddRAMParameter();
+
 		m_ConcatenatorList = ConcatenatorListType::New();
 		m_UpdateSynthesisList = UpdateSynthesisListType::New();
 		m_ReaderList = ReaderListType::New();
@@ -143,11 +195,16 @@ private:
 
 	void DoExecute()
 	{
+		m_Telemetry.Start(this);
 		std::string inXml = GetParameterAsString("xml");
-		m_CloudMask = GetParameterFloatVectorImage("cld");
-		m_WaterMask = GetParameterFloatVectorImage("wat");
-		m_SnowMask = GetParameterFloatVectorImage("snw");
-		m_WeightsL2A = GetParameterFloatVectorImage("weightl2a");
+		if(HasValue("roi")){
+			m_RegionOfInterest.SetRegionOfInterest(RegionOfInterest::FromStringList(GetParameterStringList("roi")));
+			std::cout << "Region of interest: " << m_RegionOfInterest.GetRegionOfInterest().ToString() << std::endl;
+		}
+		m_CloudMask = m_RegionOfInterest.Extract(GetParameterFloatVectorImage("cld"));
+		m_WaterMask = m_RegionOfInterest.Extract(GetParameterFloatVectorImage("wat"));
+		m_SnowMask = m_RegionOfInterest.Extract(GetParameterFloatVectorImage("snw"));
+		m_WeightsL2A = m_RegionOfInterest.Extract(GetParameterFloatVectorImage("weightl2a"));
 
 		m_CloudMask->UpdateOutputInformation();
 		m_WaterMask->UpdateOutputInformation();
@@ -155,13 +212,21 @@ private:
 		m_WeightsL2A->UpdateOutputInformation();
 
 		auto factory = MetadataHelperFactory::New();
-		auto pHelper = factory->GetMetadataHelper(inXml);
+		auto pHelper = factory->GetMetadataHelper(inXml, MTD_CONTENT_PRODUCT);
 		std::string missionName = pHelper->GetMissionName();
 		size_t nTotalRes = pHelper->getResolutions().getNumberOfResolutions();
 
 		int productDate = pHelper->GetAcquisitionDateAsDoy();
 		std::cout << "Product DOY: " << productDate << std::endl;
 
+		std::vector<float> synthesisWeights = getSynthesisWeights(pHelper->GetAcquisitionDate());
+		const size_t nSyntheses = synthesisWeights.size();
+
+		ValidFootprint::ConstPointer footprint;
+		if(GetParameterInt("footprint") > 0){
+			footprint = ValidFootprint::GetFootprint(pHelper.get());
+		}
+
 		/**
 		 * LOOP HERE:
 		 */
@@ -171,7 +236,7 @@ private:
 			ImageListType::Pointer rasterList = ImageListType::New();
 
 
-			InputVectorImageType::Pointer L2AImage = GetParameterFloatVectorImage(getParameterName("in", resolution));
+			InputVectorImageType::Pointer L2AImage = m_RegionOfInterest.Extract(GetParameterFloatVectorImage(getParameterName("in", resolution)));
 			L2AImage->UpdateOutputInformation();
 			imageListPerResolution->PushBack(L2AImage);
 			imageListPerResolution->PushBack(m_CloudMask);
@@ -214,9 +279,10 @@ private:
 				reader->SetFileName(strL2ABlueBandImg);
 				m_ReaderList->PushBack(reader);
 				reader->UpdateOutputInformation();
-				imageListPerResolution->PushBack(reader->GetOutput());
+				InputVectorImageType::Pointer blueBand = m_RegionOfInterest.Extract(reader->GetOutput());
+				imageListPerResolution->PushBack(blueBand);
 
-				ResampledBandsExtractor.ExtractAllResampledBands(reader->GetOutput(), rasterList, Interpolator_NNeighbor, 10, spacingL2A[0], nDesiredWidth, nDesiredHeight);
+				ResampledBandsExtractor.ExtractAllResampledBands(blueBand, rasterList, Interpolator_NNeighbor, 10, spacingL2A[0], nDesiredWidth, nDesiredHeight);
 				nRelBlueBandIdx = nExtractedBandsNo++;
 			}
 
@@ -227,6 +293,12 @@ private:
 
 			m_VectorObjectList.push_back(imageListPerResolution);
 
+			if(HasValue(getParameterName("outacc", resolution))){
+				updateAccumulator(resolution, L2AImage, ResampledBandsExtractor, rasterList, bandsPresenceVector, nExtractedBandsNo,
+						productDate, pHelper->GetReflectanceQuantificationValue(), synthesisWeights, footprint);
+				continue;
+			}
+
 			int nL3AWidth = -1;
 			int nL3AHeight = -1;
 			bool l3aExist = false;
@@ -238,12 +310,13 @@ private:
 				 * Previous L3 Product found - Case 1 - One file from an ongoing execution:
 				 */
 				l3aExist = true;
-				InputVectorImageType::Pointer prevL3A = GetParameterFloatVectorImage(getParameterName("prevproduct", resolution));
+				InputVectorImageType::Pointer prevL3A = m_RegionOfInterest.Extract(GetParameterFloatVectorImage(getParameterName("prevproduct", resolution)));
 				prevL3A->UpdateOutputInformation();
-				size_t nBandsL3A = prevL3A->GetNumberOfComponentsPerPixel();
-				if(size_t(nBandsL2A) != prevL3A->GetNumberOfComponentsPerPixel()){
+				size_t nBandsL3A = prevL3A->GetNumberOfComponentsPerPixel() / nSyntheses;
+				if(size_t(nBandsL2A) * nSyntheses != prevL3A->GetNumberOfComponentsPerPixel()){
 					itkExceptionMacro("ERROR: Number of L2A and L3A bands are not equal:"
-							+ std::to_string(nBandsL2A) + " " + std::to_string(nBandsL3A));
+							+ std::to_string(nBandsL2A) + " " + std::to_string(prevL3A->GetNumberOfComponentsPerPixel())
+							+ " for " + std::to_string(nSyntheses) + " syntheses");
 				}
 				auto szL3A = prevL3A->GetLargestPossibleRegion().GetSize();
 				nL3AWidth = szL3A[0];
@@ -254,18 +327,22 @@ private:
 					otbMsgDevMacro("WARNING: L3A and L2A product sizes differ: " << "L2A: " << nL2AWidth << " " << nL2AHeight << ", "
 							<< "L3A: " << nL3AWidth << " " << nL3AHeight << std::endl;)
 				}
-				InternalBandImageType::Pointer weights = ResampledBandsExtractor.ExtractImgResampledBand(prevL3A, 1, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
-				rasterList->PushBack(weights);
-				InternalBandImageType::Pointer dates = ResampledBandsExtractor.ExtractImgResampledBand(prevL3A, 2, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
-				rasterList->PushBack(dates);
-				//Starting at #4, cause the three previous ones are the masks:
-				for(size_t i = 4; i < nBandsL3A+1; i ++){
-					InternalBandImageType::Pointer refl = ResampledBandsExtractor.ExtractImgResampledBand(prevL3A, i, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
-					rasterList->PushBack(refl);
+				//The bands of each synthesis follow each other
+				for(size_t k = 0; k < nSyntheses; k++){
+					const size_t nOffset = k * nBandsL3A;
+					InternalBandImageType::Pointer weights = ResampledBandsExtractor.ExtractImgResampledBand(prevL3A, nOffset + 1, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
+					rasterList->PushBack(weights);
+					InternalBandImageType::Pointer dates = ResampledBandsExtractor.ExtractImgResampledBand(prevL3A, nOffset + 2, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
+					rasterList->PushBack(dates);
+					//Starting at #4, cause the three previous ones are the masks:
+					for(size_t i = 4; i < nBandsL3A+1; i ++){
+						InternalBandImageType::Pointer refl = ResampledBandsExtractor.ExtractImgResampledBand(prevL3A, nOffset + i, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
+						rasterList->PushBack(refl);
+					}
+					//Adding the Flags later, because of the internal order of the Functor
+					InternalBandImageType::Pointer flags = ResampledBandsExtractor.ExtractImgResampledBand(prevL3A, nOffset + 3, Interpolator_NNeighbor, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
+					rasterList->PushBack(flags);
 				}
-				//Adding the Flags later, because of the internal order of the Functor
-				InternalBandImageType::Pointer flags = ResampledBandsExtractor.ExtractImgResampledBand(prevL3A, 3, Interpolator_NNeighbor, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
-				rasterList->PushBack(flags);
 			}else if(HasValue(getParameterName("prevl3weights", resolution)) && HasValue(getParameterName("prevl3dates", resolution)) &&
 					HasValue(getParameterName("prevl3refl", resolution)) && HasValue(getParameterName("prevl3flags", resolution)) &&
 					HasValue(getParameterName("prevproduct", resolution)) == false) {
@@ -273,10 +350,14 @@ private:
 				 * Previous L3 Product found - Case 2 - Single files from a previously finished product:
 				 */
 				l3aExist = true;
-				InputVectorImageType::Pointer prevL3AWeight = GetParameterFloatVectorImage(getParameterName("prevl3weights", resolution));
-				InputVectorImageType::Pointer prevL3AAvgDate = GetParameterFloatVectorImage(getParameterName("prevl3dates", resolution));
-				InputVectorImageType::Pointer prevL3ARefl = GetParameterFloatVectorImage(getParameterName("prevl3refl", resolution));
-				InputVectorImageType::Pointer prevL3AFlags = GetParameterFloatVectorImage(getParameterName("prevl3flags", resolution));
+				InputVectorImageType::Pointer prevL3AWeight = m_RegionOfInterest.Extract(GetParameterFloatVectorImage(getParameterName("prevl3weights", resolution)));
+				InputVectorImageType::Pointer prevL3AAvgDate = m_RegionOfInterest.Extract(GetParameterFloatVectorImage(getParameterName("prevl3dates", resolution)));
+				VectorImageListType::Pointer prevL3ARefls = VectorImageListType::New();
+				VectorImageListType::Pointer prevL3AReflFiles = GetParameterImageList(getParameterName("prevl3refl", resolution));
+				for(size_t i = 0; i < prevL3AReflFiles->Size(); i++){
+					prevL3ARefls->PushBack(m_RegionOfInterest.Extract(prevL3AReflFiles->GetNthElement(i).GetPointer()));
+				}
+				InputVectorImageType::Pointer prevL3AFlags = m_RegionOfInterest.Extract(GetParameterFloatVectorImage(getParameterName("prevl3flags", resolution)));
 				prevL3AFlags->UpdateOutputInformation();
 				auto szL3A = prevL3AFlags->GetLargestPossibleRegion().GetSize();
 				nL3AWidth = szL3A[0];
@@ -287,21 +368,30 @@ private:
 					otbMsgDevMacro("WARNING: L3A and L2A product sizes differ: " << "L2A: " << nL2AWidth << " " << nL2AHeight << ", "
 							<< "L3A: " << nL3AWidth << " " << nL3AHeight << std::endl;)
 				}
-				int nL3Weights = ResampledBandsExtractor.ExtractAllResampledBands(prevL3AWeight, rasterList, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
-				int nL3Dates= ResampledBandsExtractor.ExtractAllResampledBands(prevL3AAvgDate, rasterList, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
-				int l3bReflBandsNo = ResampledBandsExtractor.ExtractAllResampledBands(prevL3ARefl, rasterList, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
-				int nL3Flags = ResampledBandsExtractor.ExtractAllResampledBands(prevL3AFlags, rasterList, Interpolator_NNeighbor, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
+				//A finished product is the starting point of all syntheses
+				int nL3Weights = 0, nL3Dates = 0, l3bReflBandsNo = 0, nL3Flags = 0;
+				for(size_t k = 0; k < nSyntheses; k++){
+					nL3Weights = ResampledBandsExtractor.ExtractAllResampledBands(prevL3AWeight, rasterList, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
+					nL3Dates= ResampledBandsExtractor.ExtractAllResampledBands(prevL3AAvgDate, rasterList, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
+					l3bReflBandsNo = 0;
+					for(size_t i = 0; i < prevL3ARefls->Size(); i++){
+						l3bReflBandsNo += ResampledBandsExtractor.ExtractAllResampledBands(prevL3ARefls->GetNthElement(i), rasterList, Interpolator_Linear, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
+					}
+					nL3Flags = ResampledBandsExtractor.ExtractAllResampledBands(prevL3AFlags, rasterList, Interpolator_NNeighbor, spacingPrevL3A[0], spacingL2A[0], nDesiredWidth, nDesiredHeight);
+				}
 
 				if(nL3Flags > 1 || nL3Weights > 1 || nL3Dates > 1){
 					otbMsgDevMacro("WARNING: Level3 mask bands contain more than one channel - Only the first one of each will be used");
 				}
-				if(l3bReflBandsNo != nBandsL2A){
+				if(l3bReflBandsNo != int(bandsPresenceVector.size())){
 					otbMsgDevMacro("WARNING: Level3 image bands unequal to the Level2 image band");
 				}
 
 				imageListPerResolution->PushBack(prevL3AWeight);
 				imageListPerResolution->PushBack(prevL3AAvgDate);
-				imageListPerResolution->PushBack(prevL3ARefl);
+				for(size_t i = 0; i < prevL3ARefls->Size(); i++){
+					imageListPerResolution->PushBack(prevL3ARefls->GetNthElement(i));
+				}
 				imageListPerResolution->PushBack(prevL3AFlags);
 
 			}
@@ -314,10 +404,21 @@ private:
 			UpdateSynthesisFunctorType updateSynthesisFunctor;
 			updateSynthesisFunctor.Initialize(bandsPresenceVector, nExtractedBandsNo, nRelBlueBandIdx, bHasAppendedPrevL2ABlueBand, l3aExist,
 					productDate, pHelper->GetReflectanceQuantificationValue());
+			updateSynthesisFunctor.SetSynthesisWeights(synthesisWeights);
 
 			UpdateSynthesisFilterType::Pointer updateSynthesisFilter = UpdateSynthesisFilterType::New();
 			updateSynthesisFilter->SetFunctor(updateSynthesisFunctor);
 			updateSynthesisFilter->SetInput(concatenator->GetOutput());
+			// Outside of the footprint, the previous L3A values have to be kept, thus only restrict without previous product
+			if(!l3aExist){
+				updateSynthesisFilter->SetFootprint(footprint);
+				std::vector<double> outsideValues;
+				for(size_t k = 0; k < nSyntheses; k++){
+					outsideValues.insert(outsideValues.end(), {WEIGHT_NO_DATA * WEIGHT_QUANTIF_VALUE, DATE_NO_DATA, IMG_FLG_NO_DATA});
+					outsideValues.insert(outsideValues.end(), updateSynthesisFunctor.GetNbOfL3AReflectanceBands(), NO_DATA_VALUE);
+				}
+				updateSynthesisFilter->SetOutsideValues(outsideValues);
+			}
 
 			updateSynthesisFilter->UpdateOutputInformation();
 			int nbComponents = updateSynthesisFunctor.GetNbOfOutputComponents();
@@ -328,10 +429,143 @@ private:
 			SetParameterOutputImagePixelType(getParameterName("out", resolution), ImagePixelType_int16);
 			SetParameterOutputImage(getParameterName("out", resolution), updateSynthesisFilter->GetOutput());
 
+			// Stream along the blocks of the inputs already on the output grid, so that each of them is decoded once
+			std::vector<std::string> alignedInputs = {GetParameterAsString(getParameterName("in", resolution))};
+			for(const std::string &prevName : {"prevproduct", "prevl3weights", "prevl3dates", "prevl3flags"}){
+				if(HasValue(getParameterName(prevName, resolution))){
+					alignedInputs.push_back(GetParameterAsString(getParameterName(prevName, resolution)));
+				}
+			}
+			if(HasValue(getParameterName("prevl3refl", resolution))){
+				std::vector<std::string> prevRefls = GetParameterStringList(getParameterName("prevl3refl", resolution));
+				alignedInputs.insert(alignedInputs.end(), prevRefls.begin(), prevRefls.end());
+			}
+			const std::string outName = getParameterName("out", resolution);
+			SetParameterString(outName, StreamingAlignment::AlignOutput(GetParameterAsString(outName), alignedInputs, GetParameterInt("ram"),
+				m_RegionOfInterest.GetRegionOfInterest(), this->GetLogger()));
+
 		}
 		return;
 	}
 
+	/**
+	 * @brief Update the accumulator state of a resolution and compute the L3A product from it, if requested
+	 * @param resolution The index of the resolution
+	 * @param L2AImage The L2A reflectances of the resolution, giving the output grid
+	 * @param extractor The extractor of the L2A bands in rasterList
+	 * @param rasterList The L2A reflectances, masks and weights, to which the previous state is appended
+	 * @param bandsPresenceVector The relative L2A band index of each L3A reflectance band
+	 * @param nExtractedBandsNo The number of L2A reflectance bands in rasterList
+	 * @param productDate The date of the L2A product as day of year
+	 * @param fReflQuantifVal The quantification value of the L2A reflectances
+	 * @param synthesisWeights The weight on date of each synthesis
+	 * @param footprint The footprint of the L2A product, used without previous state
+	 */
+	void updateAccumulator(size_t resolution, InputVectorImageType::Pointer L2AImage, ResamplingBandExtractor<float> &extractor, ImageListType::Pointer rasterList,
+			const std::vector<int> &bandsPresenceVector, int nExtractedBandsNo, int productDate, float fReflQuantifVal,
+			const std::vector<float> &synthesisWeights, const ValidFootprint::ConstPointer &footprint){
+		const bool bRemove = GetParameterInt("remove") > 0;
+		const ts::Functor::SynthesisAccumulatorLayout layout(bandsPresenceVector.size());
+		const std::string prevName = getParameterName("prevacc", resolution);
+		const bool bPrevStateAvailable = HasValue(prevName);
+		if(bRemove && !bPrevStateAvailable){
+			itkExceptionMacro("Cannot remove the L2A product without previous accumulator state " << prevName);
+		}
+		if(bPrevStateAvailable){
+			InputVectorImageType::Pointer prevState = m_RegionOfInterest.Extract(GetParameterFloatVectorImage(prevName));
+			prevState->UpdateOutputInformation();
+			const size_t nExpectedBands = layout.GetNbOfComponents() * synthesisWeights.size();
+			if(prevState->GetNumberOfComponentsPerPixel() != nExpectedBands){
+				itkExceptionMacro("ERROR: The accumulator state " << prevName << " has " << prevState->GetNumberOfComponentsPerPixel()
+						<< " bands instead of " << nExpectedBands);
+			}
+			auto szL2A = L2AImage->GetLargestPossibleRegion().GetSize();
+			// The sums cannot be interpolated
+			extractor.ExtractAllResampledBands(prevState, rasterList, Interpolator_NNeighbor, prevState->GetSpacing()[0],
+					L2AImage->GetSpacing()[0], szL2A[0], szL2A[1]);
+		}
+		m_ResamplerExtractorList.push_back(extractor);
+		ConcatenatorFilterType::Pointer concatenator = ConcatenatorFilterType::New();
+		concatenator->SetInput(rasterList);
+		m_ObjectList.push_back(rasterList.GetPointer());
+		m_ConcatenatorList->PushBack(concatenator);
+
+		AccumulatorFunctorType accumulatorFunctor;
+		accumulatorFunctor.Initialize(bandsPresenceVector, nExtractedBandsNo, bPrevStateAvailable, productDate, fReflQuantifVal, bRemove);
+		accumulatorFunctor.SetSynthesisWeights(synthesisWeights);
+
+		AccumulatorFilterType::Pointer accumulatorFilter = AccumulatorFilterType::New();
+		accumulatorFilter->SetFunctor(accumulatorFunctor);
+		accumulatorFilter->SetInput(concatenator->GetOutput());
+		// Outside of the footprint, the previous state has to be kept, thus only restrict without previous state
+		if(!bPrevStateAvailable){
+			std::vector<double> outsideValues;
+			for(size_t k = 0; k < synthesisWeights.size(); k++){
+				std::vector<double> emptyState = layout.GetEmptyState();
+				outsideValues.insert(outsideValues.end(), emptyState.begin(), emptyState.end());
+			}
+			accumulatorFilter->SetFootprint(footprint);
+			accumulatorFilter->SetOutsideValues(outsideValues);
+		}
+		accumulatorFilter->UpdateOutputInformation();
+		accumulatorFilter->GetOutput()->SetNumberOfComponentsPerPixel(accumulatorFunctor.GetNbOfOutputComponents());
+		std::cout << "Total Components for the accumulator state: " << accumulatorFunctor.GetNbOfOutputComponents() << std::endl;
+		m_AccumulatorFilters.push_back(accumulatorFilter.GetPointer());
+
+		const std::string outAccName = getParameterName("outacc", resolution);
+		SetParameterOutputImagePixelType(outAccName, ImagePixelType_float);
+		SetParameterOutputImage(outAccName, accumulatorFilter->GetOutput());
+
+		std::vector<std::string> alignedInputs = {GetParameterAsString(getParameterName("in", resolution))};
+		if(bPrevStateAvailable){
+			alignedInputs.push_back(GetParameterAsString(prevName));
+		}
+		SetParameterString(outAccName, StreamingAlignment::AlignOutput(GetParameterAsString(outAccName), alignedInputs, GetParameterInt("ram"),
+				m_RegionOfInterest.GetRegionOfInterest(), this->GetLogger()));
+
+		const std::string outName = getParameterName("out", resolution);
+		if(HasValue(outName)){
+			AccumulatorToL3AFunctorType toL3AFunctor;
+			toL3AFunctor.Initialize(bandsPresenceVector.size(), synthesisWeights.size());
+			AccumulatorToL3AFilterType::Pointer toL3AFilter = AccumulatorToL3AFilterType::New();
+			toL3AFilter->SetFunctor(toL3AFunctor);
+			toL3AFilter->SetInput(accumulatorFilter->GetOutput());
+			toL3AFilter->UpdateOutputInformation();
+			toL3AFilter->GetOutput()->SetNumberOfComponentsPerPixel(toL3AFunctor.GetNbOfOutputComponents());
+			m_AccumulatorFilters.push_back(toL3AFilter.GetPointer());
+			SetParameterOutputImagePixelType(outName, ImagePixelType_int16);
+			SetParameterOutputImage(outName, toL3AFilter->GetOutput());
+			SetParameterString(outName, StreamingAlignment::AlignOutput(GetParameterAsString(outName), alignedInputs, GetParameterInt("ram"),
+				m_RegionOfInterest.GetRegionOfInterest(), this->GetLogger()));
+		}
+	}
+
+	/**
+	 * @brief Get the factor of each synthesis date to scale the L2A weights with
+	 * @param l2aDate The acquisition date of the L2A product in the format YYYYMMDD
+	 * @return The weight on date for each of the l3adates, which is 0 if the L2A product is outside of its synthesis period.
+	 * A single factor of 1 if no l3adates are given.
+	 */
+	std::vector<float> getSynthesisWeights(const std::string &l2aDate){
+		if(!HasValue("l3adates")){
+			return {1};
+		}
+		std::vector<std::string> l3aDates = GetParameterStringList("l3adates");
+		int halfSynthesis = HasValue("halfsynthesis") ? GetParameterInt("halfsynthesis") : 0;
+		float weightOnDateMin = GetParameterFloat("wdatemin");
+		std::vector<float> weights;
+		for(const std::string &l3aDate : l3aDates){
+			int nDays = getDaysBetween(l2aDate, l3aDate);
+			float weight = computeSynthesisWeight(nDays, halfSynthesis, weightOnDateMin);
+			std::cout << "Weight on date for synthesis " << l3aDate << ": " << weight << " (" << nDays << " days)" << std::endl;
+			weights.push_back(weight);
+		}
+		if(weights.empty()){
+			itkExceptionMacro("No synthesis date given in l3adates");
+		}
+		return weights;
+	}
+
 	InputVectorImageType::Pointer             m_CloudMask, m_WaterMask, m_SnowMask, m_WeightsL2A;
 	std::vector<ImageListType::Pointer>		  m_ObjectList;
 	std::vector<VectorImageListType::Pointer> m_VectorObjectList;
@@ -339,6 +573,9 @@ private:
 	ConcatenatorListType::Pointer			  m_ConcatenatorList;
 	UpdateSynthesisListType::Pointer		  m_UpdateSynthesisList;
 	std::vector<ResamplingBandExtractor<float>> m_ResamplerExtractorList;
+	std::vector<itk::ProcessObject::Pointer>	m_AccumulatorFilters;
+	RegionOfInterestExtractor					m_RegionOfInterest;
+	PerformanceTelemetry						m_Telemetry;
 };
 
 } //namespace Wrapper
@@ -60,6 +60,7 @@ UpdateSynthesisFunctor<TInput,TOutput>::UpdateSynthesisFunctor()
 	m_nPrevL3APixelFlagBandIndex = -1;
 	m_nL2ABlueBandIndex = -1;
 	m_nL3ABlueBandIndex = -1;
+	m_vecSynthesisWeights = {1};
 }
 
 template< class TInput, class TOutput>
@@ -83,6 +84,7 @@ UpdateSynthesisFunctor<TInput,TOutput>& UpdateSynthesisFunctor<TInput,TOutput>::
 	m_nPrevL3APixelFlagBandIndex = copy.m_nPrevL3APixelFlagBandIndex;
 	m_nL2ABlueBandIndex = copy.m_nL2ABlueBandIndex;
 	m_nL3ABlueBandIndex = copy.m_nL3ABlueBandIndex;
+	m_vecSynthesisWeights = copy.m_vecSynthesisWeights;
 
 	return *this;
 }
@@ -126,6 +128,14 @@ void UpdateSynthesisFunctor<TInput,TOutput>::Initialize(const std::vector<int> p
 			m_nL2ABlueBandIndex;
 }
 
+template< class TInput, class TOutput>
+void UpdateSynthesisFunctor<TInput,TOutput>::SetSynthesisWeights(const std::vector<float> &weights) {
+	m_vecSynthesisWeights = weights;
+	if(m_vecSynthesisWeights.empty()) {
+		m_vecSynthesisWeights = {1};
+	}
+}
+
 template<class TInput, class TOutput>
 void UpdateSynthesisFunctor<TInput, TOutput>::printDebugInfo(){
 	std::cout << "Indices: \n" << "m_nCurrentDate " << m_nCurrentDate <<
@@ -161,6 +171,24 @@ bool UpdateSynthesisFunctor<TInput,TOutput>::operator==( const UpdateSynthesisFu
 
 template< class TInput, class TOutput>
 TOutput UpdateSynthesisFunctor<TInput,TOutput>::operator()( const TInput & A )
+{
+	int nTotalOutBandsNo = GetNbOfOutputComponents();
+	TOutput var(nTotalOutBandsNo);
+	var.SetSize(nTotalOutBandsNo);
+
+	// Each synthesis is updated from the L2A bands with its own weight and its own previous L3A block
+	const int nSynthesisBandsNo = GetNbOfSynthesisComponents();
+	for(size_t k = 0; k < m_vecSynthesisWeights.size(); k++)
+	{
+		const int nPrevL3AOffset = m_bPrevL3ABandsAvailable ? int(k) * nSynthesisBandsNo : 0;
+		ComputeSynthesis(SynthesisInput(A, *this, m_vecSynthesisWeights[k], nPrevL3AOffset), var, k * nSynthesisBandsNo);
+	}
+
+	return var;
+}
+
+template< class TInput, class TOutput>
+void UpdateSynthesisFunctor<TInput,TOutput>::ComputeSynthesis(const SynthesisInput & A, TOutput & var, int nOffset)
 {
 	OutFunctorInfos outInfos(m_nNbOfL3AReflectanceBands);
 
@@ -183,11 +211,7 @@ TOutput UpdateSynthesisFunctor<TInput,TOutput>::operator()( const TInput & A )
 	//      - one band for flag with the status of each pixel
 	//      - The weighted average reflectance bands -> e.g. 4 or 6 for 10m and 20m respectively for S2
 	// Note: Files are written in this order
-	int nTotalOutBandsNo = GetNbOfOutputComponents();
-	TOutput var(nTotalOutBandsNo);
-	var.SetSize(nTotalOutBandsNo);
-
-	int cnt = 0;
+	int cnt = nOffset;
 
 	// Weighted Average Reflectances
 
@@ -216,12 +240,10 @@ TOutput UpdateSynthesisFunctor<TInput,TOutput>::operator()( const TInput & A )
 			//var[cnt++] = outInfos.m_CurrentWeightedReflectances[i];
 		}
 	}
-
-	return var;
 }
 
 template< class TInput, class TOutput>
-void UpdateSynthesisFunctor<TInput,TOutput>::ResetCurrentPixelValues(const TInput & A, OutFunctorInfos& outInfos)
+void UpdateSynthesisFunctor<TInput,TOutput>::ResetCurrentPixelValues(const SynthesisInput & A, OutFunctorInfos& outInfos)
 {
 	for(int i = 0; i<m_nNbOfL3AReflectanceBands; i++)
 	{
@@ -254,7 +276,7 @@ float UpdateSynthesisFunctor<TInput,TOutput>::GetL2AReflectanceForPixelVal(float
 }
 
 template< class TInput, class TOutput>
-void UpdateSynthesisFunctor<TInput,TOutput>::HandleLandPixel(const TInput & A, OutFunctorInfos& outInfos)
+void UpdateSynthesisFunctor<TInput,TOutput>::HandleLandPixel(const SynthesisInput & A, OutFunctorInfos& outInfos)
 {
 	bool bAllReflsAreNoData = true;
 
@@ -332,7 +354,7 @@ void UpdateSynthesisFunctor<TInput,TOutput>::HandleLandPixel(const TInput & A, O
 }
 
 template< class TInput, class TOutput>
-void UpdateSynthesisFunctor<TInput,TOutput>::HandleSnowOrWaterPixel(const TInput & A, OutFunctorInfos& outInfos)
+void UpdateSynthesisFunctor<TInput,TOutput>::HandleSnowOrWaterPixel(const SynthesisInput & A, OutFunctorInfos& outInfos)
 {
 	FlagType curFlgType = IsWaterPixel(A) ? IMG_FLG_WATER : IMG_FLG_SNOW;
 	bool bCurrentPixelWeightedDateSet = false;
@@ -393,7 +415,7 @@ void UpdateSynthesisFunctor<TInput,TOutput>::HandleSnowOrWaterPixel(const TInput
 }
 
 template< class TInput, class TOutput>
-void UpdateSynthesisFunctor<TInput,TOutput>::HandleCloudOrShadowPixel(const TInput & A, OutFunctorInfos& outInfos)
+void UpdateSynthesisFunctor<TInput,TOutput>::HandleCloudOrShadowPixel(const SynthesisInput & A, OutFunctorInfos& outInfos)
 {
 	for(int i = 0; i<m_nNbOfL3AReflectanceBands; i++)
 	{
@@ -470,7 +492,7 @@ void UpdateSynthesisFunctor<TInput,TOutput>::HandleCloudOrShadowPixel(const TInp
 }
 
 template< class TInput, class TOutput>
-bool UpdateSynthesisFunctor<TInput,TOutput>::IsSnowPixel(const TInput & A)
+bool UpdateSynthesisFunctor<TInput,TOutput>::IsSnowPixel(const SynthesisInput & A)
 {
 	if(m_nSnowMaskBandIndex == -1)
 		return false;
@@ -484,7 +506,7 @@ bool UpdateSynthesisFunctor<TInput,TOutput>::IsSnowPixel(const TInput & A)
 }
 
 template< class TInput, class TOutput>
-bool UpdateSynthesisFunctor<TInput,TOutput>::IsWaterPixel(const TInput & A)
+bool UpdateSynthesisFunctor<TInput,TOutput>::IsWaterPixel(const SynthesisInput & A)
 {
 	if(m_nWaterMaskBandIndex == -1)
 		return false;
@@ -498,7 +520,7 @@ bool UpdateSynthesisFunctor<TInput,TOutput>::IsWaterPixel(const TInput & A)
 }
 
 template< class TInput, class TOutput>
-bool UpdateSynthesisFunctor<TInput,TOutput>::IsCloudPixel(const TInput & A)
+bool UpdateSynthesisFunctor<TInput,TOutput>::IsCloudPixel(const SynthesisInput & A)
 {
 	if(m_nCloudMaskBandIndex== -1)
 		return false;
@@ -512,13 +534,13 @@ bool UpdateSynthesisFunctor<TInput,TOutput>::IsCloudPixel(const TInput & A)
 }
 
 template< class TInput, class TOutput>
-bool UpdateSynthesisFunctor<TInput,TOutput>::IsLandPixel(const TInput & A)
+bool UpdateSynthesisFunctor<TInput,TOutput>::IsLandPixel(const SynthesisInput & A)
 {
 	return (!IsSnowPixel(A) && !IsWaterPixel(A) && !IsCloudPixel(A));
 }
 
 template< class TInput, class TOutput>
-float UpdateSynthesisFunctor<TInput,TOutput>::GetCurrentL2AWeightValue(const TInput & A)
+float UpdateSynthesisFunctor<TInput,TOutput>::GetCurrentL2AWeightValue(const SynthesisInput & A)
 {
 	// TODO: Normally, this should not happen so we should log this error and maybe throw an exception
 	if(m_nCurrentL2AWeightBandIndex == -1)
@@ -529,7 +551,7 @@ float UpdateSynthesisFunctor<TInput,TOutput>::GetCurrentL2AWeightValue(const TIn
 }
 
 template< class TInput, class TOutput>
-float UpdateSynthesisFunctor<TInput,TOutput>::GetPrevL3AWeightValue(const TInput & A, int offset)
+float UpdateSynthesisFunctor<TInput,TOutput>::GetPrevL3AWeightValue(const SynthesisInput & A, int offset)
 {
 	if(!m_bPrevL3ABandsAvailable || m_nPrevL3AWeightBandStartIndex == -1)
 		return WEIGHT_NO_DATA;
@@ -544,7 +566,7 @@ float UpdateSynthesisFunctor<TInput,TOutput>::GetPrevL3AWeightValue(const TInput
 }
 
 template< class TInput, class TOutput>
-short UpdateSynthesisFunctor<TInput,TOutput>::GetPrevL3AWeightedAvDateValue(const TInput & A, int offset)
+short UpdateSynthesisFunctor<TInput,TOutput>::GetPrevL3AWeightedAvDateValue(const SynthesisInput & A, int offset)
 {
 	if(!m_bPrevL3ABandsAvailable || m_nPrevL3AWeightedAvDateBandIndex == -1)
 		return DATE_NO_DATA;
@@ -559,7 +581,7 @@ short UpdateSynthesisFunctor<TInput,TOutput>::GetPrevL3AWeightedAvDateValue(cons
 }
 
 template< class TInput, class TOutput>
-float UpdateSynthesisFunctor<TInput,TOutput>::GetPrevL3AReflectanceValue(const TInput & A, int offset)
+float UpdateSynthesisFunctor<TInput,TOutput>::GetPrevL3AReflectanceValue(const SynthesisInput & A, int offset)
 {
 	if(!m_bPrevL3ABandsAvailable || m_nPrevL3AReflectanceBandStartIndex == -1)
 		return NO_DATA_VALUE;
@@ -579,7 +601,7 @@ float UpdateSynthesisFunctor<TInput,TOutput>::GetPrevL3AReflectanceValue(const T
 }
 
 template< class TInput, class TOutput>
-short UpdateSynthesisFunctor<TInput,TOutput>::GetPrevL3APixelFlagValue(const TInput & A, int offset)
+short UpdateSynthesisFunctor<TInput,TOutput>::GetPrevL3APixelFlagValue(const SynthesisInput & A, int offset)
 {
 	if(!m_bPrevL3ABandsAvailable || m_nPrevL3APixelFlagBandIndex == -1)
 		return IMG_FLG_NO_DATA;
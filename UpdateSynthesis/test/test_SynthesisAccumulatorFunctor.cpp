@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE SynthesisAccumulatorFunctor
+#include <boost/test/unit_test.hpp>
+#include "itkVariableLengthVector.h"
+#include "SynthesisAccumulatorFunctor.h"
+#include <algorithm>
+#include <vector>
+
+using namespace ts;
+
+typedef itk::VariableLengthVector<float>		StatePixelType;
+typedef itk::VariableLengthVector<short>		L3APixelType;
+typedef Functor::SynthesisAccumulatorFunctor<StatePixelType, StatePixelType>	AccumulatorFunctorType;
+typedef Functor::SynthesisAccumulatorToL3AFunctor<StatePixelType, L3APixelType>	AccumulatorToL3AFunctorType;
+
+#define N_L2A_BANDS			2
+#define N_SYNTHESES			2
+
+/**
+ * @brief The L2A bands of a pixel: reflectances, cloud, water and snow masks and weight
+ */
+struct L2A{
+	float refls[N_L2A_BANDS];
+	float cloud;
+	float water;
+	float snow;
+	float weight;
+	int date;
+};
+
+const L2A LAND = {{500, 800}, 0, 0, 0, 0.8f, 100};
+const L2A LAND_PARTIAL = {{NO_DATA_VALUE, 700}, 0, 0, 0, 0.6f, 105};
+const L2A LAND_UNWEIGHTED = {{450, 750}, 0, 0, 0, 0, 108};
+const L2A CLOUD = {{3000, 3500}, 1, 0, 0, 0.1f, 110};
+const L2A WATER = {{100, 50}, 0, 1, 0, 0.5f, 115};
+const L2A SNOW = {{6000, 6500}, 0, 0, 1, 0.5f, 120};
+const L2A NO_DATA = {{NO_DATA_VALUE, NO_DATA_VALUE}, 0, 0, 0, 0, 125};
+
+/**
+ * @brief Add or remove an L2A product to the state of the syntheses
+ */
+StatePixelType update(const StatePixelType &state, const L2A &l2a, bool bRemove){
+	AccumulatorFunctorType functor;
+	functor.Initialize({0, 1}, N_L2A_BANDS, state.GetSize() > 0, l2a.date, 10000, bRemove);
+	functor.SetSynthesisWeights({1, 0.5});
+	std::vector<float> values(l2a.refls, l2a.refls + N_L2A_BANDS);
+	values.insert(values.end(), {l2a.cloud, l2a.water, l2a.snow, l2a.weight});
+	for(size_t i = 0; i < state.GetSize(); i++){
+		values.push_back(state[i]);
+	}
+	StatePixelType pixel(values.size());
+	for(size_t i = 0; i < values.size(); i++){
+		pixel[i] = values[i];
+	}
+	return functor(pixel);
+}
+
+StatePixelType add(const std::vector<L2A> &l2as){
+	StatePixelType state;
+	for(const L2A &l2a : l2as){
+		state = update(state, l2a, false);
+	}
+	return state;
+}
+
+L3APixelType toL3A(const StatePixelType &state){
+	AccumulatorToL3AFunctorType functor;
+	functor.Initialize(N_L2A_BANDS, N_SYNTHESES);
+	return functor(state);
+}
+
+/**
+ * @brief Check that two states are the same up to the rounding of the sums, as well as the L3A computed from them
+ */
+void checkSameState(const StatePixelType &state, const StatePixelType &expected){
+	BOOST_REQUIRE_EQUAL(state.GetSize(), expected.GetSize());
+	for(size_t i = 0; i < state.GetSize(); i++){
+		BOOST_CHECK_SMALL(state[i] - expected[i], 0.01f);
+	}
+	const L3APixelType l3a = toL3A(state);
+	const L3APixelType expectedL3A = toL3A(expected);
+	BOOST_REQUIRE_EQUAL(l3a.GetSize(), expectedL3A.GetSize());
+	for(size_t i = 0; i < l3a.GetSize(); i++){
+		BOOST_CHECK_LE(std::abs(l3a[i] - expectedL3A[i]), 1);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(testLayout){
+	const Functor::SynthesisAccumulatorLayout layout(N_L2A_BANDS);
+	StatePixelType state = add({LAND});
+	BOOST_CHECK_EQUAL(state.GetSize(), N_SYNTHESES * layout.GetNbOfComponents());
+	const std::vector<double> emptyState = layout.GetEmptyState();
+	BOOST_CHECK_EQUAL(emptyState.size(), layout.GetNbOfComponents());
+	// The indexes cover all bands once
+	std::vector<int> indexes = {layout.GetWeightedDateIndex(), layout.GetObservationWeightIndex()};
+	for(int i = 0; i < N_L2A_BANDS; i++){
+		indexes.insert(indexes.end(), {layout.GetWeightIndex(i), layout.GetWeightedReflectanceIndex(i)});
+	}
+	for(int c = 0; c < Functor::SynthesisAccumulatorLayout::FALLBACK_CLASSES_NO; c++){
+		indexes.insert(indexes.end(), {layout.GetFallbackCountIndex(c), layout.GetFallbackDateIndex(c)});
+		for(int i = 0; i < N_L2A_BANDS; i++){
+			indexes.insert(indexes.end(), {layout.GetFallbackReflectanceCountIndex(c, i), layout.GetFallbackReflectanceIndex(c, i)});
+		}
+	}
+	std::sort(indexes.begin(), indexes.end());
+	for(size_t i = 0; i < indexes.size(); i++){
+		BOOST_CHECK_EQUAL(indexes[i], i);
+	}
+	BOOST_CHECK_EQUAL(indexes.size(), layout.GetNbOfComponents());
+}
+
+BOOST_AUTO_TEST_CASE(testRoundTrip){
+	const std::vector<L2A> l2as = {LAND, LAND_PARTIAL, LAND_UNWEIGHTED, CLOUD, WATER, SNOW, NO_DATA};
+	for(const L2A &a : l2as){
+		for(const L2A &b : l2as){
+			// Add A, add B, remove B gives the same as adding A
+			checkSameState(update(add({a, b}), b, true), add({a}));
+			// The order in which the dates were added does not matter
+			checkSameState(update(add({b, a}), b, true), add({a}));
+			// Removing all dates gives back the empty state
+			checkSameState(update(update(add({a, b}), a, true), b, true), add({NO_DATA}));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(testFallback){
+	// Without weighted land, the class observed last is used
+	L3APixelType l3a = toL3A(add({WATER, SNOW}));
+	BOOST_CHECK_EQUAL(l3a[2], IMG_FLG_SNOW);
+	BOOST_CHECK_EQUAL(l3a[1], SNOW.date);
+	BOOST_CHECK_EQUAL(l3a[3], SNOW.refls[0]);
+	// and restored when this date is removed
+	l3a = toL3A(update(add({WATER, SNOW}), SNOW, true));
+	BOOST_CHECK_EQUAL(l3a[2], IMG_FLG_WATER);
+	BOOST_CHECK_EQUAL(l3a[1], WATER.date);
+	BOOST_CHECK_EQUAL(l3a[3], WATER.refls[0]);
+	// Clouds only replace pixels without other observations
+	l3a = toL3A(add({SNOW, CLOUD}));
+	BOOST_CHECK_EQUAL(l3a[2], IMG_FLG_SNOW);
+	l3a = toL3A(update(add({SNOW, CLOUD}), SNOW, true));
+	BOOST_CHECK_EQUAL(l3a[2], IMG_FLG_CLOUD);
+	// Weighted land takes precedence, its weighted date does not depend on the first band being valid
+	l3a = toL3A(add({LAND_PARTIAL, SNOW}));
+	BOOST_CHECK_EQUAL(l3a[2], IMG_FLG_LAND);
+	BOOST_CHECK_EQUAL(l3a[1], LAND_PARTIAL.date);
+	BOOST_CHECK_EQUAL(l3a[3], SNOW.refls[0]);
+	BOOST_CHECK_EQUAL(l3a[4], LAND_PARTIAL.refls[1]);
+	// Without any observation
+	l3a = toL3A(add({NO_DATA}));
+	BOOST_CHECK_EQUAL(l3a[2], IMG_FLG_NO_DATA);
+	BOOST_CHECK_EQUAL(l3a[3], NO_DATA_VALUE);
+}
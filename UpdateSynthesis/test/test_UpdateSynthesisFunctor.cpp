@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2018-2019, Centre National d'Etudes Spatiales (CNES)
+ * All rights reserved
+ *
+ * This file is part of Weighted Average Synthesis Processor (WASP)
+ *
+ * Authors:
+ * - Peter KETTIG <peter.kettig@cnes.fr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * See the LICENSE.md file for more details.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define BOOST_TEST_MODULE UpdateSynthesisFunctor
+#include <boost/test/unit_test.hpp>
+#include "itkVariableLengthVector.h"
+#include "UpdateSynthesisFunctor.h"
+#include "GlobalDefs.h"
+#include <vector>
+
+using namespace ts;
+
+typedef itk::VariableLengthVector<float>								InputPixelType;
+typedef itk::VariableLengthVector<short>								OutputPixelType;
+typedef Functor::UpdateSynthesisFunctor<InputPixelType, OutputPixelType>	UpdateSynthesisFunctorType;
+
+#define N_L2A_BANDS			2
+#define N_SYNTHESIS_BANDS	(N_L2A_BANDS + 3)
+#define L2A_DATE			120
+
+/**
+ * @brief The previous L3A bands of a synthesis: weight, weighted date, reflectances and flag
+ */
+struct PrevL3A{
+	float weight;
+	float date;
+	float refls[N_L2A_BANDS];
+	float flag;
+};
+
+/**
+ * @brief The L2A bands of a pixel: reflectances, cloud, water and snow masks and weight
+ */
+struct L2A{
+	float refls[N_L2A_BANDS];
+	float cloud;
+	float water;
+	float snow;
+	float weight;
+};
+
+UpdateSynthesisFunctorType createFunctor(const std::vector<float> &synthesisWeights){
+	UpdateSynthesisFunctorType functor;
+	functor.Initialize({0, 1}, N_L2A_BANDS, 0, false, true, L2A_DATE, 10000);
+	functor.SetSynthesisWeights(synthesisWeights);
+	return functor;
+}
+
+/**
+ * @brief Create the input pixel from the L2A bands and the previous L3A bands of each synthesis
+ */
+InputPixelType createInput(const L2A &l2a, const std::vector<PrevL3A> &prevL3As){
+	std::vector<float> values(l2a.refls, l2a.refls + N_L2A_BANDS);
+	values.insert(values.end(), {l2a.cloud, l2a.water, l2a.snow, l2a.weight});
+	for(const PrevL3A &prev : prevL3As){
+		values.insert(values.end(), {prev.weight, prev.date});
+		values.insert(values.end(), prev.refls, prev.refls + N_L2A_BANDS);
+		values.push_back(prev.flag);
+	}
+	InputPixelType pixel(values.size());
+	for(size_t i = 0; i < values.size(); i++){
+		pixel[i] = values[i];
+	}
+	return pixel;
+}
+
+/**
+ * @brief Check that the bands of a synthesis in a multi-synthesis output equal the output of a single synthesis
+ */
+void checkSynthesis(const OutputPixelType &multi, const size_t &synthesis, const OutputPixelType &single){
+	BOOST_REQUIRE_EQUAL(single.GetSize(), N_SYNTHESIS_BANDS);
+	for(size_t i = 0; i < N_SYNTHESIS_BANDS; i++){
+		BOOST_CHECK_EQUAL(multi[synthesis * N_SYNTHESIS_BANDS + i], single[i]);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(testWeightOnDate){
+	// The weight only drops to its minimum from the half synthesis period on
+	BOOST_CHECK_EQUAL(computeWeightOnDate(0, 15, 0.5), 1);
+	BOOST_CHECK_EQUAL(computeWeightOnDate(14, 15, 0.5), 1);
+	BOOST_CHECK_EQUAL(computeWeightOnDate(15, 15, 0.5), 0.5);
+	BOOST_CHECK_EQUAL(computeWeightOnDate(-15, 15, 0.5), 0.5);
+	// Without half synthesis period, the date is not weighted
+	BOOST_CHECK_EQUAL(computeWeightOnDate(100, 0, 0.5), 1);
+
+	// Acquisitions beyond the half synthesis period are not part of the synthesis
+	BOOST_CHECK_EQUAL(computeSynthesisWeight(15, 15, 0.5), 0.5);
+	BOOST_CHECK_EQUAL(computeSynthesisWeight(16, 15, 0.5), 0);
+	BOOST_CHECK_EQUAL(computeSynthesisWeight(-16, 15, 0.5), 0);
+	BOOST_CHECK_EQUAL(computeSynthesisWeight(100, 0, 0.5), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testTwoSynthesesMatchSingleRuns){
+	const std::vector<float> weights = {0.5, 0.25};
+	const std::vector<PrevL3A> prevL3As = {
+			{400, 100, {300, 600}, IMG_FLG_LAND},
+			{0, NO_DATA_VALUE, {NO_DATA_VALUE, NO_DATA_VALUE}, IMG_FLG_NO_DATA}};
+	const std::vector<L2A> l2as = {
+			{{500, 800}, 0, 0, 0, 0.8f},	// Land
+			{{500, 800}, 1, 0, 0, 0.8f},	// Cloud
+			{{500, 800}, 0, 1, 0, 0.8f},	// Water
+			{{500, 800}, 0, 0, 1, 0.8f},	// Snow
+			{{NO_DATA_VALUE, NO_DATA_VALUE}, 0, 0, 0, 0}};	// No data
+	UpdateSynthesisFunctorType multiFunctor = createFunctor(weights);
+	BOOST_CHECK_EQUAL(multiFunctor.GetNbOfOutputComponents(), 2 * N_SYNTHESIS_BANDS);
+	UpdateSynthesisFunctorType singleFunctor = createFunctor({1});
+	for(const L2A &l2a : l2as){
+		const OutputPixelType multi = multiFunctor(createInput(l2a, prevL3As));
+		BOOST_REQUIRE_EQUAL(multi.GetSize(), 2 * N_SYNTHESIS_BANDS);
+		for(size_t k = 0; k < weights.size(); k++){
+			// A single synthesis of an L2A whose weight is already scaled by the weight on date
+			L2A scaled = l2a;
+			scaled.weight = l2a.weight * weights[k];
+			checkSynthesis(multi, k, singleFunctor(createInput(scaled, {prevL3As[k]})));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(testOutsideOfSynthesisPeriod){
+	// An L2A outside of the period of a synthesis keeps its previous values
+	const PrevL3A prevL3A = {400, 100, {300, 600}, IMG_FLG_LAND};
+	UpdateSynthesisFunctorType functor = createFunctor({1, 0});
+	for(const L2A &l2a : {L2A{{500, 800}, 0, 0, 0, 0.8f}, L2A{{500, 800}, 1, 0, 0, 0.8f}, L2A{{500, 800}, 0, 0, 1, 0.8f}}){
+		const OutputPixelType out = functor(createInput(l2a, {prevL3A, prevL3A}));
+		BOOST_CHECK_EQUAL(out[N_SYNTHESIS_BANDS], prevL3A.weight);
+		BOOST_CHECK_EQUAL(out[N_SYNTHESIS_BANDS + 1], prevL3A.date);
+		BOOST_CHECK_EQUAL(out[N_SYNTHESIS_BANDS + 2], prevL3A.flag);
+		for(size_t i = 0; i < N_L2A_BANDS; i++){
+			BOOST_CHECK_LE(std::abs(out[N_SYNTHESIS_BANDS + 3 + i] - prevL3A.refls[i]), 1);
+		}
+	}
+}
@@ -27,6 +27,9 @@
 #include "otbWrapperApplicationFactory.h"
 #include "TotalWeightComputation.h"
 #include "MetadataHelperFactory.h"
+#include "StreamingAlignment.h"
+#include "RegionOfInterest.h"
+#include "PerformanceTelemetry.h"
 
 /**
  * @brief otb Namespace for all OTB-related Filters and Applications
@@ -82,10 +85,12 @@ private:
     SetParameterDescription("wcldfile", "The file name of the image containing the cloud weigth for each pixel.");
 
     AddParameter(ParameterType_String, "l3adate", "L3A date");
-    SetParameterDescription("l3adate", "The L3A date in the format YYYYMMDDD");
+    SetParameterDescription("l3adate", "The L3A date in the format YYYYMMDDD. If not set, the date is not weighted, e.g. when UpdateSynthesis applies the weight on date of several synthesis dates itself.");
+    MandatoryOff("l3adate");
 
     AddParameter(ParameterType_Int, "halfsynthesis", "Delta max");
     SetParameterDescription("halfsynthesis", "Half synthesis period expressed in days.");
+    MandatoryOff("halfsynthesis");
 
     AddParameter(ParameterType_Float, "wdatemin", "Minimum date weight");
     SetParameterDescription("wdatemin", "Minimum weight at edge of synthesis time window.");
@@ -95,6 +100,10 @@ private:
     AddParameter(ParameterType_OutputImage, "out", "Output Total Weight Image");
     SetParameterDescription("out","The output image containg the computed total weight for each pixel.");
 
+    AddParameter(ParameterType_StringList, "roi", "Region of interest");
+    SetParameterDescription("roi", "Extent xmin ymin xmax ymax in the map coordinates of the weight images. The output is cropped to the pixels whose centre lies within it");
+    MandatoryOff("roi");
+
     AddRAMParameter();
 
     // Doc example parameter settings
@@ -105,6 +114,7 @@ private:
     SetDocExampleParameterValue("halfsynthesis", "50");
     SetDocExampleParameterValue("wdatemin", "0.10");
     SetDocExampleParameterValue("out", "apTotalWeightOutput.tif");
+    SetDocExampleParameterValue("roi", "300000 4890240 354900 4945140");
   }
 
   void DoUpdateParameters()
@@ -113,6 +123,7 @@ private:
 
   void DoExecute()
   {
+    m_Telemetry.Start(this);
     // Get the input image list
     std::string inXml = GetParameterString("xml");
     if (inXml.empty())
@@ -121,10 +132,11 @@ private:
     }
 
     auto factory = MetadataHelperFactory::New();
-    auto pHelper = factory->GetMetadataHelper(inXml);
+    auto pHelper = factory->GetMetadataHelper(inXml, MTD_CONTENT_PRODUCT);
     std::string l2aDate = pHelper->GetAcquisitionDate();
-    std::string l3aDate = GetParameterString("l3adate");
-    int halfSynthesis = GetParameterInt("halfsynthesis");
+    // Without synthesis date, the acquisition is weighted as if it was acquired on it
+    std::string l3aDate = HasValue("l3adate") ? GetParameterString("l3adate") : l2aDate;
+    int halfSynthesis = HasValue("halfsynthesis") ? GetParameterInt("halfsynthesis") : 0;
     float weightOnDateMin = GetParameterFloat("wdatemin");
 
     std::string inAotFileName = GetParameterString("waotfile");
@@ -144,11 +156,20 @@ private:
     m_totalWeightComputation.SetAotWeightFile(inAotFileName);
     m_totalWeightComputation.SetCloudsWeightFile(inCloudFileName);
 
+    if(HasValue("roi")){
+        m_RegionOfInterest.SetRegionOfInterest(RegionOfInterest::FromStringList(GetParameterStringList("roi")));
+    }
+
     // Set the output image
-    SetParameterOutputImage("out", m_totalWeightComputation.GetOutputImageSource()->GetOutput());
+    SetParameterOutputImage("out", m_RegionOfInterest.Extract(m_totalWeightComputation.GetOutputImageSource()->GetOutput()).GetPointer());
+    // Stream along the blocks of both weight images, so that each of them is decoded once
+    SetParameterString("out", ts::StreamingAlignment::AlignOutput(GetParameterString("out"), {inAotFileName, inCloudFileName}, GetParameterInt("ram"),
+        m_RegionOfInterest.GetRegionOfInterest(), this->GetLogger()));
   }
 
   TotalWeightComputation m_totalWeightComputation;
+  RegionOfInterestExtractor m_RegionOfInterest;
+  PerformanceTelemetry m_Telemetry;
 };
 
 } // namespace Wrapper
@@ -51,14 +51,7 @@ void TotalWeightComputation::SetDates(std::string& L2ADate, std::string& L3ADate
     std::cout << "L2ADate: " << L2ADate << std::endl;
     std::cout << "L3ADate: " << L3ADate << std::endl;
 
-    struct tm tmTime = {};
-    strptime(L2ADate.c_str(), "%Y%m%d", &tmTime);
-    time_t ttL2ATime = mktime(&tmTime);
-    strptime(L3ADate.c_str(), "%Y%m%d", &tmTime);
-    time_t ttL3ATime = mktime(&tmTime);
-    double seconds = fabs(difftime(ttL2ATime, ttL3ATime));
-    // compute the time difference as the number of days
-    m_nDaysTimeInterval = (int)(seconds / (3600 *24));
+    m_nDaysTimeInterval = getDaysBetween(L2ADate, L3ADate);
     std::cout << "Days: " << m_nDaysTimeInterval << std::endl;
 }
 
@@ -126,7 +119,7 @@ void TotalWeightComputation::ComputeWeightOnDate()
     //std::cout << "\tm_nDaysTimeInterval: " << m_nDaysTimeInterval << std::endl;
     //std::cout << "\tm_nDeltaMax : " << m_nDeltaMax << std::endl;
     //std::cout << "\tm_fWeightOnDateMin : " << m_fWeightOnDateMin << std::endl;
-    m_fWeightOnDate = 1 - (abs(m_nDaysTimeInterval)/m_nDeltaMax) * (1-m_fWeightOnDateMin);
+    m_fWeightOnDate = computeWeightOnDate(m_nDaysTimeInterval, m_nDeltaMax, m_fWeightOnDateMin);
 }
 
 void TotalWeightComputation::ComputeTotalWeight()
@@ -28,6 +28,9 @@
 
 #include "WeightAOTComputation.h"
 #include "MetadataHelperFactory.h"
+#include "StreamingAlignment.h"
+#include "RegionOfInterest.h"
+#include "PerformanceTelemetry.h"
 
 /**
  * @brief otb Namespace for all OTB-related Filters and Applications
@@ -40,6 +43,8 @@ namespace otb
 namespace Wrapper
 {
 
+using namespace ts;
+
 /**
  * @brief Calculate the AOT-weight from a given AOT-mask
  */
@@ -88,6 +93,10 @@ private:
     AddParameter(ParameterType_Float, "aotmax", "AOTMax");
     SetParameterDescription("aotmax", "maximum value of the linear range for weights w.r.t AOT");
 
+    AddParameter(ParameterType_StringList, "roi", "Region of interest");
+    SetParameterDescription("roi", "Extent xmin ymin xmax ymax in the map coordinates of the input. The output is cropped to the pixels whose centre lies within it");
+    MandatoryOff("roi");
+
     AddRAMParameter();
 
     // Doc example parameter settings
@@ -97,6 +106,7 @@ private:
     SetDocExampleParameterValue("waotmax", "1");
     SetDocExampleParameterValue("aotmax", "50");
     SetDocExampleParameterValue("out", "apAOTWeightOutput.tif");
+    SetDocExampleParameterValue("roi", "300000 4890240 354900 4945140");
   }
 
   void DoUpdateParameters()
@@ -105,6 +115,7 @@ private:
 
   void DoExecute()
   {
+    m_Telemetry.Start(this);
     // Get the input image list
     std::string inImgStr = GetParameterString("in");
     if (inImgStr.empty())
@@ -124,18 +135,27 @@ private:
 
     m_weightOnAot.SetInputFileName(inImgStr);
     auto factory = ts::MetadataHelperFactory::New();
-    auto pHelper = factory->GetMetadataHelper(inMetadataXml);
+    auto pHelper = factory->GetMetadataHelper(inMetadataXml, ts::MTD_CONTENT_PRODUCT);
     float fAotQuantificationVal = pHelper->GetAotQuantificationValue();
     // the bands in XML are 1 based
     int nBand = 0;//pHelper->GetAotBandIndex()-1;
     std::cout << "fAotQuantificationVal " << fAotQuantificationVal << std::endl;
     m_weightOnAot.Initialize(nBand, fAotQuantificationVal, fAotMax, fWaotMin, fWaotMax);
 
+    if(HasValue("roi")){
+        m_RegionOfInterest.SetRegionOfInterest(ts::RegionOfInterest::FromStringList(GetParameterStringList("roi")));
+    }
+
     // Set the output image
-    SetParameterOutputImage("out", m_weightOnAot.GetOutputImageSource()->GetOutput());
+    SetParameterOutputImage("out", m_RegionOfInterest.Extract(m_weightOnAot.GetOutputImageSource()->GetOutput()).GetPointer());
+    // Stream along the blocks of the AOT image, so that each of them is decoded once
+    SetParameterString("out", ts::StreamingAlignment::AlignOutput(GetParameterString("out"), {inImgStr}, GetParameterInt("ram"),
+        m_RegionOfInterest.GetRegionOfInterest(), this->GetLogger()));
   }
 
   ts::WeightOnAOT m_weightOnAot;
+  ts::RegionOfInterestExtractor m_RegionOfInterest;
+  PerformanceTelemetry m_Telemetry;
 };
 
 } // namespace Wrapper
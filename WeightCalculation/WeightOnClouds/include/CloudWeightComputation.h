@@ -31,6 +31,7 @@
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 #include "GlobalDefs.h"
+#include "FootprintFunctorImageFilter.h"
 
 /**
  * @brief The TemporalSynthesis namespace, covering all needed functions to execute this processing chain
@@ -84,7 +85,7 @@ class CloudWeightComputation
 {
 public:
 	//typedef otb::Wrapper::FloatImageType ImageType;
-	typedef itk::BinaryFunctorImageFilter< TInput, TInput, TOutput,
+	typedef FootprintBinaryFunctorImageFilter< TInput, TInput, TOutput,
 			Functor::WeightOnCloudsCalculation<typename TOutput::PixelType> > FilterType;
 	typedef otb::ImageFileReader<TInput> ReaderType;
 	typedef otb::ImageFileWriter<TOutput> WriterType;
@@ -137,6 +138,12 @@ public:
 
 	void SetOutputFileName(std::string &outFile) { m_outputFileName = outFile; }
 
+	/**
+	 * @brief Only compute the weight within the valid footprint of the product, the rest is set to no-data
+	 * @param footprint The footprint, or a null pointer to compute the full extent
+	 */
+	void SetFootprint(const ValidFootprint::ConstPointer &footprint) { m_footprint = footprint; }
+
 	const char *GetNameOfClass() { return "CloudWeightComputation";}
 	typename OutImageSource::Pointer GetOutputImageSource() {
 		BuildOutputImageSource();
@@ -191,12 +198,15 @@ private:
 		m_filter = FilterType::New();
 		m_filter->SetInput1(m_inputReader1->GetOutput());
 		m_filter->SetInput2(m_inputReader2->GetOutput());
+		m_filter->SetFootprint(m_footprint);
+		m_filter->SetOutsideValue(NO_DATA_VALUE);
 	}
 
 	typename ImageSource::Pointer m_inputReader1;
 	typename ImageSource::Pointer m_inputReader2;
 	std::string m_outputFileName;
 	typename FilterType::Pointer m_filter;
+	ValidFootprint::ConstPointer m_footprint;
 };
 } //namespace ts
 #endif // WEIGHTONCLOUDS_H
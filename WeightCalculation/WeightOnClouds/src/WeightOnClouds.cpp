@@ -33,6 +33,11 @@
 #include "GaussianFilter.h"
 #include "PaddingImageHandler.h"
 #include "MetadataHelperFactory.h"
+#include "StreamingAlignment.h"
+#include "RegionOfInterest.h"
+#include "PerformanceTelemetry.h"
+#include "itkGaussianOperator.h"
+#include "itkRegionOfInterestImageFilter.h"
 
 /**
  * @brief otb Namespace for all OTB-related Filters and Applications
@@ -104,6 +109,15 @@ private:
 		SetParameterDescription("cut", "Cut the oversampled images coming out of the Cloud detection to fit the original size again");
 		MandatoryOff("cut");
 
+		AddParameter(ParameterType_String, "xml", "L2A product metadata");
+		SetParameterDescription("xml", "If set, the weight is only computed within the valid footprint given by the edge mask of the product, the rest is set to no-data");
+		MandatoryOff("xml");
+
+		AddParameter(ParameterType_StringList, "roi", "Region of interest");
+		SetParameterDescription("roi", "Extent xmin ymin xmax ymax in the map coordinates of the cloud mask. The output is cropped to the pixels whose centre lies within it. "
+				"The cloud mask has to cover the full tile: Only the part around the extent needed by the Gaussian filters is read.");
+		MandatoryOff("roi");
+
 	    AddRAMParameter();
 
 		// Doc example parameter settings
@@ -114,6 +128,8 @@ private:
 		SetDocExampleParameterValue("kernelwidth", "81");
 		SetDocExampleParameterValue("out", "apAOTWeightOutput.tif");
 		SetDocExampleParameterValue("cut", "0");
+		SetDocExampleParameterValue("xml", "/path/to/L2Aproduct_muscate.xml");
+		SetDocExampleParameterValue("roi", "300000 4890240 354900 4945140");
 
 	}
 
@@ -123,6 +139,7 @@ private:
 
 	void DoExecute()
 	{
+		m_Telemetry.Start(this);
 		bool bRoiCutOversampledImgs = true;
 		if(HasValue("cut")){
 			bRoiCutOversampledImgs = GetParameterInt("cut") > 0 ? true : false;
@@ -145,8 +162,14 @@ private:
 		long inImageWidth, inImageHeight;
 
 		m_cloudMaskBinarization.SetInputFileName(inCldFileName);
+		itk::ImageSource<FloatImageType>::Pointer cloudMask = m_cloudMaskBinarization.GetOutputImageSource();
+		if(HasValue("roi")){
+			m_RegionOfInterest.SetRegionOfInterest(RegionOfInterest::FromStringList(GetParameterStringList("roi")));
+			std::cout << "Region of interest: " << m_RegionOfInterest.GetRegionOfInterest().ToString() << std::endl;
+			cloudMask = cropToHalo(cloudMask, coarseResolution, std::max(sigmaSmallCloud, sigmaLargeCloud), gaussianKernelWidth);
+		}
 
-		m_underSampler.SetInputImageReader(m_cloudMaskBinarization.GetOutputImageSource());
+		m_underSampler.SetInputImageReader(cloudMask);
 		m_underSampler.SetOutputResolution(coarseResolution);
 		m_underSampler.SetInputResolution(inputCloudMaskResolution);
 		if(inputCloudMaskResolution == -1) {
@@ -156,7 +179,7 @@ private:
 		m_underSampler.SetBicubicInterpolatorRadius(2*(coarseResolution/inputCloudMaskResolution));
 		m_underSampler.GetInputImageDimension(inImageWidth, inImageHeight);
 
-		m_padding1.SetInputImageReader(m_cloudMaskBinarization.GetOutputImageSource(), m_underSampler.GetOutputImageSource());
+		m_padding1.SetInputImageReader(cloudMask, m_underSampler.GetOutputImageSource());
 
 		m_cloudMaskBinarization2.SetInputImageReader(m_padding1.GetOutputImageSource());
 		m_cloudMaskBinarization2.SetThreshold(0.5f);
@@ -207,8 +230,14 @@ private:
 			m_cloudWeightComputation.SetInputImageReader1(m_padding2.GetOutputImageSource());
 			m_cloudWeightComputation.SetInputImageReader2(m_padding3.GetOutputImageSource());
 		}
+		// Restrict the computation to the valid footprint of the product if known
+		if(HasValue("xml")){
+			auto factory = MetadataHelperFactory::New();
+			auto pHelper = factory->GetMetadataHelper(GetParameterAsString("xml"), MTD_CONTENT_PRODUCT);
+			m_cloudWeightComputation.SetFootprint(ValidFootprint::GetFootprint(pHelper.get()));
+		}
 		// Set the output image
-		SetParameterOutputImage("out", m_cloudWeightComputation.GetOutputImageSource()->GetOutput());
+		SetParameterOutputImage("out", m_RegionOfInterest.Extract(m_cloudWeightComputation.GetOutputImageSource()->GetOutput()).GetPointer());
 
 		// write debug infos if needed
 		if(bWriteDebugFiles) {
@@ -273,8 +302,69 @@ private:
 
 			}
 		}
+		// Stream along the blocks of the cloud mask, so that each of them is decoded once
+		SetParameterString("out", ts::StreamingAlignment::AlignOutput(GetParameterString("out"), {inCldFileName}, GetParameterInt("ram"),
+				m_RegionOfInterest.GetRegionOfInterest(), this->GetLogger()));
+	}
+
+	/**
+	 * @brief Crop the cloud mask to the region of interest and the margin around it needed to compute the weight within it.
+	 * The margin covers the support of the Gaussian filters and of both resamplers at the coarse resolution,
+	 * thus the weight within the region of interest is the same as for the full cloud mask.
+	 * @param cloudMask The binarized cloud mask of the full tile
+	 * @param coarseResolution The coarse resolution the Gaussian filters are applied at
+	 * @param sigma The largest sigma of the Gaussian filters, in coarse pixels
+	 * @param kernelWidth The maximum kernel width of the Gaussian filters
+	 * @return The cropped cloud mask
+	 */
+	itk::ImageSource<FloatImageType>::Pointer cropToHalo(itk::ImageSource<FloatImageType>::Pointer cloudMask, int coarseResolution, float sigma, int kernelWidth){
+		FloatImageType::Pointer mask = cloudMask->GetOutput();
+		mask->UpdateOutputInformation();
+		const long nFactor = std::max<long>(1, coarseResolution / std::max<int>(1, std::abs(mask->GetSpacing()[0])));
+		// Gaussian kernel, plus the BCO radius of the undersampling and oversampling, plus one coarse pixel for the rounding
+		const long nMargin = getGaussianRadius(sigma, kernelWidth) + 2 + 2 + 1;
+		const RegionOfInterest::RegionType largest = mask->GetLargestPossibleRegion();
+		RegionOfInterest::RegionType region = m_RegionOfInterest.GetRegionOfInterest().GetRegion(mask);
+		for(unsigned int dim = 0; dim < 2; dim++){
+			// Snap to the coarse pixels of the full mask, so that the undersampled pixels are the same
+			const long first = largest.GetIndex(dim);
+			const long roiStart = region.GetIndex(dim) - first;
+			const long roiEnd = roiStart + long(region.GetSize(dim));
+			const long start = std::max<long>(0, (roiStart / nFactor - nMargin) * nFactor);
+			const long end = std::min<long>(long(largest.GetSize(dim)), ((roiEnd + nFactor - 1) / nFactor + nMargin) * nFactor);
+			region.SetIndex(dim, first + start);
+			region.SetSize(dim, end - start);
+		}
+		std::cout << "Reading the cloud mask with a margin of " << nMargin << " pixels at " << coarseResolution << "m: "
+				<< region.GetSize(0) << "x" << region.GetSize(1) << " pixels at " << region.GetIndex(0) << " " << region.GetIndex(1) << std::endl;
+		m_haloCrop = HaloCropFilterType::New();
+		m_haloCrop->SetInput(mask);
+		m_haloCrop->SetRegionOfInterest(region);
+		return m_haloCrop.GetPointer();
 	}
 
+	/**
+	 * @brief Get the radius of the kernel the Gaussian filter uses for the given sigma
+	 * @param sigma The sigma in pixels
+	 * @param kernelWidth The maximum kernel width
+	 * @return The radius in pixels
+	 */
+	long getGaussianRadius(float sigma, int kernelWidth){
+		itk::GaussianOperator<float, 2> gaussianOperator;
+		gaussianOperator.SetDirection(0);
+		gaussianOperator.SetVariance(sigma * sigma);
+		// Default of the itk::DiscreteGaussianImageFilter used by the GaussianFilter
+		gaussianOperator.SetMaximumError(0.01);
+		gaussianOperator.SetMaximumKernelWidth(kernelWidth);
+		gaussianOperator.CreateDirectional();
+		return gaussianOperator.GetRadius(0);
+	}
+
+	typedef itk::RegionOfInterestImageFilter<FloatImageType, FloatImageType> HaloCropFilterType;
+	HaloCropFilterType::Pointer m_haloCrop;
+	RegionOfInterestExtractor m_RegionOfInterest;
+	PerformanceTelemetry m_Telemetry;
+
 	CloudsInterpolation<otb::Wrapper::FloatImageType, otb::Wrapper::FloatImageType> m_underSampler;
 	CloudMaskBinarization<otb::Wrapper::FloatImageType, otb::Wrapper::FloatImageType> m_cloudMaskBinarization;
 	CloudMaskBinarization<otb::Wrapper::FloatImageType, otb::Wrapper::FloatImageType> m_cloudMaskBinarization2;